@@ -1,6 +1,7 @@
 #pragma once
 
 #include "types.hpp"
+#include "resampler.hpp"
 #include <memory>
 #include <functional>
 #include <chrono>
@@ -13,7 +14,8 @@ enum class AudioEngineError {
     BUFFER_UNDERRUN = 2,
     THREADING_ERROR = 3,
     DIRECTSOUND_FAILURE = 4,
-    CALLBACK_TIMEOUT = 5
+    CALLBACK_TIMEOUT = 5,
+    DEVICE_FAILURE = 6
 };
 
 struct CompletionResult {
@@ -25,6 +27,31 @@ struct CompletionResult {
 
 using CompletionCallback = std::function<void(const CompletionResult&)>;
 
+enum class AudioEngineEventType {
+    COMPLETION,
+    XRUN,
+    POSITION,
+    DEVICE_LOST,
+    DEVICE_RESTORED,
+    CAPTURE_OVERFLOW
+};
+
+// Plain data so the audio thread can publish events without allocating
+struct AudioEngineEvent {
+    AudioEngineEventType type = AudioEngineEventType::POSITION;
+    AudioEngineError error_code = AudioEngineError::SUCCESS;
+    std::chrono::milliseconds completion_time{0};
+    size_t samples_processed = 0;
+    size_t frames_played = 0;
+    size_t frames_dropped = 0;  // CAPTURE_OVERFLOW: total frames the capture has lost
+    int sample_rate = 0;
+};
+
+using AudioEngineEventCallback = std::function<void(const AudioEngineEvent&)>;
+
+class IPcmDevice;
+struct PcmRecoveryPolicy;
+
 class IAudioEngine {
 public:
     virtual ~IAudioEngine() = default;
@@ -42,8 +69,24 @@ public:
     
     // New callback-based completion detection
     virtual void set_completion_callback(CompletionCallback callback) = 0;
+    virtual void set_event_callback(AudioEngineEventCallback callback) = 0;
     virtual void signal_eof() = 0;
     virtual size_t get_buffered_samples() const = 0;
+    
+    // Frames of the current track the device has actually played since start(),
+    // counted at the track's sample rate. This is the playback clock.
+    virtual uint64_t get_played_frames() const = 0;
+    
+    // Sample-rate conversion used when the device rate differs from the file rate
+    virtual void set_resampler_quality(ResamplerQuality quality) = 0;
+    
+    // Rate to open the output device at; every track is converted to the rate
+    // the device settles on. Takes effect the next time the device is opened.
+    virtual void set_device_rate(int sample_rate) = 0;
+    
+    // Records what is played to a WAV file or named pipe; an empty path stops it.
+    // Returns false if the backend can't capture.
+    virtual bool set_capture_path(const std::string& path) = 0;
 };
 
 class DirectSoundEngine : public IAudioEngine {
@@ -69,8 +112,14 @@ public:
     
     // New callback-based completion detection
     void set_completion_callback(CompletionCallback callback) override;
+    void set_event_callback(AudioEngineEventCallback callback) override;
     void signal_eof() override;
     size_t get_buffered_samples() const override;
+    uint64_t get_played_frames() const override;
+    
+    void set_resampler_quality(ResamplerQuality quality) override;
+    void set_device_rate(int sample_rate) override;
+    bool set_capture_path(const std::string& path) override;
 };
 
 class AlsaAudioEngine : public IAudioEngine {
@@ -80,6 +129,8 @@ private:
 
 public:
     AlsaAudioEngine();
+    explicit AlsaAudioEngine(std::unique_ptr<IPcmDevice> device);
+    AlsaAudioEngine(std::unique_ptr<IPcmDevice> device, const PcmRecoveryPolicy& recovery_policy);
     ~AlsaAudioEngine() override;
 
     bool initialize(const AudioFormat& format) override;
@@ -96,8 +147,14 @@ public:
     
     // New callback-based completion detection
     void set_completion_callback(CompletionCallback callback) override;
+    void set_event_callback(AudioEngineEventCallback callback) override;
     void signal_eof() override;
     size_t get_buffered_samples() const override;
+    uint64_t get_played_frames() const override;
+    
+    void set_resampler_quality(ResamplerQuality quality) override;
+    void set_device_rate(int sample_rate) override;
+    bool set_capture_path(const std::string& path) override;
 };
 
 std::unique_ptr<IAudioEngine> create_audio_engine();
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+namespace nigamp {
+
+// Little-endian fields, as the session snapshot, library index and WAV headers store them
+void put_u16(std::string& out, uint16_t value);
+void put_u32(std::string& out, uint32_t value);
+void put_u64(std::string& out, uint64_t value);
+uint32_t get_u32(const unsigned char* data);
+uint64_t get_u64(const unsigned char* data);
+
+// Renames a finished temporary file over path, replacing it on every platform.
+// The temporary is removed if that fails.
+bool replace_file(const std::string& temp_path, const std::string& path);
+
+// Writes the parts in order to path + ".tmp" and replaces path with it, so a
+// crash mid-write leaves the previous file intact
+bool write_file_atomically(const std::string& path, std::initializer_list<std::string_view> parts);
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "event_loop.hpp"
+#include "player_command.hpp"
+#include "types.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace nigamp {
+
+struct PlayerStatus {
+    PlaybackState state{PlaybackState::STOPPED};
+    double position{0.0};   // Seconds
+    double duration{0.0};   // Seconds, 0 if unknown
+    float volume{0.0f};
+    uint32_t index{0};      // Position in the play order
+    uint32_t playlist_size{0};
+    std::string title;
+};
+
+// Binary frames are a 4-byte big-endian length (of opcode plus payload), an
+// opcode byte and the payload. Numbers in payloads are little-endian; SEEK and
+// VOLUME carry an f64 delta, ENQUEUE and EXPORT a path. Every request is answered with
+// ACK (echoing the request opcode), STATUS_REPORT or ERROR (a message).
+// Frames are capped far below 16 MiB, so a binary stream always starts with
+// 0x00; a connection whose first byte is '{' speaks line-delimited JSON.
+enum class ControlOpcode : uint8_t {
+    PING = 0x01,
+    PAUSE_RESUME = 0x02,
+    NEXT = 0x03,
+    PREVIOUS = 0x04,
+    SEEK = 0x05,
+    VOLUME = 0x06,
+    ENQUEUE = 0x07,
+    STATUS = 0x08,
+    SUBSCRIBE = 0x09,
+    UNSUBSCRIBE = 0x0A,
+    QUIT = 0x0B,
+    EXPORT = 0x0C,
+
+    ACK = 0x80,
+    STATUS_REPORT = 0x81,
+    ERROR = 0x82
+};
+
+static constexpr size_t CONTROL_MAX_FRAME = 64 * 1024;
+
+std::string encode_control_frame(ControlOpcode opcode, const std::string& payload = "");
+// Returns the bytes consumed from the front of data, 0 if the frame is not
+// complete yet, or SIZE_MAX if the stream is malformed.
+size_t decode_control_frame(const char* data, size_t size, ControlOpcode& opcode, std::string& payload);
+
+std::string encode_f64(double value);
+bool decode_f64(const std::string& payload, double& value);
+
+std::string encode_status(const PlayerStatus& status);
+bool decode_status(const std::string& payload, PlayerStatus& status);
+std::string status_to_json(const PlayerStatus& status);
+
+// Maps a request to the player command it stands for; false for requests the
+// server answers itself (ping, status, subscriptions) or malformed payloads.
+bool control_request_to_command(ControlOpcode opcode, const std::string& payload, PlayerCommand& command);
+
+// Parses {"cmd":"seek","seconds":-10}-style lines into a binary request
+bool parse_json_request(const std::string& line, ControlOpcode& opcode, std::string& payload);
+
+// Serves the control socket from the player's event loop: no thread per
+// client, every socket is non-blocking. Commands are handed to the player as
+// PlayerCommands; subscribers get a status report every STATUS_INTERVAL_MS and
+// whenever publish_status() is called. A client that stops reading is dropped
+// once its unsent output passes a cap rather than ever blocking the loop.
+class ControlServer {
+public:
+    using CommandHandler = std::function<void(const PlayerCommand&)>;
+    using StatusProvider = std::function<PlayerStatus()>;
+
+    static constexpr int STATUS_INTERVAL_MS = 500;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+
+public:
+    explicit ControlServer(IEventLoop& loop);
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    // Binds a Unix-domain socket at path, replacing a stale one. Call on the loop
+    // thread. Both callbacks run on the loop and must not stop the server.
+    bool start(const std::string& path, CommandHandler on_command, StatusProvider get_status);
+    void stop();
+    bool is_running() const;
+
+    void publish_status();
+    size_t client_count() const;
+};
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "audio_engine.hpp"
+#include <functional>
+#include <memory>
+
+namespace nigamp {
+
+// Delivers audio engine events on a dedicated thread, in the order they were
+// posted. Posting only pushes into a lock-free ring, so a slow user callback
+// can never stall audio output. Posts must come from one thread at a time.
+class EngineEventDispatcher {
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+
+public:
+    using Handler = std::function<void(const AudioEngineEvent&)>;
+
+    explicit EngineEventDispatcher(Handler handler, size_t capacity = 256);
+    ~EngineEventDispatcher();
+
+    // Returns false (and counts a drop) if the queue is full
+    bool post(const AudioEngineEvent& event);
+
+    // For one-shot events that must never be lost, such as COMPLETION: kept in
+    // a single slot outside the queue and handled after everything posted
+    // before it. Returns false only if the previous one is still unhandled.
+    bool post_reserved(const AudioEngineEvent& event);
+
+    // Blocks until every event posted so far has been handled
+    void flush();
+
+    size_t get_dropped_count() const;
+};
+
+}
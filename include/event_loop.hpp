@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+
+namespace nigamp {
+
+// Single-threaded reactor: fd readiness, timers, signals and tasks posted
+// from other threads all run on the thread that calls run(). Registration
+// calls belong on that thread (or before run()); post() and stop() are safe
+// from anywhere. Once stopped, run() returns immediately.
+class IEventLoop {
+public:
+    using Callback = std::function<void()>;
+    using TimerId = int;
+    static constexpr TimerId INVALID_TIMER = -1;
+
+    virtual ~IEventLoop() = default;
+
+    // Level-triggered: the callback runs while the fd stays readable
+    virtual bool add_fd(int fd, Callback on_readable) = 0;
+    virtual void remove_fd(int fd) = 0;
+
+    // Also runs on_writable while an added fd stays writable; an empty
+    // callback stops watching for writability
+    virtual bool watch_writable(int fd, Callback on_writable) = 0;
+
+    virtual TimerId add_timer(std::chrono::milliseconds interval, Callback callback, bool repeat) = 0;
+    virtual void cancel_timer(TimerId id) = 0;
+
+    // Delivers the signal as a loop callback. Call before other threads are
+    // started so they inherit the blocked signal mask.
+    virtual bool watch_signal(int signal_number, Callback callback) = 0;
+
+    virtual void post(Callback task) = 0;
+    virtual void run() = 0;
+    virtual void stop() = 0;
+};
+
+// epoll + timerfd + eventfd + signalfd (Linux)
+class EpollEventLoop : public IEventLoop {
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+
+public:
+    EpollEventLoop();
+    ~EpollEventLoop() override;
+
+    bool add_fd(int fd, Callback on_readable) override;
+    void remove_fd(int fd) override;
+    bool watch_writable(int fd, Callback on_writable) override;
+    TimerId add_timer(std::chrono::milliseconds interval, Callback callback, bool repeat) override;
+    void cancel_timer(TimerId id) override;
+    bool watch_signal(int signal_number, Callback callback) override;
+    void post(Callback task) override;
+    void run() override;
+    void stop() override;
+};
+
+// Condition-variable loop for platforms without epoll; fds and signals are unsupported
+class PortableEventLoop : public IEventLoop {
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+
+public:
+    PortableEventLoop();
+    ~PortableEventLoop() override;
+
+    bool add_fd(int fd, Callback on_readable) override;
+    void remove_fd(int fd) override;
+    bool watch_writable(int fd, Callback on_writable) override;
+    TimerId add_timer(std::chrono::milliseconds interval, Callback callback, bool repeat) override;
+    void cancel_timer(TimerId id) override;
+    bool watch_signal(int signal_number, Callback callback) override;
+    void post(Callback task) override;
+    void run() override;
+    void stop() override;
+};
+
+std::unique_ptr<IEventLoop> create_event_loop();
+
+}
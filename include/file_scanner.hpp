@@ -1,35 +1,51 @@
 #pragma once
 
 #include "types.hpp"
+#include <functional>
 #include <string>
 #include <vector>
 
 namespace nigamp {
 
+// Called for each song as it is found; return false to stop the scan
+using SongFoundCallback = std::function<bool(const Song&)>;
+
 class IFileScanner {
 public:
     virtual ~IFileScanner() = default;
     virtual SongList scan_directory(const std::string& directory_path) = 0;
+    // Unsorted, in no particular order; returns the number of songs reported.
+    // on_song may be called from worker threads, but never concurrently.
+    virtual size_t scan_directory_streaming(const std::string& directory_path, const SongFoundCallback& on_song) = 0;
     virtual bool is_supported_format(const std::string& file_path) = 0;
+    // The song a scan would report for this file, without touching the disk
+    virtual Song create_song_from_file(const std::string& file_path) = 0;
 };
 
+// On Linux, directories are read with getdents64 by a pool of workers that
+// steal subtrees from each other, and d_type saves a stat per entry on most
+// filesystems. Elsewhere a single recursive_directory_iterator walks the tree.
 class FileScanner : public IFileScanner {
 private:
     std::vector<std::string> m_supported_extensions;
+    unsigned m_threads;
 
 public:
-    FileScanner();
+    // threads = 0 uses one worker per core
+    explicit FileScanner(unsigned threads = 0);
     ~FileScanner() override = default;
 
     SongList scan_directory(const std::string& directory_path) override;
+    size_t scan_directory_streaming(const std::string& directory_path, const SongFoundCallback& on_song) override;
     bool is_supported_format(const std::string& file_path) override;
+    Song create_song_from_file(const std::string& file_path) override;
 
 private:
-    Song create_song_from_file(const std::string& file_path);
+    size_t scan_parallel(const std::string& directory_path, const SongFoundCallback& on_song);
     std::string get_file_extension(const std::string& file_path);
     std::string extract_title_from_filename(const std::string& file_path);
 };
 
-std::unique_ptr<IFileScanner> create_file_scanner();
+std::unique_ptr<IFileScanner> create_file_scanner(unsigned threads = 0);
 
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "types.hpp"
+#include <vector>
+
+namespace nigamp {
+
+// Per-sample smoothed gain for interleaved 16-bit PCM. Two independent linear
+// ramps (user volume and a fade envelope) are multiplied and applied in a
+// single pass, so volume changes and pause/stop fades never produce steps.
+class GainRamp {
+private:
+    struct Ramp {
+        float current = 1.0f;
+        float target = 1.0f;
+        float step = 0.0f;
+        size_t remaining = 0;
+
+        void set(float value, size_t frames);
+        void advance(size_t frames);
+    };
+
+    Ramp m_volume;
+    Ramp m_fade;
+    int m_sample_rate = 44100;
+    int m_channels = 2;
+    std::vector<float> m_gains;
+
+public:
+    GainRamp() = default;
+
+    void configure(int sample_rate, int channels);
+
+    void set_volume(float volume, double ramp_ms);
+    void set_fade(float level, double ramp_ms);
+    void jump_fade(float level);
+
+    float get_volume_target() const;
+    float get_fade_level() const;
+    bool is_fading() const;
+
+    void process(int16_t* samples, size_t frames);
+
+private:
+    size_t ms_to_frames(double ms) const;
+};
+
+}
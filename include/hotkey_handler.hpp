@@ -11,11 +11,15 @@ enum class HotkeyAction {
     PAUSE_RESUME,
     VOLUME_UP,
     VOLUME_DOWN,
+    SEEK_FORWARD,
+    SEEK_BACKWARD,
     QUIT
 };
 
 using HotkeyCallback = std::function<void(HotkeyAction)>;
 
+class IEventLoop;
+
 class IHotkeyHandler {
 public:
     virtual ~IHotkeyHandler() = default;
@@ -25,6 +29,10 @@ public:
     virtual bool register_hotkeys() = 0;
     virtual void unregister_hotkeys() = 0;
     virtual void process_messages() = 0;
+    
+    // Serve input from the given loop instead of dedicated threads. Returns
+    // false if the platform can't, in which case use process_messages().
+    virtual bool attach(IEventLoop& loop) = 0;
 };
 
 class WindowsHotkeyHandler : public IHotkeyHandler {
@@ -42,6 +50,7 @@ public:
     bool register_hotkeys() override;
     void unregister_hotkeys() override;
     void process_messages() override;
+    bool attach(IEventLoop& loop) override;
 };
 
 class LinuxHotkeyHandler : public IHotkeyHandler {
@@ -59,6 +68,7 @@ public:
     bool register_hotkeys() override;
     void unregister_hotkeys() override;
     void process_messages() override;
+    bool attach(IEventLoop& loop) override;
 };
 
 std::unique_ptr<IHotkeyHandler> create_hotkey_handler();
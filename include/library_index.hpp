@@ -0,0 +1,67 @@
+#pragma once
+
+#include "types.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nigamp {
+
+// Size and modification time; a file whose stamp changed is re-read
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;  // Nanoseconds since the epoch
+};
+
+inline bool operator==(const FileStamp& a, const FileStamp& b) {
+    return a.size == b.size && a.mtime_ns == b.mtime_ns;
+}
+
+inline bool operator!=(const FileStamp& a, const FileStamp& b) {
+    return !(a == b);
+}
+
+// False if the file cannot be stat'ed
+bool read_file_stamp(const std::string& path, FileStamp& stamp);
+
+struct IndexedSong {
+    Song song;
+    FileStamp stamp;
+};
+
+// Writes the library sorted by path, with fixed-size records pointing into a
+// shared string table, to a temporary file renamed over path.
+bool save_library_index(const std::string& path, const std::string& directory, std::vector<IndexedSong> songs);
+
+// Read-only view of a saved index. open() maps the file and checks only the
+// header, so it costs the same for any library size; records are bounds-checked
+// as they are read. Safe to read from several threads once open.
+class LibraryIndex {
+public:
+    static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    LibraryIndex();
+    ~LibraryIndex();
+    LibraryIndex(const LibraryIndex&) = delete;
+    LibraryIndex& operator=(const LibraryIndex&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const;
+
+    size_t size() const;
+    std::string directory() const;
+
+    // False if the record points outside the string table
+    bool get(size_t index, IndexedSong& entry) const;
+    // Binary search by path; NOT_FOUND if absent
+    size_t find(std::string_view path) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace nigamp {
+
+using SongId = uint32_t;
+constexpr SongId INVALID_SONG_ID = static_cast<SongId>(-1);
+
+// String storage in fixed blocks; views into it stay valid until the string is
+// replaced or the pool cleared. A string's id is where it is stored: its block
+// and the offset of a length prefix, so the pool keeps no table of views.
+// intern() hands out one id per distinct string.
+class StringPool {
+public:
+    using StringId = uint32_t;
+
+    StringId add(std::string_view text);
+    StringId intern(std::string_view text);
+    // Overwrites an added (not interned) string when the new text is no longer,
+    // and returns the same id; otherwise adds the text and the old bytes are dead
+    StringId replace(StringId id, std::string_view text);
+    std::string_view get(StringId id) const {
+        const unsigned char* at =
+            reinterpret_cast<const unsigned char*>(m_blocks[id >> OFFSET_BITS].get()) + (id & OFFSET_MASK);
+        size_t size = 0;
+        for (int shift = 0;; shift += 7) {
+            size |= static_cast<size_t>(*at & 0x7F) << shift;
+            if (!(*at++ & 0x80)) {
+                break;
+            }
+        }
+        return std::string_view(reinterpret_cast<const char*>(at), size);
+    }
+
+    size_t count() const {
+        return m_count;
+    }
+    // Text bytes written, dead or alive
+    size_t stored_bytes() const {
+        return m_stored_bytes;
+    }
+    // Block space reserved, plus the lookup tables
+    size_t memory_bytes() const;
+    void clear();
+
+private:
+    static constexpr int OFFSET_BITS = 16;
+    static constexpr StringId OFFSET_MASK = (1u << OFFSET_BITS) - 1;
+    static constexpr size_t BLOCK_SIZE = size_t(1) << OFFSET_BITS;
+
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    // The block short strings go into; long ones get blocks of their own
+    size_t m_current_block = 0;
+    size_t m_block_used = BLOCK_SIZE;
+    size_t m_block_bytes = 0;
+    size_t m_count = 0;
+    size_t m_stored_bytes = 0;
+    std::unordered_map<std::string_view, StringId> m_interned;
+};
+
+// A song id plus the generation it was added in. Ids of removed songs are
+// handed out again, so an id held across library updates may name a different
+// song later; a handle stops resolving instead.
+struct SongHandle {
+    SongId id = INVALID_SONG_ID;
+    uint32_t generation = 0;
+
+    bool operator==(const SongHandle& other) const {
+        return id == other.id && generation == other.generation;
+    }
+    bool operator!=(const SongHandle& other) const {
+        return !(*this == other);
+    }
+};
+
+// A song read straight out of the store; valid until the store next changes
+struct SongView {
+    SongId id = INVALID_SONG_ID;
+    std::string_view directory;  // Up to and including the last separator
+    std::string_view file_name;
+    std::string_view title;
+    std::string_view artist;
+    double duration = 0.0;
+
+    std::string path() const {
+        std::string path;
+        path.reserve(directory.size() + file_name.size());
+        path.append(directory).append(file_name);
+        return path;
+    }
+
+    Song to_song() const {
+        return Song{path(), std::string(title), std::string(artist), duration};
+    }
+};
+
+// The library as parallel columns indexed by 32-bit song id. Directory
+// prefixes and artists are interned, file names and titles share the string
+// pool, and a song costs a few fixed-width fields instead of three strings.
+// Removed songs' ids are reused by later adds, so the columns stay dense, and
+// the pool is rebuilt once most of its text belongs to replaced or removed strings.
+class LibraryStore {
+public:
+    // Returns the existing id, updated in place, if the path is already stored
+    SongId add(const Song& song);
+    // Replaces a song's fields, path included; false if the id is not live
+    bool update(SongId id, const Song& song);
+    bool remove(SongId id);
+    void clear();
+
+    bool contains(SongId id) const {
+        return id < m_file_name.size() && m_live[id];
+    }
+    SongId find(std::string_view path) const;
+    SongView view(SongId id) const;
+
+    // An invalid handle if the id is not live
+    SongHandle handle(SongId id) const;
+    bool valid(SongHandle handle) const {
+        return contains(handle.id) && m_generation[handle.id] == handle.generation;
+    }
+    // Empty if the handle's song has been removed
+    SongView view(SongHandle handle) const;
+    std::string path(SongId id) const;
+
+    // The same for every song by one artist, and different across artists
+    uint32_t artist_key(SongId id) const {
+        return m_artist[id];
+    }
+    // Times the song was started since it was added
+    uint32_t play_count(SongId id) const {
+        return m_play_count[id];
+    }
+    void add_play(SongId id) {
+        if (contains(id)) {
+            ++m_play_count[id];
+        }
+    }
+
+    // Live songs anywhere below dir_path. Walks only the subtree's directories
+    // and their songs, not the whole library.
+    std::vector<SongId> songs_under(std::string_view dir_path) const;
+
+    size_t size() const {
+        return m_live_count;
+    }
+    // Columns, string pool and lookup tables
+    size_t memory_bytes() const;
+
+private:
+    // Below this much dead text the pool is not worth rebuilding
+    static constexpr size_t COMPACT_MIN_BYTES = 64 * 1024;
+
+    // An interned directory and the head of its songs' list
+    struct Directory {
+        StringPool::StringId path;
+        SongId first_song = INVALID_SONG_ID;
+        bool emptied = false;  // Its path is counted as dead text until a song returns
+    };
+
+    StringPool m_strings;
+    // Index into m_directory_list
+    std::vector<uint32_t> m_directory;
+    std::vector<StringPool::StringId> m_file_name;
+    std::vector<StringPool::StringId> m_title;
+    std::vector<StringPool::StringId> m_artist;
+    std::vector<float> m_duration;
+    std::vector<bool> m_live;
+    std::vector<uint32_t> m_play_count;
+    std::vector<uint32_t> m_generation;
+    // Each directory's live songs, linked through these two columns
+    std::vector<SongId> m_next_in_directory;
+    std::vector<SongId> m_previous_in_directory;
+    std::vector<SongId> m_free;
+    size_t m_live_count = 0;
+    // Pool text no live song refers to any more
+    size_t m_dead_string_bytes = 0;
+    // Never reset, so handles from before a clear() do not resolve either
+    uint32_t m_next_generation = 0;
+
+    // Directory paths to their index, ordered so a subtree is one range
+    std::map<std::string_view, uint32_t> m_directories;
+    std::vector<Directory> m_directory_list;
+    // Open-addressed path lookup holding only ids; keys are read from the columns
+    std::vector<SongId> m_slots;
+
+    static size_t hash_path(uint32_t directory, std::string_view file_name);
+
+    static size_t split_point(std::string_view path);
+    uint32_t intern_directory(std::string_view directory);
+    void link(SongId id);
+    void unlink(SongId id);
+    size_t find_slot(uint32_t directory, std::string_view file_name) const;
+    void insert_slot(SongId id);
+    void erase_slot(SongId id);
+    void assign(SongId id, const Song& song);
+    void set_string(StringPool::StringId& id, std::string_view text);
+    void release_strings(SongId id);
+    void compact_if_wasteful();
+    void compact();
+};
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "event_loop.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nigamp {
+
+struct LibraryChange {
+    enum class Kind { ADDED, REMOVED, RENAMED };
+
+    Kind kind{Kind::ADDED};
+    bool is_directory{false};  // REMOVED or RENAMED stands for everything below path
+    std::string path;
+    std::string old_path;      // RENAMED only
+};
+
+// Keeps a library directory in sync from inotify events on the player's event
+// loop. Files written in a watched directory are reported once they are closed
+// after writing or moved in; a rename inside the tree arrives as one RENAMED
+// change. Directories created or moved in are walked and watched on a
+// background thread, and the files found in them follow as a later ADDED
+// batch. The walk reports whatever is there, so a file still being copied
+// into a new directory can arrive early and be ADDED again when it is closed.
+// Paths are built like FileScanner's, so they compare equal to scanned paths.
+// Formats are not filtered.
+class LibraryWatcher {
+public:
+    using ChangeHandler = std::function<void(const std::vector<LibraryChange>&)>;
+    // Events were lost and only a full rescan can catch up. If the inotify
+    // watch limit was hit the watcher has also stopped itself.
+    using RescanHandler = std::function<void()>;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+
+public:
+    explicit LibraryWatcher(IEventLoop& loop);
+    ~LibraryWatcher();
+
+    LibraryWatcher(const LibraryWatcher&) = delete;
+    LibraryWatcher& operator=(const LibraryWatcher&) = delete;
+
+    // Call on the loop thread. Existing directories are watched from the
+    // background thread too, so a large tree does not hold up the loop. Both
+    // handlers run on the loop and must not stop the watcher. False where
+    // inotify is unavailable.
+    bool start(const std::string& root, ChangeHandler on_changes, RescanHandler on_rescan);
+    void stop();
+    bool is_running() const;
+
+    size_t watch_count() const;
+};
+
+}
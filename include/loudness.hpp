@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nigamp {
+
+// Coarse loudness over time: RMS of the mono mix per fixed block, 0..1
+struct LoudnessEnvelope {
+    static constexpr double BLOCK_SECONDS = 0.5;
+    std::vector<float> rms;
+
+    double duration() const {
+        return rms.size() * BLOCK_SECONDS;
+    }
+};
+
+// Decodes the whole file once; false if it cannot be opened, or if cancel is
+// set while decoding (checked between decoded blocks)
+bool compute_loudness_envelope(const std::string& path, LoudnessEnvelope& envelope,
+                               const std::atomic<bool>* cancel = nullptr);
+
+// Start, in seconds, of the window_seconds stretch with the most energy.
+// 0 for tracks no longer than the window or without an envelope.
+double find_loudest_window(const LoudnessEnvelope& envelope, double window_seconds);
+
+// Computes envelopes on a small worker pool and caches the most recently used
+// cache_limit of them by path. A request for a cached path calls back right
+// away on the caller's thread; one for a path already queued only adds its
+// callback. Destroying the analyzer abandons analyses in flight without
+// calling back, so it never waits for a whole track to decode.
+//
+// With a store_path, every finished analysis is also appended there at one
+// byte per block, stamped with the file's size and mtime, and a later run
+// reuses it instead of decoding the track again while the stamp matches.
+class LoudnessAnalyzer {
+public:
+    // Runs on a worker thread once the path has been analyzed (or failed)
+    using Callback = std::function<void()>;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+
+public:
+    static constexpr size_t DEFAULT_CACHE_LIMIT = 2048;
+
+    explicit LoudnessAnalyzer(unsigned threads, size_t cache_limit = DEFAULT_CACHE_LIMIT,
+                              const std::string& store_path = std::string());
+    ~LoudnessAnalyzer();
+
+    LoudnessAnalyzer(const LoudnessAnalyzer&) = delete;
+    LoudnessAnalyzer& operator=(const LoudnessAnalyzer&) = delete;
+
+    void request(const std::string& path, Callback done = Callback());
+
+    // True once the path has been analyzed; envelope is empty if that failed
+    bool lookup(const std::string& path, LoudnessEnvelope& envelope) const;
+
+    // Analyzes on the calling thread, through the same cache and store, for
+    // callers that already run their own workers. False if the file cannot be
+    // decoded or the analyzer is being destroyed.
+    bool analyze(const std::string& path, LoudnessEnvelope& envelope);
+};
+
+}
@@ -14,6 +14,8 @@ public:
     virtual void close() = 0;
     virtual AudioFormat get_format() const = 0;
     virtual double get_duration() const = 0;
+    // Exact length in frames; get_duration() is derived from it
+    virtual uint64_t get_total_frames() const = 0;
     virtual bool seek(double seconds) = 0;
     virtual bool is_eof() const = 0;
 };
@@ -32,6 +34,7 @@ public:
     void close() override;
     AudioFormat get_format() const override;
     double get_duration() const override;
+    uint64_t get_total_frames() const override;
     bool seek(double seconds) override;
     bool is_eof() const override;
 };
@@ -50,6 +53,7 @@ public:
     void close() override;
     AudioFormat get_format() const override;
     double get_duration() const override;
+    uint64_t get_total_frames() const override;
     bool seek(double seconds) override;
     bool is_eof() const override;
 };
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace nigamp {
+
+// Unbounded multi-producer/single-consumer queue (Vyukov). Push is one atomic
+// exchange and never waits on other producers or the consumer. A push that is
+// still in progress may be invisible to try_pop for a moment; the producer
+// finishes it without help, so callers should signal after push returns.
+template <typename T>
+class MpscQueue {
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        T value{};
+    };
+
+    alignas(CACHE_LINE) std::atomic<Node*> m_head;  // Last pushed node (producers)
+    alignas(CACHE_LINE) Node* m_tail;               // Stub before the next node to pop (consumer)
+
+public:
+    MpscQueue() {
+        Node* stub = new Node;
+        m_head.store(stub, std::memory_order_relaxed);
+        m_tail = stub;
+    }
+
+    ~MpscQueue() {
+        T discarded;
+        while (try_pop(discarded)) {
+        }
+        delete m_tail;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T item) {
+        Node* node = new Node;
+        node->value = std::move(item);
+        Node* previous = m_head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    bool try_pop(T& item) {
+        Node* next = m_tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        item = std::move(next->value);
+        delete m_tail;
+        m_tail = next;
+        return true;
+    }
+
+    bool empty() const {
+        return m_tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+};
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "types.hpp"
+#include <memory>
+#include <string>
+
+namespace nigamp {
+
+// What the device actually agreed to when it was opened
+struct PcmConfig {
+    int sample_rate = 0;
+    int channels = 0;
+    size_t buffer_frames = 0;
+    size_t period_frames = 0;
+    bool can_pause = false;
+};
+
+// Thin seam over the PCM calls the ALSA engine makes, so device failures can
+// be injected in tests. Return values follow ALSA: a negative errno on failure.
+class IPcmDevice {
+public:
+    virtual ~IPcmDevice() = default;
+    virtual int open(const AudioFormat& requested, PcmConfig& actual) = 0;
+    virtual void close() = 0;
+    virtual bool is_open() const = 0;
+    virtual int prepare() = 0;
+    virtual int resume() = 0;
+    virtual int drop() = 0;
+    virtual int pause(bool enable) = 0;
+    virtual long avail() = 0;
+    virtual long write(const int16_t* samples, size_t frames) = 0;
+    virtual long rewindable() = 0;
+    virtual long rewind(size_t frames) = 0;
+};
+
+std::unique_ptr<IPcmDevice> create_alsa_pcm_device(const std::string& name = "default");
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "pcm_device.hpp"
+#include <chrono>
+
+namespace nigamp {
+
+enum class PcmRecoveryState {
+    RUNNING,
+    SUSPENDED,     // Waiting for the device to come back from system suspend
+    DISCONNECTED,  // Device closed; reopening with exponential backoff
+    FAILED         // Gave up: the device keeps coming back in a layout we can't play
+};
+
+enum class PcmRecoveryResult {
+    NONE,       // Error needs no action (e.g. -EAGAIN)
+    WAITING,    // Device not usable yet, poll again later
+    RESUMED,    // Stream continues with its queued audio intact
+    RESTARTED,  // Stream was re-prepared; anything queued in it is gone
+    REOPENED,   // Device was reopened; queued audio is gone and its rate or buffer sizes may differ
+    FAILED      // Recovery gave up; returned once, later polls just wait
+};
+
+struct PcmRecoveryPolicy {
+    std::chrono::milliseconds initial_backoff{100};
+    std::chrono::milliseconds max_backoff{5000};
+    std::chrono::milliseconds resume_interval{50};
+    int max_channel_mismatches = 5;
+};
+
+// Turns PCM write/avail errors into recovery steps: an xrun is re-prepared,
+// a suspend is resumed (falling back to prepare), and anything else closes
+// the device and keeps reopening it with capped exponential backoff. A reopen
+// may come back at another rate, which the caller converts to. One with another
+// channel count counts as a failed attempt, and recovery gives up after a few.
+// Time is passed in so the transitions can be driven deterministically.
+class PcmRecovery {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    IPcmDevice& m_device;
+    PcmRecoveryPolicy m_policy;
+    AudioFormat m_format;
+    PcmConfig m_config;
+
+    PcmRecoveryState m_state = PcmRecoveryState::RUNNING;
+    Clock::time_point m_next_attempt;
+    std::chrono::milliseconds m_backoff{0};
+    int m_reopen_attempts = 0;
+    int m_channel_mismatches = 0;
+    size_t m_recoveries = 0;
+
+    void disconnect(Clock::time_point now);
+    PcmRecoveryResult restart(Clock::time_point now);
+
+public:
+    explicit PcmRecovery(IPcmDevice& device, const PcmRecoveryPolicy& policy = PcmRecoveryPolicy());
+
+    // Format requested when the device has to be reopened
+    void set_format(const AudioFormat& format);
+    void reset();
+
+    PcmRecoveryResult handle_error(long error, Clock::time_point now);
+    PcmRecoveryResult poll(Clock::time_point now);
+
+    PcmRecoveryState get_state() const;
+    bool is_running() const;
+    const PcmConfig& get_config() const;
+    std::chrono::milliseconds get_backoff() const;
+    // When poll() will next try the device; meaningless while running or failed
+    Clock::time_point get_next_attempt() const;
+    int get_reopen_attempts() const;
+    size_t get_recovery_count() const;
+};
+
+}
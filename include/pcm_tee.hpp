@@ -0,0 +1,43 @@
+#pragma once
+
+#include "types.hpp"
+#include <memory>
+#include <string>
+
+namespace nigamp {
+
+static constexpr size_t WAV_HEADER_SIZE = 44;
+
+// Canonical 16-bit PCM WAV header for data_bytes of audio, WAV_HEADER_SIZE bytes long
+std::string make_wav_header(const AudioFormat& format, uint32_t data_bytes);
+
+// Copies played PCM to a WAV file or a named pipe. write() only copies into a
+// lock-free ring and never waits on I/O; a writer thread does all file I/O and
+// sleeps until a chunk is committed, so write() briefly takes its lock only to
+// wake it. When the writer falls behind, audio is dropped and counted instead
+// of stalling the caller. Only one thread may call write() at a time.
+class PcmTee {
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+
+public:
+    PcmTee();
+    ~PcmTee();
+
+    // Starts the writer thread, which for a FIFO blocks until a reader shows up
+    bool open(const std::string& path, const AudioFormat& format);
+    // Flushes what is buffered, finalizes the WAV header and joins the writer
+    void close();
+    bool is_open() const;
+
+    const AudioFormat& get_format() const;
+
+    // Interleaved samples in the format passed to open(). Returns how many were accepted.
+    size_t write(const int16_t* samples, size_t count);
+
+    size_t get_frames_written() const;
+    size_t get_dropped_frames() const;
+};
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "hotkey_handler.hpp"
+#include "mpsc_queue.hpp"
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace nigamp {
+
+enum class PlayerCommandType {
+    NEXT,
+    PREVIOUS,
+    SEEK,
+    VOLUME,
+    PAUSE_RESUME,
+    ENQUEUE,
+    EXPORT,
+    QUIT
+};
+
+struct PlayerCommand {
+    PlayerCommandType type{PlayerCommandType::NEXT};
+    double amount{1.0};  // Tracks for NEXT/PREVIOUS, seconds for SEEK, volume delta for VOLUME
+    std::string path;    // Song or playlist for ENQUEUE, playlist file for EXPORT
+};
+
+static constexpr double VOLUME_STEP = 0.1;
+static constexpr double SEEK_STEP_SECONDS = 10.0;
+
+PlayerCommand command_from_hotkey(HotkeyAction action);
+
+// Merges adjacent commands that have the same effect applied once: skips add
+// up (a next and a previous cancel), as do seeks and volume changes, pause
+// toggles cancel in pairs, and nothing after a quit survives.
+std::vector<PlayerCommand> coalesce_commands(const std::vector<PlayerCommand>& commands);
+
+// Hotkey and control threads push; the player drains on its own thread.
+class CommandQueue {
+private:
+    MpscQueue<PlayerCommand> m_queue;
+    std::atomic<bool> m_drain_pending{false};
+
+public:
+    // Returns true when no drain is pending yet and the caller must schedule one
+    bool push(PlayerCommand command);
+
+    // Pops everything queued so far, coalesced
+    std::vector<PlayerCommand> drain();
+};
+
+}
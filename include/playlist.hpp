@@ -1,53 +1,152 @@
 #pragma once
 
 #include "types.hpp"
+#include "library_store.hpp"
+#include "shuffle_strategy.hpp"
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <random>
+#include <vector>
 
 namespace nigamp {
 
+// Songs live in the playlist's LibraryStore; everything else passes their ids.
+// Ids of removed songs are reused, so keep a library().handle() across updates.
 class IPlaylist {
 public:
     virtual ~IPlaylist() = default;
-    virtual void add_song(const Song& song) = 0;
+    // Returns the song's id; adding a path that is already present updates it
+    virtual SongId add_song(const Song& song) = 0;
+    // The same for many songs at once; ids come back in the songs' order
+    virtual std::vector<SongId> add_songs(const SongList& songs) = 0;
     virtual void clear() = 0;
-    virtual const Song* current() const = 0;
-    virtual const Song* next() = 0;
-    virtual const Song* previous() = 0;
+    // INVALID_SONG_ID when empty; the queued song while one is playing
+    virtual SongId current() const = 0;
+    virtual SongId next() = 0;
+    virtual SongId previous() = 0;
     virtual bool has_next() const = 0;
     virtual bool has_previous() const = 0;
     virtual size_t size() const = 0;
     virtual bool empty() const = 0;
+    // A new order from the shuffle strategy, with recently played songs moved to the end
     virtual void shuffle() = 0;
     virtual void reset() = 0;
+    virtual void set_shuffle_strategy(std::unique_ptr<IShuffleStrategy> strategy) = 0;
+    // How many of the last songs played shuffle() keeps away from the front
+    virtual void set_no_repeat_window(size_t tracks) = 0;
+    // Counts a play and puts the song in the no-repeat window. Only the first
+    // call after the song becomes current counts, so restarting it at another
+    // position (a seek, a preview retry, a resumed session) is not a new play.
+    virtual void record_play(SongId id) = 0;
+    
+    // Up next: next() plays queued songs first in first out, then the order
+    // resumes where it left off. previous() from a queued song returns to the
+    // order. Removed songs drop out of the queue.
+    virtual void enqueue(SongId id) = 0;
+    virtual void clear_queue() = 0;
+    // Queued songs still to play, next first
+    virtual std::vector<SongId> queue() const = 0;
+    virtual bool has_queued() const = 0;
+    // The current song, the queue, the rest of the order, then the songs already played
+    virtual std::vector<SongId> play_order() const = 0;
+    
+    virtual const LibraryStore& library() const = 0;
+    // Changes whenever the songs or the play order change, but not when playback
+    // moves along the order or the queue; cheap to poll for unsaved changes
+    virtual uint64_t revision() const = 0;
+    // Every song in add order
+    virtual const std::vector<SongId>& songs() const = 0;
+    // Song indices (in add order) in play order; empty when not shuffled
+    virtual std::vector<size_t> shuffle_order() const = 0;
+    virtual bool is_shuffled() const = 0;
+    virtual size_t current_index() const = 0;
+    // Reinstates a saved order instead of shuffling again; false if it is not a permutation of the songs
+    virtual bool restore_order(const std::vector<size_t>& order, size_t current_index) = 0;
+    
+    // Library updates, O(1) per affected song plus, for directories, one ordered
+    // lookup of the subtree; paths are unique.
+    // Played and upcoming songs stay on their side of the current one. If the
+    // current song is removed, an upcoming song takes its place.
+    virtual bool contains(const std::string& file_path) const = 0;
+    virtual bool remove_song(const std::string& file_path) = 0;
+    // Replaces the song at old_path, keeping its id and place in the play order;
+    // a song already at the new path is dropped
+    virtual bool rename_song(const std::string& old_path, const Song& song) = 0;
+    // The same for a file that only moved: its title, artist and duration stay
+    virtual bool move_song(const std::string& old_path, const std::string& new_path) = 0;
+    // Songs anywhere below dir_path; both return how many were affected
+    virtual size_t remove_directory(const std::string& dir_path) = 0;
+    virtual size_t rename_directory(const std::string& old_dir, const std::string& new_dir) = 0;
 };
 
 class ShufflePlaylist : public IPlaylist {
 private:
-    SongList m_songs;
-    SongList m_shuffled_songs;
+    LibraryStore m_library;
+    // Shuffling permutes indices into m_songs; the songs themselves never move
+    std::vector<SongId> m_songs;
+    std::vector<uint32_t> m_shuffle_order;  // Play order while shuffled: m_songs[m_shuffle_order[i]]
+    std::vector<uint32_t> m_position;       // Inverse of m_shuffle_order while shuffled
+    std::vector<uint32_t> m_index_of;       // By song id: index into m_songs
     size_t m_current_index;
     std::mt19937 m_random_engine;
     bool m_is_shuffled;
+    std::unique_ptr<IShuffleStrategy> m_strategy;
+    RecentWindow m_recent;
+    // Handles, so songs removed after they were queued are skipped
+    std::deque<SongHandle> m_queue;
+    SongHandle m_playing_queued;  // Invalid while the order's current song plays
+    bool m_current_unplayed;      // The order's current song has not been started yet
+    bool m_play_counted;          // record_play() has counted the current song
+    uint64_t m_revision = 0;
 
 public:
+    static constexpr size_t DEFAULT_NO_REPEAT_TRACKS = 100;
+
     ShufflePlaylist();
     ~ShufflePlaylist() override = default;
 
-    void add_song(const Song& song) override;
+    SongId add_song(const Song& song) override;
+    std::vector<SongId> add_songs(const SongList& songs) override;
     void clear() override;
-    const Song* current() const override;
-    const Song* next() override;
-    const Song* previous() override;
+    SongId current() const override;
+    SongId next() override;
+    SongId previous() override;
     bool has_next() const override;
     bool has_previous() const override;
     size_t size() const override;
     bool empty() const override;
     void shuffle() override;
     void reset() override;
+    void set_shuffle_strategy(std::unique_ptr<IShuffleStrategy> strategy) override;
+    void set_no_repeat_window(size_t tracks) override;
+    void record_play(SongId id) override;
+    void enqueue(SongId id) override;
+    void clear_queue() override;
+    std::vector<SongId> queue() const override;
+    bool has_queued() const override;
+    std::vector<SongId> play_order() const override;
+    const LibraryStore& library() const override;
+    uint64_t revision() const override;
+    const std::vector<SongId>& songs() const override;
+    std::vector<size_t> shuffle_order() const override;
+    bool is_shuffled() const override;
+    size_t current_index() const override;
+    bool restore_order(const std::vector<size_t>& order, size_t current_index) override;
+    bool contains(const std::string& file_path) const override;
+    bool remove_song(const std::string& file_path) override;
+    bool rename_song(const std::string& old_path, const Song& song) override;
+    bool move_song(const std::string& old_path, const std::string& new_path) override;
+    size_t remove_directory(const std::string& dir_path) override;
+    size_t rename_directory(const std::string& old_dir, const std::string& new_dir) override;
 
 private:
-    void fisher_yates_shuffle();
+    SongId song_at(size_t position) const;
+    bool take_queued();
+    void move_recent_to_end();
+    void rebuild_positions();
+    void swap_positions(size_t a, size_t b);
+    void remove_at(size_t index);
 };
 
 std::unique_ptr<IPlaylist> create_playlist();
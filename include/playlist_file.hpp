@@ -0,0 +1,77 @@
+#pragma once
+
+#include "types.hpp"
+#include "library_index.hpp"
+#include "library_store.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace nigamp {
+
+// M3U and M3U8 (#EXTM3U with #EXTINF lines, or bare paths) and PLS ([playlist]
+// with FileN/TitleN/LengthN keys), chosen by the file's extension
+enum class PlaylistFormat {
+    UNKNOWN,
+    M3U,
+    PLS
+};
+
+PlaylistFormat playlist_format(const std::string& path);
+
+struct PlaylistEntry {
+    std::string path;   // Absolute: relative entries are resolved against the playlist's directory
+    std::string title;  // Empty if the file gives none
+    double duration{0.0};  // Seconds, 0 if unknown
+};
+
+static constexpr size_t PLAYLIST_BATCH = 4096;
+
+// Gets each batch of entries in file order; returning false stops the read
+using PlaylistBatchCallback = std::function<bool(std::vector<PlaylistEntry>& batch)>;
+
+// Streams the file in fixed-size chunks, so memory stays flat for any length.
+// A UTF-8 byte order mark and CRLF line ends are accepted; file:// URIs are
+// decoded, and other URLs and lines that are not entries are skipped. False if
+// the file cannot be read or its format is unknown.
+bool read_playlist(const std::string& path, const PlaylistBatchCallback& on_batch,
+                   size_t batch_size = PLAYLIST_BATCH);
+
+// Drops entries already in the library from the batch's to-do list and turns
+// the rest into songs: tags from the index when it has the path, otherwise the
+// entry's own title and duration if the file exists. Entries for missing files
+// are removed from `entries`, so what is left all resolves after the songs are added.
+void resolve_playlist_entries(std::vector<PlaylistEntry>& entries, const LibraryStore& library,
+                              const LibraryIndex* index, SongList& new_songs);
+
+// Writes entries as they come to a temporary file that close() renames over
+// the target. Paths below the playlist's directory are written relative to it.
+class PlaylistWriter {
+private:
+    std::FILE* m_file = nullptr;
+    PlaylistFormat m_format = PlaylistFormat::UNKNOWN;
+    std::string m_path;
+    std::string m_temp_path;
+    std::string m_base_directory;
+    size_t m_count = 0;
+    std::vector<char> m_buffer;
+
+public:
+    PlaylistWriter() = default;
+    ~PlaylistWriter();
+    PlaylistWriter(const PlaylistWriter&) = delete;
+    PlaylistWriter& operator=(const PlaylistWriter&) = delete;
+
+    // False if the extension is not a playlist format or the file cannot be created
+    bool open(const std::string& path);
+    void write(const PlaylistEntry& entry);
+    // False if anything failed to write; the target is then left untouched
+    bool close();
+    size_t count() const {
+        return m_count;
+    }
+};
+
+}
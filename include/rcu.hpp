@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace nigamp {
+
+// An immutable value that readers on other threads see without locking.
+// A writer builds the next version off to the side and publishes it with one
+// pointer exchange. Earlier versions stay alive until every reader that could
+// still see them has finished (epoch-based reclamation). Reading is two stores
+// and two loads: it never waits on the writer or on other readers.
+template <typename T>
+class RcuCell {
+public:
+    static constexpr size_t MAX_READERS = 64;
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr uint64_t IDLE = 0;
+
+    struct alignas(CACHE_LINE) ReaderSlot {
+        std::atomic<bool> claimed{false};
+        std::atomic<uint64_t> epoch{IDLE};  // Epoch the current read started in
+    };
+
+    struct Retired {
+        uint64_t epoch;  // Readers from before this epoch may still hold it
+        std::unique_ptr<const T> value;
+    };
+
+    alignas(CACHE_LINE) std::atomic<const T*> m_current{nullptr};
+    alignas(CACHE_LINE) std::atomic<uint64_t> m_epoch{1};
+    std::array<ReaderSlot, MAX_READERS> m_slots;
+
+    std::mutex m_write_mutex;  // Writers only
+    std::vector<Retired> m_retired;
+
+    // Frees versions no reader can still hold; the write mutex is held
+    void reclaim_locked() {
+        uint64_t oldest = UINT64_MAX;
+        for (const auto& slot : m_slots) {
+            uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+            if (epoch != IDLE && epoch < oldest) {
+                oldest = epoch;
+            }
+        }
+        size_t kept = 0;
+        for (auto& retired : m_retired) {
+            if (retired.epoch > oldest) {
+                m_retired[kept++] = std::move(retired);
+            }
+        }
+        m_retired.resize(kept);
+    }
+
+public:
+    // Keeps its version alive until destroyed; hold it only briefly
+    class ReadGuard {
+    private:
+        std::atomic<uint64_t>* m_epoch;
+        const T* m_value;
+
+    public:
+        ReadGuard(std::atomic<uint64_t>* epoch, const T* value) : m_epoch(epoch), m_value(value) {}
+        ~ReadGuard() {
+            if (m_epoch) {
+                m_epoch->store(IDLE, std::memory_order_release);
+            }
+        }
+        ReadGuard(ReadGuard&& other) noexcept : m_epoch(other.m_epoch), m_value(other.m_value) {
+            other.m_epoch = nullptr;
+        }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ReadGuard& operator=(ReadGuard&&) = delete;
+
+        // Null before the first publish
+        const T* get() const { return m_value; }
+        const T& operator*() const { return *m_value; }
+        const T* operator->() const { return m_value; }
+        explicit operator bool() const { return m_value != nullptr; }
+    };
+
+    // One per reading thread; reads through one Reader must not overlap
+    class Reader {
+    private:
+        RcuCell* m_cell = nullptr;
+        ReaderSlot* m_slot = nullptr;
+
+    public:
+        Reader() = default;
+        Reader(RcuCell* cell, ReaderSlot* slot) : m_cell(cell), m_slot(slot) {}
+        ~Reader() {
+            if (m_slot) {
+                m_slot->claimed.store(false, std::memory_order_release);
+            }
+        }
+        Reader(Reader&& other) noexcept : m_cell(other.m_cell), m_slot(other.m_slot) {
+            other.m_slot = nullptr;
+        }
+        Reader& operator=(Reader&& other) noexcept {
+            std::swap(m_cell, other.m_cell);
+            std::swap(m_slot, other.m_slot);
+            return *this;
+        }
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        // False if every reader slot was taken
+        explicit operator bool() const { return m_slot != nullptr; }
+
+        ReadGuard read() const {
+            // Announce the read before loading the pointer; the writer checks the
+            // announcements after swapping it, so it cannot miss this reader
+            m_slot->epoch.store(m_cell->m_epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+            return ReadGuard(&m_slot->epoch, m_cell->m_current.load(std::memory_order_seq_cst));
+        }
+    };
+
+    RcuCell() = default;
+    explicit RcuCell(std::unique_ptr<const T> initial) {
+        m_current.store(initial.release(), std::memory_order_release);
+    }
+    // Readers must be gone by now
+    ~RcuCell() {
+        delete m_current.load(std::memory_order_acquire);
+    }
+
+    RcuCell(const RcuCell&) = delete;
+    RcuCell& operator=(const RcuCell&) = delete;
+
+    Reader reader() {
+        for (auto& slot : m_slots) {
+            bool expected = false;
+            if (!slot.claimed.load(std::memory_order_relaxed) &&
+                slot.claimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                return Reader(this, &slot);
+            }
+        }
+        return Reader();
+    }
+
+    // Replaces the value readers see. The previous version is freed here or by a
+    // later publish()/reclaim(), once no read that started before now is running.
+    void publish(std::unique_ptr<const T> value) {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        const T* previous = m_current.exchange(value.release(), std::memory_order_seq_cst);
+        // Reads announced from here on may see the new version but not the old one
+        uint64_t epoch = m_epoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+        if (previous) {
+            m_retired.push_back(Retired{epoch, std::unique_ptr<const T>(previous)});
+        }
+        reclaim_locked();
+    }
+
+    void publish(T value) {
+        publish(std::make_unique<const T>(std::move(value)));
+    }
+
+    void reclaim() {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        reclaim_locked();
+    }
+
+    // Versions waiting for readers to finish
+    size_t retired() {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        return m_retired.size();
+    }
+};
+
+}
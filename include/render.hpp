@@ -0,0 +1,43 @@
+#pragma once
+
+#include "loudness.hpp"
+#include "resampler.hpp"
+#include "types.hpp"
+#include <string>
+#include <vector>
+
+namespace nigamp {
+
+struct RenderOptions {
+    AudioFormat format{44100, 2, 16};  // Every track is converted to this
+    float volume{1.0f};
+    double preview_seconds{0.0};       // Trim each track to this many seconds; 0 renders whole tracks
+    bool smart_preview{false};         // Start each trimmed clip at the track's loudest stretch
+    LoudnessAnalyzer* loudness{nullptr};  // Smart previews read and store envelopes here when set
+    ResamplerQuality resampler_quality{ResamplerQuality::MEDIUM};
+    unsigned threads{0};               // Decode workers; 0 uses every core
+};
+
+struct RenderStats {
+    size_t tracks_rendered{0};
+    size_t tracks_failed{0};
+    uint64_t frames_written{0};
+    double audio_seconds{0.0};
+    double wall_seconds{0.0};
+
+    double realtime_factor() const {
+        return wall_seconds > 0.0 ? audio_seconds / wall_seconds : 0.0;
+    }
+};
+
+// Decodes the tracks through the same decoder, trim, gain and resampler stages
+// as playback and writes them back to back into one WAV file, as fast as the
+// CPU allows. Tracks are decoded in parallel on a worker pool and streamed to
+// the file in order, in chunks; audio not yet written is capped at a fixed
+// budget however long the tracks are. Tracks that fail
+// to open are skipped and counted. Returns false if the output could not be
+// written.
+bool render_playlist(const std::vector<std::string>& paths, const std::string& output_path,
+                     const RenderOptions& options, RenderStats& stats);
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "types.hpp"
+#include <memory>
+
+namespace nigamp {
+
+enum class ResamplerQuality {
+    FAST,
+    MEDIUM,
+    HIGH
+};
+
+class IResampler {
+public:
+    virtual ~IResampler() = default;
+    virtual bool configure(int input_rate, int output_rate, int channels) = 0;
+    virtual void process(const AudioBuffer& input, AudioBuffer& output) = 0;
+    // End of stream: pads with silence to drain the filter delay's worth of
+    // output still held back, then starts over as after reset()
+    virtual void flush(AudioBuffer& output) = 0;
+    virtual void reset() = 0;
+    virtual bool is_passthrough() const = 0;
+    virtual int get_input_rate() const = 0;
+    virtual int get_output_rate() const = 0;
+};
+
+// Rational polyphase FIR resampler. Filter tables are shared between all
+// instances converting the same rate pair at the same quality.
+class PolyphaseResampler : public IResampler {
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+
+public:
+    explicit PolyphaseResampler(ResamplerQuality quality = ResamplerQuality::MEDIUM);
+    ~PolyphaseResampler() override;
+
+    bool configure(int input_rate, int output_rate, int channels) override;
+    void process(const AudioBuffer& input, AudioBuffer& output) override;
+    void flush(AudioBuffer& output) override;
+    void reset() override;
+    bool is_passthrough() const override;
+    int get_input_rate() const override;
+    int get_output_rate() const override;
+};
+
+std::unique_ptr<IResampler> create_resampler(ResamplerQuality quality = ResamplerQuality::MEDIUM);
+
+bool parse_resampler_quality(const std::string& name, ResamplerQuality& quality);
+
+// Number of distinct filter tables currently cached (one per rate pair/quality)
+size_t get_resampler_cache_size();
+void clear_resampler_cache();
+
+}
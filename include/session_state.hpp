@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nigamp {
+
+// What a restart needs to carry on where the last run stopped
+struct SessionState {
+    std::string directory;            // Library root the session belongs to
+    std::vector<std::string> paths;   // Library, in playlist add order
+    std::vector<uint32_t> order;      // Play order as indices into paths
+    uint32_t current_index = 0;       // Position in order
+    uint64_t sample_position = 0;     // Frames into the current track
+    uint32_t sample_rate = 0;         // Rate sample_position is counted at
+    float volume = 1.0f;
+};
+
+// The fields that move while the library and order stay put
+struct SessionPosition {
+    uint32_t current_index = 0;
+    uint64_t sample_position = 0;
+    uint32_t sample_rate = 0;
+    float volume = 1.0f;
+};
+
+// Writes a compact little-endian snapshot to a temporary file and renames it
+// over path, so a crash mid-write leaves the previous snapshot intact.
+bool save_session(const std::string& path, const SessionState& state);
+
+// Maps the snapshot and validates it; false on a missing, truncated or
+// inconsistent file, leaving state untouched.
+bool load_session(const std::string& path, SessionState& state);
+
+// Overwrites the position fields of an existing snapshot in place: one 20-byte
+// write at a fixed offset, cheap enough to run every few seconds. False if the
+// file is missing or doesn't hold song_count songs; the caller then writes a
+// full snapshot with save_session().
+bool update_session_position(const std::string& path, size_t song_count, const SessionPosition& position);
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "library_store.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace nigamp {
+
+// Builds a whole play order for ShufflePlaylist::shuffle(). Songs added while
+// shuffled are still placed uniformly among the upcoming ones.
+class IShuffleStrategy {
+public:
+    virtual ~IShuffleStrategy() = default;
+    // Fills order with a permutation of indices into songs
+    virtual void build_order(const LibraryStore& library, const std::vector<SongId>& songs,
+                             std::mt19937& random, std::vector<uint32_t>& order) = 0;
+    virtual const char* name() const = 0;
+};
+
+// Fisher-Yates: every order equally likely
+std::unique_ptr<IShuffleStrategy> create_uniform_shuffle();
+// Songs played less often this session tend to come first. Weights fall from
+// 1 to 1/16 with play count; draws use an alias table, O(1) expected each.
+std::unique_ptr<IShuffleStrategy> create_weighted_shuffle();
+// Each artist's songs are spread evenly over the order at a random offset, so
+// one artist rarely plays twice in a row. Linear time via bucket sort.
+std::unique_ptr<IShuffleStrategy> create_artist_spread_shuffle();
+// "uniform", "weighted" or "artist"; null for anything else
+std::unique_ptr<IShuffleStrategy> create_shuffle_strategy(const std::string& name);
+
+// Vose's alias method: O(n) to build, O(1) per draw
+class AliasTable {
+private:
+    std::vector<float> m_probability;
+    std::vector<uint32_t> m_alias;
+
+public:
+    // Weights must be positive
+    void build(const std::vector<double>& weights);
+    uint32_t sample(std::mt19937& random) const;
+    size_t size() const {
+        return m_probability.size();
+    }
+};
+
+// The last few songs played, oldest first, for keeping them out of the front
+// of a new order. A bitset by id makes contains() O(1); push() and forget()
+// walk the window, which is a hundred songs or so.
+class RecentWindow {
+private:
+    std::deque<SongId> m_songs;
+    size_t m_capacity;
+    std::vector<uint64_t> m_bits;
+
+    void set_bit(SongId id, bool value);
+    void erase(SongId id);
+
+public:
+    explicit RecentWindow(size_t capacity);
+
+    // A song already in the window moves to the newest end
+    void push(SongId id);
+    bool contains(SongId id) const {
+        return id / 64 < m_bits.size() && (m_bits[id / 64] >> (id % 64)) & 1;
+    }
+    // For removed songs, whose id may be reused
+    void forget(SongId id);
+    void clear();
+    // Zero turns the window off; shrinking keeps the newest songs
+    void resize(size_t capacity);
+    size_t capacity() const {
+        return m_capacity;
+    }
+    size_t size() const {
+        return m_songs.size();
+    }
+    // Oldest first
+    const std::deque<SongId>& songs() const {
+        return m_songs;
+    }
+};
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace nigamp {
+
+// Bounded single-producer/single-consumer ring buffer. Push and pop are
+// wait-free and never allocate, so the producer can be a real-time thread.
+template <typename T>
+class SpscQueue {
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    std::vector<T> m_slots;
+    size_t m_mask;
+    alignas(CACHE_LINE) std::atomic<size_t> m_head{0};  // Next slot to read (consumer)
+    alignas(CACHE_LINE) std::atomic<size_t> m_tail{0};  // Next slot to write (producer)
+
+    static size_t round_up_pow2(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+public:
+    explicit SpscQueue(size_t capacity)
+        : m_slots(round_up_pow2(capacity < 2 ? 2 : capacity))
+        , m_mask(m_slots.size() - 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    bool try_push(const T& item) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= m_slots.size()) {
+            return false;
+        }
+        m_slots[tail & m_mask] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& item) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = m_slots[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const {
+        return m_slots.size();
+    }
+};
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace nigamp {
+
+// What the status line shows; published by the player, drawn by StatusRenderer
+struct StatusSnapshot {
+    bool active{false};     // Nothing is drawn while no track is playing
+    std::string title;
+    double remaining{0.0};  // Seconds
+    double total{0.0};      // Seconds
+    bool paused{false};
+    bool preview{false};
+
+    bool operator==(const StatusSnapshot& other) const;
+    bool operator!=(const StatusSnapshot& other) const { return !(*this == other); }
+};
+
+// MM:SS
+std::string format_time(double seconds);
+std::string format_status_line(const StatusSnapshot& snapshot);
+
+// Draws the one-line status on its own low-priority thread at a fixed frame
+// rate. update() only copies the snapshot, so a slow or blocked terminal can
+// never hold up the caller. A frame is written only when the line changed and
+// only if the output accepts it without blocking; otherwise it is retried on a
+// later frame.
+class StatusRenderer {
+public:
+    static constexpr std::chrono::milliseconds DEFAULT_FRAME_INTERVAL{100};
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+
+public:
+    // fd is ignored on Windows, where the renderer writes to stdout
+    explicit StatusRenderer(int fd = 1, std::chrono::milliseconds frame_interval = DEFAULT_FRAME_INTERVAL);
+    ~StatusRenderer();
+
+    StatusRenderer(const StatusRenderer&) = delete;
+    StatusRenderer& operator=(const StatusRenderer&) = delete;
+
+    void start();
+    void stop();
+    void update(const StatusSnapshot& snapshot);
+};
+
+}
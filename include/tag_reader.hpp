@@ -0,0 +1,43 @@
+#pragma once
+
+#include "types.hpp"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace nigamp {
+
+// Fills title, artist and duration from ID3v2/ID3v1 tags and the first MPEG
+// frame (Xing/VBRI frame counts, else the bitrate), or from a WAV's fmt, data
+// and LIST/INFO chunks. Only tag headers and footers are read, never the audio.
+// Fields the file does not provide are left as they were; false if the file
+// cannot be opened or is neither format.
+bool read_song_tags(const std::string& path, Song& song);
+
+// Reads tags on a small worker pool. At most max_outstanding songs are queued
+// or being read at once; request() blocks until there is room, which keeps a
+// fast directory walk from queueing the whole library.
+class TagReader {
+public:
+    // Runs on a worker thread with the song as tagged (or as given, if reading failed)
+    using Callback = std::function<void(Song)>;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+
+public:
+    TagReader(unsigned threads, size_t max_outstanding);
+    ~TagReader();
+
+    TagReader(const TagReader&) = delete;
+    TagReader& operator=(const TagReader&) = delete;
+
+    void request(Song song, Callback done);
+
+    // Blocks until every request so far has called back
+    void wait();
+};
+
+}
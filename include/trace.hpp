@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+#endif
+
+// Scoped span tracing for the hot paths, exported as Chrome trace JSON
+// (chrome://tracing or ui.perfetto.dev). Configure with -DNIGAMP_TRACING=ON;
+// otherwise TRACE_SCOPE expands to nothing and the recorder is stubbed out.
+// Even when built in, spans are only recorded after trace_enable().
+//
+// Each thread appends to its own fixed-size ring of events without locking;
+// when a ring wraps, the oldest spans of that thread are dropped. Spans are
+// timed with the TSC on x86-64, since a clock_gettime can cost as much as the
+// whole span budget; ticks are converted against steady_clock on export.
+// A span is inlined down to the enabled check, two TSC reads and one ring
+// store; only a thread's first span leaves the header to register its ring.
+
+namespace nigamp {
+
+void trace_enable(bool enabled);
+// Names the calling thread in the exported trace; `name` must be a string literal
+void trace_set_thread_name(const char* name);
+// Writes every recorded span; false if tracing is compiled out or the file cannot be written
+bool write_chrome_trace(const std::string& path);
+// Drops every recorded span (mainly for tests)
+void trace_clear();
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start_ticks;
+    uint64_t end_ticks;
+};
+
+// Single writer (the owning thread); readers copy and discard anything the writer may have lapped
+struct TraceRing {
+    static constexpr size_t CAPACITY = 1 << 14;
+
+    TraceEvent events[CAPACITY];
+    std::atomic<uint64_t> head{0};
+};
+
+namespace trace_detail {
+
+inline std::atomic<bool> g_enabled{false};
+// Null until the thread records its first span
+inline thread_local TraceRing* t_ring = nullptr;
+
+// Allocates and registers the calling thread's ring
+TraceRing& create_ring();
+
+}
+
+inline bool trace_enabled() {
+    return trace_detail::g_enabled.load(std::memory_order_relaxed);
+}
+
+inline uint64_t trace_ticks() {
+#if defined(__x86_64__) || defined(_M_X64)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Records [construction, destruction) under `name`, which must be a string literal
+class TraceSpan {
+private:
+    const char* m_name;
+    uint64_t m_start = 0;
+
+    static void record(const char* name, uint64_t start_ticks, uint64_t end_ticks) {
+        TraceRing* ring = trace_detail::t_ring;
+        if (!ring) {
+            ring = &trace_detail::create_ring();
+        }
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        ring->events[head % TraceRing::CAPACITY] = {name, start_ticks, end_ticks};
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+public:
+    explicit TraceSpan(const char* name) : m_name(trace_enabled() ? name : nullptr) {
+        if (m_name) {
+            m_start = trace_ticks();
+        }
+    }
+
+    ~TraceSpan() {
+        if (m_name) {
+            record(m_name, m_start, trace_ticks());
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+}
+
+#ifdef NIGAMP_TRACING
+    #define NIGAMP_TRACE_JOIN2(a, b) a##b
+    #define NIGAMP_TRACE_JOIN(a, b) NIGAMP_TRACE_JOIN2(a, b)
+    #define TRACE_SCOPE(name) ::nigamp::TraceSpan NIGAMP_TRACE_JOIN(nigamp_trace_span_, __LINE__)(name)
+    #define TRACE_THREAD_NAME(name) ::nigamp::trace_set_thread_name(name)
+#else
+    #define TRACE_SCOPE(name) do {} while(0)
+    #define TRACE_THREAD_NAME(name) do {} while(0)
+#endif
@@ -1,8 +1,16 @@
 #include "audio_engine.hpp"
-#include <alsa/asoundlib.h>
+#include "event_dispatcher.hpp"
+#include "gain_ramp.hpp"
+#include "pcm_device.hpp"
+#include "pcm_recovery.hpp"
+#include "pcm_tee.hpp"
+#include "trace.hpp"
+#include <cerrno>
+#include <cstring>
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
 #include <algorithm>
 #include <string>
 #include <deque>
@@ -12,9 +20,12 @@
 namespace nigamp {
 
 struct AlsaAudioEngine::Impl {
-    snd_pcm_t* pcm_handle = nullptr;
+    std::unique_ptr<IPcmDevice> pcm;
+    PcmRecovery recovery;
+    size_t last_queued_frames = 0;  // Frames queued in the device as of the last avail and writes
     
-    AudioFormat format;
+    AudioFormat format;         // Format of the current track
+    AudioFormat device_format;  // Format the PCM is actually running at
     size_t buffer_size = 0;
     size_t period_size = 0;
     
@@ -27,128 +38,266 @@ struct AlsaAudioEngine::Impl {
     std::mutex buffer_mutex;
 
     std::deque<int16_t> pending_samples;
+    std::condition_variable space_cv;   // Signalled when pending audio drops below the high-water mark
+    static constexpr int HIGH_WATER_MS = 500;
     
-    // Callback-based completion detection
+    // The playback thread sleeps here between refills. Anything that gives it
+    // work sooner (new audio, pause, resume, stop) sets wake_requested.
+    std::condition_variable wake_cv;
+    bool wake_requested = false;        // Guarded by buffer_mutex
+    static constexpr int TRANSITION_POLL_MS = 5;  // While a fade or stop is in flight
+    
+    // Sample-rate conversion into the fixed device rate. The device is opened
+    // at a chosen rate rather than the first track's, so a low-rate opener
+    // doesn't downsample the rest of the session.
+    static constexpr int DEFAULT_DEVICE_RATE = 48000;
+    int preferred_rate = DEFAULT_DEVICE_RATE;
+    ResamplerQuality resampler_quality = ResamplerQuality::MEDIUM;
+    std::unique_ptr<IResampler> resampler;
+    AudioBuffer resample_buffer;
+    std::atomic<uint64_t> device_generation{0};  // Bumped when a reopened device changes rate
+    uint64_t converter_generation = 0;           // Device generation the converter was set up for
+    
+    // Output stage: smoothed volume plus pause/stop fades (audio thread only)
+    enum class OutputState {
+        PLAYING,
+        FADING_TO_PAUSE,
+        PAUSED,
+        FADING_TO_STOP,
+        STOPPED
+    };
+    OutputState output_state = OutputState::PLAYING;
+    GainRamp gain;
+    AudioBuffer write_buffer;
+    std::deque<int16_t> history;    // Pre-gain copy of the audio still queued in the device
+    size_t silence_queued = 0;      // Trailing silence frames queued in the device
+    size_t max_lead_frames = 0;
+    bool hw_can_pause = false;
+    bool hw_paused = false;
+    std::atomic<bool> stop_requested{false};
+    bool stop_faded = false;            // Guarded by buffer_mutex
+    std::condition_variable fade_cv;    // Signalled once stop_faded is set
+    
+    // Capture of exactly what the device played: post-gain, pause silence included
+    std::string capture_path;
+    PcmTee tee;
+    std::deque<int16_t> tee_queue;  // Written to the device but not played yet
+    AudioBuffer tee_buffer;
+    size_t reported_capture_drops = 0;
+    
+    static constexpr double VOLUME_RAMP_MS = 30.0;
+    static constexpr double FADE_MS = 15.0;
+    static constexpr int REWIND_SAFETY_MS = 10;
+    static constexpr int STOP_FADE_TIMEOUT_MS = 150;
+    
+    // Callback-based completion detection. Callbacks run on the dispatcher
+    // thread; the playback thread only posts events.
     CompletionCallback completion_callback;
+    AudioEngineEventCallback event_callback;
     std::atomic<bool> eof_signaled{false};
     std::atomic<bool> callback_fired{false};
     std::mutex callback_mutex;
     size_t total_samples_processed = 0;
     std::chrono::steady_clock::time_point start_time;
+    std::atomic<uint64_t> played_frames{0};  // Track-rate frames heard so far
+    std::chrono::steady_clock::time_point last_position_event;
+    std::atomic<bool> position_queued{false};  // At most one POSITION waits in the dispatcher
+    static constexpr int POSITION_EVENT_INTERVAL_MS = 100;
     
-    // Time-based completion tracking
-    std::chrono::steady_clock::time_point last_audio_written_time;
-    std::chrono::milliseconds estimated_remaining_ms{0};
+    // Declared last so it is joined before the state its handler touches goes away
+    std::unique_ptr<EngineEventDispatcher> dispatcher;
     
-    bool open_pcm() {
-        int err = snd_pcm_open(&pcm_handle, "default", SND_PCM_STREAM_PLAYBACK, 0);
-        if (err < 0) {
-            std::cerr << "ALSA: Cannot open audio device: " << snd_strerror(err) << std::endl;
+    Impl(std::unique_ptr<IPcmDevice> device, const PcmRecoveryPolicy& policy)
+        : pcm(std::move(device)), recovery(*pcm, policy) {}
+    
+    void apply_config(const PcmConfig& config) {
+        device_format.sample_rate = config.sample_rate;
+        device_format.channels = config.channels;
+        device_format.bits_per_sample = 16;
+        buffer_size = config.buffer_frames;
+        period_size = config.period_frames;
+        hw_can_pause = config.can_pause;
+        
+        // Keep only a few periods queued so fades and pauses are heard promptly
+        max_lead_frames = std::min(buffer_size, period_size * 4);
+        gain.configure(device_format.sample_rate, device_format.channels);
+    }
+    
+    bool open_device() {
+        AudioFormat requested = format;
+        requested.sample_rate = preferred_rate;
+        PcmConfig config;
+        if (pcm->open(requested, config) < 0) {
             return false;
         }
+        apply_config(config);
+        // A reopen after a device loss asks for the same rate so the converter stays valid
+        recovery.set_format(device_format);
+        recovery.reset();
+        
+        if (tee.is_open() && tee.get_format().channels != device_format.channels) {
+            std::cerr << "Capture: Device format changed, capture stopped" << std::endl;
+            stop_capture();
+            capture_path.clear();
+        }
+        start_capture();
         return true;
     }
     
-    bool set_hw_params() {
-        snd_pcm_hw_params_t* hw_params;
-        snd_pcm_hw_params_alloca(&hw_params);
-        
-        int err = snd_pcm_hw_params_any(pcm_handle, hw_params);
-        if (err < 0) {
-            std::cerr << "ALSA: Cannot initialize hardware parameters: " << snd_strerror(err) << std::endl;
-            return false;
+    void start_capture() {
+        if (capture_path.empty() || tee.is_open()) {
+            return;
         }
-        
-        err = snd_pcm_hw_params_set_access(pcm_handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
-        if (err < 0) {
-            std::cerr << "ALSA: Cannot set access type: " << snd_strerror(err) << std::endl;
-            return false;
+        if (!tee.open(capture_path, device_format)) {
+            std::cerr << "Capture: Cannot open " << capture_path << std::endl;
+            capture_path.clear();
+            return;
         }
-        
-        snd_pcm_format_t pcm_format = SND_PCM_FORMAT_S16_LE;
-        err = snd_pcm_hw_params_set_format(pcm_handle, hw_params, pcm_format);
-        if (err < 0) {
-            std::cerr << "ALSA: Cannot set sample format: " << snd_strerror(err) << std::endl;
-            return false;
+        reported_capture_drops = 0;
+        std::cout << "Capture: Recording output to " << capture_path << std::endl;
+    }
+    
+    void stop_capture() {
+        if (!tee.is_open()) {
+            return;
         }
-        
-        unsigned int channels = format.channels;
-        err = snd_pcm_hw_params_set_channels(pcm_handle, hw_params, channels);
-        if (err < 0) {
-            std::cerr << "ALSA: Cannot set channel count: " << snd_strerror(err) << std::endl;
-            return false;
+        tee.close();
+        tee_queue.clear();
+        std::cout << "Capture: " << tee.get_frames_written() << " frames written to " << capture_path;
+        if (tee.get_dropped_frames() > 0) {
+            std::cout << " (" << tee.get_dropped_frames() << " dropped)";
         }
-        
-        unsigned int sample_rate = format.sample_rate;
-        err = snd_pcm_hw_params_set_rate_near(pcm_handle, hw_params, &sample_rate, 0);
-        if (err < 0) {
-            std::cerr << "ALSA: Cannot set sample rate: " << snd_strerror(err) << std::endl;
-            return false;
+        std::cout << std::endl;
+    }
+    
+    void queue_for_capture(const int16_t* samples, size_t count) {
+        if (tee.is_open()) {
+            tee_queue.insert(tee_queue.end(), samples, samples + count);
         }
-        
-        // Set buffer size (2 seconds of audio)
-        buffer_size = format.sample_rate * 2;
-        snd_pcm_uframes_t buffer_frames = buffer_size;
-        err = snd_pcm_hw_params_set_buffer_size_near(pcm_handle, hw_params, &buffer_frames);
-        if (err < 0) {
-            std::cerr << "ALSA: Cannot set buffer size: " << snd_strerror(err) << std::endl;
-            return false;
+    }
+    
+    // Forget the newest frames: they were pulled back out of the device unplayed
+    void unqueue_capture(size_t frames) {
+        size_t samples = std::min(frames * device_format.channels, tee_queue.size());
+        tee_queue.erase(tee_queue.end() - samples, tee_queue.end());
+    }
+    
+    // Everything older than what is still queued in the device has been played
+    void commit_capture(size_t queued_frames) {
+        if (!tee.is_open()) {
+            return;
         }
-        buffer_size = buffer_frames;
-        
-        // Set period size (50ms of audio for low latency)
-        period_size = format.sample_rate / 20; // 50ms
-        snd_pcm_uframes_t period_frames = period_size;
-        err = snd_pcm_hw_params_set_period_size_near(pcm_handle, hw_params, &period_frames, 0);
-        if (err < 0) {
-            std::cerr << "ALSA: Cannot set period size: " << snd_strerror(err) << std::endl;
-            return false;
+        size_t queued_samples = queued_frames * device_format.channels;
+        if (tee_queue.size() > queued_samples) {
+            size_t played = tee_queue.size() - queued_samples;
+            tee_buffer.assign(tee_queue.begin(), tee_queue.begin() + played);
+            tee_queue.erase(tee_queue.begin(), tee_queue.begin() + played);
+            tee.write(tee_buffer.data(), played);
         }
-        period_size = period_frames;
         
-        err = snd_pcm_hw_params(pcm_handle, hw_params);
-        if (err < 0) {
-            std::cerr << "ALSA: Cannot set hardware parameters: " << snd_strerror(err) << std::endl;
+        size_t dropped = tee.get_dropped_frames();
+        if (dropped > reported_capture_drops) {
+            if (reported_capture_drops == 0) {
+                std::cerr << "Capture: Writer is falling behind, dropping audio" << std::endl;
+            }
+            reported_capture_drops = dropped;
+            AudioEngineEvent event;
+            event.type = AudioEngineEventType::CAPTURE_OVERFLOW;
+            event.frames_dropped = dropped;
+            event.sample_rate = device_format.sample_rate;
+            dispatcher->post(event);
+        }
+    }
+    
+    bool configure_resampler() {
+        if (!resampler) {
+            resampler = create_resampler(resampler_quality);
+        }
+        converter_generation = device_generation;
+        if (!resampler->configure(format.sample_rate, device_format.sample_rate, format.channels)) {
+            std::cerr << "ALSA: Cannot convert " << format.sample_rate << " Hz to "
+                      << device_format.sample_rate << " Hz" << std::endl;
             return false;
         }
-        
+        if (!resampler->is_passthrough()) {
+            std::cout << "ALSA: Resampling " << format.sample_rate << " Hz -> "
+                      << device_format.sample_rate << " Hz" << std::endl;
+        }
         return true;
     }
     
+    // The track is over once only trailing silence is left in the device
     void check_completion() {
-        if (eof_signaled.load() && pending_samples.empty()) {
-            bool time_elapsed = is_audio_playback_complete_by_time();
-            
-            if (time_elapsed) {
-                fire_completion_callback(AudioEngineError::SUCCESS);
-            }
+        if (eof_signaled.load() && pending_samples.empty() && silence_queued >= last_queued_frames) {
+            fire_completion_callback(AudioEngineError::SUCCESS);
         }
     }
     
-    bool is_audio_playback_complete_by_time() {
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - last_audio_written_time);
-        return elapsed >= estimated_remaining_ms;
+    // Device-rate frames of audio (not padding) that have left the speaker
+    size_t played_device_frames(size_t queued_frames) const {
+        size_t written_frames = total_samples_processed / device_format.channels;
+        size_t queued_audio = queued_frames > silence_queued ? queued_frames - silence_queued : 0;
+        return written_frames > queued_audio ? written_frames - queued_audio : 0;
+    }
+    
+    void update_played_frames(size_t queued_frames) {
+        uint64_t frames = played_device_frames(queued_frames);
+        played_frames = frames * format.sample_rate / device_format.sample_rate;
     }
     
     void fire_completion_callback(AudioEngineError error_code) {
-        std::lock_guard<std::mutex> lock(callback_mutex);
-        if (!callback_fired.exchange(true) && completion_callback) {
-            try {
-                auto completion_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    std::chrono::steady_clock::now() - start_time);
-                    
-                CompletionResult result;
-                result.error_code = error_code;
-                result.error_message = get_error_description(error_code);
-                result.completion_time = completion_time;
-                result.samples_processed = total_samples_processed;
-                
-                completion_callback(result);
-            } catch (...) {
-                // Log exception but don't crash audio thread
+        if (!callback_fired.exchange(true)) {
+            AudioEngineEvent event;
+            event.type = AudioEngineEventType::COMPLETION;
+            event.error_code = error_code;
+            event.completion_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start_time);
+            event.samples_processed = total_samples_processed;
+            event.frames_played = played_device_frames(last_queued_frames);
+            event.sample_rate = device_format.sample_rate;
+            // A full queue must not cost the player the end of the track
+            dispatcher->post_reserved(event);
+        }
+    }
+    
+    bool post_event(AudioEngineEventType type, size_t queued_frames) {
+        AudioEngineEvent event;
+        event.type = type;
+        event.samples_processed = total_samples_processed;
+        event.frames_played = played_device_frames(queued_frames);
+        event.sample_rate = device_format.sample_rate;
+        return dispatcher->post(event);
+    }
+    
+    // Runs on the dispatcher thread
+    void deliver_event(const AudioEngineEvent& event) {
+        if (event.type == AudioEngineEventType::POSITION) {
+            position_queued = false;
+        }
+        
+        // Called without the lock, so a callback may stop() or replace the callbacks
+        CompletionCallback on_completion;
+        AudioEngineEventCallback on_event;
+        {
+            std::lock_guard<std::mutex> lock(callback_mutex);
+            on_completion = completion_callback;
+            on_event = event_callback;
+        }
+        try {
+            if (event.type == AudioEngineEventType::COMPLETION) {
+                if (on_completion) {
+                    CompletionResult result;
+                    result.error_code = event.error_code;
+                    result.error_message = get_error_description(event.error_code);
+                    result.completion_time = event.completion_time;
+                    result.samples_processed = event.samples_processed;
+                    on_completion(result);
+                }
+            } else if (on_event) {
+                on_event(event);
             }
+        } catch (...) {
+            // Log exception but don't crash the dispatcher
         }
     }
     
@@ -160,126 +309,450 @@ struct AlsaAudioEngine::Impl {
             case AudioEngineError::THREADING_ERROR: return "Threading synchronization error";
             case AudioEngineError::DIRECTSOUND_FAILURE: return "ALSA operation failed";
             case AudioEngineError::CALLBACK_TIMEOUT: return "Completion callback timeout";
+            case AudioEngineError::DEVICE_FAILURE: return "Audio device could not be recovered";
             default: return "Unknown error";
         }
     }
     
     void playback_loop() {
+        TRACE_THREAD_NAME("audio engine");
         while (!should_stop) {
-            if (is_playing && !is_paused && pcm_handle) {
+            if (is_playing) {
                 update_buffer();
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            
+            std::unique_lock<std::mutex> lock(buffer_mutex);
+            auto woken = [&]() { return wake_requested || should_stop; };
+            auto deadline = next_wake();
+            if (!is_playing || deadline == std::chrono::steady_clock::time_point::max()) {
+                wake_cv.wait(lock, woken);
+            } else {
+                wake_cv.wait_until(lock, deadline, woken);
+            }
+            wake_requested = false;
         }
     }
     
-    void update_buffer() {
-        std::lock_guard<std::mutex> lock(buffer_mutex);
+    // Caller holds buffer_mutex
+    void request_wake() {
+        wake_requested = true;
+        wake_cv.notify_one();
+    }
+    
+    // When the playback thread next has anything to do, given the state the last
+    // update_buffer() left. Caller holds buffer_mutex.
+    std::chrono::steady_clock::time_point next_wake() const {
+        using Clock = std::chrono::steady_clock;
+        auto now = Clock::now();
+        if (!recovery.is_running()) {
+            if (recovery.get_state() == PcmRecoveryState::FAILED) {
+                return Clock::time_point::max();
+            }
+            return std::max(now, recovery.get_next_attempt());
+        }
+        if (hw_paused) {
+            return Clock::time_point::max();
+        }
         
-        if (pending_samples.empty()) {
-            check_completion();
-            return;
+        if (output_state == OutputState::FADING_TO_PAUSE || output_state == OutputState::FADING_TO_STOP) {
+            return now + std::chrono::milliseconds(TRANSITION_POLL_MS);
         }
         
-        // Get available space in ALSA buffer
-        snd_pcm_sframes_t avail = snd_pcm_avail(pcm_handle);
-        if (avail < 0) {
-            // Handle underrun
-            if (avail == -EPIPE) {
-                snd_pcm_prepare(pcm_handle);
+        auto frames_to_time = [&](size_t frames) {
+            return std::chrono::microseconds(
+                static_cast<int64_t>(frames) * 1000000 / std::max(device_format.sample_rate, 1));
+        };
+        // Once the queued audio has played a track ends, a stop fade is done or
+        // the device can be paused
+        size_t audio = last_queued_frames > silence_queued ? last_queued_frames - silence_queued : 0;
+        bool draining = output_state != OutputState::PLAYING || (eof_signaled && pending_samples.empty());
+        if (draining && audio > 0) {
+            return now + std::max(frames_to_time(audio), std::chrono::microseconds(TRANSITION_POLL_MS * 1000));
+        }
+        // Otherwise top the device up again after about a period has played
+        return now + frames_to_time(period_size);
+    }
+    
+    // Caller holds buffer_mutex
+    void mark_stop_faded() {
+        stop_faded = true;
+        fade_cv.notify_all();
+    }
+    
+    void update_output_state() {
+        if (stop_requested && output_state != OutputState::FADING_TO_STOP && output_state != OutputState::STOPPED) {
+            if (output_state == OutputState::PAUSED) {
+                // Already silent, nothing left to fade
+                output_state = OutputState::STOPPED;
+                mark_stop_faded();
+            } else {
+                reclaim_queued_audio();
+                gain.set_fade(0.0f, FADE_MS);
+                output_state = OutputState::FADING_TO_STOP;
             }
-            return;
+        } else if (is_paused && output_state == OutputState::PLAYING) {
+            reclaim_queued_audio();
+            gain.set_fade(0.0f, FADE_MS);
+            output_state = OutputState::FADING_TO_PAUSE;
+        } else if (!is_paused && (output_state == OutputState::FADING_TO_PAUSE || output_state == OutputState::PAUSED)) {
+            if (hw_paused) {
+                if (pcm->pause(false) < 0) {
+                    pcm->prepare();
+                }
+                hw_paused = false;
+            } else if (output_state == OutputState::PAUSED) {
+                // Throw away the queued silence so audio resumes immediately
+                reclaim_queued_audio();
+            }
+            gain.set_fade(1.0f, FADE_MS);
+            output_state = OutputState::PLAYING;
         }
         
-        // Write up to period_size samples
-        size_t samples_to_write = std::min(
-            static_cast<size_t>(avail),
-            std::min(pending_samples.size(), period_size * format.channels)
-        );
+        // Volume changes glide instead of stepping
+        float target_volume = volume.load();
+        if (target_volume != gain.get_volume_target()) {
+            gain.set_volume(target_volume, VOLUME_RAMP_MS);
+        }
+    }
+    
+    // Pull not-yet-played frames back out of the device so a fade starts within
+    // a few milliseconds instead of after the queued lead has drained.
+    void reclaim_queued_audio() {
+        long rewindable = pcm->rewindable();
+        long keep = device_format.sample_rate * REWIND_SAFETY_MS / 1000;
+        if (rewindable <= keep) {
+            return;
+        }
         
-        if (samples_to_write == 0) {
+        long rewound = pcm->rewind(rewindable - keep);
+        if (rewound <= 0) {
             return;
         }
         
-        // Prepare buffer for writing
-        std::vector<int16_t> write_buffer(samples_to_write);
-        for (size_t i = 0; i < samples_to_write; ++i) {
-            int16_t sample = pending_samples[i];
-            // Apply volume
-            sample = static_cast<int16_t>(sample * volume.load());
-            write_buffer[i] = sample;
+        size_t frames = static_cast<size_t>(rewound);
+        unqueue_capture(frames);
+        last_queued_frames -= std::min(last_queued_frames, frames);
+        size_t silent_frames = std::min(frames, silence_queued);
+        silence_queued -= silent_frames;
+        frames -= silent_frames;
+        
+        // Rewound audio goes back to the front of the queue to be replayed with the fade
+        size_t samples = std::min(frames * device_format.channels, history.size());
+        pending_samples.insert(pending_samples.begin(), history.end() - samples, history.end());
+        history.erase(history.end() - samples, history.end());
+        total_samples_processed -= std::min(total_samples_processed, samples);
+    }
+    
+    void write_audio(size_t max_frames) {
+        size_t channels = device_format.channels;
+        size_t frames = std::min(max_frames, pending_samples.size() / channels);
+        if (frames == 0) {
+            return;
         }
         
-        // Write to ALSA
-        snd_pcm_sframes_t frames_written = snd_pcm_writei(
-            pcm_handle, 
-            write_buffer.data(), 
-            samples_to_write / format.channels
-        );
+        size_t samples = frames * channels;
+        write_buffer.assign(pending_samples.begin(), pending_samples.begin() + samples);
+        gain.process(write_buffer.data(), frames);
         
+        long frames_written = pcm->write(write_buffer.data(), frames);
         if (frames_written < 0) {
-            // Handle errors
-            if (frames_written == -EPIPE) {
-                snd_pcm_prepare(pcm_handle);
-            } else if (frames_written == -ESTRPIPE) {
-                snd_pcm_resume(pcm_handle);
-            }
+            handle_device_error(frames_written);
             return;
         }
         
-        size_t samples_written = frames_written * format.channels;
+        size_t samples_written = frames_written * channels;
         total_samples_processed += samples_written;
+        last_queued_frames += frames_written;
+        queue_for_capture(write_buffer.data(), samples_written);
+        
+        // History must describe the contiguous audio tail of the device queue
+        if (silence_queued > 0) {
+            history.clear();
+            silence_queued = 0;
+        }
+        history.insert(history.end(), pending_samples.begin(), pending_samples.begin() + samples_written);
+        size_t history_limit = max_lead_frames * channels;
+        if (history.size() > history_limit) {
+            history.erase(history.begin(), history.begin() + (history.size() - history_limit));
+        }
         
         pending_samples.erase(
             pending_samples.begin(), 
             pending_samples.begin() + samples_written
         );
+    }
+    
+    void write_silence(size_t frames) {
+        if (frames == 0) {
+            return;
+        }
+        write_buffer.assign(frames * device_format.channels, 0);
+        long frames_written = pcm->write(write_buffer.data(), frames);
+        if (frames_written < 0) {
+            handle_device_error(frames_written);
+            return;
+        }
+        silence_queued += frames_written;
+        last_queued_frames += frames_written;
+        queue_for_capture(write_buffer.data(), frames_written * device_format.channels);
+    }
+    
+    void handle_device_error(long error) {
+        if (error == -EPIPE) {
+            post_event(AudioEngineEventType::XRUN, 0);
+        }
+        bool was_running = recovery.is_running();
+        PcmRecoveryResult result = recovery.handle_error(error, std::chrono::steady_clock::now());
+        if (error == -EPIPE) {
+            // An underrun means the device played everything it had
+            last_queued_frames = 0;
+        }
+        if (was_running && !recovery.is_running()) {
+            std::cerr << "ALSA: Audio device unavailable (" << error << "), trying to recover" << std::endl;
+            post_event(AudioEngineEventType::DEVICE_LOST, 0);
+        }
+        apply_recovery_result(result);
+    }
+    
+    void apply_recovery_result(PcmRecoveryResult result) {
+        if (result == PcmRecoveryResult::RESTARTED || result == PcmRecoveryResult::REOPENED) {
+            requeue_lost_audio();
+        }
+        if (result == PcmRecoveryResult::REOPENED) {
+            const PcmConfig& config = recovery.get_config();
+            if (config.sample_rate != device_format.sample_rate) {
+                change_device_rate(config.sample_rate);
+            }
+            apply_config(config);
+            recovery.set_format(device_format);
+            hw_paused = false;
+            std::cout << "ALSA: Audio device restored" << std::endl;
+            post_event(AudioEngineEventType::DEVICE_RESTORED, 0);
+        } else if (result == PcmRecoveryResult::FAILED) {
+            std::cerr << "ALSA: Audio device keeps coming back with other channels, giving up" << std::endl;
+            fire_completion_callback(AudioEngineError::DEVICE_FAILURE);
+        }
+    }
+    
+    // A replugged device may negotiate another rate. Convert the audio queued
+    // for the old one and have the producer retune its converter on its next
+    // block, so the track carries on at the right pitch.
+    void change_device_rate(int rate) {
+        std::cout << "ALSA: Device came back at " << rate << " Hz instead of "
+                  << device_format.sample_rate << " Hz, converting" << std::endl;
+        auto converter = create_resampler(resampler_quality);
+        if (converter->configure(device_format.sample_rate, rate, device_format.channels)) {
+            AudioBuffer queued(pending_samples.begin(), pending_samples.end());
+            AudioBuffer converted;
+            AudioBuffer tail;
+            converter->process(queued, converted);
+            converter->flush(tail);
+            pending_samples.assign(converted.begin(), converted.end());
+            pending_samples.insert(pending_samples.end(), tail.begin(), tail.end());
+        }
+        uint64_t frames = total_samples_processed / device_format.channels;
+        total_samples_processed = static_cast<size_t>(frames * rate / device_format.sample_rate) * device_format.channels;
+        ++device_generation;
         
-        // Update timing-based completion tracking
-        last_audio_written_time = std::chrono::steady_clock::now();
-        size_t buffer_samples = buffer_size * format.channels;
-        estimated_remaining_ms = std::chrono::milliseconds(
-            (buffer_samples * 1000) / format.sample_rate);
+        if (tee.is_open()) {
+            std::cerr << "Capture: Device format changed, capture stopped" << std::endl;
+            stop_capture();
+            capture_path.clear();
+        }
+    }
+    
+    // The device dropped whatever it had queued; play that audio again so the
+    // track continues from where it was actually heard, not where the decoder is.
+    void requeue_lost_audio() {
+        size_t lost_frames = last_queued_frames > silence_queued ? last_queued_frames - silence_queued : 0;
+        size_t samples = std::min(lost_frames * device_format.channels, history.size());
+        pending_samples.insert(pending_samples.begin(), history.end() - samples, history.end());
+        total_samples_processed -= std::min(total_samples_processed, samples);
+        unqueue_capture(last_queued_frames);
+        history.clear();
+        silence_queued = 0;
+        last_queued_frames = 0;
+        hw_paused = false;
+        
+        if (output_state == OutputState::PLAYING) {
+            gain.jump_fade(0.0f);
+            gain.set_fade(1.0f, FADE_MS);
+        }
+    }
+    
+    void finish_fade() {
+        if (output_state == OutputState::FADING_TO_PAUSE) {
+            output_state = OutputState::PAUSED;
+        } else if (output_state == OutputState::FADING_TO_STOP) {
+            output_state = OutputState::STOPPED;
+        }
+    }
+    
+    void update_buffer() {
+        TRACE_SCOPE("AlsaAudioEngine::update_buffer");
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        
+        if (!recovery.is_running()) {
+            apply_recovery_result(recovery.poll(std::chrono::steady_clock::now()));
+            if (!recovery.is_running()) {
+                // Nothing can be heard while the device is gone, so don't hold up stop()
+                if (stop_requested) {
+                    mark_stop_faded();
+                }
+                return;
+            }
+        }
+        
+        update_output_state();
+        
+        if (hw_paused) {
+            return;
+        }
+        
+        // Get available space in ALSA buffer
+        long avail = pcm->avail();
+        if (avail < 0) {
+            handle_device_error(avail);
+            return;
+        }
+        
+        size_t queued = buffer_size > static_cast<size_t>(avail) ? buffer_size - avail : 0;
+        last_queued_frames = queued;
+        commit_capture(queued);
+        update_played_frames(queued);
+        
+        auto now = std::chrono::steady_clock::now();
+        if (output_state == OutputState::PLAYING &&
+            now - last_position_event >= std::chrono::milliseconds(POSITION_EVENT_INTERVAL_MS)) {
+            // Positions coalesce while the handler is behind so they never fill the queue
+            if (!position_queued.exchange(true) && !post_event(AudioEngineEventType::POSITION, queued)) {
+                position_queued = false;
+            }
+            last_position_event = now;
+        }
+        
+        if (output_state == OutputState::PAUSED || output_state == OutputState::STOPPED) {
+            // Once only silence is left queued the fade has been heard in full
+            bool fade_played = silence_queued >= queued;
+            if (output_state == OutputState::STOPPED && fade_played) {
+                mark_stop_faded();
+            }
+            if (output_state == OutputState::PAUSED && fade_played && hw_can_pause) {
+                if (pcm->pause(true) == 0) {
+                    hw_paused = true;
+                    return;
+                }
+                // Device refused; keep it running on silence from now on
+                hw_can_pause = false;
+            }
+            
+            // Software pause: keep the device fed with a short lead of silence
+            size_t silence_lead = period_size * 2;
+            if (queued < silence_lead) {
+                write_silence(silence_lead - queued);
+            }
+            return;
+        }
+        
+        if (pending_samples.empty()) {
+            if (output_state == OutputState::PLAYING && eof_signaled) {
+                // Pad the tail with silence so the device drains without an xrun
+                size_t silence_lead = period_size * 2;
+                if (queued < silence_lead) {
+                    write_silence(silence_lead - queued);
+                }
+                check_completion();
+            } else if (output_state != OutputState::PLAYING) {
+                // Nothing left to fade out
+                gain.jump_fade(0.0f);
+                finish_fade();
+            }
+            return;
+        }
+        
+        if (queued >= max_lead_frames) {
+            return;
+        }
+        
+        write_audio(max_lead_frames - queued);
+        space_cv.notify_one();
+        
+        if (output_state != OutputState::PLAYING && !gain.is_fading()) {
+            finish_fade();
+        }
     }
 };
 
-AlsaAudioEngine::AlsaAudioEngine() : m_impl(std::make_unique<Impl>()) {}
+AlsaAudioEngine::AlsaAudioEngine() : AlsaAudioEngine(create_alsa_pcm_device()) {}
+
+AlsaAudioEngine::AlsaAudioEngine(std::unique_ptr<IPcmDevice> device)
+    : AlsaAudioEngine(std::move(device), PcmRecoveryPolicy()) {}
+
+AlsaAudioEngine::AlsaAudioEngine(std::unique_ptr<IPcmDevice> device, const PcmRecoveryPolicy& recovery_policy)
+    : m_impl(std::make_unique<Impl>(std::move(device), recovery_policy)) {
+    Impl* impl = m_impl.get();
+    m_impl->dispatcher = std::make_unique<EngineEventDispatcher>(
+        [impl](const AudioEngineEvent& event) { impl->deliver_event(event); });
+}
 
 AlsaAudioEngine::~AlsaAudioEngine() {
     shutdown();
 }
 
 bool AlsaAudioEngine::initialize(const AudioFormat& fmt) {
+    TRACE_SCOPE("AlsaAudioEngine::initialize");
     m_impl->format = fmt;
     
-    if (!m_impl->open_pcm()) {
-        return false;
+    // Keep the device at its fixed rate across tracks; only the converter changes.
+    // A device that is being recovered counts as open so tracks queue up for it.
+    bool device_usable = m_impl->pcm->is_open() ||
+                         (!m_impl->recovery.is_running() && m_impl->recovery.get_state() != PcmRecoveryState::FAILED);
+    if (device_usable && m_impl->device_format.channels == fmt.channels) {
+        return m_impl->configure_resampler();
     }
     
-    if (!m_impl->set_hw_params()) {
-        snd_pcm_close(m_impl->pcm_handle);
-        m_impl->pcm_handle = nullptr;
+    if (!m_impl->open_device()) {
         return false;
     }
     
-    return true;
+    return m_impl->configure_resampler();
 }
 
 bool AlsaAudioEngine::start() {
-    if (!m_impl->pcm_handle) {
+    if (!m_impl->pcm->is_open() && m_impl->recovery.is_running()) {
         return false;
     }
     
-    int err = snd_pcm_prepare(m_impl->pcm_handle);
-    if (err < 0) {
-        std::cerr << "ALSA: Cannot prepare PCM: " << snd_strerror(err) << std::endl;
-        return false;
+    // While the device is being recovered the playback thread keeps queueing
+    if (m_impl->recovery.is_running()) {
+        int err = m_impl->pcm->prepare();
+        if (err < 0) {
+            std::cerr << "ALSA: Cannot prepare PCM: " << std::strerror(-err) << std::endl;
+            return false;
+        }
     }
     
     // Reset state for new playback
+    m_impl->history.clear();
+    m_impl->silence_queued = 0;
+    m_impl->last_queued_frames = 0;
+    m_impl->hw_paused = false;
+    m_impl->stop_requested = false;
+    m_impl->gain.set_volume(m_impl->volume.load(), 0.0);
+    if (m_impl->is_paused) {
+        m_impl->gain.jump_fade(0.0f);
+        m_impl->output_state = Impl::OutputState::PAUSED;
+    } else {
+        // Short fade-in so the new track never starts on a step
+        m_impl->gain.jump_fade(0.0f);
+        m_impl->gain.set_fade(1.0f, Impl::FADE_MS);
+        m_impl->output_state = Impl::OutputState::PLAYING;
+    }
+    
     m_impl->eof_signaled = false;
     m_impl->callback_fired = false;
     m_impl->total_samples_processed = 0;
+    m_impl->played_frames = 0;
     m_impl->start_time = std::chrono::steady_clock::now();
     
     m_impl->is_playing = true;
@@ -290,13 +763,31 @@ bool AlsaAudioEngine::start() {
 }
 
 bool AlsaAudioEngine::stop() {
-    if (!m_impl->pcm_handle) {
+    TRACE_SCOPE("AlsaAudioEngine::stop");
+    if (!m_impl->pcm->is_open() && m_impl->recovery.is_running()) {
         return false;
     }
     
-    // Signal thread to stop FIRST
+    // Fade out what is queued before dropping it so skips and stops don't click
+    if (m_impl->is_playing && m_impl->playback_thread.joinable()) {
+        std::unique_lock<std::mutex> lock(m_impl->buffer_mutex);
+        m_impl->stop_faded = false;
+        m_impl->stop_requested = true;
+        m_impl->request_wake();
+        m_impl->fade_cv.wait_for(lock, std::chrono::milliseconds(Impl::STOP_FADE_TIMEOUT_MS), [&]() {
+            return m_impl->stop_faded;
+        });
+    }
+    
+    // Signal thread to stop
     m_impl->is_playing = false;
     m_impl->should_stop = true;
+    {
+        // Release a producer blocked on a full queue, and the playback thread
+        std::lock_guard<std::mutex> lock(m_impl->buffer_mutex);
+        m_impl->space_cv.notify_all();
+        m_impl->request_wake();
+    }
     
     // Wait for playback thread to finish
     if (m_impl->playback_thread.joinable()) {
@@ -304,56 +795,96 @@ bool AlsaAudioEngine::stop() {
     }
     
     // Stop ALSA
-    snd_pcm_drop(m_impl->pcm_handle);
+    m_impl->pcm->drop();
     
     // Clear data structures
     {
         std::lock_guard<std::mutex> lock(m_impl->buffer_mutex);
         m_impl->pending_samples.clear();
+        // Whatever was still queued in the device was never heard
+        m_impl->tee_queue.clear();
     }
     
-    // Clear callback
+    // Clear callback, then let the dispatcher discard anything still queued
     {
         std::lock_guard<std::mutex> lock(m_impl->callback_mutex);
         m_impl->completion_callback = nullptr;
     }
+    m_impl->dispatcher->flush();
     
     return true;
 }
 
 bool AlsaAudioEngine::pause() {
-    if (m_impl->pcm_handle) {
-        snd_pcm_pause(m_impl->pcm_handle, 1);
-    }
+    // The playback thread fades out, then uses hardware pause or feeds silence
     m_impl->is_paused = true;
+    std::lock_guard<std::mutex> lock(m_impl->buffer_mutex);
+    m_impl->request_wake();
     return true;
 }
 
 bool AlsaAudioEngine::resume() {
-    if (m_impl->pcm_handle) {
-        snd_pcm_pause(m_impl->pcm_handle, 0);
-    }
     m_impl->is_paused = false;
+    std::lock_guard<std::mutex> lock(m_impl->buffer_mutex);
+    m_impl->request_wake();
     return true;
 }
 
 void AlsaAudioEngine::shutdown() {
     stop();
     
-    if (m_impl->pcm_handle) {
-        snd_pcm_close(m_impl->pcm_handle);
-        m_impl->pcm_handle = nullptr;
-    }
+    m_impl->pcm->close();
+    m_impl->recovery.reset();
+    
+    std::lock_guard<std::mutex> lock(m_impl->buffer_mutex);
+    m_impl->stop_capture();
 }
 
 bool AlsaAudioEngine::write_samples(const AudioBuffer& buffer) {
-    std::lock_guard<std::mutex> lock(m_impl->buffer_mutex);
-    m_impl->pending_samples.insert(
-        m_impl->pending_samples.end(), 
-        buffer.begin(), 
-        buffer.end()
-    );
-    return true;
+    std::unique_lock<std::mutex> lock(m_impl->buffer_mutex, std::defer_lock);
+    for (;;) {
+        uint64_t generation = m_impl->device_generation;
+        if (generation != m_impl->converter_generation) {
+            lock.lock();
+            m_impl->configure_resampler();
+            lock.unlock();
+        }
+        
+        // Convert on the producer thread so the ALSA thread only copies device-rate audio
+        const AudioBuffer* samples = &buffer;
+        if (m_impl->resampler && !m_impl->resampler->is_passthrough()) {
+            m_impl->resampler->process(buffer, m_impl->resample_buffer);
+            samples = &m_impl->resample_buffer;
+        }
+        
+        // Block instead of queueing without bound, so the decoder never has to poll
+        lock.lock();
+        size_t high_water = static_cast<size_t>(m_impl->device_format.sample_rate) *
+                            m_impl->device_format.channels * Impl::HIGH_WATER_MS / 1000;
+        m_impl->space_cv.wait(lock, [&]() {
+            return !m_impl->is_playing || m_impl->pending_samples.size() < high_water;
+        });
+        if (!m_impl->is_playing) {
+            return false;
+        }
+        
+        if (m_impl->device_generation != generation) {
+            // The device changed rate while this block was converted: convert it again
+            lock.unlock();
+            continue;
+        }
+        
+        // A playback thread waiting for audio shouldn't sleep out its period
+        if (m_impl->pending_samples.size() < m_impl->max_lead_frames * m_impl->device_format.channels) {
+            m_impl->request_wake();
+        }
+        m_impl->pending_samples.insert(
+            m_impl->pending_samples.end(), 
+            samples->begin(), 
+            samples->end()
+        );
+        return true;
+    }
 }
 
 size_t AlsaAudioEngine::get_buffer_size() const {
@@ -377,11 +908,29 @@ void AlsaAudioEngine::set_completion_callback(CompletionCallback callback) {
     m_impl->completion_callback = callback;
 }
 
+void AlsaAudioEngine::set_event_callback(AudioEngineEventCallback callback) {
+    std::lock_guard<std::mutex> lock(m_impl->callback_mutex);
+    m_impl->event_callback = callback;
+}
+
 void AlsaAudioEngine::signal_eof() {
+    // The converter still holds the last few milliseconds of the track
+    if (m_impl->resampler && !m_impl->resampler->is_passthrough()) {
+        m_impl->resampler->flush(m_impl->resample_buffer);
+    } else {
+        m_impl->resample_buffer.clear();
+    }
+    
+    std::lock_guard<std::mutex> lock(m_impl->buffer_mutex);
+    // A tail converted for a device rate that has since changed is left out
+    if (m_impl->is_playing && m_impl->device_generation == m_impl->converter_generation) {
+        m_impl->pending_samples.insert(m_impl->pending_samples.end(),
+                                       m_impl->resample_buffer.begin(), m_impl->resample_buffer.end());
+    }
     m_impl->eof_signaled = true;
+    m_impl->request_wake();
     
     // Check completion immediately in case buffers are already empty
-    std::lock_guard<std::mutex> lock(m_impl->buffer_mutex);
     m_impl->check_completion();
 }
 
@@ -390,6 +939,32 @@ size_t AlsaAudioEngine::get_buffered_samples() const {
     return m_impl->pending_samples.size();
 }
 
+uint64_t AlsaAudioEngine::get_played_frames() const {
+    return m_impl->played_frames;
+}
+
+void AlsaAudioEngine::set_resampler_quality(ResamplerQuality quality) {
+    m_impl->resampler_quality = quality;
+    m_impl->resampler.reset();
+    if (m_impl->pcm->is_open()) {
+        m_impl->configure_resampler();
+    }
+}
+
+void AlsaAudioEngine::set_device_rate(int sample_rate) {
+    m_impl->preferred_rate = sample_rate > 0 ? sample_rate : Impl::DEFAULT_DEVICE_RATE;
+}
+
+bool AlsaAudioEngine::set_capture_path(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_impl->buffer_mutex);
+    m_impl->stop_capture();
+    m_impl->capture_path = path;
+    if (m_impl->pcm->is_open()) {
+        m_impl->start_capture();
+    }
+    return true;
+}
+
 std::unique_ptr<IAudioEngine> create_audio_engine() {
     return std::make_unique<AlsaAudioEngine>();
 }
@@ -0,0 +1,157 @@
+#include "pcm_device.hpp"
+#include <alsa/asoundlib.h>
+#include <iostream>
+
+namespace nigamp {
+
+class AlsaPcmDevice : public IPcmDevice {
+private:
+    std::string m_name;
+    snd_pcm_t* m_handle = nullptr;
+
+    bool set_hw_params(const AudioFormat& requested, PcmConfig& actual) {
+        snd_pcm_hw_params_t* hw_params;
+        snd_pcm_hw_params_alloca(&hw_params);
+
+        int err = snd_pcm_hw_params_any(m_handle, hw_params);
+        if (err < 0) {
+            std::cerr << "ALSA: Cannot initialize hardware parameters: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+
+        err = snd_pcm_hw_params_set_access(m_handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
+        if (err < 0) {
+            std::cerr << "ALSA: Cannot set access type: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+
+        snd_pcm_format_t pcm_format = SND_PCM_FORMAT_S16_LE;
+        err = snd_pcm_hw_params_set_format(m_handle, hw_params, pcm_format);
+        if (err < 0) {
+            std::cerr << "ALSA: Cannot set sample format: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+
+        unsigned int channels = requested.channels;
+        err = snd_pcm_hw_params_set_channels(m_handle, hw_params, channels);
+        if (err < 0) {
+            std::cerr << "ALSA: Cannot set channel count: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+
+        // Ask for a native rate only; conversion is done in-process by the resampler
+        err = snd_pcm_hw_params_set_rate_resample(m_handle, hw_params, 0);
+        if (err < 0) {
+            std::cerr << "ALSA: Cannot disable plugin resampling: " << snd_strerror(err) << std::endl;
+        }
+
+        unsigned int sample_rate = requested.sample_rate;
+        err = snd_pcm_hw_params_set_rate_near(m_handle, hw_params, &sample_rate, 0);
+        if (err < 0) {
+            std::cerr << "ALSA: Cannot set sample rate: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+
+        // Set buffer size (2 seconds of audio)
+        snd_pcm_uframes_t buffer_frames = sample_rate * 2;
+        err = snd_pcm_hw_params_set_buffer_size_near(m_handle, hw_params, &buffer_frames);
+        if (err < 0) {
+            std::cerr << "ALSA: Cannot set buffer size: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+
+        // Set period size (50ms of audio for low latency)
+        snd_pcm_uframes_t period_frames = sample_rate / 20;
+        err = snd_pcm_hw_params_set_period_size_near(m_handle, hw_params, &period_frames, 0);
+        if (err < 0) {
+            std::cerr << "ALSA: Cannot set period size: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+
+        err = snd_pcm_hw_params(m_handle, hw_params);
+        if (err < 0) {
+            std::cerr << "ALSA: Cannot set hardware parameters: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+
+        actual.sample_rate = static_cast<int>(sample_rate);
+        actual.channels = requested.channels;
+        actual.buffer_frames = buffer_frames;
+        actual.period_frames = period_frames;
+        actual.can_pause = snd_pcm_hw_params_can_pause(hw_params) == 1;
+        return true;
+    }
+
+public:
+    explicit AlsaPcmDevice(const std::string& name) : m_name(name) {}
+
+    ~AlsaPcmDevice() override {
+        close();
+    }
+
+    int open(const AudioFormat& requested, PcmConfig& actual) override {
+        close();
+
+        int err = snd_pcm_open(&m_handle, m_name.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
+        if (err < 0) {
+            std::cerr << "ALSA: Cannot open audio device: " << snd_strerror(err) << std::endl;
+            m_handle = nullptr;
+            return err;
+        }
+
+        if (!set_hw_params(requested, actual)) {
+            close();
+            return -EINVAL;
+        }
+        return 0;
+    }
+
+    void close() override {
+        if (m_handle) {
+            snd_pcm_close(m_handle);
+            m_handle = nullptr;
+        }
+    }
+
+    bool is_open() const override {
+        return m_handle != nullptr;
+    }
+
+    int prepare() override {
+        return m_handle ? snd_pcm_prepare(m_handle) : -ENODEV;
+    }
+
+    int resume() override {
+        return m_handle ? snd_pcm_resume(m_handle) : -ENODEV;
+    }
+
+    int drop() override {
+        return m_handle ? snd_pcm_drop(m_handle) : -ENODEV;
+    }
+
+    int pause(bool enable) override {
+        return m_handle ? snd_pcm_pause(m_handle, enable ? 1 : 0) : -ENODEV;
+    }
+
+    long avail() override {
+        return m_handle ? snd_pcm_avail(m_handle) : -ENODEV;
+    }
+
+    long write(const int16_t* samples, size_t frames) override {
+        return m_handle ? snd_pcm_writei(m_handle, samples, frames) : -ENODEV;
+    }
+
+    long rewindable() override {
+        return m_handle ? snd_pcm_rewindable(m_handle) : -ENODEV;
+    }
+
+    long rewind(size_t frames) override {
+        return m_handle ? snd_pcm_rewind(m_handle, frames) : -ENODEV;
+    }
+};
+
+std::unique_ptr<IPcmDevice> create_alsa_pcm_device(const std::string& name) {
+    return std::make_unique<AlsaPcmDevice>(name);
+}
+
+}
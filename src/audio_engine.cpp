@@ -1,9 +1,12 @@
 #include "audio_engine.hpp"
+#include "event_dispatcher.hpp"
+#include "trace.hpp"
 #include <windows.h>
 #include <dsound.h>
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
 #include <algorithm>
 #include <string>
 #include <deque>
@@ -30,10 +33,14 @@ struct DirectSoundEngine::Impl {
     std::mutex buffer_mutex;
 
     std::deque<int16_t> pending_samples;
+    std::condition_variable space_cv;   // Signalled when pending audio drops below the high-water mark
+    static constexpr int HIGH_WATER_MS = 500;
     size_t write_cursor = 0;
     
-    // New callback-based completion detection
+    // New callback-based completion detection. Callbacks run on the
+    // dispatcher thread; the playback thread only posts events.
     CompletionCallback completion_callback;
+    AudioEngineEventCallback event_callback;
     std::atomic<bool> eof_signaled{false};
     std::atomic<bool> callback_fired{false};
     std::mutex callback_mutex;
@@ -41,12 +48,13 @@ struct DirectSoundEngine::Impl {
     std::chrono::steady_clock::time_point start_time;
     
     // DirectSound buffer position tracking
-    DWORD last_write_position = 0;
     DWORD frame_size = 0;
+    DWORD last_play_cursor = 0;
+    uint64_t played_bytes = 0;               // Play cursor travel since start()
+    std::atomic<uint64_t> played_frames{0};  // Capped at what was actually written
     
-    // Alternative: Time-based completion tracking
-    std::chrono::steady_clock::time_point last_audio_written_time;
-    std::chrono::milliseconds estimated_remaining_ms{0};
+    // Declared last so it is joined before the state its handler touches goes away
+    std::unique_ptr<EngineEventDispatcher> dispatcher;
     
     bool create_window() {
         WNDCLASS wc = {};
@@ -113,54 +121,65 @@ struct DirectSoundEngine::Impl {
         return SUCCEEDED(hr);
     }
     
+    // The track is over once the play cursor has passed everything written
     void check_completion() {
-        if (eof_signaled.load() && pending_samples.empty()) {
-            // Use both methods for bulletproof completion detection
-            bool buffer_drained = is_directsound_buffer_drained();
-            bool time_elapsed = is_audio_playback_complete_by_time();
-            
-            if (buffer_drained || time_elapsed) {
-                fire_completion_callback(AudioEngineError::SUCCESS);
-            }
+        uint64_t written_frames = total_samples_processed / format.channels;
+        if (eof_signaled.load() && pending_samples.empty() && played_frames >= written_frames) {
+            fire_completion_callback(AudioEngineError::SUCCESS);
         }
     }
     
-    bool is_directsound_buffer_drained() {
-        DWORD play_cursor, write_cursor;
-        HRESULT hr = secondary_buffer->GetCurrentPosition(&play_cursor, &write_cursor);
-        if (FAILED(hr)) return true; // If we can't check, assume drained
+    void advance_play_position(DWORD play_cursor) {
+        DWORD delta = play_cursor >= last_play_cursor
+            ? play_cursor - last_play_cursor
+            : static_cast<DWORD>(buffer_bytes) - last_play_cursor + play_cursor;
+        last_play_cursor = play_cursor;
+        played_bytes += delta;
         
-        // Check if play cursor has caught up to our last write position
-        // This means all audio we wrote has been played
-        return (play_cursor >= last_write_position) || 
-               (last_write_position - play_cursor < frame_size * 2); // Small tolerance
+        uint64_t written_frames = total_samples_processed / format.channels;
+        played_frames = std::min<uint64_t>(played_bytes / frame_size, written_frames);
     }
     
-    // Alternative: Time-based completion (simpler & more reliable)
-    bool is_audio_playback_complete_by_time() {
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - last_audio_written_time);
-        return elapsed >= estimated_remaining_ms;
+    void fire_completion_callback(AudioEngineError error_code) {
+        if (!callback_fired.exchange(true)) {
+            AudioEngineEvent event;
+            event.type = AudioEngineEventType::COMPLETION;
+            event.error_code = error_code;
+            event.completion_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start_time);
+            event.samples_processed = total_samples_processed;
+            event.frames_played = static_cast<size_t>(played_frames.load());
+            event.sample_rate = format.sample_rate;
+            // A full queue must not cost the player the end of the track
+            dispatcher->post_reserved(event);
+        }
     }
     
-    void fire_completion_callback(AudioEngineError error_code) {
-        std::lock_guard<std::mutex> lock(callback_mutex);
-        if (!callback_fired.exchange(true) && completion_callback) {
-            try {
-                auto completion_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    std::chrono::steady_clock::now() - start_time);
-                    
-                CompletionResult result;
-                result.error_code = error_code;
-                result.error_message = get_error_description(error_code);
-                result.completion_time = completion_time;
-                result.samples_processed = total_samples_processed;
-                
-                completion_callback(result);
-            } catch (...) {
-                // Log exception but don't crash audio thread
+    // Runs on the dispatcher thread
+    void deliver_event(const AudioEngineEvent& event) {
+        // Called without the lock, so a callback may stop() or replace the callbacks
+        CompletionCallback on_completion;
+        AudioEngineEventCallback on_event;
+        {
+            std::lock_guard<std::mutex> lock(callback_mutex);
+            on_completion = completion_callback;
+            on_event = event_callback;
+        }
+        try {
+            if (event.type == AudioEngineEventType::COMPLETION) {
+                if (on_completion) {
+                    CompletionResult result;
+                    result.error_code = event.error_code;
+                    result.error_message = get_error_description(event.error_code);
+                    result.completion_time = event.completion_time;
+                    result.samples_processed = event.samples_processed;
+                    on_completion(result);
+                }
+            } else if (on_event) {
+                on_event(event);
             }
+        } catch (...) {
+            // Log exception but don't crash the dispatcher
         }
     }
     
@@ -172,11 +191,13 @@ struct DirectSoundEngine::Impl {
             case AudioEngineError::THREADING_ERROR: return "Threading synchronization error";
             case AudioEngineError::DIRECTSOUND_FAILURE: return "DirectSound operation failed";
             case AudioEngineError::CALLBACK_TIMEOUT: return "Completion callback timeout";
+            case AudioEngineError::DEVICE_FAILURE: return "Audio device could not be recovered";
             default: return "Unknown error";
         }
     }
     
     void playback_loop() {
+        TRACE_THREAD_NAME("audio engine");
         while (!should_stop) {
             if (is_playing && !is_paused) {
                 update_buffer();
@@ -186,6 +207,7 @@ struct DirectSoundEngine::Impl {
     }
     
     void update_buffer() {
+        TRACE_SCOPE("DirectSoundEngine::update_buffer");
         DWORD play_cursor, write_cursor_pos;
         HRESULT hr = secondary_buffer->GetCurrentPosition(&play_cursor, &write_cursor_pos);
         if (FAILED(hr)) {
@@ -193,6 +215,7 @@ struct DirectSoundEngine::Impl {
         }
         
         std::lock_guard<std::mutex> lock(buffer_mutex);
+        advance_play_position(play_cursor);
         if (pending_samples.empty()) {
             // Check for completion when buffers are empty
             check_completion();
@@ -241,33 +264,32 @@ struct DirectSoundEngine::Impl {
         
         secondary_buffer->Unlock(audio_ptr1, audio_bytes1, audio_ptr2, audio_bytes2);
         
-        size_t samples_written = (audio_bytes1 + audio_bytes2) / sizeof(int16_t);
+        // Only what was actually copied counts; the cursor advances by whole frames
+        size_t samples_written = std::min(pending_samples.size(),
+                                          (audio_bytes1 + audio_bytes2) / sizeof(int16_t));
+        samples_written -= samples_written % format.channels;
         total_samples_processed += samples_written;
         
         pending_samples.erase(pending_samples.begin(), 
                             pending_samples.begin() + samples_written);
+        space_cv.notify_one();
         
-        write_cursor = (write_cursor + bytes_to_write) % buffer_bytes;
-        
-        // Update last write position for completion detection
-        last_write_position = (last_write_position + audio_bytes1 + audio_bytes2) % buffer_bytes;
-        
-        // Update timing-based completion tracking
-        last_audio_written_time = std::chrono::steady_clock::now();
-        // Calculate remaining playback time: buffer_size_in_samples / sample_rate * 1000ms
-        size_t buffer_samples = buffer_bytes / frame_size;
-        estimated_remaining_ms = std::chrono::milliseconds(
-            (buffer_samples * 1000) / format.sample_rate);
+        write_cursor = (write_cursor + samples_written * sizeof(int16_t)) % buffer_bytes;
     }
 };
 
-DirectSoundEngine::DirectSoundEngine() : m_impl(std::make_unique<Impl>()) {}
+DirectSoundEngine::DirectSoundEngine() : m_impl(std::make_unique<Impl>()) {
+    Impl* impl = m_impl.get();
+    m_impl->dispatcher = std::make_unique<EngineEventDispatcher>(
+        [impl](const AudioEngineEvent& event) { impl->deliver_event(event); });
+}
 
 DirectSoundEngine::~DirectSoundEngine() {
     shutdown();
 }
 
 bool DirectSoundEngine::initialize(const AudioFormat& format) {
+    TRACE_SCOPE("DirectSoundEngine::initialize");
     m_impl->format = format;
     
     if (!m_impl->create_window()) {
@@ -305,6 +327,9 @@ bool DirectSoundEngine::start() {
     m_impl->eof_signaled = false;
     m_impl->callback_fired = false;
     m_impl->total_samples_processed = 0;
+    m_impl->last_play_cursor = 0;
+    m_impl->played_bytes = 0;
+    m_impl->played_frames = 0;
     m_impl->start_time = std::chrono::steady_clock::now();
     
     m_impl->is_playing = true;
@@ -315,6 +340,7 @@ bool DirectSoundEngine::start() {
 }
 
 bool DirectSoundEngine::stop() {
+    TRACE_SCOPE("DirectSoundEngine::stop");
     if (!m_impl->secondary_buffer) {
         return false;
     }
@@ -322,6 +348,11 @@ bool DirectSoundEngine::stop() {
     // Signal thread to stop FIRST, before acquiring any locks
     m_impl->is_playing = false;
     m_impl->should_stop = true;
+    {
+        // Release a producer blocked on a full queue
+        std::lock_guard<std::mutex> lock(m_impl->buffer_mutex);
+        m_impl->space_cv.notify_all();
+    }
     
     // Stop DirectSound buffer immediately
     HRESULT hr = m_impl->secondary_buffer->Stop();
@@ -337,11 +368,12 @@ bool DirectSoundEngine::stop() {
         m_impl->pending_samples.clear();
     }
     
-    // Clear callback to prevent firing during shutdown
+    // Clear callback to prevent firing during shutdown, then discard queued events
     {
         std::lock_guard<std::mutex> lock(m_impl->callback_mutex);
         m_impl->completion_callback = nullptr;
     }
+    m_impl->dispatcher->flush();
     
     // Reset write cursor position for clean start on next play
     m_impl->write_cursor = 0;
@@ -387,7 +419,17 @@ void DirectSoundEngine::shutdown() {
 }
 
 bool DirectSoundEngine::write_samples(const AudioBuffer& buffer) {
-    std::lock_guard<std::mutex> lock(m_impl->buffer_mutex);
+    // Block instead of queueing without bound, so the decoder never has to poll
+    std::unique_lock<std::mutex> lock(m_impl->buffer_mutex);
+    size_t high_water = static_cast<size_t>(m_impl->format.sample_rate) *
+                        m_impl->format.channels * Impl::HIGH_WATER_MS / 1000;
+    m_impl->space_cv.wait(lock, [&]() {
+        return !m_impl->is_playing || m_impl->pending_samples.size() < high_water;
+    });
+    if (!m_impl->is_playing) {
+        return false;
+    }
+    
     m_impl->pending_samples.insert(m_impl->pending_samples.end(), buffer.begin(), buffer.end());
     return true;
 }
@@ -418,6 +460,11 @@ void DirectSoundEngine::set_completion_callback(CompletionCallback callback) {
     m_impl->completion_callback = callback;
 }
 
+void DirectSoundEngine::set_event_callback(AudioEngineEventCallback callback) {
+    std::lock_guard<std::mutex> lock(m_impl->callback_mutex);
+    m_impl->event_callback = callback;
+}
+
 void DirectSoundEngine::signal_eof() {
     m_impl->eof_signaled = true;
     
@@ -431,6 +478,26 @@ size_t DirectSoundEngine::get_buffered_samples() const {
     return m_impl->pending_samples.size();
 }
 
+uint64_t DirectSoundEngine::get_played_frames() const {
+    return m_impl->played_frames;
+}
+
+void DirectSoundEngine::set_resampler_quality(ResamplerQuality quality) {
+    // DirectSound converts to the mixer rate itself; nothing to configure
+    (void)quality;
+}
+
+void DirectSoundEngine::set_device_rate(int sample_rate) {
+    // The DirectSound mixer runs at its own rate and converts every buffer to it
+    (void)sample_rate;
+}
+
+bool DirectSoundEngine::set_capture_path(const std::string& path) {
+    // Volume is applied by the DirectSound mixer, so the post-volume PCM never
+    // passes through this process
+    return path.empty();
+}
+
 std::unique_ptr<IAudioEngine> create_audio_engine() {
     return std::make_unique<DirectSoundEngine>();
 }
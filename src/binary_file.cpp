@@ -0,0 +1,61 @@
+#include "binary_file.hpp"
+#include <cstdio>
+#include <fstream>
+
+namespace nigamp {
+
+void put_u16(std::string& out, uint16_t value) {
+    out.push_back(static_cast<char>(value & 0xFF));
+    out.push_back(static_cast<char>(value >> 8));
+}
+
+void put_u32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void put_u64(std::string& out, uint64_t value) {
+    put_u32(out, static_cast<uint32_t>(value & 0xFFFFFFFFu));
+    put_u32(out, static_cast<uint32_t>(value >> 32));
+}
+
+uint32_t get_u32(const unsigned char* data) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t get_u64(const unsigned char* data) {
+    return (static_cast<uint64_t>(get_u32(data + 4)) << 32) | get_u32(data);
+}
+
+bool replace_file(const std::string& temp_path, const std::string& path) {
+#ifdef _WIN32
+    std::remove(path.c_str());  // rename does not replace on Windows
+#endif
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool write_file_atomically(const std::string& path, std::initializer_list<std::string_view> parts) {
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        for (std::string_view part : parts) {
+            file.write(part.data(), static_cast<std::streamsize>(part.size()));
+        }
+        if (!file.flush()) {
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+    return replace_file(temp_path, path);
+}
+
+}
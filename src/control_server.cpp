@@ -0,0 +1,768 @@
+#include "control_server.hpp"
+#include "binary_file.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+namespace nigamp {
+
+namespace {
+
+constexpr size_t READ_CHUNK = 4096;
+constexpr size_t MAX_PENDING_OUTPUT = 256 * 1024;
+
+const unsigned char* bytes_at(const std::string& in, size_t offset) {
+    return reinterpret_cast<const unsigned char*>(in.data()) + offset;
+}
+
+void put_f32(std::string& out, float value) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    put_u32(out, bits);
+}
+
+float get_f32(const std::string& in, size_t offset) {
+    uint32_t bits = get_u32(bytes_at(in, offset));
+    float value = 0.0f;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+double get_f64(const std::string& in, size_t offset) {
+    uint64_t bits = get_u64(bytes_at(in, offset));
+    double value = 0.0;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+const char* state_name(PlaybackState state) {
+    switch (state) {
+        case PlaybackState::PLAYING: return "playing";
+        case PlaybackState::PAUSED: return "paused";
+        case PlaybackState::STOPPED: break;
+    }
+    return "stopped";
+}
+
+std::string json_escape(const std::string& text) {
+    std::string out;
+    out.reserve(text.size() + 2);
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[7];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out;
+}
+
+std::string json_number(double value) {
+    if (!std::isfinite(value)) {
+        return "0";
+    }
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.3f", value);
+    return buffer;
+}
+
+// Just enough JSON for flat request objects: string, number and literal values
+class JsonObjectParser {
+private:
+    const std::string& m_text;
+    size_t m_pos = 0;
+
+    void skip_space() {
+        while (m_pos < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_pos]))) {
+            ++m_pos;
+        }
+    }
+
+    bool consume(char c) {
+        skip_space();
+        if (m_pos < m_text.size() && m_text[m_pos] == c) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    static void append_utf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    bool parse_string(std::string& out) {
+        if (!consume('"')) {
+            return false;
+        }
+        out.clear();
+        while (m_pos < m_text.size()) {
+            char c = m_text[m_pos++];
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (m_pos >= m_text.size()) {
+                return false;
+            }
+            char escape = m_text[m_pos++];
+            switch (escape) {
+                case '"': case '\\': case '/': out += escape; break;
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    if (m_pos + 4 > m_text.size()) {
+                        return false;
+                    }
+                    uint32_t code = 0;
+                    for (int i = 0; i < 4; ++i) {
+                        char h = m_text[m_pos++];
+                        code <<= 4;
+                        if (h >= '0' && h <= '9') code |= h - '0';
+                        else if (h >= 'a' && h <= 'f') code |= h - 'a' + 10;
+                        else if (h >= 'A' && h <= 'F') code |= h - 'A' + 10;
+                        else return false;
+                    }
+                    append_utf8(out, code);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+
+    // Numbers and literals are kept as their raw text
+    bool parse_scalar(std::string& out) {
+        skip_space();
+        size_t start = m_pos;
+        while (m_pos < m_text.size() && m_text[m_pos] != ',' && m_text[m_pos] != '}' &&
+               !std::isspace(static_cast<unsigned char>(m_text[m_pos]))) {
+            ++m_pos;
+        }
+        out = m_text.substr(start, m_pos - start);
+        return !out.empty();
+    }
+
+public:
+    explicit JsonObjectParser(const std::string& text) : m_text(text) {}
+
+    bool parse(std::unordered_map<std::string, std::string>& fields) {
+        if (!consume('{')) {
+            return false;
+        }
+        if (consume('}')) {
+            return true;
+        }
+        do {
+            std::string key;
+            std::string value;
+            if (!parse_string(key) || !consume(':')) {
+                return false;
+            }
+            skip_space();
+            bool ok = m_pos < m_text.size() && m_text[m_pos] == '"' ? parse_string(value) : parse_scalar(value);
+            if (!ok) {
+                return false;
+            }
+            fields[key] = value;
+        } while (consume(','));
+        if (!consume('}')) {
+            return false;
+        }
+        skip_space();
+        return m_pos == m_text.size();
+    }
+};
+
+bool parse_json_number(const std::unordered_map<std::string, std::string>& fields, const char* key, double& value) {
+    auto it = fields.find(key);
+    if (it == fields.end()) {
+        return false;
+    }
+    char* end = nullptr;
+    value = std::strtod(it->second.c_str(), &end);
+    return end && *end == '\0' && std::isfinite(value);
+}
+
+}
+
+std::string encode_control_frame(ControlOpcode opcode, const std::string& payload) {
+    uint32_t length = static_cast<uint32_t>(payload.size() + 1);
+    std::string frame;
+    frame.reserve(4 + length);
+    frame.push_back(static_cast<char>((length >> 24) & 0xFF));
+    frame.push_back(static_cast<char>((length >> 16) & 0xFF));
+    frame.push_back(static_cast<char>((length >> 8) & 0xFF));
+    frame.push_back(static_cast<char>(length & 0xFF));
+    frame.push_back(static_cast<char>(opcode));
+    frame += payload;
+    return frame;
+}
+
+size_t decode_control_frame(const char* data, size_t size, ControlOpcode& opcode, std::string& payload) {
+    if (size < 4) {
+        return 0;
+    }
+    uint32_t length = 0;
+    for (int i = 0; i < 4; ++i) {
+        length = (length << 8) | static_cast<unsigned char>(data[i]);
+    }
+    if (length == 0 || length > CONTROL_MAX_FRAME) {
+        return SIZE_MAX;
+    }
+    if (size < 4 + static_cast<size_t>(length)) {
+        return 0;
+    }
+    opcode = static_cast<ControlOpcode>(static_cast<unsigned char>(data[4]));
+    payload.assign(data + 5, length - 1);
+    return 4 + static_cast<size_t>(length);
+}
+
+std::string encode_f64(double value) {
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    std::string out;
+    put_u64(out, bits);
+    return out;
+}
+
+bool decode_f64(const std::string& payload, double& value) {
+    if (payload.size() != 8) {
+        return false;
+    }
+    value = get_f64(payload, 0);
+    return std::isfinite(value);
+}
+
+// state u8, position f64, duration f64, volume f32, index u32, size u32, title (rest)
+std::string encode_status(const PlayerStatus& status) {
+    std::string out;
+    out.reserve(29 + status.title.size());
+    out.push_back(static_cast<char>(static_cast<unsigned char>(status.state)));
+    out += encode_f64(status.position);
+    out += encode_f64(status.duration);
+    put_f32(out, status.volume);
+    put_u32(out, status.index);
+    put_u32(out, status.playlist_size);
+    out += status.title;
+    return out;
+}
+
+bool decode_status(const std::string& payload, PlayerStatus& status) {
+    if (payload.size() < 29 || static_cast<unsigned char>(payload[0]) > static_cast<unsigned char>(PlaybackState::PAUSED)) {
+        return false;
+    }
+    status.state = static_cast<PlaybackState>(static_cast<unsigned char>(payload[0]));
+    status.position = get_f64(payload, 1);
+    status.duration = get_f64(payload, 9);
+    status.volume = get_f32(payload, 17);
+    status.index = get_u32(bytes_at(payload, 21));
+    status.playlist_size = get_u32(bytes_at(payload, 25));
+    status.title.assign(payload, 29, std::string::npos);
+    return true;
+}
+
+std::string status_to_json(const PlayerStatus& status) {
+    return std::string("{\"event\":\"status\",\"state\":\"") + state_name(status.state) +
+           "\",\"position\":" + json_number(status.position) +
+           ",\"duration\":" + json_number(status.duration) +
+           ",\"volume\":" + json_number(status.volume) +
+           ",\"index\":" + std::to_string(status.index) +
+           ",\"size\":" + std::to_string(status.playlist_size) +
+           ",\"title\":\"" + json_escape(status.title) + "\"}";
+}
+
+bool control_request_to_command(ControlOpcode opcode, const std::string& payload, PlayerCommand& command) {
+    command = PlayerCommand();
+    switch (opcode) {
+        case ControlOpcode::PAUSE_RESUME:
+            command.type = PlayerCommandType::PAUSE_RESUME;
+            return payload.empty();
+        case ControlOpcode::NEXT:
+            command.type = PlayerCommandType::NEXT;
+            return payload.empty();
+        case ControlOpcode::PREVIOUS:
+            command.type = PlayerCommandType::PREVIOUS;
+            return payload.empty();
+        case ControlOpcode::SEEK:
+            command.type = PlayerCommandType::SEEK;
+            return decode_f64(payload, command.amount);
+        case ControlOpcode::VOLUME:
+            command.type = PlayerCommandType::VOLUME;
+            return decode_f64(payload, command.amount);
+        case ControlOpcode::ENQUEUE:
+            command.type = PlayerCommandType::ENQUEUE;
+            command.path = payload;
+            return !payload.empty();
+        case ControlOpcode::EXPORT:
+            command.type = PlayerCommandType::EXPORT;
+            command.path = payload;
+            return !payload.empty();
+        case ControlOpcode::QUIT:
+            command.type = PlayerCommandType::QUIT;
+            return payload.empty();
+        default:
+            return false;
+    }
+}
+
+bool parse_json_request(const std::string& line, ControlOpcode& opcode, std::string& payload) {
+    std::unordered_map<std::string, std::string> fields;
+    if (!JsonObjectParser(line).parse(fields)) {
+        return false;
+    }
+    auto cmd = fields.find("cmd");
+    if (cmd == fields.end()) {
+        return false;
+    }
+
+    static const std::unordered_map<std::string, ControlOpcode> names = {
+        {"ping", ControlOpcode::PING},
+        {"pause", ControlOpcode::PAUSE_RESUME},
+        {"next", ControlOpcode::NEXT},
+        {"previous", ControlOpcode::PREVIOUS},
+        {"seek", ControlOpcode::SEEK},
+        {"volume", ControlOpcode::VOLUME},
+        {"enqueue", ControlOpcode::ENQUEUE},
+        {"status", ControlOpcode::STATUS},
+        {"subscribe", ControlOpcode::SUBSCRIBE},
+        {"unsubscribe", ControlOpcode::UNSUBSCRIBE},
+        {"quit", ControlOpcode::QUIT},
+        {"export", ControlOpcode::EXPORT},
+    };
+    auto name = names.find(cmd->second);
+    if (name == names.end()) {
+        return false;
+    }
+
+    opcode = name->second;
+    payload.clear();
+    double amount = 0.0;
+    switch (opcode) {
+        case ControlOpcode::SEEK:
+            if (!parse_json_number(fields, "seconds", amount)) {
+                return false;
+            }
+            payload = encode_f64(amount);
+            break;
+        case ControlOpcode::VOLUME:
+            if (!parse_json_number(fields, "delta", amount)) {
+                return false;
+            }
+            payload = encode_f64(amount);
+            break;
+        case ControlOpcode::ENQUEUE:
+        case ControlOpcode::EXPORT: {
+            auto path = fields.find("path");
+            if (path == fields.end() || path->second.empty()) {
+                return false;
+            }
+            payload = path->second;
+            break;
+        }
+        default:
+            break;
+    }
+    return true;
+}
+
+#ifndef _WIN32
+
+struct ControlServer::Impl {
+    enum class Mode { UNKNOWN, BINARY, JSON };
+
+    struct Client {
+        int fd = -1;
+        Mode mode = Mode::UNKNOWN;
+        bool subscribed = false;
+        bool write_armed = false;
+        std::string input;
+        std::string output;
+    };
+
+    IEventLoop& loop;
+    std::string path;
+    int listen_fd = -1;
+    IEventLoop::TimerId status_timer = IEventLoop::INVALID_TIMER;
+    std::unordered_map<int, Client> clients;
+    CommandHandler on_command;
+    StatusProvider get_status;
+
+    explicit Impl(IEventLoop& event_loop) : loop(event_loop) {}
+
+    void accept_clients() {
+        for (;;) {
+            int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return;  // EAGAIN, or an error the next readiness will report again
+            }
+            if (!loop.add_fd(fd, [this, fd]() { read_client(fd); })) {
+                ::close(fd);
+                continue;
+            }
+            clients[fd].fd = fd;
+        }
+    }
+
+    void drop_client(int fd) {
+        loop.remove_fd(fd);
+        ::close(fd);
+        clients.erase(fd);
+    }
+
+    void write_client(int fd) {
+        auto it = clients.find(fd);
+        if (it != clients.end() && !flush(it->second)) {
+            drop_client(fd);
+        }
+    }
+
+    void read_client(int fd) {
+        auto it = clients.find(fd);
+        if (it == clients.end()) {
+            return;
+        }
+        Client& client = it->second;
+
+        char chunk[READ_CHUNK];
+        ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            drop_client(fd);
+            return;
+        }
+        if (received < 0) {
+            return;
+        }
+        client.input.append(chunk, static_cast<size_t>(received));
+
+        if (client.mode == Mode::UNKNOWN) {
+            client.mode = client.input[0] == '{' ? Mode::JSON : Mode::BINARY;
+        }
+        bool ok = client.mode == Mode::JSON ? process_json(client) : process_binary(client);
+        if (!ok || !flush(client)) {
+            drop_client(fd);
+        }
+    }
+
+    bool process_binary(Client& client) {
+        size_t offset = 0;
+        ControlOpcode opcode;
+        std::string payload;
+        for (;;) {
+            size_t used = decode_control_frame(client.input.data() + offset, client.input.size() - offset,
+                                               opcode, payload);
+            if (used == SIZE_MAX) {
+                return false;
+            }
+            if (used == 0) {
+                break;
+            }
+            offset += used;
+            handle_request(client, opcode, payload);
+        }
+        client.input.erase(0, offset);
+        return true;
+    }
+
+    bool process_json(Client& client) {
+        size_t start = 0;
+        size_t newline;
+        while ((newline = client.input.find('\n', start)) != std::string::npos) {
+            std::string line = client.input.substr(start, newline - start);
+            start = newline + 1;
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty()) {
+                continue;
+            }
+
+            ControlOpcode opcode;
+            std::string payload;
+            if (parse_json_request(line, opcode, payload)) {
+                handle_request(client, opcode, payload);
+            } else {
+                client.output += "{\"ok\":false,\"error\":\"bad request\"}\n";
+            }
+        }
+        client.input.erase(0, start);
+        return client.input.size() <= CONTROL_MAX_FRAME;
+    }
+
+    void reply_ack(Client& client, ControlOpcode opcode) {
+        if (client.mode == Mode::JSON) {
+            client.output += "{\"ok\":true}\n";
+        } else {
+            client.output += encode_control_frame(ControlOpcode::ACK, std::string(1, static_cast<char>(opcode)));
+        }
+    }
+
+    void reply_error(Client& client, const std::string& message) {
+        if (client.mode == Mode::JSON) {
+            client.output += "{\"ok\":false,\"error\":\"" + json_escape(message) + "\"}\n";
+        } else {
+            client.output += encode_control_frame(ControlOpcode::ERROR, message);
+        }
+    }
+
+    void append_status(Client& client, const PlayerStatus& status) {
+        if (client.mode == Mode::JSON) {
+            client.output += status_to_json(status) + "\n";
+        } else {
+            client.output += encode_control_frame(ControlOpcode::STATUS_REPORT, encode_status(status));
+        }
+    }
+
+    void handle_request(Client& client, ControlOpcode opcode, const std::string& payload) {
+        switch (opcode) {
+            case ControlOpcode::PING:
+                reply_ack(client, opcode);
+                return;
+            case ControlOpcode::STATUS:
+                append_status(client, get_status());
+                return;
+            case ControlOpcode::SUBSCRIBE:
+                client.subscribed = true;
+                append_status(client, get_status());
+                return;
+            case ControlOpcode::UNSUBSCRIBE:
+                client.subscribed = false;
+                reply_ack(client, opcode);
+                return;
+            default:
+                break;
+        }
+
+        PlayerCommand command;
+        if (!control_request_to_command(opcode, payload, command)) {
+            reply_error(client, "bad request");
+            return;
+        }
+        // Acknowledged before it runs, so a quit still gets its reply out
+        reply_ack(client, opcode);
+        flush(client);
+        on_command(command);
+    }
+
+    // False once the client is gone or has too much unread output
+    bool flush(Client& client) {
+        while (!client.output.empty()) {
+            ssize_t sent = ::send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            client.output.erase(0, static_cast<size_t>(sent));
+        }
+
+        // Whatever the socket refused goes out as soon as it drains
+        int fd = client.fd;
+        if (!client.output.empty() && !client.write_armed) {
+            client.write_armed = loop.watch_writable(fd, [this, fd]() { write_client(fd); });
+        } else if (client.output.empty() && client.write_armed) {
+            loop.watch_writable(fd, nullptr);
+            client.write_armed = false;
+        }
+        return client.output.size() <= MAX_PENDING_OUTPUT;
+    }
+
+    void publish() {
+        bool any = false;
+        for (const auto& entry : clients) {
+            any = any || entry.second.subscribed;
+        }
+        if (!any) {
+            return;
+        }
+
+        PlayerStatus status = get_status();
+        std::vector<int> dropped;
+        for (auto& entry : clients) {
+            Client& client = entry.second;
+            if (!client.subscribed) {
+                continue;
+            }
+            append_status(client, status);
+            if (!flush(client)) {
+                dropped.push_back(entry.first);
+            }
+        }
+        for (int fd : dropped) {
+            drop_client(fd);
+        }
+    }
+
+    void close_all() {
+        if (status_timer != IEventLoop::INVALID_TIMER) {
+            loop.cancel_timer(status_timer);
+            status_timer = IEventLoop::INVALID_TIMER;
+        }
+        while (!clients.empty()) {
+            drop_client(clients.begin()->first);
+        }
+        if (listen_fd >= 0) {
+            loop.remove_fd(listen_fd);
+            ::close(listen_fd);
+            listen_fd = -1;
+            ::unlink(path.c_str());
+        }
+    }
+};
+
+ControlServer::ControlServer(IEventLoop& loop) : m_impl(std::make_unique<Impl>(loop)) {}
+
+ControlServer::~ControlServer() {
+    stop();
+}
+
+bool ControlServer::start(const std::string& path, CommandHandler on_command, StatusProvider get_status) {
+    stop();
+
+    sockaddr_un address{};
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Control socket path is too long: " << path << "\n";
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    // A socket file nobody answers on is left over from a crash
+    struct stat info;
+    if (::lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+        int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool in_use = probe >= 0 && ::connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        if (probe >= 0) {
+            ::close(probe);
+        }
+        if (in_use) {
+            std::cerr << "Control socket already in use: " << path << "\n";
+            ::close(fd);
+            return false;
+        }
+        ::unlink(path.c_str());
+    }
+
+    // Created owner-only, so nobody can connect before the mode is set
+    mode_t old_umask = ::umask(0177);
+    bool bound = ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    ::umask(old_umask);
+    if (!bound || ::listen(fd, 16) != 0) {
+        std::cerr << "Failed to bind control socket " << path << ": " << std::strerror(errno) << "\n";
+        ::close(fd);
+        return false;
+    }
+
+    if (!m_impl->loop.add_fd(fd, [this]() { m_impl->accept_clients(); })) {
+        ::close(fd);
+        ::unlink(path.c_str());
+        return false;
+    }
+
+    m_impl->listen_fd = fd;
+    m_impl->path = path;
+    m_impl->on_command = std::move(on_command);
+    m_impl->get_status = std::move(get_status);
+    m_impl->status_timer = m_impl->loop.add_timer(std::chrono::milliseconds(STATUS_INTERVAL_MS), [this]() {
+        m_impl->publish();
+    }, true);
+    return true;
+}
+
+void ControlServer::stop() {
+    m_impl->close_all();
+}
+
+bool ControlServer::is_running() const {
+    return m_impl->listen_fd >= 0;
+}
+
+void ControlServer::publish_status() {
+    m_impl->publish();
+}
+
+size_t ControlServer::client_count() const {
+    return m_impl->clients.size();
+}
+
+#else
+
+// Windows has no pollable fds in the player loop; the control socket is Unix-only for now
+struct ControlServer::Impl {
+    explicit Impl(IEventLoop&) {}
+};
+
+ControlServer::ControlServer(IEventLoop& loop) : m_impl(std::make_unique<Impl>(loop)) {}
+
+ControlServer::~ControlServer() = default;
+
+bool ControlServer::start(const std::string&, CommandHandler, StatusProvider) {
+    return false;
+}
+
+void ControlServer::stop() {}
+
+bool ControlServer::is_running() const {
+    return false;
+}
+
+void ControlServer::publish_status() {}
+
+size_t ControlServer::client_count() const {
+    return 0;
+}
+
+#endif
+
+}
@@ -0,0 +1,148 @@
+#include "event_dispatcher.hpp"
+#include "spsc_queue.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace nigamp {
+
+struct EngineEventDispatcher::Impl {
+    Handler handler;
+    SpscQueue<AudioEngineEvent> queue;
+    AudioEngineEvent reserved;
+    std::atomic<bool> reserved_ready{false};
+
+    std::thread thread;
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+    std::atomic<bool> consumer_waiting{false};
+    std::atomic<bool> should_stop{false};
+
+    std::atomic<size_t> posted{0};
+    std::atomic<size_t> handled{0};
+    std::atomic<size_t> dropped{0};
+
+    // flush() sleeps here; the consumer only takes the lock when someone is waiting
+    std::mutex flush_mutex;
+    std::condition_variable flush_cv;
+    std::atomic<int> flush_waiters{0};
+
+    // Upper bound on delivery latency if a wake-up races with the consumer going to sleep
+    static constexpr int MAX_WAKE_LATENCY_MS = 20;
+
+    Impl(Handler h, size_t capacity) : handler(std::move(h)), queue(capacity) {}
+
+    void handle(const AudioEngineEvent& event) {
+        try {
+            handler(event);
+        } catch (...) {
+            // A throwing callback must not take the dispatcher down
+        }
+        handled.fetch_add(1);
+        if (flush_waiters.load() > 0) {
+            std::lock_guard<std::mutex> lock(flush_mutex);
+            flush_cv.notify_all();
+        }
+    }
+
+    void drain_queue() {
+        AudioEngineEvent event;
+        while (queue.try_pop(event)) {
+            handle(event);
+        }
+    }
+
+    void drain() {
+        drain_queue();
+        if (reserved_ready.load(std::memory_order_acquire)) {
+            // Events pushed just before the reserved one are visible now
+            drain_queue();
+            AudioEngineEvent event = reserved;
+            reserved_ready.store(false, std::memory_order_release);
+            handle(event);
+        }
+    }
+
+    void run() {
+        while (!should_stop) {
+            drain();
+
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            consumer_waiting = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (queue.empty() && !reserved_ready.load() && !should_stop) {
+                wake_cv.wait_for(lock, std::chrono::milliseconds(MAX_WAKE_LATENCY_MS));
+            }
+            consumer_waiting = false;
+        }
+        drain();
+    }
+
+    void wake() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumer_waiting.load()) {
+            wake_cv.notify_one();
+        }
+    }
+};
+
+EngineEventDispatcher::EngineEventDispatcher(Handler handler, size_t capacity)
+    : m_impl(std::make_unique<Impl>(std::move(handler), capacity)) {
+    m_impl->thread = std::thread(&Impl::run, m_impl.get());
+}
+
+EngineEventDispatcher::~EngineEventDispatcher() {
+    {
+        std::lock_guard<std::mutex> lock(m_impl->wake_mutex);
+        m_impl->should_stop = true;
+    }
+    m_impl->wake_cv.notify_one();
+    if (m_impl->thread.joinable()) {
+        m_impl->thread.join();
+    }
+}
+
+bool EngineEventDispatcher::post(const AudioEngineEvent& event) {
+    if (!m_impl->queue.try_push(event)) {
+        m_impl->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    m_impl->posted.fetch_add(1, std::memory_order_release);
+    m_impl->wake();
+    return true;
+}
+
+bool EngineEventDispatcher::post_reserved(const AudioEngineEvent& event) {
+    if (m_impl->reserved_ready.load(std::memory_order_acquire)) {
+        m_impl->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    m_impl->reserved = event;
+    m_impl->posted.fetch_add(1, std::memory_order_release);
+    m_impl->reserved_ready.store(true, std::memory_order_release);
+    m_impl->wake();
+    return true;
+}
+
+void EngineEventDispatcher::flush() {
+    // Flushing from a callback would wait on ourselves
+    if (std::this_thread::get_id() == m_impl->thread.get_id()) {
+        return;
+    }
+
+    size_t target = m_impl->posted.load(std::memory_order_acquire);
+    m_impl->flush_waiters.fetch_add(1);
+    {
+        std::unique_lock<std::mutex> lock(m_impl->flush_mutex);
+        m_impl->flush_cv.wait(lock, [&]() { return m_impl->handled.load() >= target; });
+    }
+    m_impl->flush_waiters.fetch_sub(1);
+}
+
+size_t EngineEventDispatcher::get_dropped_count() const {
+    return m_impl->dropped.load(std::memory_order_relaxed);
+}
+
+}
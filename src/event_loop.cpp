@@ -0,0 +1,413 @@
+#include "event_loop.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+    #include <cerrno>
+    #include <csignal>
+    #include <cstdint>
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <sys/signalfd.h>
+    #include <sys/timerfd.h>
+    #include <unistd.h>
+#endif
+
+namespace nigamp {
+
+struct PortableEventLoop::Impl {
+    using Clock = std::chrono::steady_clock;
+
+    struct Timer {
+        Clock::time_point due;
+        std::chrono::milliseconds interval;
+        Callback callback;
+        bool repeat;
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake_cv;
+    std::vector<Callback> posted;
+    std::map<TimerId, Timer> timers;
+    TimerId next_timer_id = 1;
+    bool should_stop = false;
+
+    // Moves due timers into `tasks`; returns the next deadline, if any
+    bool collect_due(Clock::time_point now, std::vector<Callback>& tasks, Clock::time_point& next_due) {
+        bool have_next = false;
+        for (auto it = timers.begin(); it != timers.end();) {
+            Timer& timer = it->second;
+            if (timer.due <= now) {
+                tasks.push_back(timer.callback);
+                if (!timer.repeat) {
+                    it = timers.erase(it);
+                    continue;
+                }
+                timer.due += timer.interval;
+                if (timer.due <= now) {
+                    timer.due = now + timer.interval;
+                }
+            }
+            if (!have_next || timer.due < next_due) {
+                next_due = timer.due;
+                have_next = true;
+            }
+            ++it;
+        }
+        return have_next;
+    }
+};
+
+PortableEventLoop::PortableEventLoop() : m_impl(std::make_unique<Impl>()) {}
+
+PortableEventLoop::~PortableEventLoop() = default;
+
+bool PortableEventLoop::add_fd(int fd, Callback on_readable) {
+    (void)fd;
+    (void)on_readable;
+    return false;
+}
+
+void PortableEventLoop::remove_fd(int fd) {
+    (void)fd;
+}
+
+bool PortableEventLoop::watch_writable(int fd, Callback on_writable) {
+    (void)fd;
+    (void)on_writable;
+    return false;
+}
+
+IEventLoop::TimerId PortableEventLoop::add_timer(std::chrono::milliseconds interval, Callback callback, bool repeat) {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    TimerId id = m_impl->next_timer_id++;
+    m_impl->timers[id] = Impl::Timer{Impl::Clock::now() + interval, interval, std::move(callback), repeat};
+    m_impl->wake_cv.notify_one();
+    return id;
+}
+
+void PortableEventLoop::cancel_timer(TimerId id) {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->timers.erase(id);
+}
+
+bool PortableEventLoop::watch_signal(int signal_number, Callback callback) {
+    (void)signal_number;
+    (void)callback;
+    return false;
+}
+
+void PortableEventLoop::post(Callback task) {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->posted.push_back(std::move(task));
+    m_impl->wake_cv.notify_one();
+}
+
+void PortableEventLoop::run() {
+    std::vector<Callback> tasks;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_impl->mutex);
+            while (true) {
+                if (m_impl->should_stop) {
+                    return;
+                }
+                tasks.swap(m_impl->posted);
+                Impl::Clock::time_point next_due;
+                bool have_next = m_impl->collect_due(Impl::Clock::now(), tasks, next_due);
+                if (!tasks.empty()) {
+                    break;
+                }
+                if (have_next) {
+                    m_impl->wake_cv.wait_until(lock, next_due);
+                } else {
+                    m_impl->wake_cv.wait(lock);
+                }
+            }
+        }
+        for (auto& task : tasks) {
+            task();
+        }
+        tasks.clear();
+    }
+}
+
+void PortableEventLoop::stop() {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->should_stop = true;
+    m_impl->wake_cv.notify_one();
+}
+
+#ifdef __linux__
+
+struct EpollEventLoop::Impl {
+    struct Timer {
+        int fd;
+        Callback callback;
+        bool repeat;
+    };
+
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    int signal_fd = -1;
+    sigset_t signal_mask;
+
+    std::unordered_map<int, Callback> fd_callbacks;
+    std::unordered_map<int, Callback> write_callbacks;
+    std::unordered_map<TimerId, Timer> timers;
+    std::unordered_map<int, TimerId> timer_ids;  // timerfd -> timer
+    std::unordered_map<int, Callback> signal_callbacks;
+    TimerId next_timer_id = 1;
+
+    std::mutex post_mutex;
+    std::vector<Callback> posted;
+    std::atomic<bool> should_stop{false};
+
+    static constexpr int MAX_EVENTS = 16;
+
+    bool watch(int fd) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+
+    void wake() {
+        uint64_t one = 1;
+        ssize_t result = ::write(wake_fd, &one, sizeof(one));
+        (void)result;  // EAGAIN means a wake-up is already pending
+    }
+
+    void run_posted() {
+        uint64_t count;
+        while (::read(wake_fd, &count, sizeof(count)) > 0) {
+        }
+        std::vector<Callback> tasks;
+        {
+            std::lock_guard<std::mutex> lock(post_mutex);
+            tasks.swap(posted);
+        }
+        for (auto& task : tasks) {
+            task();
+        }
+    }
+
+    void run_signals() {
+        signalfd_siginfo info;
+        while (::read(signal_fd, &info, sizeof(info)) == static_cast<ssize_t>(sizeof(info))) {
+            auto it = signal_callbacks.find(static_cast<int>(info.ssi_signo));
+            if (it != signal_callbacks.end()) {
+                Callback callback = it->second;
+                callback();
+            }
+        }
+    }
+
+    void dispatch(int fd, uint32_t events) {
+        if (fd == wake_fd) {
+            run_posted();
+            return;
+        }
+        if (fd == signal_fd) {
+            run_signals();
+            return;
+        }
+
+        // Callbacks are copied because they may unregister themselves
+        auto timer = timer_ids.find(fd);
+        if (timer != timer_ids.end()) {
+            uint64_t expirations;
+            if (::read(fd, &expirations, sizeof(expirations)) <= 0) {
+                return;
+            }
+            TimerId id = timer->second;
+            Timer& entry = timers[id];
+            Callback callback = entry.callback;
+            if (!entry.repeat) {
+                cancel(id);
+            }
+            callback();
+            return;
+        }
+
+        if (events & EPOLLOUT) {
+            auto writable = write_callbacks.find(fd);
+            if (writable != write_callbacks.end()) {
+                Callback callback = writable->second;
+                callback();
+            }
+        }
+        // Hang-ups and errors go to the read callback, which sees them from read()
+        if (events & ~static_cast<uint32_t>(EPOLLOUT)) {
+            auto it = fd_callbacks.find(fd);
+            if (it != fd_callbacks.end()) {
+                Callback callback = it->second;
+                callback();
+            }
+        }
+    }
+
+    void cancel(TimerId id) {
+        auto it = timers.find(id);
+        if (it == timers.end()) {
+            return;
+        }
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+        ::close(it->second.fd);
+        timer_ids.erase(it->second.fd);
+        timers.erase(it);
+    }
+};
+
+EpollEventLoop::EpollEventLoop() : m_impl(std::make_unique<Impl>()) {
+    m_impl->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    m_impl->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    sigemptyset(&m_impl->signal_mask);
+    if (m_impl->epoll_fd >= 0 && m_impl->wake_fd >= 0) {
+        m_impl->watch(m_impl->wake_fd);
+    }
+}
+
+EpollEventLoop::~EpollEventLoop() {
+    while (!m_impl->timers.empty()) {
+        m_impl->cancel(m_impl->timers.begin()->first);
+    }
+    if (m_impl->signal_fd >= 0) {
+        ::close(m_impl->signal_fd);
+    }
+    if (m_impl->wake_fd >= 0) {
+        ::close(m_impl->wake_fd);
+    }
+    if (m_impl->epoll_fd >= 0) {
+        ::close(m_impl->epoll_fd);
+    }
+}
+
+bool EpollEventLoop::add_fd(int fd, Callback on_readable) {
+    if (m_impl->fd_callbacks.count(fd) || !m_impl->watch(fd)) {
+        return false;
+    }
+    m_impl->fd_callbacks[fd] = std::move(on_readable);
+    return true;
+}
+
+void EpollEventLoop::remove_fd(int fd) {
+    if (m_impl->fd_callbacks.erase(fd)) {
+        m_impl->write_callbacks.erase(fd);
+        epoll_ctl(m_impl->epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+}
+
+bool EpollEventLoop::watch_writable(int fd, Callback on_writable) {
+    if (!m_impl->fd_callbacks.count(fd)) {
+        return false;
+    }
+    epoll_event event{};
+    event.events = on_writable ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(m_impl->epoll_fd, EPOLL_CTL_MOD, fd, &event) != 0) {
+        return false;
+    }
+    if (on_writable) {
+        m_impl->write_callbacks[fd] = std::move(on_writable);
+    } else {
+        m_impl->write_callbacks.erase(fd);
+    }
+    return true;
+}
+
+IEventLoop::TimerId EpollEventLoop::add_timer(std::chrono::milliseconds interval, Callback callback, bool repeat) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        return INVALID_TIMER;
+    }
+
+    // A zero it_value would disarm the timer
+    auto count = std::max<long long>(interval.count(), 1);
+    itimerspec spec{};
+    spec.it_value.tv_sec = static_cast<time_t>(count / 1000);
+    spec.it_value.tv_nsec = static_cast<long>((count % 1000) * 1000000);
+    if (repeat) {
+        spec.it_interval = spec.it_value;
+    }
+    if (timerfd_settime(fd, 0, &spec, nullptr) != 0 || !m_impl->watch(fd)) {
+        ::close(fd);
+        return INVALID_TIMER;
+    }
+
+    TimerId id = m_impl->next_timer_id++;
+    m_impl->timers[id] = Impl::Timer{fd, std::move(callback), repeat};
+    m_impl->timer_ids[fd] = id;
+    return id;
+}
+
+void EpollEventLoop::cancel_timer(TimerId id) {
+    m_impl->cancel(id);
+}
+
+bool EpollEventLoop::watch_signal(int signal_number, Callback callback) {
+    sigaddset(&m_impl->signal_mask, signal_number);
+    if (pthread_sigmask(SIG_BLOCK, &m_impl->signal_mask, nullptr) != 0) {
+        return false;
+    }
+
+    // Passing the existing fd updates its mask in place
+    int fd = signalfd(m_impl->signal_fd, &m_impl->signal_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    if (m_impl->signal_fd < 0) {
+        m_impl->signal_fd = fd;
+        if (!m_impl->watch(fd)) {
+            return false;
+        }
+    }
+    m_impl->signal_callbacks[signal_number] = std::move(callback);
+    return true;
+}
+
+void EpollEventLoop::post(Callback task) {
+    {
+        std::lock_guard<std::mutex> lock(m_impl->post_mutex);
+        m_impl->posted.push_back(std::move(task));
+    }
+    m_impl->wake();
+}
+
+void EpollEventLoop::run() {
+    epoll_event events[Impl::MAX_EVENTS];
+    while (!m_impl->should_stop) {
+        int count = epoll_wait(m_impl->epoll_fd, events, Impl::MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        for (int i = 0; i < count && !m_impl->should_stop; ++i) {
+            m_impl->dispatch(events[i].data.fd, events[i].events);
+        }
+    }
+}
+
+void EpollEventLoop::stop() {
+    m_impl->should_stop = true;
+    m_impl->wake();
+}
+
+#endif
+
+std::unique_ptr<IEventLoop> create_event_loop() {
+#ifdef __linux__
+    return std::make_unique<EpollEventLoop>();
+#else
+    return std::make_unique<PortableEventLoop>();
+#endif
+}
+
+}
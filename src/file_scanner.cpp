@@ -1,31 +1,142 @@
 #include "file_scanner.hpp"
+#include "trace.hpp"
 #include <filesystem>
 #include <algorithm>
 #include <cctype>
 
+#ifdef __linux__
+    #include <atomic>
+    #include <condition_variable>
+    #include <cstdint>
+    #include <deque>
+    #include <mutex>
+    #include <thread>
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
 namespace nigamp {
 
-FileScanner::FileScanner() {
+#ifdef __linux__
+namespace {
+
+// Layout the kernel uses for getdents64 records
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+// Large enough that a network filesystem returns a typical directory in one round trip
+constexpr size_t DIRENT_BUFFER_SIZE = 64 * 1024;
+
+// Directories still to be read, one deque per worker. The owner takes the
+// newest entry (depth first, warm caches); idle workers steal the oldest,
+// which tends to be the biggest untouched subtree.
+struct ScanWork {
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::string> dirs;
+    };
+
+    std::vector<Queue> queues;
+    std::mutex idle_mutex;
+    std::condition_variable idle_cv;
+    size_t pending = 0;             // Queued or being read; guarded by idle_mutex
+    uint64_t pushes = 0;            // Bumped by every push; guarded by idle_mutex
+    std::atomic<bool> stop{false};
+
+    std::mutex report_mutex;        // Serializes the caller's callback
+    size_t found = 0;
+
+    explicit ScanWork(size_t workers) : queues(workers) {}
+
+    // Queued and announced under idle_mutex, so a worker about to wait sees it
+    void push(size_t worker, std::string dir) {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        ++pending;
+        ++pushes;
+        {
+            std::lock_guard<std::mutex> queue_lock(queues[worker].mutex);
+            queues[worker].dirs.push_back(std::move(dir));
+        }
+        idle_cv.notify_one();
+    }
+
+    bool take(size_t worker, std::string& dir) {
+        for (size_t i = 0; i < queues.size(); ++i) {
+            Queue& queue = queues[(worker + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.dirs.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                dir = std::move(queue.dirs.back());
+                queue.dirs.pop_back();
+            } else {
+                dir = std::move(queue.dirs.front());
+                queue.dirs.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void finish_one() {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        if (--pending == 0) {
+            idle_cv.notify_all();
+        }
+    }
+
+    // Blocks until there is a directory to read; false once the whole tree is done
+    bool next(size_t worker, std::string& dir) {
+        for (;;) {
+            uint64_t seen;
+            {
+                std::lock_guard<std::mutex> lock(idle_mutex);
+                seen = pushes;
+            }
+            if (stop || take(worker, dir)) {
+                return !stop;
+            }
+            // Anything pushed since `seen` may be what take() missed, so look again
+            std::unique_lock<std::mutex> lock(idle_mutex);
+            idle_cv.wait(lock, [&]() { return stop || pending == 0 || pushes != seen; });
+            if (pending == 0) {
+                return false;
+            }
+        }
+    }
+
+    void halt() {
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex);
+            stop = true;
+        }
+        idle_cv.notify_all();
+    }
+};
+
+}
+#endif
+
+FileScanner::FileScanner(unsigned threads) : m_threads(threads) {
     m_supported_extensions = {".mp3", ".wav"};
 }
 
 SongList FileScanner::scan_directory(const std::string& directory_path) {
     SongList songs;
     
-    try {
-        // Use recursive_directory_iterator for recursive search
-        for (const auto& entry : std::filesystem::recursive_directory_iterator(directory_path)) {
-            if (entry.is_regular_file()) {
-                std::string file_path = entry.path().string();
-                if (is_supported_format(file_path)) {
-                    Song song = create_song_from_file(file_path);
-                    songs.push_back(song);
-                }
-            }
-        }
-    } catch (const std::filesystem::filesystem_error& e) {
-        // Skip inaccessible directories and continue
-    }
+    scan_directory_streaming(directory_path, [&songs](const Song& song) {
+        songs.push_back(song);
+        return true;
+    });
     
     std::sort(songs.begin(), songs.end(), 
               [](const Song& a, const Song& b) {
@@ -35,6 +146,136 @@ SongList FileScanner::scan_directory(const std::string& directory_path) {
     return songs;
 }
 
+size_t FileScanner::scan_directory_streaming(const std::string& directory_path, const SongFoundCallback& on_song) {
+    TRACE_SCOPE("FileScanner::scan_directory");
+#ifdef __linux__
+    return scan_parallel(directory_path, on_song);
+#else
+    namespace fs = std::filesystem;
+    size_t found = 0;
+    
+    // Unreadable directories are skipped; other errors end the scan without throwing
+    std::error_code ec;
+    fs::recursive_directory_iterator it(directory_path, fs::directory_options::skip_permission_denied, ec);
+    for (fs::recursive_directory_iterator end; !ec && it != end; it.increment(ec)) {
+        std::error_code type_ec;
+        if (!it->is_regular_file(type_ec)) {
+            continue;
+        }
+        
+        std::string file_path = it->path().string();
+        if (is_supported_format(file_path)) {
+            ++found;
+            if (!on_song(create_song_from_file(file_path))) {
+                break;
+            }
+        }
+    }
+    
+    return found;
+#endif
+}
+
+#ifdef __linux__
+size_t FileScanner::scan_parallel(const std::string& directory_path, const SongFoundCallback& on_song) {
+    unsigned workers = m_threads > 0 ? m_threads : std::max(1u, std::thread::hardware_concurrency());
+    ScanWork work(workers);
+    work.push(0, directory_path);
+    
+    auto report = [&](const std::string& file_path) {
+        if (!is_supported_format(file_path)) {
+            return;
+        }
+        Song song = create_song_from_file(file_path);
+        std::lock_guard<std::mutex> lock(work.report_mutex);
+        if (work.stop) {
+            return;
+        }
+        ++work.found;
+        if (!on_song(song)) {
+            work.halt();
+        }
+    };
+    
+    auto read_directory = [&](size_t worker, const std::string& dir) {
+        // Unreadable directories are skipped, like skip_permission_denied
+        int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        // Matches what recursive_directory_iterator would build with operator/
+        std::string prefix = dir;
+        if (prefix.empty() || prefix.back() != '/') {
+            prefix += '/';
+        }
+        
+        std::vector<char> buffer(DIRENT_BUFFER_SIZE);
+        long bytes;
+        while (!work.stop && (bytes = syscall(SYS_getdents64, fd, buffer.data(), buffer.size())) > 0) {
+            for (long offset = 0; offset < bytes;) {
+                auto* entry = reinterpret_cast<LinuxDirent64*>(buffer.data() + offset);
+                offset += entry->d_reclen;
+                
+                const char* name = entry->d_name;
+                if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                    continue;
+                }
+                
+                unsigned char type = entry->d_type;
+                if (type == DT_UNKNOWN || type == DT_LNK) {
+                    // Some filesystems leave d_type unset; symlinks count as what they point to,
+                    // but like recursive_directory_iterator, linked directories are not entered
+                    struct stat st;
+                    int flags = type == DT_UNKNOWN ? AT_SYMLINK_NOFOLLOW : 0;
+                    if (fstatat(fd, name, &st, flags) != 0) {
+                        continue;
+                    }
+                    if (S_ISLNK(st.st_mode)) {
+                        // Only now known to be a link: follow it, but still only for files
+                        if (fstatat(fd, name, &st, 0) != 0 || !S_ISREG(st.st_mode)) {
+                            continue;
+                        }
+                    }
+                    if (S_ISREG(st.st_mode)) {
+                        type = DT_REG;
+                    } else if (S_ISDIR(st.st_mode) && type == DT_UNKNOWN) {
+                        type = DT_DIR;
+                    } else {
+                        continue;
+                    }
+                }
+                
+                if (type == DT_DIR) {
+                    work.push(worker, prefix + name);
+                } else if (type == DT_REG) {
+                    report(prefix + name);
+                }
+            }
+        }
+        ::close(fd);
+    };
+    
+    auto worker_loop = [&](size_t worker) {
+        std::string dir;
+        while (work.next(worker, dir)) {
+            read_directory(worker, dir);
+            work.finish_one();
+        }
+    };
+    
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < workers; ++i) {
+        pool.emplace_back(worker_loop, i);
+    }
+    worker_loop(0);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    
+    return work.found;
+}
+#endif
+
 bool FileScanner::is_supported_format(const std::string& file_path) {
     std::string extension = get_file_extension(file_path);
     std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
@@ -75,8 +316,8 @@ std::string FileScanner::extract_title_from_filename(const std::string& file_pat
     return filename;
 }
 
-std::unique_ptr<IFileScanner> create_file_scanner() {
-    return std::make_unique<FileScanner>();
+std::unique_ptr<IFileScanner> create_file_scanner(unsigned threads) {
+    return std::make_unique<FileScanner>(threads);
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "gain_ramp.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define NIGAMP_GAIN_SSE2 1
+#endif
+
+namespace nigamp {
+
+namespace {
+
+// Ramps are rendered in blocks so the per-frame gain table stays in L1
+constexpr size_t BLOCK_FRAMES = 256;
+
+inline int16_t scale_sample(int16_t sample, float gain) {
+    long scaled = std::lrint(sample * gain);
+    return static_cast<int16_t>(std::max(-32768L, std::min(32767L, scaled)));
+}
+
+void apply_gains(int16_t* samples, const float* gains, size_t count) {
+    size_t i = 0;
+#if defined(NIGAMP_GAIN_SSE2)
+    for (; i + 8 <= count; i += 8) {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        __m128i sign = _mm_srai_epi16(in, 15);
+        __m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(in, sign));
+        __m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(in, sign));
+        low = _mm_mul_ps(low, _mm_loadu_ps(gains + i));
+        high = _mm_mul_ps(high, _mm_loadu_ps(gains + i + 4));
+        // packs saturates to int16, so clipping comes for free
+        __m128i out = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i), out);
+    }
+#endif
+    for (; i < count; ++i) {
+        samples[i] = scale_sample(samples[i], gains[i]);
+    }
+}
+
+void apply_constant(int16_t* samples, float gain, size_t count) {
+    if (gain == 1.0f) {
+        return;
+    }
+    if (gain == 0.0f) {
+        std::memset(samples, 0, count * sizeof(int16_t));
+        return;
+    }
+
+    size_t i = 0;
+#if defined(NIGAMP_GAIN_SSE2)
+    __m128 factor = _mm_set1_ps(gain);
+    for (; i + 8 <= count; i += 8) {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        __m128i sign = _mm_srai_epi16(in, 15);
+        __m128 low = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(in, sign)), factor);
+        __m128 high = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(in, sign)), factor);
+        __m128i out = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i), out);
+    }
+#endif
+    for (; i < count; ++i) {
+        samples[i] = scale_sample(samples[i], gain);
+    }
+}
+
+} // namespace
+
+void GainRamp::Ramp::set(float value, size_t frames) {
+    target = value;
+    if (frames == 0 || current == value) {
+        current = value;
+        step = 0.0f;
+        remaining = 0;
+        return;
+    }
+    step = (value - current) / static_cast<float>(frames);
+    remaining = frames;
+}
+
+void GainRamp::Ramp::advance(size_t frames) {
+    if (remaining == 0) {
+        return;
+    }
+    if (frames >= remaining) {
+        current = target;
+        step = 0.0f;
+        remaining = 0;
+    } else {
+        current += step * static_cast<float>(frames);
+        remaining -= frames;
+    }
+}
+
+void GainRamp::configure(int sample_rate, int channels) {
+    m_sample_rate = std::max(1, sample_rate);
+    m_channels = std::max(1, channels);
+}
+
+void GainRamp::set_volume(float volume, double ramp_ms) {
+    m_volume.set(volume, ms_to_frames(ramp_ms));
+}
+
+void GainRamp::set_fade(float level, double ramp_ms) {
+    m_fade.set(level, ms_to_frames(ramp_ms));
+}
+
+void GainRamp::jump_fade(float level) {
+    m_fade.set(level, 0);
+}
+
+float GainRamp::get_volume_target() const {
+    return m_volume.target;
+}
+
+float GainRamp::get_fade_level() const {
+    return m_fade.current;
+}
+
+bool GainRamp::is_fading() const {
+    return m_fade.remaining > 0;
+}
+
+void GainRamp::process(int16_t* samples, size_t frames) {
+    size_t done = 0;
+    while (done < frames) {
+        int16_t* block = samples + done * m_channels;
+        bool ramping = m_volume.remaining > 0 || m_fade.remaining > 0;
+
+        if (!ramping) {
+            apply_constant(block, m_volume.current * m_fade.current, (frames - done) * m_channels);
+            return;
+        }
+
+        // Stop the block where either ramp ends so each segment is a clean line
+        size_t count = std::min(frames - done, BLOCK_FRAMES);
+        if (m_volume.remaining > 0) {
+            count = std::min(count, m_volume.remaining);
+        }
+        if (m_fade.remaining > 0) {
+            count = std::min(count, m_fade.remaining);
+        }
+
+        float volume = m_volume.current;
+        float volume_step = m_volume.remaining > 0 ? m_volume.step : 0.0f;
+        float fade = m_fade.current;
+        float fade_step = m_fade.remaining > 0 ? m_fade.step : 0.0f;
+
+        m_gains.resize(count * m_channels);
+        for (size_t f = 0; f < count; ++f) {
+            float position = static_cast<float>(f + 1);
+            float gain = (volume + volume_step * position) * (fade + fade_step * position);
+            for (int c = 0; c < m_channels; ++c) {
+                m_gains[f * m_channels + c] = gain;
+            }
+        }
+        apply_gains(block, m_gains.data(), count * m_channels);
+
+        m_volume.advance(count);
+        m_fade.advance(count);
+        done += count;
+    }
+}
+
+size_t GainRamp::ms_to_frames(double ms) const {
+    if (ms <= 0.0) {
+        return 0;
+    }
+    return static_cast<size_t>(ms * m_sample_rate / 1000.0);
+}
+
+}
@@ -19,6 +19,8 @@ struct WindowsHotkeyHandler::Impl {
     static constexpr int HOTKEY_VOLUME_UP = 4;
     static constexpr int HOTKEY_VOLUME_DOWN = 5;
     static constexpr int HOTKEY_QUIT = 6;
+    static constexpr int HOTKEY_SEEK_FORWARD = 7;
+    static constexpr int HOTKEY_SEEK_BACKWARD = 8;
     
     bool create_window() {
         // Create message-only window for global hotkeys
@@ -85,6 +87,12 @@ struct WindowsHotkeyHandler::Impl {
             case HOTKEY_QUIT:
                 callback(HotkeyAction::QUIT);
                 break;
+            case HOTKEY_SEEK_FORWARD:
+                callback(HotkeyAction::SEEK_FORWARD);
+                break;
+            case HOTKEY_SEEK_BACKWARD:
+                callback(HotkeyAction::SEEK_BACKWARD);
+                break;
         }
     }
     
@@ -217,6 +225,8 @@ bool WindowsHotkeyHandler::register_hotkeys() {
     register_hotkey_with_error(m_impl->HOTKEY_VOLUME_UP, MOD_CONTROL | MOD_ALT, VK_OEM_PLUS, "Ctrl+Alt+Plus");
     register_hotkey_with_error(m_impl->HOTKEY_VOLUME_DOWN, MOD_CONTROL | MOD_ALT, VK_OEM_MINUS, "Ctrl+Alt+Minus");
     register_hotkey_with_error(m_impl->HOTKEY_QUIT, MOD_CONTROL | MOD_ALT, VK_ESCAPE, "Ctrl+Alt+Escape");
+    register_hotkey_with_error(m_impl->HOTKEY_SEEK_FORWARD, MOD_CONTROL | MOD_ALT, VK_RIGHT, "Ctrl+Alt+Right");
+    register_hotkey_with_error(m_impl->HOTKEY_SEEK_BACKWARD, MOD_CONTROL | MOD_ALT, VK_LEFT, "Ctrl+Alt+Left");
     
     if (!success) {
         std::cerr << "Note: Some hotkeys failed to register. Try closing other applications\n";
@@ -237,6 +247,8 @@ void WindowsHotkeyHandler::unregister_hotkeys() {
     UnregisterHotKey(m_impl->window_handle, m_impl->HOTKEY_VOLUME_UP);
     UnregisterHotKey(m_impl->window_handle, m_impl->HOTKEY_VOLUME_DOWN);
     UnregisterHotKey(m_impl->window_handle, m_impl->HOTKEY_QUIT);
+    UnregisterHotKey(m_impl->window_handle, m_impl->HOTKEY_SEEK_FORWARD);
+    UnregisterHotKey(m_impl->window_handle, m_impl->HOTKEY_SEEK_BACKWARD);
 }
 
 void WindowsHotkeyHandler::process_messages() {
@@ -252,6 +264,12 @@ void WindowsHotkeyHandler::process_messages() {
     }
 }
 
+bool WindowsHotkeyHandler::attach(IEventLoop& loop) {
+    // WM_HOTKEY arrives through a window message queue, which has no fd to poll
+    (void)loop;
+    return false;
+}
+
 std::unique_ptr<IHotkeyHandler> create_hotkey_handler() {
     return std::make_unique<WindowsHotkeyHandler>();
 }
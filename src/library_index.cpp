@@ -0,0 +1,312 @@
+#include "library_index.hpp"
+#include "binary_file.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace nigamp {
+
+namespace {
+
+constexpr char MAGIC[4] = {'N', 'G', 'L', 'I'};
+constexpr uint32_t VERSION = 1;
+
+// magic, version, song count, directory length, string table size
+constexpr size_t HEADER_SIZE = 4 + 4 + 4 + 4 + 8;
+
+// path, title and artist as offset/length pairs, duration bits, size, mtime
+constexpr size_t RECORD_SIZE = 6 * 4 + 8 + 8 + 8;
+
+// Identical titles and artists share one copy in the string table
+class StringTable {
+private:
+    std::string m_data;
+    std::unordered_map<std::string, uint32_t> m_offsets;
+
+public:
+    bool add(const std::string& value, bool dedupe, uint32_t& offset) {
+        if (dedupe) {
+            auto it = m_offsets.find(value);
+            if (it != m_offsets.end()) {
+                offset = it->second;
+                return true;
+            }
+        }
+        if (m_data.size() + value.size() > UINT32_MAX) {
+            return false;
+        }
+        offset = static_cast<uint32_t>(m_data.size());
+        m_data += value;
+        if (dedupe) {
+            m_offsets.emplace(value, offset);
+        }
+        return true;
+    }
+
+    const std::string& data() const {
+        return m_data;
+    }
+};
+
+}
+
+bool read_file_stamp(const std::string& path, FileStamp& stamp) {
+#ifdef __linux__
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+    stamp.size = static_cast<uint64_t>(info.st_size);
+    stamp.mtime_ns = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    return true;
+#else
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return false;
+    }
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        return false;
+    }
+    stamp.size = static_cast<uint64_t>(size);
+    stamp.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+    return true;
+#endif
+}
+
+bool save_library_index(const std::string& path, const std::string& directory, std::vector<IndexedSong> songs) {
+    if (songs.size() > UINT32_MAX) {
+        return false;
+    }
+    std::sort(songs.begin(), songs.end(), [](const IndexedSong& a, const IndexedSong& b) {
+        return a.song.file_path < b.song.file_path;
+    });
+
+    StringTable strings;
+    uint32_t directory_offset = 0;
+    std::string records;
+    records.reserve(songs.size() * RECORD_SIZE);
+    if (!strings.add(directory, false, directory_offset)) {
+        return false;
+    }
+    for (const auto& entry : songs) {
+        uint32_t path_offset = 0;
+        uint32_t title_offset = 0;
+        uint32_t artist_offset = 0;
+        if (!strings.add(entry.song.file_path, false, path_offset) ||
+            !strings.add(entry.song.title, true, title_offset) ||
+            !strings.add(entry.song.artist, true, artist_offset)) {
+            return false;
+        }
+        uint64_t duration_bits = 0;
+        std::memcpy(&duration_bits, &entry.song.duration, sizeof(duration_bits));
+
+        put_u32(records, path_offset);
+        put_u32(records, static_cast<uint32_t>(entry.song.file_path.size()));
+        put_u32(records, title_offset);
+        put_u32(records, static_cast<uint32_t>(entry.song.title.size()));
+        put_u32(records, artist_offset);
+        put_u32(records, static_cast<uint32_t>(entry.song.artist.size()));
+        put_u64(records, duration_bits);
+        put_u64(records, entry.stamp.size);
+        put_u64(records, static_cast<uint64_t>(entry.stamp.mtime_ns));
+    }
+
+    std::string header;
+    header.append(MAGIC, sizeof(MAGIC));
+    put_u32(header, VERSION);
+    put_u32(header, static_cast<uint32_t>(songs.size()));
+    put_u32(header, static_cast<uint32_t>(directory.size()));
+    put_u64(header, strings.data().size());
+
+    return write_file_atomically(path, {header, records, strings.data()});
+}
+
+struct LibraryIndex::Impl {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    std::string contents;
+#endif
+
+    size_t count = 0;
+    size_t directory_length = 0;
+    const unsigned char* records = nullptr;
+    const char* strings = nullptr;
+    uint64_t strings_size = 0;
+
+    ~Impl() {
+        unmap();
+    }
+
+    bool map(const std::string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        size_t length = static_cast<size_t>(info.st_size);
+        void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            return false;
+        }
+        data = static_cast<const unsigned char*>(mapping);
+        size = length;
+        return true;
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        contents.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        data = reinterpret_cast<const unsigned char*>(contents.data());
+        size = contents.size();
+        return true;
+#endif
+    }
+
+    void unmap() {
+#ifndef _WIN32
+        if (data) {
+            ::munmap(const_cast<unsigned char*>(data), size);
+        }
+#else
+        contents.clear();
+#endif
+        data = nullptr;
+        size = 0;
+        count = 0;
+        records = nullptr;
+        strings = nullptr;
+        strings_size = 0;
+    }
+
+    // Every section must fit exactly; the records themselves are checked on access
+    bool parse_header() {
+        if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0 ||
+            get_u32(data + 4) != VERSION) {
+            return false;
+        }
+        count = get_u32(data + 8);
+        directory_length = get_u32(data + 12);
+        strings_size = get_u64(data + 16);
+        size_t body = size - HEADER_SIZE;
+        if (body / RECORD_SIZE < count || body - count * RECORD_SIZE != strings_size ||
+            directory_length > strings_size) {
+            return false;
+        }
+        records = data + HEADER_SIZE;
+        strings = reinterpret_cast<const char*>(records + count * RECORD_SIZE);
+        return true;
+    }
+
+    bool text(const unsigned char* field, std::string_view& value) const {
+        uint32_t offset = get_u32(field);
+        uint32_t length = get_u32(field + 4);
+        if (offset > strings_size || length > strings_size - offset) {
+            return false;
+        }
+        value = std::string_view(strings + offset, length);
+        return true;
+    }
+
+    std::string_view path_at(size_t index) const {
+        std::string_view path;
+        return text(records + index * RECORD_SIZE, path) ? path : std::string_view();
+    }
+};
+
+LibraryIndex::LibraryIndex() : m_impl(std::make_unique<Impl>()) {}
+
+LibraryIndex::~LibraryIndex() = default;
+
+bool LibraryIndex::open(const std::string& path) {
+    m_impl->unmap();
+    if (!m_impl->map(path)) {
+        return false;
+    }
+    if (!m_impl->parse_header()) {
+        m_impl->unmap();
+        return false;
+    }
+    return true;
+}
+
+void LibraryIndex::close() {
+    m_impl->unmap();
+}
+
+bool LibraryIndex::is_open() const {
+    return m_impl->data != nullptr;
+}
+
+size_t LibraryIndex::size() const {
+    return m_impl->count;
+}
+
+std::string LibraryIndex::directory() const {
+    if (!is_open()) {
+        return "";
+    }
+    return std::string(m_impl->strings, m_impl->directory_length);
+}
+
+bool LibraryIndex::get(size_t index, IndexedSong& entry) const {
+    if (index >= m_impl->count) {
+        return false;
+    }
+    const unsigned char* record = m_impl->records + index * RECORD_SIZE;
+    std::string_view path;
+    std::string_view title;
+    std::string_view artist;
+    if (!m_impl->text(record, path) || !m_impl->text(record + 8, title) || !m_impl->text(record + 16, artist)) {
+        return false;
+    }
+
+    uint64_t duration_bits = get_u64(record + 24);
+    entry.song.file_path.assign(path);
+    entry.song.title.assign(title);
+    entry.song.artist.assign(artist);
+    std::memcpy(&entry.song.duration, &duration_bits, sizeof(duration_bits));
+    entry.stamp.size = get_u64(record + 32);
+    entry.stamp.mtime_ns = static_cast<int64_t>(get_u64(record + 40));
+    return true;
+}
+
+size_t LibraryIndex::find(std::string_view path) const {
+    size_t low = 0;
+    size_t high = m_impl->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        int order = m_impl->path_at(middle).compare(path);
+        if (order == 0) {
+            return middle;
+        }
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return NOT_FOUND;
+}
+
+}
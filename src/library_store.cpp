@@ -0,0 +1,423 @@
+#include "library_store.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace nigamp {
+
+StringPool::StringId StringPool::add(std::string_view text) {
+    unsigned char prefix[10];
+    size_t prefix_size = 0;
+    size_t size = text.size();
+    do {
+        prefix[prefix_size++] = static_cast<unsigned char>((size & 0x7F) | (size > 0x7F ? 0x80 : 0));
+        size >>= 7;
+    } while (size > 0);
+    size_t total = prefix_size + text.size();
+
+    size_t block;
+    size_t offset = 0;
+    // Long strings get a block of their own rather than wasting the current one's tail
+    if (total > BLOCK_SIZE / 4) {
+        m_blocks.push_back(std::make_unique<char[]>(total));
+        m_block_bytes += total;
+        block = m_blocks.size() - 1;
+    } else {
+        if (m_block_used + total > BLOCK_SIZE) {
+            m_blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+            m_block_bytes += BLOCK_SIZE;
+            m_current_block = m_blocks.size() - 1;
+            m_block_used = 0;
+        }
+        block = m_current_block;
+        offset = m_block_used;
+        m_block_used += total;
+    }
+    char* destination = m_blocks[block].get() + offset;
+    std::memcpy(destination, prefix, prefix_size);
+    if (!text.empty()) {
+        std::memcpy(destination + prefix_size, text.data(), text.size());
+    }
+    ++m_count;
+    m_stored_bytes += text.size();
+    return static_cast<StringId>(block << OFFSET_BITS | offset);
+}
+
+StringPool::StringId StringPool::replace(StringId id, std::string_view text) {
+    std::string_view old = get(id);
+    if (text.size() > old.size()) {
+        return add(text);
+    }
+    // A shorter length never needs a longer prefix, so the text stays where it was
+    unsigned char* at = reinterpret_cast<unsigned char*>(m_blocks[id >> OFFSET_BITS].get()) + (id & OFFSET_MASK);
+    size_t prefix_size = reinterpret_cast<const unsigned char*>(old.data()) - at;
+    size_t size = text.size();
+    for (size_t i = 0; i < prefix_size; ++i) {
+        // Padded to the old prefix's width with continuation bytes
+        at[i] = static_cast<unsigned char>((size & 0x7F) | (i + 1 < prefix_size ? 0x80 : 0));
+        size >>= 7;
+    }
+    if (!text.empty()) {
+        std::memmove(at + prefix_size, text.data(), text.size());
+    }
+    return id;
+}
+
+StringPool::StringId StringPool::intern(std::string_view text) {
+    auto it = m_interned.find(text);
+    if (it != m_interned.end()) {
+        return it->second;
+    }
+    StringId id = add(text);
+    m_interned.emplace(get(id), id);
+    return id;
+}
+
+size_t StringPool::memory_bytes() const {
+    // Hash nodes hold a view, an id and a next pointer; buckets are a pointer each
+    return m_block_bytes + m_blocks.capacity() * sizeof(std::unique_ptr<char[]>) +
+           m_interned.size() * (sizeof(std::string_view) + sizeof(StringId) + 2 * sizeof(void*)) +
+           m_interned.bucket_count() * sizeof(void*);
+}
+
+void StringPool::clear() {
+    m_blocks.clear();
+    m_current_block = 0;
+    m_block_used = BLOCK_SIZE;
+    m_block_bytes = 0;
+    m_count = 0;
+    m_stored_bytes = 0;
+    m_interned.clear();
+}
+
+size_t LibraryStore::split_point(std::string_view path) {
+    size_t separator = path.find_last_of("/\\");
+    return separator == std::string_view::npos ? 0 : separator + 1;
+}
+
+uint32_t LibraryStore::intern_directory(std::string_view directory) {
+    auto it = m_directories.find(directory);
+    if (it != m_directories.end()) {
+        return it->second;
+    }
+    StringPool::StringId path = m_strings.intern(directory);
+    uint32_t index = static_cast<uint32_t>(m_directory_list.size());
+    m_directory_list.push_back(Directory{path});
+    m_directories.emplace(m_strings.get(path), index);
+    return index;
+}
+
+// Puts the song at the head of its directory's list
+void LibraryStore::link(SongId id) {
+    Directory& directory = m_directory_list[m_directory[id]];
+    if (directory.emptied) {
+        m_dead_string_bytes -= m_strings.get(directory.path).size();
+        directory.emptied = false;
+    }
+    m_previous_in_directory[id] = INVALID_SONG_ID;
+    m_next_in_directory[id] = directory.first_song;
+    if (directory.first_song != INVALID_SONG_ID) {
+        m_previous_in_directory[directory.first_song] = id;
+    }
+    directory.first_song = id;
+}
+
+void LibraryStore::unlink(SongId id) {
+    SongId previous = m_previous_in_directory[id];
+    SongId next = m_next_in_directory[id];
+    if (previous != INVALID_SONG_ID) {
+        m_next_in_directory[previous] = next;
+    } else {
+        m_directory_list[m_directory[id]].first_song = next;
+    }
+    if (next != INVALID_SONG_ID) {
+        m_previous_in_directory[next] = previous;
+    }
+    Directory& directory = m_directory_list[m_directory[id]];
+    if (directory.first_song == INVALID_SONG_ID) {
+        m_dead_string_bytes += m_strings.get(directory.path).size();
+        directory.emptied = true;
+    }
+}
+
+size_t LibraryStore::hash_path(uint32_t directory, std::string_view file_name) {
+    return std::hash<std::string_view>()(file_name) ^ (directory * 0x9E3779B97F4A7C15ull);
+}
+
+// The slot holding the song, or the empty slot where it would go
+size_t LibraryStore::find_slot(uint32_t directory, std::string_view file_name) const {
+    size_t mask = m_slots.size() - 1;
+    size_t slot = hash_path(directory, file_name) & mask;
+    while (m_slots[slot] != INVALID_SONG_ID) {
+        SongId id = m_slots[slot];
+        if (m_directory[id] == directory && m_strings.get(m_file_name[id]) == file_name) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void LibraryStore::insert_slot(SongId id) {
+    // Kept at most half full so probes stay short
+    if ((m_live_count + 1) * 2 > m_slots.size()) {
+        std::vector<SongId> old_slots(std::max<size_t>(16, m_slots.size() * 2), INVALID_SONG_ID);
+        old_slots.swap(m_slots);
+        for (SongId old_id : old_slots) {
+            if (old_id != INVALID_SONG_ID) {
+                m_slots[find_slot(m_directory[old_id], m_strings.get(m_file_name[old_id]))] = old_id;
+            }
+        }
+    }
+    m_slots[find_slot(m_directory[id], m_strings.get(m_file_name[id]))] = id;
+}
+
+// Backward-shift deletion: later entries of the probe run move up, so no tombstones
+void LibraryStore::erase_slot(SongId id) {
+    size_t mask = m_slots.size() - 1;
+    size_t hole = find_slot(m_directory[id], m_strings.get(m_file_name[id]));
+    m_slots[hole] = INVALID_SONG_ID;
+    for (size_t slot = (hole + 1) & mask; m_slots[slot] != INVALID_SONG_ID; slot = (slot + 1) & mask) {
+        SongId moved = m_slots[slot];
+        size_t home = hash_path(m_directory[moved], m_strings.get(m_file_name[moved])) & mask;
+        // Move it only if its home is not between the hole and where it sits
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            m_slots[hole] = moved;
+            m_slots[slot] = INVALID_SONG_ID;
+            hole = slot;
+        }
+    }
+}
+
+// Unchanged fields keep their strings, and changed ones are overwritten in
+// place when they fit, so tag refreshes and renames mostly do not grow the pool
+void LibraryStore::assign(SongId id, const Song& song) {
+    std::string_view path = song.file_path;
+    size_t split = split_point(path);
+    m_directory[id] = intern_directory(path.substr(0, split));
+    set_string(m_file_name[id], path.substr(split));
+    set_string(m_title[id], song.title);
+    m_artist[id] = m_strings.intern(song.artist);
+    m_duration[id] = static_cast<float>(song.duration);
+}
+
+void LibraryStore::set_string(StringPool::StringId& id, std::string_view text) {
+    if (id == INVALID_SONG_ID) {
+        id = m_strings.add(text);
+        return;
+    }
+    std::string_view old = m_strings.get(id);
+    if (old == text) {
+        return;
+    }
+    size_t old_size = old.size();
+    StringPool::StringId replaced = m_strings.replace(id, text);
+    m_dead_string_bytes += replaced == id ? old_size - text.size() : old_size;
+    id = replaced;
+}
+
+void LibraryStore::release_strings(SongId id) {
+    m_dead_string_bytes += m_strings.get(m_file_name[id]).size() + m_strings.get(m_title[id]).size();
+    m_file_name[id] = INVALID_SONG_ID;
+    m_title[id] = INVALID_SONG_ID;
+}
+
+// Rebuilding costs one pass over the live songs, and it waits until the dead
+// text outweighs the live, so it is amortized against the changes that made it
+void LibraryStore::compact_if_wasteful() {
+    if (m_dead_string_bytes >= COMPACT_MIN_BYTES && m_dead_string_bytes * 2 > m_strings.stored_bytes()) {
+        compact();
+    }
+}
+
+// Copies the live songs' strings into a fresh pool. Directories and artists no
+// song uses any more are dropped, so directory indices and the path lookup are
+// rebuilt too.
+void LibraryStore::compact() {
+    StringPool old_strings = std::move(m_strings);
+    std::vector<Directory> old_directories = std::move(m_directory_list);
+    m_strings.clear();
+    m_directory_list.clear();
+    m_directories.clear();
+    for (SongId id = 0; id < m_live.size(); ++id) {
+        if (!m_live[id]) {
+            continue;
+        }
+        m_directory[id] = intern_directory(old_strings.get(old_directories[m_directory[id]].path));
+        m_file_name[id] = m_strings.add(old_strings.get(m_file_name[id]));
+        m_title[id] = m_strings.add(old_strings.get(m_title[id]));
+        m_artist[id] = m_strings.intern(old_strings.get(m_artist[id]));
+        link(id);
+    }
+    std::fill(m_slots.begin(), m_slots.end(), INVALID_SONG_ID);
+    for (SongId id = 0; id < m_live.size(); ++id) {
+        if (m_live[id]) {
+            m_slots[find_slot(m_directory[id], m_strings.get(m_file_name[id]))] = id;
+        }
+    }
+    m_dead_string_bytes = 0;
+}
+
+SongId LibraryStore::add(const Song& song) {
+    SongId existing = find(song.file_path);
+    if (existing != INVALID_SONG_ID) {
+        assign(existing, song);
+        compact_if_wasteful();
+        return existing;
+    }
+    SongId id;
+    if (!m_free.empty()) {
+        id = m_free.back();
+        m_free.pop_back();
+        m_live[id] = true;
+        m_play_count[id] = 0;
+    } else {
+        if (m_file_name.size() >= INVALID_SONG_ID) {
+            return INVALID_SONG_ID;
+        }
+        id = static_cast<SongId>(m_file_name.size());
+        m_directory.push_back(INVALID_SONG_ID);
+        m_file_name.push_back(INVALID_SONG_ID);
+        m_title.push_back(INVALID_SONG_ID);
+        m_artist.push_back(INVALID_SONG_ID);
+        m_duration.push_back(0.0f);
+        m_live.push_back(true);
+        m_play_count.push_back(0);
+        m_generation.push_back(0);
+        m_next_in_directory.push_back(INVALID_SONG_ID);
+        m_previous_in_directory.push_back(INVALID_SONG_ID);
+    }
+    m_generation[id] = ++m_next_generation;
+    assign(id, song);
+    link(id);
+    insert_slot(id);
+    ++m_live_count;
+    compact_if_wasteful();
+    return id;
+}
+
+bool LibraryStore::update(SongId id, const Song& song) {
+    if (!contains(id)) {
+        return false;
+    }
+    SongId other = find(song.file_path);
+    if (other != INVALID_SONG_ID && other != id) {
+        return false;
+    }
+    std::string_view path = song.file_path;
+    bool moved = view(id).directory != path.substr(0, split_point(path));
+    erase_slot(id);
+    if (moved) {
+        unlink(id);
+    }
+    assign(id, song);
+    if (moved) {
+        link(id);
+    }
+    insert_slot(id);
+    compact_if_wasteful();
+    return true;
+}
+
+bool LibraryStore::remove(SongId id) {
+    if (!contains(id)) {
+        return false;
+    }
+    erase_slot(id);
+    unlink(id);
+    release_strings(id);
+    m_live[id] = false;
+    m_free.push_back(id);
+    --m_live_count;
+    compact_if_wasteful();
+    return true;
+}
+
+void LibraryStore::clear() {
+    m_slots.clear();
+    m_directories.clear();
+    m_directory_list.clear();
+    m_directory.clear();
+    m_file_name.clear();
+    m_title.clear();
+    m_artist.clear();
+    m_duration.clear();
+    m_live.clear();
+    m_play_count.clear();
+    m_generation.clear();
+    m_next_in_directory.clear();
+    m_previous_in_directory.clear();
+    m_free.clear();
+    m_live_count = 0;
+    m_dead_string_bytes = 0;
+    m_strings.clear();
+}
+
+SongId LibraryStore::find(std::string_view path) const {
+    size_t split = split_point(path);
+    auto it = m_directories.find(path.substr(0, split));
+    if (it == m_directories.end() || m_slots.empty()) {
+        return INVALID_SONG_ID;
+    }
+    return m_slots[find_slot(it->second, path.substr(split))];
+}
+
+SongView LibraryStore::view(SongId id) const {
+    SongView view;
+    if (!contains(id)) {
+        return view;
+    }
+    view.id = id;
+    view.directory = m_strings.get(m_directory_list[m_directory[id]].path);
+    view.file_name = m_strings.get(m_file_name[id]);
+    view.title = m_strings.get(m_title[id]);
+    view.artist = m_strings.get(m_artist[id]);
+    view.duration = m_duration[id];
+    return view;
+}
+
+SongHandle LibraryStore::handle(SongId id) const {
+    SongHandle handle;
+    if (contains(id)) {
+        handle.id = id;
+        handle.generation = m_generation[id];
+    }
+    return handle;
+}
+
+SongView LibraryStore::view(SongHandle handle) const {
+    return valid(handle) ? view(handle.id) : SongView();
+}
+
+std::string LibraryStore::path(SongId id) const {
+    return view(id).path();
+}
+
+std::vector<SongId> LibraryStore::songs_under(std::string_view dir_path) const {
+    std::string prefix(dir_path);
+    if (prefix.empty() || (prefix.back() != '/' && prefix.back() != '\\')) {
+        prefix += '/';
+    }
+
+    std::vector<SongId> songs;
+    for (auto it = m_directories.lower_bound(prefix);
+         it != m_directories.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+        for (SongId id = m_directory_list[it->second].first_song; id != INVALID_SONG_ID; id = m_next_in_directory[id]) {
+            songs.push_back(id);
+        }
+    }
+    return songs;
+}
+
+size_t LibraryStore::memory_bytes() const {
+    size_t columns = (m_directory.capacity() + m_file_name.capacity() + m_title.capacity() + m_artist.capacity()) *
+                     sizeof(StringPool::StringId) +
+                     m_duration.capacity() * sizeof(float) + m_live.capacity() / 8 +
+                     (m_play_count.capacity() + m_generation.capacity() + m_next_in_directory.capacity() +
+                      m_previous_in_directory.capacity() + m_free.capacity()) * sizeof(uint32_t);
+    size_t directories = m_directories.size() * (sizeof(std::string_view) + sizeof(uint32_t) + 4 * sizeof(void*)) +
+                         m_directory_list.capacity() * sizeof(Directory);
+    size_t paths = m_slots.capacity() * sizeof(SongId);
+    return columns + m_strings.memory_bytes() + directories + paths;
+}
+
+}
@@ -0,0 +1,392 @@
+#include "library_watcher.hpp"
+
+#ifdef __linux__
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace nigamp {
+
+namespace {
+
+constexpr uint32_t WATCH_MASK = IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+std::string join_path(const std::string& dir, const char* name) {
+    std::string path = dir;
+    if (path.empty() || path.back() != '/') {
+        path += '/';
+    }
+    return path + name;
+}
+
+bool is_under(const std::string& path, const std::string& dir) {
+    return path.size() > dir.size() && path.compare(0, dir.size(), dir) == 0 && path[dir.size()] == '/';
+}
+
+}
+
+struct LibraryWatcher::Impl {
+    // A directory for the setup thread to watch, with everything below it
+    struct PendingTree {
+        std::string dir;
+        bool report_files;  // False for the root, whose files the startup scan finds
+    };
+
+    IEventLoop& loop;
+    int inotify_fd = -1;
+    int setup_done_fd = -1;  // Signalled by the setup thread as trees are watched
+    ChangeHandler on_changes;
+    RescanHandler on_rescan;
+
+    // Shared with the setup thread
+    mutable std::mutex mutex;
+    std::unordered_map<int, std::string> dir_by_wd;
+    std::map<std::string, int> wd_by_dir;  // Ordered so a subtree is one range
+    std::deque<PendingTree> pending_trees;
+    std::vector<LibraryChange> found_files;  // Waiting to be reported on the loop
+    bool setup_running = false;
+
+    std::thread setup_thread;
+    std::atomic<bool> cancel_setup{false};
+    std::atomic<bool> limit_reached{false};
+
+    explicit Impl(IEventLoop& event_loop) : loop(event_loop) {}
+
+    // False only when the kernel is out of watches
+    bool add_watch(const std::string& dir) {
+        std::lock_guard<std::mutex> lock(mutex);
+        int wd = inotify_add_watch(inotify_fd, dir.c_str(), WATCH_MASK);
+        if (wd < 0) {
+            return errno != ENOSPC;
+        }
+        auto it = dir_by_wd.find(wd);
+        if (it != dir_by_wd.end()) {
+            wd_by_dir.erase(it->second);
+        }
+        dir_by_wd[wd] = dir;
+        wd_by_dir[dir] = wd;
+        return true;
+    }
+
+    // Watches dir and everything below it; files found are reported as added when `added` is given
+    bool add_tree(const std::string& dir, std::vector<LibraryChange>* added) {
+        namespace fs = std::filesystem;
+        if (!add_watch(dir)) {
+            return false;
+        }
+        std::error_code ec;
+        fs::recursive_directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec);
+        for (fs::recursive_directory_iterator end; !ec && it != end && !cancel_setup; it.increment(ec)) {
+            std::error_code type_ec;
+            if (it->is_directory(type_ec) && !it->is_symlink(type_ec)) {
+                if (!add_watch(it->path().string())) {
+                    return false;
+                }
+            } else if (added && it->is_regular_file(type_ec)) {
+                LibraryChange change;
+                change.path = it->path().string();
+                added->push_back(std::move(change));
+            }
+        }
+        return true;
+    }
+
+    // Walking a new tree and adding a watch per directory can take a while, so
+    // it happens on the setup thread, which is started when there is work and
+    // exits when the queue is empty
+    void queue_tree(const std::string& dir, bool report_files) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending_trees.push_back(PendingTree{dir, report_files});
+            if (setup_running) {
+                return;
+            }
+            setup_running = true;
+        }
+        // A previous setup thread has emptied the queue and is on its way out
+        if (setup_thread.joinable()) {
+            setup_thread.join();
+        }
+        setup_thread = std::thread([this]() { run_setup(); });
+    }
+
+    void run_setup() {
+        for (;;) {
+            PendingTree tree;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (pending_trees.empty() || cancel_setup || limit_reached) {
+                    setup_running = false;
+                    break;
+                }
+                tree = std::move(pending_trees.front());
+                pending_trees.pop_front();
+            }
+            std::vector<LibraryChange> added;
+            bool watched = add_tree(tree.dir, tree.report_files ? &added : nullptr);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                found_files.insert(found_files.end(), std::make_move_iterator(added.begin()),
+                                   std::make_move_iterator(added.end()));
+                if (!watched) {
+                    limit_reached = true;
+                }
+            }
+            uint64_t one = 1;
+            if (::write(setup_done_fd, &one, sizeof(one)) < 0) {
+                // Only fails if the counter overflows, which the loop drains long before
+            }
+        }
+    }
+
+    void rename_watches(const std::string& old_dir, const std::string& new_dir) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::pair<std::string, int>> moved;
+        // Siblings such as "old_dir x" sort among the subtree, so filter within the prefix range
+        for (auto it = wd_by_dir.lower_bound(old_dir);
+             it != wd_by_dir.end() && it->first.compare(0, old_dir.size(), old_dir) == 0; ++it) {
+            if (it->first == old_dir || is_under(it->first, old_dir)) {
+                moved.push_back(*it);
+            }
+        }
+        for (const auto& entry : moved) {
+            std::string renamed = new_dir + entry.first.substr(old_dir.size());
+            wd_by_dir.erase(entry.first);
+            wd_by_dir[renamed] = entry.second;
+            dir_by_wd[entry.second] = renamed;
+        }
+    }
+
+    // For a directory that left the tree; its watches would otherwise keep reporting
+    void remove_watches(const std::string& dir) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = wd_by_dir.lower_bound(dir);
+             it != wd_by_dir.end() && it->first.compare(0, dir.size(), dir) == 0;) {
+            if (it->first != dir && !is_under(it->first, dir)) {
+                ++it;
+                continue;
+            }
+            inotify_rm_watch(inotify_fd, it->second);
+            dir_by_wd.erase(it->second);
+            it = wd_by_dir.erase(it);
+        }
+    }
+
+    void read_events() {
+        alignas(inotify_event) char buffer[64 * 1024];
+        std::vector<LibraryChange> changes;
+        std::map<uint32_t, LibraryChange> moved_from;  // By cookie, until the matching MOVED_TO
+        bool overflow = false;
+
+        ssize_t bytes;
+        while ((bytes = ::read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t offset = 0; offset < bytes;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    overflow = true;
+                    continue;
+                }
+                std::string dir;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    auto it = dir_by_wd.find(event->wd);
+                    if (it == dir_by_wd.end()) {
+                        continue;
+                    }
+                    if (event->mask & IN_IGNORED) {
+                        wd_by_dir.erase(it->second);
+                        dir_by_wd.erase(it);
+                        continue;
+                    }
+                    dir = it->second;
+                }
+                if (event->len == 0) {
+                    continue;
+                }
+
+                LibraryChange change;
+                change.path = join_path(dir, event->name);
+                change.is_directory = (event->mask & IN_ISDIR) != 0;
+
+                if (event->mask & IN_MOVED_FROM) {
+                    change.kind = LibraryChange::Kind::REMOVED;
+                    moved_from[event->cookie] = std::move(change);
+                } else if (event->mask & IN_MOVED_TO) {
+                    auto from = moved_from.find(event->cookie);
+                    if (from != moved_from.end()) {
+                        change.kind = LibraryChange::Kind::RENAMED;
+                        change.old_path = std::move(from->second.path);
+                        moved_from.erase(from);
+                        if (change.is_directory) {
+                            rename_watches(change.old_path, change.path);
+                        }
+                        changes.push_back(std::move(change));
+                    } else if (change.is_directory) {
+                        queue_tree(change.path, true);
+                    } else {
+                        changes.push_back(std::move(change));
+                    }
+                } else if (event->mask & IN_CREATE) {
+                    // Files wait for IN_CLOSE_WRITE; a new directory may already have content
+                    if (change.is_directory) {
+                        queue_tree(change.path, true);
+                    }
+                } else if (event->mask & IN_CLOSE_WRITE) {
+                    changes.push_back(std::move(change));
+                } else if (event->mask & IN_DELETE) {
+                    change.kind = LibraryChange::Kind::REMOVED;
+                    changes.push_back(std::move(change));
+                }
+            }
+        }
+
+        // Moved out of the tree
+        for (auto& entry : moved_from) {
+            if (entry.second.is_directory) {
+                remove_watches(entry.second.path);
+            }
+            changes.push_back(std::move(entry.second));
+        }
+
+        if (!changes.empty() && on_changes) {
+            on_changes(changes);
+        }
+        if (overflow && on_rescan) {
+            on_rescan();
+        }
+    }
+
+    // Reports files the setup thread found in new directories
+    void finish_setup() {
+        uint64_t value;
+        if (::read(setup_done_fd, &value, sizeof(value)) < 0) {
+            return;
+        }
+        std::vector<LibraryChange> added;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            added.swap(found_files);
+        }
+        if (!added.empty() && on_changes) {
+            on_changes(added);
+        }
+        if (limit_reached) {
+            std::cerr << "Warning: inotify watch limit reached (see fs.inotify.max_user_watches); "
+                      << "library changes will be picked up by periodic rescans\n";
+            close_all();
+            if (on_rescan) {
+                on_rescan();
+            }
+        }
+    }
+
+    void close_all() {
+        cancel_setup = true;
+        if (setup_thread.joinable()) {
+            setup_thread.join();
+        }
+        if (setup_done_fd >= 0) {
+            loop.remove_fd(setup_done_fd);
+            ::close(setup_done_fd);
+            setup_done_fd = -1;
+        }
+        if (inotify_fd >= 0) {
+            loop.remove_fd(inotify_fd);
+            ::close(inotify_fd);
+            inotify_fd = -1;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        dir_by_wd.clear();
+        wd_by_dir.clear();
+        pending_trees.clear();
+        found_files.clear();
+        setup_running = false;
+    }
+};
+
+LibraryWatcher::LibraryWatcher(IEventLoop& loop) : m_impl(std::make_unique<Impl>(loop)) {}
+
+LibraryWatcher::~LibraryWatcher() {
+    stop();
+}
+
+bool LibraryWatcher::start(const std::string& root, ChangeHandler on_changes, RescanHandler on_rescan) {
+    stop();
+
+    m_impl->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    m_impl->setup_done_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_impl->inotify_fd < 0 || m_impl->setup_done_fd < 0 ||
+        !m_impl->loop.add_fd(m_impl->inotify_fd, [this]() { m_impl->read_events(); }) ||
+        !m_impl->loop.add_fd(m_impl->setup_done_fd, [this]() { m_impl->finish_setup(); })) {
+        std::cerr << "Warning: Cannot watch library for changes: " << std::strerror(errno) << "\n";
+        m_impl->close_all();
+        return false;
+    }
+
+    m_impl->on_changes = std::move(on_changes);
+    m_impl->on_rescan = std::move(on_rescan);
+    m_impl->cancel_setup = false;
+    m_impl->limit_reached = false;
+    m_impl->queue_tree(root, false);
+    return true;
+}
+
+void LibraryWatcher::stop() {
+    m_impl->close_all();
+}
+
+bool LibraryWatcher::is_running() const {
+    return m_impl->inotify_fd >= 0;
+}
+
+size_t LibraryWatcher::watch_count() const {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    return m_impl->dir_by_wd.size();
+}
+
+}
+
+#else
+
+namespace nigamp {
+
+// Other platforms fall back to periodic rescans
+struct LibraryWatcher::Impl {
+    explicit Impl(IEventLoop&) {}
+};
+
+LibraryWatcher::LibraryWatcher(IEventLoop& loop) : m_impl(std::make_unique<Impl>(loop)) {}
+
+LibraryWatcher::~LibraryWatcher() = default;
+
+bool LibraryWatcher::start(const std::string&, ChangeHandler, RescanHandler) {
+    return false;
+}
+
+void LibraryWatcher::stop() {}
+
+bool LibraryWatcher::is_running() const {
+    return false;
+}
+
+size_t LibraryWatcher::watch_count() const {
+    return 0;
+}
+
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "hotkey_handler.hpp"
+#include "event_loop.hpp"
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
 #include <thread>
@@ -23,6 +24,8 @@ struct LinuxHotkeyHandler::Impl {
     struct termios original_termios;
     bool terminal_configured = false;
     bool x11_available = false;
+    IEventLoop* loop = nullptr;       // Set when input is served from an event loop
+    bool stdin_attached = false;
     
     static constexpr int HOTKEY_NEXT = 1;
     static constexpr int HOTKEY_PREV = 2;
@@ -102,7 +105,6 @@ struct LinuxHotkeyHandler::Impl {
     }
     
     void message_loop() {
-        XEvent event;
         while (!should_stop) {
             // Check for X11 events with a timeout
             fd_set readfds;
@@ -117,21 +119,26 @@ struct LinuxHotkeyHandler::Impl {
             int result = select(x11_fd + 1, &readfds, nullptr, nullptr, &timeout);
             
             if (result > 0 && FD_ISSET(x11_fd, &readfds)) {
-                while (XPending(display) > 0) {
-                    XNextEvent(display, &event);
-                    
-                    if (event.type == KeyPress) {
-                        KeySym keysym = XLookupKeysym(&event.xkey, 0);
-                        unsigned int state = event.xkey.state;
-                        
-                        // Check for Ctrl+Alt combinations
-                        bool ctrl = (state & ControlMask) != 0;
-                        bool alt = (state & Mod1Mask) != 0;
-                        
-                        if (ctrl && alt) {
-                            handle_x11_hotkey(keysym);
-                        }
-                    }
+                process_x11_events();
+            }
+        }
+    }
+    
+    void process_x11_events() {
+        XEvent event;
+        while (XPending(display) > 0) {
+            XNextEvent(display, &event);
+            
+            if (event.type == KeyPress) {
+                KeySym keysym = XLookupKeysym(&event.xkey, 0);
+                unsigned int state = event.xkey.state;
+                
+                // Check for Ctrl+Alt combinations
+                bool ctrl = (state & ControlMask) != 0;
+                bool alt = (state & Mod1Mask) != 0;
+                
+                if (ctrl && alt) {
+                    handle_x11_hotkey(keysym);
                 }
             }
         }
@@ -161,6 +168,12 @@ struct LinuxHotkeyHandler::Impl {
             case XK_underscore:
                 callback(HotkeyAction::VOLUME_DOWN);
                 break;
+            case XK_Right:
+                callback(HotkeyAction::SEEK_FORWARD);
+                break;
+            case XK_Left:
+                callback(HotkeyAction::SEEK_BACKWARD);
+                break;
             case XK_Escape:
                 callback(HotkeyAction::QUIT);
                 break;
@@ -177,6 +190,20 @@ struct LinuxHotkeyHandler::Impl {
         }
     }
     
+    void process_console_input() {
+        char buffer[64];
+        ssize_t count = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (count == 0 && loop) {
+            // stdin closed: stop polling it or the loop would spin on EOF
+            loop->remove_fd(STDIN_FILENO);
+            stdin_attached = false;
+            return;
+        }
+        for (ssize_t i = 0; i < count; ++i) {
+            handle_input(buffer[i]);
+        }
+    }
+    
     void handle_input(char c) {
         if (!callback) return;
         
@@ -187,6 +214,8 @@ struct LinuxHotkeyHandler::Impl {
             case ' ': case 'r': case 'R': callback(HotkeyAction::PAUSE_RESUME); break;
             case '+': case '=': callback(HotkeyAction::VOLUME_UP); break;
             case '-': case '_': callback(HotkeyAction::VOLUME_DOWN); break;
+            case '.': case '>': callback(HotkeyAction::SEEK_FORWARD); break;
+            case ',': case '<': callback(HotkeyAction::SEEK_BACKWARD); break;
             case 'q': case 'Q': case 27: callback(HotkeyAction::QUIT); break;
         }
     }
@@ -224,6 +253,17 @@ bool LinuxHotkeyHandler::initialize() {
 void LinuxHotkeyHandler::shutdown() {
     unregister_hotkeys();
     
+    if (m_impl->loop) {
+        if (m_impl->display) {
+            m_impl->loop->remove_fd(ConnectionNumber(m_impl->display));
+        }
+        if (m_impl->stdin_attached) {
+            m_impl->loop->remove_fd(STDIN_FILENO);
+            m_impl->stdin_attached = false;
+        }
+        m_impl->loop = nullptr;
+    }
+    
     m_impl->should_stop = true;
     if (m_impl->message_thread.joinable()) {
         m_impl->message_thread.join();
@@ -234,9 +274,11 @@ void LinuxHotkeyHandler::shutdown() {
     
     if (m_impl->window) {
         XDestroyWindow(m_impl->display, m_impl->window);
+        m_impl->window = 0;
     }
     if (m_impl->display) {
         XCloseDisplay(m_impl->display);
+        m_impl->display = nullptr;
     }
     
     m_impl->restore_terminal();
@@ -254,6 +296,7 @@ bool LinuxHotkeyHandler::register_hotkeys() {
         std::cout << "  P/p - Previous track\n";
         std::cout << "  Space/R/r - Pause/Resume\n";
         std::cout << "  +/- - Volume up/down\n";
+        std::cout << "  ./, - Seek forward/back 10s\n";
         std::cout << "  Q/q/ESC - Quit\n";
         return true;
     }
@@ -265,6 +308,8 @@ bool LinuxHotkeyHandler::register_hotkeys() {
     KeyCode plus_key = XKeysymToKeycode(m_impl->display, XK_plus);
     KeyCode minus_key = XKeysymToKeycode(m_impl->display, XK_minus);
     KeyCode escape_key = XKeysymToKeycode(m_impl->display, XK_Escape);
+    KeyCode right_key = XKeysymToKeycode(m_impl->display, XK_Right);
+    KeyCode left_key = XKeysymToKeycode(m_impl->display, XK_Left);
     
     unsigned int mod_mask = ControlMask | Mod1Mask; // Ctrl+Alt
     
@@ -295,6 +340,14 @@ bool LinuxHotkeyHandler::register_hotkeys() {
         std::cerr << "Failed to register Ctrl+Alt+Escape\n";
         success = false;
     }
+    if (XGrabKey(m_impl->display, right_key, mod_mask, m_impl->window, False, GrabModeAsync, GrabModeAsync) != Success) {
+        std::cerr << "Failed to register Ctrl+Alt+Right\n";
+        success = false;
+    }
+    if (XGrabKey(m_impl->display, left_key, mod_mask, m_impl->window, False, GrabModeAsync, GrabModeAsync) != Success) {
+        std::cerr << "Failed to register Ctrl+Alt+Left\n";
+        success = false;
+    }
     
     XFlush(m_impl->display);
     
@@ -305,6 +358,7 @@ bool LinuxHotkeyHandler::register_hotkeys() {
         std::cout << "  Ctrl+Alt+R - Pause/Resume\n";
         std::cout << "  Ctrl+Alt+Plus - Volume up\n";
         std::cout << "  Ctrl+Alt+Minus - Volume down\n";
+        std::cout << "  Ctrl+Alt+Right/Left - Seek forward/back 10s\n";
         std::cout << "  Ctrl+Alt+Escape - Quit\n";
     } else {
         std::cerr << "Some hotkeys failed to register. They may be in use by another application.\n";
@@ -324,6 +378,8 @@ void LinuxHotkeyHandler::unregister_hotkeys() {
     KeyCode plus_key = XKeysymToKeycode(m_impl->display, XK_plus);
     KeyCode minus_key = XKeysymToKeycode(m_impl->display, XK_minus);
     KeyCode escape_key = XKeysymToKeycode(m_impl->display, XK_Escape);
+    KeyCode right_key = XKeysymToKeycode(m_impl->display, XK_Right);
+    KeyCode left_key = XKeysymToKeycode(m_impl->display, XK_Left);
     
     unsigned int mod_mask = ControlMask | Mod1Mask;
     
@@ -333,6 +389,8 @@ void LinuxHotkeyHandler::unregister_hotkeys() {
     XUngrabKey(m_impl->display, plus_key, mod_mask, m_impl->window);
     XUngrabKey(m_impl->display, minus_key, mod_mask, m_impl->window);
     XUngrabKey(m_impl->display, escape_key, mod_mask, m_impl->window);
+    XUngrabKey(m_impl->display, right_key, mod_mask, m_impl->window);
+    XUngrabKey(m_impl->display, left_key, mod_mask, m_impl->window);
     
     XFlush(m_impl->display);
 }
@@ -350,6 +408,24 @@ void LinuxHotkeyHandler::process_messages() {
     }
 }
 
+bool LinuxHotkeyHandler::attach(IEventLoop& loop) {
+    Impl* impl = m_impl.get();
+    impl->loop = &loop;
+    
+    if (impl->x11_available && impl->display) {
+        if (!loop.add_fd(ConnectionNumber(impl->display), [impl]() { impl->process_x11_events(); })) {
+            impl->loop = nullptr;
+            return false;
+        }
+        // Events Xlib already read off the socket won't make the fd readable again
+        impl->process_x11_events();
+    }
+    
+    // Fails for stdin redirected from a regular file, which has nothing to wait for
+    impl->stdin_attached = loop.add_fd(STDIN_FILENO, [impl]() { impl->process_console_input(); });
+    return true;
+}
+
 std::unique_ptr<IHotkeyHandler> create_hotkey_handler() {
     return std::make_unique<LinuxHotkeyHandler>();
 }
@@ -0,0 +1,372 @@
+#include "loudness.hpp"
+#include "binary_file.hpp"
+#include "library_index.hpp"
+#include "mp3_decoder.hpp"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace nigamp {
+
+bool compute_loudness_envelope(const std::string& path, LoudnessEnvelope& envelope,
+                               const std::atomic<bool>* cancel) {
+    envelope.rms.clear();
+    auto decoder = create_decoder(path);
+    if (!decoder || !decoder->open(path)) {
+        return false;
+    }
+
+    AudioFormat format = decoder->get_format();
+    if (format.channels <= 0 || format.sample_rate <= 0) {
+        return false;
+    }
+    const size_t block_frames = static_cast<size_t>(LoudnessEnvelope::BLOCK_SECONDS * format.sample_rate);
+
+    double sum_squares = 0.0;
+    size_t block_filled = 0;
+    AudioBuffer buffer;
+    while (decoder->decode(buffer, 16384)) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            envelope.rms.clear();
+            return false;
+        }
+        size_t frames = buffer.size() / format.channels;
+        for (size_t frame = 0; frame < frames; ++frame) {
+            int32_t mixed = 0;
+            for (int ch = 0; ch < format.channels; ++ch) {
+                mixed += buffer[frame * format.channels + ch];
+            }
+            double sample = static_cast<double>(mixed) / (format.channels * 32768.0);
+            sum_squares += sample * sample;
+
+            if (++block_filled == block_frames) {
+                envelope.rms.push_back(static_cast<float>(std::sqrt(sum_squares / block_frames)));
+                sum_squares = 0.0;
+                block_filled = 0;
+            }
+        }
+    }
+    // A trailing partial block is too short to be a useful start point
+    return true;
+}
+
+double find_loudest_window(const LoudnessEnvelope& envelope, double window_seconds) {
+    size_t window = static_cast<size_t>(std::ceil(window_seconds / LoudnessEnvelope::BLOCK_SECONDS));
+    if (window == 0 || envelope.rms.size() <= window) {
+        return 0.0;
+    }
+
+    // Sliding sum of block energies
+    double energy = 0.0;
+    for (size_t i = 0; i < window; ++i) {
+        energy += envelope.rms[i] * envelope.rms[i];
+    }
+    double best_energy = energy;
+    size_t best_start = 0;
+    for (size_t start = 1; start + window <= envelope.rms.size(); ++start) {
+        double leaving = envelope.rms[start - 1];
+        double entering = envelope.rms[start + window - 1];
+        energy += entering * entering - leaving * leaving;
+        if (energy > best_energy) {
+            best_energy = energy;
+            best_start = start;
+        }
+    }
+    return best_start * LoudnessEnvelope::BLOCK_SECONDS;
+}
+
+struct StoredEnvelope {
+    FileStamp stamp;
+    std::string blocks;  // rms * 255, rounded
+};
+
+namespace {
+
+constexpr char STORE_MAGIC[4] = {'N', 'G', 'L', 'E'};
+constexpr uint32_t STORE_VERSION = 1;
+constexpr size_t STORE_HEADER_SIZE = 4 + 4;
+
+// path length, size, mtime, block count; then the path and one byte per block
+constexpr size_t STORE_RECORD_SIZE = 4 + 8 + 8 + 4;
+
+// Superseded records tolerated in the file before it is compacted on load
+constexpr size_t STORE_SLACK_RECORDS = 256;
+
+void put_record(std::string& out, const std::string& path, const StoredEnvelope& stored) {
+    put_u32(out, static_cast<uint32_t>(path.size()));
+    put_u64(out, stored.stamp.size);
+    put_u64(out, static_cast<uint64_t>(stored.stamp.mtime_ns));
+    put_u32(out, static_cast<uint32_t>(stored.blocks.size()));
+    out += path;
+    out += stored.blocks;
+}
+
+}
+
+// Append-only file of analyses; the last record for a path wins
+class EnvelopeStore {
+private:
+    std::string m_path;
+    std::mutex m_mutex;
+    std::unordered_map<std::string, StoredEnvelope> m_entries;
+
+    // Caller holds the mutex
+    void load() {
+        std::ifstream file(m_path, std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        auto bytes = reinterpret_cast<const unsigned char*>(data.data());
+
+        size_t records = 0;
+        size_t offset = STORE_HEADER_SIZE;
+        bool valid = data.size() >= STORE_HEADER_SIZE && data.compare(0, 4, STORE_MAGIC, 4) == 0 &&
+                     get_u32(bytes + 4) == STORE_VERSION;
+        while (valid && data.size() - offset >= STORE_RECORD_SIZE) {
+            const unsigned char* record = bytes + offset;
+            size_t path_size = get_u32(record);
+            size_t block_count = get_u32(record + 20);
+            if (data.size() - offset - STORE_RECORD_SIZE < path_size + block_count) {
+                break;  // Torn by a crash mid-append
+            }
+            StoredEnvelope stored;
+            stored.stamp.size = get_u64(record + 4);
+            stored.stamp.mtime_ns = static_cast<int64_t>(get_u64(record + 12));
+            offset += STORE_RECORD_SIZE;
+            std::string path = data.substr(offset, path_size);
+            stored.blocks = data.substr(offset + path_size, block_count);
+            offset += path_size + block_count;
+            m_entries[std::move(path)] = std::move(stored);
+            ++records;
+        }
+
+        // Start over on anything unreadable, and drop torn tails and superseded
+        // records so appends always follow a clean record
+        if (valid && offset == data.size() && records <= m_entries.size() + STORE_SLACK_RECORDS) {
+            return;
+        }
+        if (!valid) {
+            m_entries.clear();
+        }
+        std::string contents(STORE_MAGIC, sizeof(STORE_MAGIC));
+        put_u32(contents, STORE_VERSION);
+        for (const auto& [path, stored] : m_entries) {
+            put_record(contents, path, stored);
+        }
+        if (!write_file_atomically(m_path, {contents})) {
+            m_path.clear();
+        }
+    }
+
+public:
+    explicit EnvelopeStore(std::string path) : m_path(std::move(path)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        load();
+    }
+
+    bool find(const std::string& path, const FileStamp& stamp, LoudnessEnvelope& envelope) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(path);
+        if (it == m_entries.end() || it->second.stamp != stamp) {
+            return false;
+        }
+        envelope.rms.clear();
+        envelope.rms.reserve(it->second.blocks.size());
+        for (unsigned char block : it->second.blocks) {
+            envelope.rms.push_back(block / 255.0f);
+        }
+        return true;
+    }
+
+    void add(const std::string& path, const FileStamp& stamp, const LoudnessEnvelope& envelope) {
+        StoredEnvelope stored;
+        stored.stamp = stamp;
+        stored.blocks.reserve(envelope.rms.size());
+        for (float rms : envelope.rms) {
+            stored.blocks.push_back(static_cast<char>(std::lround(std::clamp(rms, 0.0f, 1.0f) * 255.0f)));
+        }
+        std::string record;
+        put_record(record, path, stored);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_path.empty()) {
+            return;
+        }
+        std::ofstream file(m_path, std::ios::binary | std::ios::app);
+        file.write(record.data(), static_cast<std::streamsize>(record.size()));
+        if (file.flush()) {
+            m_entries[path] = std::move(stored);
+        }
+    }
+};
+
+struct LoudnessAnalyzer::Impl {
+    struct Entry {
+        LoudnessEnvelope envelope;  // Empty: analysis failed
+        std::list<std::string>::iterator recency;
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable work_cv;
+    std::deque<std::string> queue;
+    std::unordered_map<std::string, std::vector<Callback>> waiting;
+    std::unordered_map<std::string, Entry> cache;
+    std::list<std::string> recency;  // Cached paths, most recently used first
+    size_t cache_limit;
+    std::unordered_set<std::string> in_progress;
+    std::vector<std::thread> workers;
+    std::unique_ptr<EnvelopeStore> envelope_store;  // Null without a store path
+    bool stopping = false;
+    std::atomic<bool> cancelled{false};
+
+    explicit Impl(size_t limit) : cache_limit(std::max<size_t>(1, limit)) {}
+
+    // Caller holds the mutex
+    void touch(Entry& entry) {
+        recency.splice(recency.begin(), recency, entry.recency);
+    }
+
+    // Caller holds the mutex
+    void store(const std::string& path, LoudnessEnvelope envelope) {
+        auto it = cache.find(path);
+        if (it != cache.end()) {
+            it->second.envelope = std::move(envelope);
+            touch(it->second);
+            return;
+        }
+        if (cache.size() >= cache_limit) {
+            cache.erase(recency.back());
+            recency.pop_back();
+        }
+        recency.push_front(path);
+        cache.emplace(path, Entry{std::move(envelope), recency.begin()});
+    }
+
+    // Reads the envelope from the store or decodes the file; false once cancelled
+    bool evaluate(const std::string& path, LoudnessEnvelope& envelope) {
+        // Stamped before decoding, so an edit made meanwhile is not
+        // recorded as analyzed
+        FileStamp stamp;
+        bool stamped = envelope_store && read_file_stamp(path, stamp);
+        if (!stamped || !envelope_store->find(path, stamp, envelope)) {
+            compute_loudness_envelope(path, envelope, &cancelled);
+            if (cancelled) {
+                return false;
+            }
+            if (stamped) {
+                envelope_store->add(path, stamp, envelope);
+            }
+        }
+        return true;
+    }
+
+    void worker_loop() {
+        for (;;) {
+            std::string path;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_cv.wait(lock, [this]() { return stopping || !queue.empty(); });
+                if (stopping) {
+                    return;
+                }
+                path = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            LoudnessEnvelope envelope;
+            if (!evaluate(path, envelope)) {
+                return;
+            }
+
+            std::vector<Callback> callbacks;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                store(path, std::move(envelope));
+                in_progress.erase(path);
+                auto it = waiting.find(path);
+                if (it != waiting.end()) {
+                    callbacks = std::move(it->second);
+                    waiting.erase(it);
+                }
+            }
+            for (auto& callback : callbacks) {
+                callback();
+            }
+        }
+    }
+};
+
+LoudnessAnalyzer::LoudnessAnalyzer(unsigned threads, size_t cache_limit, const std::string& store_path)
+    : m_impl(std::make_unique<Impl>(cache_limit)) {
+    if (!store_path.empty()) {
+        m_impl->envelope_store = std::make_unique<EnvelopeStore>(store_path);
+    }
+    for (unsigned i = 0; i < std::max(1u, threads); ++i) {
+        m_impl->workers.emplace_back([this]() { m_impl->worker_loop(); });
+    }
+}
+
+LoudnessAnalyzer::~LoudnessAnalyzer() {
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        m_impl->stopping = true;
+        m_impl->cancelled = true;
+    }
+    m_impl->work_cv.notify_all();
+    for (auto& worker : m_impl->workers) {
+        worker.join();
+    }
+}
+
+void LoudnessAnalyzer::request(const std::string& path, Callback done) {
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        auto it = m_impl->cache.find(path);
+        if (it == m_impl->cache.end()) {
+            if (done) {
+                m_impl->waiting[path].push_back(std::move(done));
+            }
+            if (m_impl->in_progress.insert(path).second) {
+                m_impl->queue.push_back(path);
+                m_impl->work_cv.notify_one();
+            }
+            return;
+        }
+        m_impl->touch(it->second);
+    }
+    // Already cached: answer right away, outside the lock
+    if (done) {
+        done();
+    }
+}
+
+bool LoudnessAnalyzer::lookup(const std::string& path, LoudnessEnvelope& envelope) const {
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    auto it = m_impl->cache.find(path);
+    if (it == m_impl->cache.end()) {
+        return false;
+    }
+    m_impl->touch(it->second);
+    envelope = it->second.envelope;
+    return true;
+}
+
+bool LoudnessAnalyzer::analyze(const std::string& path, LoudnessEnvelope& envelope) {
+    if (lookup(path, envelope)) {
+        return !envelope.rms.empty();
+    }
+    if (!m_impl->evaluate(path, envelope)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->store(path, envelope);
+    return !envelope.rms.empty();
+}
+
+}
@@ -3,13 +3,29 @@
 #include "playlist.hpp"
 #include "hotkey_handler.hpp"
 #include "file_scanner.hpp"
+#include "event_loop.hpp"
+#include "player_command.hpp"
+#include "session_state.hpp"
+#include "control_server.hpp"
+#include "render.hpp"
+#include "loudness.hpp"
+#include "status_display.hpp"
+#include "trace.hpp"
+#include "library_watcher.hpp"
+#include "library_index.hpp"
+#include "tag_reader.hpp"
+#include "playlist_file.hpp"
 #include <iostream>
 #include <thread>
 #include <atomic>
 #include <chrono>
 #include <algorithm>
 #include <filesystem>
-#include <mutex>
+#include <csignal>
+#include <unordered_set>
+#include <numeric>
+#include <random>
+#include <cstdlib>
 
 #ifdef _WIN32
     #include <windows.h>
@@ -53,77 +69,268 @@ std::string get_default_music_directory() {
 #endif
 }
 
+std::string get_session_path() {
+#ifdef _WIN32
+    char path[MAX_PATH];
+    if (SUCCEEDED(SHGetFolderPathA(nullptr, CSIDL_APPDATA, nullptr, SHGFP_TYPE_CURRENT, path))) {
+        return std::string(path) + "\\nigamp\\session.bin";
+    }
+    return "nigamp_session.bin";
+#else
+    const char* state_home = getenv("XDG_STATE_HOME");
+    if (state_home && *state_home) {
+        return std::string(state_home) + "/nigamp/session.bin";
+    }
+    const char* home = getenv("HOME");
+    if (home) {
+        return std::string(home) + "/.local/state/nigamp/session.bin";
+    }
+    return ".nigamp_session.bin";
+#endif
+}
+
+std::string get_library_index_path() {
+#ifdef _WIN32
+    char path[MAX_PATH];
+    if (SUCCEEDED(SHGetFolderPathA(nullptr, CSIDL_LOCAL_APPDATA, nullptr, SHGFP_TYPE_CURRENT, path))) {
+        return std::string(path) + "\\nigamp\\library.idx";
+    }
+    return "nigamp_library.idx";
+#else
+    const char* cache_home = getenv("XDG_CACHE_HOME");
+    if (cache_home && *cache_home) {
+        return std::string(cache_home) + "/nigamp/library.idx";
+    }
+    const char* home = getenv("HOME");
+    if (home) {
+        return std::string(home) + "/.cache/nigamp/library.idx";
+    }
+    return ".nigamp_library.idx";
+#endif
+}
+
+// Preview envelopes live beside the library index, in the cache directory
+std::string get_loudness_store_path() {
+    std::filesystem::path store_path = std::filesystem::path(get_library_index_path()).parent_path();
+    std::error_code ec;
+    if (!store_path.empty()) {
+        std::filesystem::create_directories(store_path, ec);
+    }
+    return (store_path / "loudness.bin").string();
+}
+
+// Only where a private per-user runtime directory exists
+std::string get_default_control_path() {
+#ifdef _WIN32
+    return "";
+#else
+    const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir && *runtime_dir) {
+        return std::string(runtime_dir) + "/nigamp.sock";
+    }
+    return "";
+#endif
+}
+
 class MusicPlayer {
 private:
+    // Declared first so it outlives everything that registers with it
+    std::unique_ptr<IEventLoop> m_loop;
     std::unique_ptr<IAudioEngine> m_audio_engine;
+    std::unique_ptr<ControlServer> m_control;
+    std::unique_ptr<LibraryWatcher> m_watcher;
+    std::string m_control_path;
+    StatusRenderer m_status;
     
-    // Helper function to format time as MM:SS
-    std::string format_time(double seconds) {
-        int minutes = static_cast<int>(seconds) / 60;
-        int secs = static_cast<int>(seconds) % 60;
-        char buffer[6];
-        snprintf(buffer, sizeof(buffer), "%02d:%02d", minutes, secs);
-        return std::string(buffer);
-    }
     std::unique_ptr<IPlaylist> m_playlist;
     std::unique_ptr<IHotkeyHandler> m_hotkey_handler;
     std::unique_ptr<IFileScanner> m_file_scanner;
     std::unique_ptr<IAudioDecoder> m_current_decoder;
+    std::unique_ptr<LoudnessAnalyzer> m_loudness;  // Preview mode only
+    CommandQueue m_commands;
     
     std::atomic<bool> m_should_quit{false};
     std::atomic<bool> m_is_paused{false};
-    std::atomic<bool> m_advance_to_next{false};
     std::atomic<bool> m_stop_playback{false};
     std::thread m_playback_thread;
-    std::thread m_reindex_thread;
-    std::thread m_timeout_thread;
-    std::mutex m_playlist_mutex;
+    std::thread m_reindex_thread;  // Also runs the initial streaming scan
+    bool m_reindex_running = false;
+    IEventLoop::TimerId m_startup_timer = IEventLoop::INVALID_TIMER;
+    
+    // Bumped on every stop so completions posted for an old track are ignored
+    std::atomic<unsigned> m_track_generation{0};
     
-    const Song* m_current_song = nullptr;
+    // Stops resolving once the song is removed, even if a new song reuses its id
+    SongHandle m_current_song;
     float m_volume = DEFAULT_VOLUME;
     bool m_preview_mode = false;
     
-    // Safety timeout mechanism
-    std::atomic<bool> m_timeout_active{false};
-    std::chrono::steady_clock::time_point m_eof_signaled_time;
-    static constexpr int COMPLETION_TIMEOUT_SECONDS = 3;
-    
-    // Duration-based completion tracking
-    std::chrono::steady_clock::time_point m_playback_start_time;
+    // Position comes from the engine's played frames, offset by where the track was started
+    uint64_t m_start_frame = 0;
+    int m_track_sample_rate = 0;
     double m_current_song_duration = 0.0;
-    bool m_use_duration_based_completion = true;
+    unsigned m_xrun_count = 0;  // Underruns since startup, only touched on the loop
     
     // Constants
     static constexpr double DEFAULT_VOLUME = 0.8;
     static constexpr int COUNTDOWN_UPDATE_INTERVAL_MS = 500;
     static constexpr int PREVIEW_DURATION_SECONDS = 10;
+    static constexpr size_t PREVIEW_PREFETCH_TRACKS = 3;
+    static constexpr unsigned PREVIEW_ANALYSIS_THREADS = 4;
     
     // Reindexing properties
     std::string m_current_directory = ".";
-    std::chrono::steady_clock::time_point m_last_index_time;
     static constexpr int REINDEX_INTERVAL_MINUTES = 10;
+    // Only runs when the library cannot be watched for changes
+    IEventLoop::TimerId m_reindex_timer = IEventLoop::INVALID_TIMER;
+    
+    // Streaming scan: songs reach the loop in batches, and playback starts on a
+    // random pick of the first hits rather than after the whole tree is walked
+    static constexpr size_t SCAN_BATCH_SIZE = 64;
+    static constexpr int SCAN_FLUSH_INTERVAL_MS = 50;
+    static constexpr size_t STARTUP_CHOICE_SIZE = 32;
+    static constexpr int STARTUP_GRACE_MS = 200;
+    
+    // Session snapshot, written periodically and on shutdown in folder mode
+    std::string m_session_path;
+    bool m_resume_session = true;
+    bool m_session_enabled = false;
+    static constexpr int SESSION_SAVE_INTERVAL_SECONDS = 5;
+    // Playlist revision the file on disk was written for. While it holds, a
+    // periodic save only overwrites the position fields in place.
+    bool m_session_saved = false;
+    uint64_t m_saved_revision = 0;
+    std::thread m_session_thread;  // Writes periodic snapshots off the loop
+    std::atomic<bool> m_session_writing{false};
+    std::atomic<bool> m_session_stale{false};  // An in-place update found no matching file
+    
+    // Library index from the last completed scan, mapped while the startup scan
+    // validates it. Its songs reach the playlist in batches through the loop.
+    LibraryIndex m_library_index;
+    std::string m_index_path;
+    bool m_index_feeding = false;
+    size_t m_index_feed_next = 0;
+    size_t m_index_feed_start = 0;
+    size_t m_index_feed_stride = 1;
+    std::function<void()> m_after_index_feed;
+    static constexpr size_t INDEX_FEED_BATCH = 4096;
+    // Tags are read from the head and tail of each new or changed file
+    static constexpr unsigned TAG_READ_THREADS = 8;
+    static constexpr size_t TAG_READS_IN_FLIGHT = 64;
+    
+    // Chrome trace JSON, written on SIGUSR1 and at exit when set
+    std::string m_trace_path;
 
 public:
-    MusicPlayer(bool preview_mode = false) : m_preview_mode(preview_mode) {
+    MusicPlayer(bool preview_mode = false, ResamplerQuality resampler_quality = ResamplerQuality::MEDIUM,
+                const std::string& capture_path = "", bool resume_session = true,
+                const std::string& control_path = "", const std::string& trace_path = "",
+                const std::string& shuffle_mode = "uniform", int device_rate = 0)
+        : m_control_path(control_path)
+        , m_preview_mode(preview_mode)
+        , m_session_path(get_session_path())
+        , m_resume_session(resume_session)
+        , m_index_path(get_library_index_path())
+        , m_trace_path(trace_path) {
+        TRACE_THREAD_NAME("event loop");
+        trace_enable(!m_trace_path.empty());
+        m_loop = create_event_loop();
+#ifndef _WIN32
+        // Must precede every thread we start so they all inherit the blocked mask
+        m_loop->watch_signal(SIGINT, [this]() { quit(); });
+        m_loop->watch_signal(SIGTERM, [this]() { quit(); });
+        if (!m_trace_path.empty()) {
+            m_loop->watch_signal(SIGUSR1, [this]() { dump_trace(); });
+        }
+#endif
         m_audio_engine = create_audio_engine();
+        m_audio_engine->set_resampler_quality(resampler_quality);
+        m_audio_engine->set_device_rate(device_rate);
+        if (!capture_path.empty() && !m_audio_engine->set_capture_path(capture_path)) {
+            std::cerr << "Warning: Output capture is not supported by this audio backend\n";
+        }
         m_playlist = create_playlist();
+        m_playlist->set_shuffle_strategy(create_shuffle_strategy(shuffle_mode));
         m_hotkey_handler = create_hotkey_handler();
         m_file_scanner = create_file_scanner();
-        m_last_index_time = std::chrono::steady_clock::now();
+        m_control = std::make_unique<ControlServer>(*m_loop);
+        m_watcher = std::make_unique<LibraryWatcher>(*m_loop);
+        if (m_preview_mode) {
+            unsigned threads = std::min(PREVIEW_ANALYSIS_THREADS, std::max(1u, std::thread::hardware_concurrency()));
+            m_loudness = std::make_unique<LoudnessAnalyzer>(threads, LoudnessAnalyzer::DEFAULT_CACHE_LIMIT,
+                                                            get_loudness_store_path());
+        }
     }
     
     ~MusicPlayer() {
         shutdown();
     }
     
+    // Renders the shuffled playlist to a WAV file instead of playing it; returns the exit code
+    static int render(const std::string& path, bool is_file, bool preview_mode,
+                      ResamplerQuality resampler_quality, const std::string& output_path,
+                      const std::string& shuffle_mode) {
+        auto scanner = create_file_scanner();
+        auto playlist = create_playlist();
+        playlist->set_shuffle_strategy(create_shuffle_strategy(shuffle_mode));
+        std::string source = path.empty() ? get_default_music_directory() : path;
+        
+        if (is_file) {
+            if (!scanner->is_supported_format(source) || !std::filesystem::is_regular_file(source)) {
+                std::cerr << "File not found or not supported: " << source << "\n";
+                return 1;
+            }
+            playlist->add_song(scanner->create_song_from_file(source));
+        } else {
+            for (const auto& song : scanner->scan_directory(source)) {
+                playlist->add_song(song);
+            }
+        }
+        if (playlist->empty()) {
+            std::cerr << "No supported audio files found in: " << source << "\n";
+            return 1;
+        }
+        playlist->shuffle();
+        
+        std::vector<std::string> paths;
+        for (size_t index : playlist->shuffle_order()) {
+            paths.push_back(playlist->library().path(playlist->songs()[index]));
+        }
+        
+        RenderOptions options;
+        options.volume = static_cast<float>(DEFAULT_VOLUME);
+        options.preview_seconds = preview_mode ? PREVIEW_DURATION_SECONDS : 0.0;
+        options.smart_preview = preview_mode;
+        // Render workers analyze on their own threads, so the analyzer's pool stays minimal
+        std::unique_ptr<LoudnessAnalyzer> loudness;
+        if (preview_mode) {
+            loudness = std::make_unique<LoudnessAnalyzer>(1, LoudnessAnalyzer::DEFAULT_CACHE_LIMIT,
+                                                          get_loudness_store_path());
+            options.loudness = loudness.get();
+        }
+        options.resampler_quality = resampler_quality;
+        
+        std::cout << "Rendering " << paths.size() << " tracks to " << output_path << "...\n";
+        RenderStats stats;
+        bool ok = render_playlist(paths, output_path, options, stats);
+        
+        char summary[160];
+        snprintf(summary, sizeof(summary), "Rendered %zu tracks (%zu skipped), %.1f s of audio in %.2f s: %.1fx real time\n",
+                 stats.tracks_rendered, stats.tracks_failed, stats.audio_seconds, stats.wall_seconds,
+                 stats.realtime_factor());
+        std::cout << summary;
+        return ok && stats.tracks_rendered > 0 ? 0 : 1;
+    }
+    
     bool initialize() {
         if (!m_hotkey_handler->initialize()) {
             std::cerr << "Failed to initialize hotkey handler\n";
             return false;
         }
         
+        // Hotkeys may arrive on a backend thread; all player state lives on the loop
         m_hotkey_handler->set_callback([this](HotkeyAction action) {
-            handle_hotkey(action);
+            submit_command(command_from_hotkey(action));
         });
         
         if (!m_hotkey_handler->register_hotkeys()) {
@@ -133,31 +340,401 @@ public:
             std::cout << "Global hotkeys registered successfully!\n";
         }
         
-        // Start the message loop immediately after hotkey registration
-        m_hotkey_handler->process_messages();
+        // Backends without a pollable fd keep their own message thread
+        if (!m_hotkey_handler->attach(*m_loop)) {
+            m_hotkey_handler->process_messages();
+        }
+        
+        // Control clients are served on the loop; their commands join the hotkey queue
+        if (!m_control_path.empty()) {
+            bool started = m_control->start(m_control_path,
+                [this](const PlayerCommand& command) { submit_command(command); },
+                [this]() { return current_status(); });
+            if (started) {
+                std::cout << "Control socket: " << m_control_path << "\n";
+            } else {
+                std::cout << "Warning: Control socket unavailable, continuing without it\n";
+            }
+        }
         
         return true;
     }
     
-    bool load_directory(const std::string& directory) {
-        SongList songs = m_file_scanner->scan_directory(directory);
+    // Walks the directory on a worker thread, feeding songs to the loop as they are found.
+    // Songs in `known`, and indexed songs when `index_fed`, are already in the playlist
+    // and are not reported again. Once the walk completes, those that have vanished or
+    // whose stamp changed are reported as changes and the index is rewritten.
+    void start_streaming_scan(const std::string& directory, std::unordered_set<std::string> known = {},
+                              bool index_fed = false) {
+        m_reindex_running = true;
+        const LibraryIndex* index = m_library_index.is_open() ? &m_library_index : nullptr;
+        m_reindex_thread = std::thread([this, directory, known = std::move(known), index, index_fed]() mutable {
+            TRACE_THREAD_NAME("scan");
+            SongList batch;
+            bool flushed_any = false;
+            auto last_flush = std::chrono::steady_clock::now();
+            auto flush = [&]() {
+                m_loop->post([this, songs = std::move(batch)]() {
+                    add_scanned_songs(songs);
+                });
+                batch.clear();
+                flushed_any = true;
+                last_flush = std::chrono::steady_clock::now();
+            };
+            
+            // Every file the walk turned up, with its index slot if it has one
+            std::vector<std::pair<Song, size_t>> library;
+            size_t found = 0;
+            try {
+                found = m_file_scanner->scan_directory_streaming(directory, [&](const Song& song) {
+                    size_t slot = index ? index->find(song.file_path) : LibraryIndex::NOT_FOUND;
+                    library.emplace_back(song, slot);
+                    if (known.erase(song.file_path) > 0 || (index_fed && slot != LibraryIndex::NOT_FOUND)) {
+                        return !m_should_quit.load();
+                    }
+                    batch.push_back(song);
+                    // The first hit goes out alone so the loop can arm the startup timer
+                    if (!flushed_any || batch.size() >= SCAN_BATCH_SIZE ||
+                        std::chrono::steady_clock::now() - last_flush >= std::chrono::milliseconds(SCAN_FLUSH_INTERVAL_MS)) {
+                        flush();
+                    }
+                    return !m_should_quit.load();
+                });
+            } catch (const std::exception& e) {
+                std::cerr << "Exception while scanning: " << e.what() << std::endl;
+            }
+            if (!batch.empty()) {
+                flush();
+            }
+            
+            // An unreadable root looks like an empty library; keep the old index then
+            std::vector<LibraryChange> changes;
+            SongList tagged;
+            if (!m_should_quit && found > 0) {
+                changes = validate_library(directory, library, known, index, index_fed, tagged);
+            }
+            m_loop->post([this, found, directory, changes = std::move(changes), tagged = std::move(tagged)]() {
+                finish_streaming_scan(found, directory, changes, tagged);
+            });
+        });
+    }
+    
+    // Runs on the scan thread. Unchanged files keep their indexed metadata; new
+    // and changed ones are stamped and have their tags read into `tagged`, and
+    // the result replaces the saved index.
+    std::vector<LibraryChange> validate_library(const std::string& directory,
+                                                std::vector<std::pair<Song, size_t>>& library,
+                                                const std::unordered_set<std::string>& missing,
+                                                const LibraryIndex* index, bool index_fed, SongList& tagged) {
+        TRACE_SCOPE("validate library");
+        std::vector<LibraryChange> changes;
+        std::vector<IndexedSong> entries(library.size());
+        std::vector<size_t> stale;
+        std::vector<bool> seen(index ? index->size() : 0, false);
+        
+        for (size_t i = 0; i < library.size(); ++i) {
+            if (m_should_quit) {
+                return {};
+            }
+            auto& [song, slot] = library[i];
+            IndexedSong& entry = entries[i];
+            bool stamped = read_file_stamp(song.file_path, entry.stamp);
+            FileStamp stamp = entry.stamp;
+            if (slot != LibraryIndex::NOT_FOUND && index->get(slot, entry)) {
+                seen[slot] = true;
+                if (stamped && entry.stamp == stamp) {
+                    continue;
+                }
+                entry.stamp = stamp;
+            }
+            entry.song = std::move(song);
+            stale.push_back(i);
+        }
+        
+        {
+            TagReader reader(TAG_READ_THREADS, TAG_READS_IN_FLIGHT);
+            for (size_t i : stale) {
+                if (m_should_quit) {
+                    return {};
+                }
+                reader.request(entries[i].song, [&entries, i](Song song) {
+                    entries[i].song = std::move(song);
+                });
+            }
+            reader.wait();
+        }
+        tagged.reserve(stale.size());
+        for (size_t i : stale) {
+            tagged.push_back(entries[i].song);
+        }
+        
+        for (const auto& path : missing) {
+            LibraryChange change;
+            change.kind = LibraryChange::Kind::REMOVED;
+            change.path = path;
+            changes.push_back(std::move(change));
+        }
+        if (index_fed) {
+            IndexedSong indexed;
+            for (size_t slot = 0; slot < seen.size(); ++slot) {
+                if (!seen[slot] && index->get(slot, indexed)) {
+                    LibraryChange change;
+                    change.kind = LibraryChange::Kind::REMOVED;
+                    change.path = std::move(indexed.song.file_path);
+                    changes.push_back(std::move(change));
+                }
+            }
+        }
+        
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(m_index_path).parent_path(), ec);
+        if (!save_library_index(m_index_path, directory, std::move(entries))) {
+            std::cerr << "Warning: Could not save library index to " << m_index_path << "\n";
+        }
+        return changes;
+    }
+    
+    void add_scanned_songs(const SongList& songs) {
+        for (const auto& song : songs) {
+            // The library watcher may have got there first
+            if (!m_playlist->contains(song.file_path)) {
+                m_playlist->add_song(song);
+            }
+        }
+        
+        // Once playing, new songs only join the upcoming part of the order
+        if (m_current_song.id != INVALID_SONG_ID) {
+            return;
+        }
+        if (m_playlist->size() >= STARTUP_CHOICE_SIZE) {
+            start_first_song();
+        } else if (m_startup_timer == IEventLoop::INVALID_TIMER) {
+            m_startup_timer = m_loop->add_timer(std::chrono::milliseconds(STARTUP_GRACE_MS), [this]() {
+                m_startup_timer = IEventLoop::INVALID_TIMER;
+                start_first_song();
+            }, false);
+        }
+    }
+    
+    void start_first_song() {
+        if (m_startup_timer != IEventLoop::INVALID_TIMER) {
+            m_loop->cancel_timer(m_startup_timer);
+            m_startup_timer = IEventLoop::INVALID_TIMER;
+        }
+        if (m_current_song.id != INVALID_SONG_ID || m_playlist->empty()) {
+            return;
+        }
         
-        if (songs.empty()) {
+        // Later songs are shuffled into the upcoming part of this order as they arrive
+        m_playlist->shuffle();
+        if (m_playlist->has_queued()) {
+            m_playlist->next();
+        }
+        play_current_song();
+    }
+    
+    void finish_streaming_scan(size_t found, const std::string& directory, const std::vector<LibraryChange>& changes,
+                               const SongList& tagged) {
+        // Changes may name indexed songs the playlist has not been handed yet
+        if (m_index_feeding) {
+            m_after_index_feed = [this, found, directory, changes, tagged]() {
+                finish_streaming_scan(found, directory, changes, tagged);
+            };
+            return;
+        }
+        m_reindex_running = false;
+        m_library_index.close();
+        if (!changes.empty()) {
+            apply_library_changes(changes);
+        }
+        if (!tagged.empty()) {
+            update_tagged_songs(std::make_shared<SongList>(tagged), 0);
+        }
+        if (m_playlist->empty()) {
             std::cerr << "No supported audio files found in directory: " << directory << "\n";
+            quit();
+            return;
+        }
+        
+        start_first_song();
+        std::cout << "Loaded " << m_playlist->size() << " songs from " << directory
+                  << " (" << found << " found by the scan)\n";
+    }
+    
+    // Replaces filename-derived metadata with what the tags say, a batch per loop pass
+    void update_tagged_songs(std::shared_ptr<SongList> songs, size_t next) {
+        size_t end = std::min(songs->size(), next + INDEX_FEED_BATCH);
+        for (; next < end; ++next) {
+            m_playlist->rename_song((*songs)[next].file_path, (*songs)[next]);
+        }
+        if (next < songs->size()) {
+            m_loop->post([this, songs, next]() { update_tagged_songs(songs, next); });
+        }
+        m_control->publish_status();
+    }
+    
+    // Hands the indexed library to the playlist in batches so the loop stays
+    // responsive. Stepping by a stride coprime with the size spreads the first
+    // batch, which the startup pick chooses from, across the whole library.
+    void start_index_feed() {
+        size_t count = m_library_index.size();
+        std::mt19937 rng(std::random_device{}());
+        m_index_feed_start = std::uniform_int_distribution<size_t>(0, count - 1)(rng);
+        m_index_feed_stride = count / STARTUP_CHOICE_SIZE + 1;
+        while (std::gcd(m_index_feed_stride, count) != 1) {
+            ++m_index_feed_stride;
+        }
+        m_index_feed_next = 0;
+        m_index_feeding = true;
+        std::cout << "Loaded " << count << " songs from the library index\n";
+        feed_indexed_songs();
+    }
+    
+    void feed_indexed_songs() {
+        size_t count = m_library_index.size();
+        size_t batch = m_index_feed_next == 0 ? STARTUP_CHOICE_SIZE : INDEX_FEED_BATCH;
+        size_t end = std::min(count, m_index_feed_next + batch);
+        SongList songs;
+        songs.reserve(end - m_index_feed_next);
+        IndexedSong entry;
+        for (; m_index_feed_next < end; ++m_index_feed_next) {
+            size_t slot = (m_index_feed_start + m_index_feed_next * m_index_feed_stride) % count;
+            if (m_library_index.get(slot, entry)) {
+                songs.push_back(std::move(entry.song));
+            }
+        }
+        add_scanned_songs(songs);
+        
+        if (m_index_feed_next < count) {
+            m_loop->post([this]() { feed_indexed_songs(); });
+            return;
+        }
+        m_index_feeding = false;
+        if (m_after_index_feed) {
+            auto finish = std::move(m_after_index_feed);
+            m_after_index_feed = nullptr;
+            finish();
+        }
+    }
+    
+    // Rebuilds the playlist, order, volume and position from the last snapshot
+    bool restore_session() {
+        SessionState state;
+        if (!load_session(m_session_path, state) || state.directory != m_current_directory) {
             return false;
         }
         
         m_playlist->clear();
-        for (const auto& song : songs) {
-            m_playlist->add_song(song);
+        IndexedSong entry;
+        for (const auto& path : state.paths) {
+            size_t slot = m_library_index.find(path);
+            if (slot != LibraryIndex::NOT_FOUND && m_library_index.get(slot, entry)) {
+                m_playlist->add_song(entry.song);
+            } else {
+                m_playlist->add_song(m_file_scanner->create_song_from_file(path));
+            }
+        }
+        std::vector<size_t> order(state.order.begin(), state.order.end());
+        if (!m_playlist->restore_order(order, state.current_index)) {
+            m_playlist->clear();
+            return false;
         }
         
-        m_playlist->shuffle();
+        m_volume = std::clamp(state.volume, 0.0f, 1.0f);
+        m_audio_engine->set_volume(m_volume);
         
-        std::cout << "Loaded " << songs.size() << " songs from " << directory << "\n";
+        double position = state.sample_rate > 0
+            ? static_cast<double>(state.sample_position) / state.sample_rate : 0.0;
+        std::cout << "Resuming session: " << state.paths.size() << " songs, at "
+                  << format_time(position) << "\n";
+        m_current_song = m_playlist->library().handle(m_playlist->current());
+        play_current_song(position);
         return true;
     }
     
+    bool session_saveable() const {
+        return m_session_enabled && m_current_song.id != INVALID_SONG_ID && m_playlist->is_shuffled();
+    }
+    
+    SessionPosition session_position() const {
+        SessionPosition position;
+        position.current_index = static_cast<uint32_t>(m_playlist->current_index());
+        position.sample_position = m_start_frame + m_audio_engine->get_played_frames();
+        position.sample_rate = static_cast<uint32_t>(m_track_sample_rate);
+        position.volume = m_volume;
+        return position;
+    }
+    
+    SessionState session_snapshot() {
+        m_session_saved = true;
+        m_session_stale = false;
+        m_saved_revision = m_playlist->revision();
+        
+        SessionState state;
+        state.directory = m_current_directory;
+        state.paths.reserve(m_playlist->size());
+        for (SongId id : m_playlist->songs()) {
+            state.paths.push_back(m_playlist->library().path(id));
+        }
+        auto order = m_playlist->shuffle_order();
+        state.order.assign(order.begin(), order.end());
+        SessionPosition position = session_position();
+        state.current_index = position.current_index;
+        state.sample_position = position.sample_position;
+        state.sample_rate = position.sample_rate;
+        state.volume = position.volume;
+        return state;
+    }
+    
+    // Only reads m_session_path, so it can run on m_session_thread
+    void write_session(const SessionState& state) {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(m_session_path).parent_path(), ec);
+        if (!save_session(m_session_path, state)) {
+            std::cerr << "Warning: Could not save session to " << m_session_path << "\n";
+        }
+    }
+    
+    // Periodic save, so a crash resumes close to where it was. The library and
+    // order are copied out and rewritten only after they changed; otherwise the
+    // index, position and volume are overwritten in place. Either runs on a
+    // worker thread, and a tick is skipped while the last write is still going.
+    void save_session_if_changed() {
+        if (!session_saveable() || m_session_writing) {
+            return;
+        }
+        if (m_session_thread.joinable()) {
+            m_session_thread.join();  // Already finished
+        }
+        
+        m_session_writing = true;
+        if (!m_session_saved || m_session_stale || m_playlist->revision() != m_saved_revision) {
+            m_session_thread = std::thread([this, state = session_snapshot()]() {
+                TRACE_THREAD_NAME("session");
+                write_session(state);
+                m_session_writing = false;
+            });
+        } else {
+            m_session_thread = std::thread([this, count = m_playlist->size(), position = session_position()]() {
+                TRACE_THREAD_NAME("session");
+                if (!update_session_position(m_session_path, count, position)) {
+                    m_session_stale = true;
+                }
+                m_session_writing = false;
+            });
+        }
+    }
+    
+    // The full snapshot, position included, written before returning
+    void save_session_state() {
+        if (m_session_thread.joinable()) {
+            m_session_thread.join();
+        }
+        if (session_saveable()) {
+            write_session(session_snapshot());
+        }
+    }
+    
     bool load_file(const std::string& file_path) {
         SongList songs = m_file_scanner->scan_directory(std::filesystem::path(file_path).parent_path().string());
         
@@ -179,7 +756,7 @@ public:
         return true;
     }
     
-    void run(const std::string& path = "", bool is_file = false) {
+    void run(const std::string& path = "", bool is_file = false, const std::string& playlist_path = "") {
         std::cout << "Nigamp - Ultra-Lightweight MP3 Player\n";
         std::cout << "======================================\n";
 #ifdef _WIN32
@@ -189,6 +766,7 @@ public:
         std::cout << "  Ctrl+Alt+R      - Pause/Resume\n";
         std::cout << "  Ctrl+Alt+Plus   - Volume up\n";
         std::cout << "  Ctrl+Alt+Minus  - Volume down\n";
+        std::cout << "  Ctrl+Alt+Right/Left - Seek forward/back 10s\n";
         std::cout << "  Ctrl+Alt+Escape - Quit\n";
         std::cout << "\n";
         std::cout << "Local Hotkeys (when console focused):\n";
@@ -205,79 +783,97 @@ public:
         std::cout << "  Ctrl+Alt+R      - Pause/Resume\n";
         std::cout << "  Ctrl+Alt+Plus   - Volume up\n";
         std::cout << "  Ctrl+Alt+Minus  - Volume down\n";
+        std::cout << "  Ctrl+Alt+Right/Left - Seek forward/back 10s\n";
         std::cout << "  Ctrl+Alt+Escape - Quit\n";
         std::cout << "\nTerminal Hotkeys (when terminal has focus):\n";
         std::cout << "  N/n             - Next track\n";
         std::cout << "  P/p             - Previous track\n";
         std::cout << "  Space/R/r       - Pause/Resume\n";
         std::cout << "  +/-             - Volume up/down\n";
+        std::cout << "  ./,             - Seek forward/back 10s\n";
         std::cout << "  Q/q/ESC         - Quit\n";
 #endif
         std::cout << "======================================\n\n";
         
-        bool loaded = false;
-        if (!path.empty()) {
-            if (is_file) {
-                loaded = load_file(path);
-                // For single files, store parent directory for reindexing
-                m_current_directory = std::filesystem::path(path).parent_path().string();
-            } else {
-                loaded = load_directory(path);
-                m_current_directory = path;
+        if (is_file && !path.empty()) {
+            if (!load_file(path)) {
+                std::cerr << "Failed to load audio files\n";
+                return;
             }
+            // The named file plays first, then the playlist
+            if (!playlist_path.empty()) {
+                import_playlist(playlist_path);
+            }
+            // For single files, store parent directory for reindexing
+            m_current_directory = std::filesystem::path(path).parent_path().string();
+            start_periodic_reindex();
+            play_current_song();
         } else {
-            std::string default_dir = get_default_music_directory();
-            loaded = load_directory(default_dir);
-            m_current_directory = default_dir;
-        }
-        
-        if (!loaded) {
-            std::cerr << "Failed to load audio files\n";
-            return;
-        }
-        
-        // Start background reindexing thread
-        start_reindexing_thread();
-        
-        play_current_song();
-        
-        while (!m_should_quit) {
-            // Handle track advancement requests from playback thread
-            if (m_advance_to_next.exchange(false)) {
-                handle_track_advance();
+            // Playback starts from the loop once the scan turns up songs, unless a
+            // saved session or the library index starts it right away and the scan
+            // only adds new files and validates the rest
+            m_current_directory = path.empty() ? get_default_music_directory() : path;
+            m_session_enabled = !m_preview_mode;
+            if (m_library_index.open(m_index_path) && m_library_index.directory() != m_current_directory) {
+                m_library_index.close();
+            }
+            std::unordered_set<std::string> known;
+            bool index_fed = false;
+            bool restored = m_session_enabled && m_resume_session && restore_session();
+            if (restored) {
+                for (SongId id : m_playlist->songs()) {
+                    known.insert(m_playlist->library().path(id));
+                }
+            }
+            // Queued before the library arrives, so the first song comes from the playlist
+            if (!playlist_path.empty()) {
+                import_playlist(playlist_path);
+            }
+            if (!restored && m_library_index.size() > 0) {
+                index_fed = true;
+                start_index_feed();
             }
             
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            // Watch first so nothing created during the scan slips through; duplicates are dropped
+            bool watching = m_watcher->start(m_current_directory, [this](const std::vector<LibraryChange>& changes) {
+                apply_library_changes(changes);
+            }, [this]() {
+                start_reindex();
+                if (!m_watcher->is_running()) {
+                    start_periodic_reindex();
+                }
+            });
+            start_streaming_scan(m_current_directory, std::move(known), index_fed);
+            
+            m_loop->add_timer(std::chrono::seconds(SESSION_SAVE_INTERVAL_SECONDS), [this]() {
+                save_session_if_changed();
+            }, true);
+            if (!watching) {
+                start_periodic_reindex();
+            }
         }
+        
+        m_status.start();
+        // Position events refresh the display while playing; this covers pause and idle
+        m_loop->add_timer(std::chrono::milliseconds(COUNTDOWN_UPDATE_INTERVAL_MS), [this]() {
+            update_display();
+        }, true);
+        
+        // Everything below runs on this thread until quit()
+        m_loop->run();
     }
     
 private:
-    void start_completion_timeout() {
-        m_eof_signaled_time = std::chrono::steady_clock::now();
-        m_timeout_active = true;
-        
-        // Join any existing timeout thread
-        if (m_timeout_thread.joinable()) {
-            m_timeout_thread.join();
-        }
-        
-        m_timeout_thread = std::thread([this]() {
-            std::this_thread::sleep_for(std::chrono::seconds(COMPLETION_TIMEOUT_SECONDS));
-            
-            if (m_timeout_active.load()) {
-                std::cerr << "Warning: Audio completion callback timeout after " 
-                          << COMPLETION_TIMEOUT_SECONDS << " seconds. Forcing track advance.\n";
-                m_advance_to_next = true;
-                m_timeout_active = false;
+    // Posts a track advance that is dropped if the track changed in the meantime
+    void post_track_advance(unsigned generation) {
+        m_loop->post([this, generation]() {
+            if (generation == m_track_generation) {
+                handle_track_advance();
             }
         });
     }
     
-    void handle_playback_completion(const CompletionResult& result) {
-        
-        // Cancel timeout since callback fired successfully
-        m_timeout_active = false;
-        
+    void handle_playback_completion(const CompletionResult& result, unsigned generation) {
         if (result.error_code != AudioEngineError::SUCCESS) {
             std::cerr << "Audio playback completed with error: " << result.error_message << "\n";
         } else {
@@ -285,66 +881,161 @@ private:
                       << result.completion_time.count() << "ms\n";
         }
         
-        // Signal track advancement
-        m_advance_to_next = true;
-    }
-    
-    void handle_hotkey(HotkeyAction action) {
-        // Use a thread-safe queue to pass hotkey actions to the main thread
-        // This ensures that all hotkey actions are processed in the main thread
-        // and avoids any potential race conditions.
-        
-        // For now, we'll just process the hotkey directly, but in a more complex
-        // application, a thread-safe queue would be a better approach.
-        
-        switch (action) {
-            case HotkeyAction::NEXT_TRACK:
-                next_track();
-                break;
-            case HotkeyAction::PREVIOUS_TRACK:
-                previous_track();
-                break;
-            case HotkeyAction::PAUSE_RESUME:
-                toggle_pause();
-                break;
-            case HotkeyAction::VOLUME_UP:
-                adjust_volume(0.1f);
-                break;
-            case HotkeyAction::VOLUME_DOWN:
-                adjust_volume(-0.1f);
-                break;
-            case HotkeyAction::QUIT:
-                quit();
-                break;
+        post_track_advance(generation);
+    }
+    
+    // Runs on the engine's dispatcher thread; the work happens on the loop
+    void handle_engine_event(const AudioEngineEvent& event, unsigned generation) {
+        m_loop->post([this, event, generation]() {
+            if (generation != m_track_generation) {
+                return;
+            }
+            switch (event.type) {
+                case AudioEngineEventType::POSITION:
+                    update_display();
+                    m_control->publish_status();
+                    break;
+                case AudioEngineEventType::XRUN:
+                    ++m_xrun_count;
+                    std::cerr << "Warning: Audio underrun (" << m_xrun_count << " so far)\n";
+                    break;
+                case AudioEngineEventType::DEVICE_LOST:
+                    std::cerr << "Warning: Audio device lost, waiting for it to come back\n";
+                    m_control->publish_status();
+                    break;
+                case AudioEngineEventType::DEVICE_RESTORED:
+                    std::cout << "Audio device restored at " << event.sample_rate << " Hz\n";
+                    m_control->publish_status();
+                    break;
+                case AudioEngineEventType::CAPTURE_OVERFLOW:
+                    std::cerr << "Warning: Capture fell behind, " << event.frames_dropped
+                              << " frames dropped so far\n";
+                    break;
+                case AudioEngineEventType::COMPLETION:
+                    // Delivered through the completion callback instead
+                    break;
+            }
+        });
+    }
+    
+    // Only publishes a snapshot; m_status draws it on its own thread, so a slow terminal never stalls the loop
+    void update_display() {
+        StatusSnapshot snapshot;
+        if (m_playback_thread.joinable() && m_current_song.id != INVALID_SONG_ID) {
+            double position = playback_position();
+            snapshot.title = m_playlist->library().view(m_current_song).title;
+            snapshot.paused = m_is_paused;
+            snapshot.preview = m_preview_mode;
+            if (m_preview_mode) {
+                snapshot.remaining = PREVIEW_DURATION_SECONDS - (position - start_position());
+                snapshot.total = PREVIEW_DURATION_SECONDS;
+            } else {
+                snapshot.remaining = m_current_song_duration - position;
+                snapshot.total = m_current_song_duration;
+            }
+            snapshot.active = snapshot.total > 0 && snapshot.remaining > 0;
+        }
+        m_status.update(snapshot);
+    }
+    
+    double start_position() const {
+        return m_track_sample_rate > 0 ? static_cast<double>(m_start_frame) / m_track_sample_rate : 0.0;
+    }
+    
+    // Seconds into the track of what has actually been heard
+    double playback_position() const {
+        if (m_track_sample_rate <= 0) {
+            return 0.0;
         }
+        return static_cast<double>(m_start_frame + m_audio_engine->get_played_frames()) / m_track_sample_rate;
+    }
+    
+    // Safe from any thread; bursts are coalesced before they reach the player
+    void submit_command(PlayerCommand command) {
+        if (m_commands.push(std::move(command))) {
+            m_loop->post([this]() { drain_commands(); });
+        }
+    }
+    
+    void drain_commands() {
+        for (const auto& command : m_commands.drain()) {
+            int steps = static_cast<int>(command.amount);
+            switch (command.type) {
+                case PlayerCommandType::NEXT:
+                    next_track(steps);
+                    break;
+                case PlayerCommandType::PREVIOUS:
+                    previous_track(steps);
+                    break;
+                case PlayerCommandType::SEEK:
+                    seek_relative(command.amount);
+                    break;
+                case PlayerCommandType::VOLUME:
+                    adjust_volume(static_cast<float>(command.amount));
+                    break;
+                case PlayerCommandType::PAUSE_RESUME:
+                    toggle_pause();
+                    break;
+                case PlayerCommandType::ENQUEUE:
+                    enqueue(command.path);
+                    break;
+                case PlayerCommandType::EXPORT:
+                    export_playlist(command.path);
+                    break;
+                case PlayerCommandType::QUIT:
+                    quit();
+                    return;
+            }
+        }
+        m_control->publish_status();
+    }
+    
+    PlayerStatus current_status() const {
+        PlayerStatus status;
+        if (m_current_song.id != INVALID_SONG_ID && m_playback_thread.joinable()) {
+            status.state = m_is_paused ? PlaybackState::PAUSED : PlaybackState::PLAYING;
+            status.position = playback_position();
+            status.duration = m_current_song_duration;
+            status.title = m_playlist->library().view(m_current_song).title;
+        }
+        status.volume = m_volume;
+        status.index = static_cast<uint32_t>(m_playlist->current_index());
+        status.playlist_size = static_cast<uint32_t>(m_playlist->size());
+        return status;
+    }
+    
+    // At the end of a pass the whole library is shuffled again, recently played songs last
+    SongId advance_in_order() {
+        if (!m_playlist->has_next() && m_playlist->size() > 1) {
+            m_playlist->shuffle();
+            return m_playlist->current();
+        }
+        return m_playlist->next();
     }
     
     void handle_track_advance() {
-        std::lock_guard<std::mutex> lock(m_playlist_mutex);
-        
         // For single-file preview mode, quit after completion instead of looping
         if (m_preview_mode && m_playlist->size() == 1) {
             std::cout << "Preview complete for single file. Exiting...\n";
-            // Set quit flag instead of calling quit() directly to avoid deadlock
-            m_should_quit = true;
+            quit();
             return;
         }
         
         // For automatic advancement after song completion, move to next song
-        const Song* next_song = m_playlist->next();
-        if (next_song && next_song != m_current_song) {
-            std::cout << "Auto-advancing to next track: " << next_song->title << "\n";
+        SongId next_song = advance_in_order();
+        if (next_song != INVALID_SONG_ID && next_song != m_current_song.id) {
+            std::cout << "Auto-advancing to next track: " << m_playlist->library().view(next_song).title << "\n";
             stop_current_song();
-            m_current_song = next_song;
+            m_current_song = m_playlist->library().handle(next_song);
             play_current_song();
-        } else if (next_song == m_current_song) {
+        } else if (next_song == m_current_song.id) {
             // Single song in playlist - for preview mode, quit; otherwise loop
             if (m_preview_mode) {
                 std::cout << "Preview mode with single song complete. Exiting...\n";
-                // Set quit flag instead of calling quit() directly to avoid deadlock
-                m_should_quit = true;
+                quit();
             } else {
-                std::cout << "Single song playlist - restarting current song\n";
+                std::cout << (m_playlist->size() == 1 ? "Single song playlist - restarting current song\n"
+                                                      : "Playing the same song again\n");
                 stop_current_song();
                 play_current_song();
             }
@@ -353,14 +1044,17 @@ private:
         }
     }
     
-    void next_track() {
-        std::lock_guard<std::mutex> lock(m_playlist_mutex);
-        
-        const Song* next_song = m_playlist->next();
-        if (next_song) {
+    void next_track(int steps = 1) {
+        SongId next_song = INVALID_SONG_ID;
+        for (int i = 0; i < steps; ++i) {
+            SongId song = advance_in_order();
+            if (song == INVALID_SONG_ID) break;
+            next_song = song;
+        }
+        if (next_song != INVALID_SONG_ID) {
             stop_current_song();
-            INFO_LOG("Now playing: " << next_song->title);
-            m_current_song = next_song;
+            INFO_LOG("Now playing: " << m_playlist->library().view(next_song).title);
+            m_current_song = m_playlist->library().handle(next_song);
             play_current_song();
         }
         else {
@@ -368,12 +1062,16 @@ private:
         }
     }
     
-    void previous_track() {
-        std::lock_guard<std::mutex> lock(m_playlist_mutex);
-        const Song* prev_song = m_playlist->previous();
-        if (prev_song) {
+    void previous_track(int steps = 1) {
+        SongId prev_song = INVALID_SONG_ID;
+        for (int i = 0; i < steps; ++i) {
+            SongId song = m_playlist->previous();
+            if (song == INVALID_SONG_ID) break;
+            prev_song = song;
+        }
+        if (prev_song != INVALID_SONG_ID) {
             stop_current_song();
-            m_current_song = prev_song;
+            m_current_song = m_playlist->library().handle(prev_song);
             play_current_song();
         }
     }
@@ -396,45 +1094,172 @@ private:
         std::cout << "Volume: " << static_cast<int>(m_volume * 100) << "%\n";
     }
     
+    void seek_relative(double delta_seconds) {
+        if (m_current_song.id == INVALID_SONG_ID || !m_playback_thread.joinable()) {
+            return;
+        }
+        
+        double position = std::max(0.0, playback_position() + delta_seconds);
+        if (m_current_song_duration > 0 && position >= m_current_song_duration) {
+            handle_track_advance();
+            return;
+        }
+        
+        // The decoder belongs to the playback thread, so restart it at the new position
+        stop_current_song();
+        play_current_song(position);
+        std::cout << "Seek: " << format_time(position) << "\n";
+    }
+    
+    // Queues a song, or every song in a playlist file, up next
+    void enqueue(const std::string& file_path) {
+        if (playlist_format(file_path) != PlaylistFormat::UNKNOWN) {
+            import_playlist(file_path);
+            return;
+        }
+        std::filesystem::path path(file_path);
+        if (!std::filesystem::is_regular_file(path) || !create_decoder(file_path)) {
+            std::cerr << "Cannot enqueue: " << file_path << "\n";
+            return;
+        }
+        
+        // A song already in the library keeps its tags
+        SongId id = m_playlist->library().find(path.string());
+        if (id == INVALID_SONG_ID) {
+            Song song;
+            song.file_path = path.string();
+            song.title = path.stem().string();
+            id = m_playlist->add_song(song);
+        }
+        m_playlist->enqueue(id);
+        std::cout << "Enqueued: " << m_playlist->library().view(id).title << "\n";
+    }
+    
+    // Streams the playlist in batches; entries the library lacks are added with
+    // tags from the library index when it has them. Returns the songs queued.
+    size_t import_playlist(const std::string& path) {
+        TRACE_SCOPE("import playlist");
+        LibraryIndex saved_index;
+        const LibraryIndex* index = nullptr;
+        if (m_library_index.is_open()) {
+            index = &m_library_index;
+        } else if (saved_index.open(m_index_path)) {
+            index = &saved_index;
+        }
+        
+        size_t queued = 0;
+        SongList new_songs;
+        bool read = read_playlist(path, [&](std::vector<PlaylistEntry>& batch) {
+            batch.erase(std::remove_if(batch.begin(), batch.end(), [this](const PlaylistEntry& entry) {
+                return !m_file_scanner->is_supported_format(entry.path);
+            }), batch.end());
+            resolve_playlist_entries(batch, m_playlist->library(), index, new_songs);
+            m_playlist->add_songs(new_songs);
+            for (const auto& entry : batch) {
+                m_playlist->enqueue(m_playlist->library().find(entry.path));
+            }
+            queued += batch.size();
+            return !m_should_quit;
+        });
+        if (!read) {
+            std::cerr << "Cannot read playlist: " << path << "\n";
+            return 0;
+        }
+        std::cout << "Queued " << queued << " songs from " << path << "\n";
+        return queued;
+    }
+    
+    // The current song, the queue, then the rest of the order
+    void export_playlist(const std::string& path) {
+        PlaylistWriter writer;
+        if (!writer.open(path)) {
+            std::cerr << "Cannot export playlist to " << path << " (use .m3u, .m3u8 or .pls)\n";
+            return;
+        }
+        for (SongId id : m_playlist->play_order()) {
+            SongView song = m_playlist->library().view(id);
+            writer.write(PlaylistEntry{song.path(), std::string(song.title), song.duration});
+        }
+        if (!writer.close()) {
+            std::cerr << "Cannot export playlist to " << path << "\n";
+            return;
+        }
+        std::cout << "Exported " << writer.count() << " songs to " << path << "\n";
+    }
+    
     void quit() {
         std::cout << "Shutting down...\n";
         m_should_quit = true;
+        m_loop->stop();
     }
     
-    void play_current_song() {
-        if (!m_current_song) {
-            m_current_song = m_playlist->current();
+    void play_current_song(double start_seconds = 0.0) {
+        TRACE_SCOPE("play_current_song");
+        if (m_current_song.id == INVALID_SONG_ID) {
+            m_current_song = m_playlist->library().handle(m_playlist->current());
         }
         
-        if (!m_current_song) {
+        if (m_current_song.id == INVALID_SONG_ID) {
             std::cout << "No songs to play\n";
             return;
         }
+        // The playlist counts this only when the track is newly current, not when
+        // a seek, the preview retry or a resumed session restarts it
+        m_playlist->record_play(m_current_song.id);
+        SongView song = m_playlist->library().view(m_current_song);
+        std::string song_path = song.path();
+        
+        // Previews start at the loudest stretch; wait for the envelope if it is not cached yet
+        if (m_loudness && start_seconds <= 0.0) {
+            LoudnessEnvelope envelope;
+            if (!m_loudness->lookup(song_path, envelope)) {
+                unsigned generation = m_track_generation;
+                m_loudness->request(song_path, [this, generation]() {
+                    m_loop->post([this, generation]() {
+                        if (generation == m_track_generation && !m_playback_thread.joinable()) {
+                            play_current_song();
+                        }
+                    });
+                });
+                prefetch_previews();
+                return;
+            }
+            start_seconds = find_loudest_window(envelope, PREVIEW_DURATION_SECONDS);
+            prefetch_previews();
+        }
         
         if (m_preview_mode) {
-            std::cout << "Now playing (10s preview): " << m_current_song->title << "\n";
+            std::cout << "Now playing (10s preview): " << song.title << "\n";
         } else {
-            std::cout << "Now playing: " << m_current_song->title << "\n";
+            std::cout << "Now playing: " << song.title << "\n";
         }
         
-        m_current_decoder = create_decoder(m_current_song->file_path);
-        if (!m_current_decoder || !m_current_decoder->open(m_current_song->file_path)) {
-            ERROR_LOG("Failed to open: " << m_current_song->file_path);
+        m_current_decoder = create_decoder(song_path);
+        if (!m_current_decoder || !m_current_decoder->open(song_path)) {
+            ERROR_LOG("Failed to open: " << song_path);
             return;
         }
         
-        // Get song duration for duration-based completion
+        AudioFormat format = m_current_decoder->get_format();
+        m_track_sample_rate = format.sample_rate;
         m_current_song_duration = m_current_decoder->get_duration();
+        m_start_frame = 0;
+        if (start_seconds > 0.0 && m_current_decoder->seek(start_seconds)) {
+            m_start_frame = static_cast<uint64_t>(start_seconds * format.sample_rate);
+        }
         
-        AudioFormat format = m_current_decoder->get_format();
         if (!m_audio_engine->initialize(format)) {
             ERROR_LOG("Failed to initialize audio engine");
             return;
         }
         
         // Set up callback for track advancement
-        m_audio_engine->set_completion_callback([this](const CompletionResult& result) {
-            handle_playback_completion(result);
+        unsigned generation = m_track_generation;
+        m_audio_engine->set_completion_callback([this, generation](const CompletionResult& result) {
+            handle_playback_completion(result, generation);
+        });
+        m_audio_engine->set_event_callback([this, generation](const AudioEngineEvent& event) {
+            handle_engine_event(event, generation);
         });
         
         m_audio_engine->set_volume(m_volume);
@@ -444,49 +1269,64 @@ private:
             return;
         }
         
-        // Note: m_playback_start_time will be set inside playback_loop when it actually starts
-        
         m_playback_thread = std::thread(&MusicPlayer::playback_loop, this);
+        m_control->publish_status();
+    }
+    
+    void dump_trace() {
+        if (write_chrome_trace(m_trace_path)) {
+            std::cout << "Trace written to " << m_trace_path << "\n";
+        } else {
+            std::cerr << "Warning: Could not write trace to " << m_trace_path << "\n";
+        }
+    }
+    
+    // Analyze the next few tracks in play order while the current preview runs
+    void prefetch_previews() {
+        std::vector<size_t> order = m_playlist->shuffle_order();
+        const std::vector<SongId>& songs = m_playlist->songs();
+        if (order.empty()) {
+            return;
+        }
+        size_t count = std::min(PREVIEW_PREFETCH_TRACKS, order.size() - 1);
+        for (size_t i = 1; i <= count; ++i) {
+            size_t index = order[(m_playlist->current_index() + i) % order.size()];
+            m_loudness->request(m_playlist->library().path(songs[index]));
+        }
     }
     
     void stop_current_song() {
+        TRACE_SCOPE("stop_current_song");
+        // Anything already posted for the old track is now stale
+        ++m_track_generation;
         
-        // Cancel any active timeout thread and reset advancement flags
-        m_timeout_active = false;
-        m_advance_to_next = false;
-        
-        // Reset playback state controllers (but preserve pause state)
-        m_current_song_duration = 0.0;
-        // Note: m_playback_start_time will be reset in play_current_song()
         // Note: m_is_paused is preserved so next song respects current pause state
         
         // Signal playback loop to exit FIRST - this prevents further mutex contention
         m_stop_playback = true;        
         
-        // Wait for playback thread to finish. This is the most important change.
+        // Stopping the engine releases a playback thread blocked in write_samples
+        if (m_audio_engine) {
+            std::cout << "Stopping audio engine...\n";
+            m_audio_engine->stop();
+        }
+        
         // By joining here, we ensure the thread is no longer accessing the decoder or audio engine.
         if (m_playback_thread.joinable()) {
+            TRACE_SCOPE("join playback thread");
             std::cout << "Waiting for playback thread to finish...\n";
             m_playback_thread.join();
             std::cout << "Playback thread stopped\n";
         }
         
-        // Now that the thread is stopped, it's safe to stop hardware and close resources.
-        if (m_audio_engine) {
-            std::cout << "Stopping audio engine...\n";
-            m_audio_engine->stop();
-        }
+        // Reset playback state controllers once the thread no longer reads them
+        m_current_song_duration = 0.0;
         
         if (m_current_decoder) {
             std::cout << "Force closing decoder for instant stop...\n";
             m_current_decoder->close();
         }
         
-        // Wait for timeout thread to finish if it's running
-        if (m_timeout_thread.joinable()) {
-            m_timeout_thread.join();
-        }
-        
         // Reset for next playback
         m_stop_playback = false;
 
@@ -495,117 +1335,53 @@ private:
             m_current_decoder.reset();
         }
         
-        // Clear audio engine completion callback after all threads are stopped
+        // Clear audio engine callbacks after all threads are stopped
         if (m_audio_engine) {
             m_audio_engine->set_completion_callback(nullptr);
+            m_audio_engine->set_event_callback(nullptr);
         }
     }    
 
     void playback_loop() {
+        TRACE_THREAD_NAME("playback");
         try {
             AudioBuffer buffer;
             size_t buffer_size = m_audio_engine->get_buffer_size();
+            int channels = m_current_decoder->get_format().channels;
             
-            auto start_time = std::chrono::steady_clock::now();
-            const auto preview_duration = std::chrono::seconds(PREVIEW_DURATION_SECONDS);
-            
-            // Set playback start time NOW when playback actually begins
-            m_playback_start_time = std::chrono::steady_clock::now();
-            
-            bool preview_completed = false;
-            auto last_display_update = std::chrono::steady_clock::now();
-            const auto display_update_interval = std::chrono::milliseconds(COUNTDOWN_UPDATE_INTERVAL_MS);
+            // Preview stops feeding after exactly this many frames
+            uint64_t frames_left = UINT64_MAX;
+            if (m_preview_mode) {
+                frames_left = static_cast<uint64_t>(PREVIEW_DURATION_SECONDS) * m_track_sample_rate;
+            }
             
-            while (!m_stop_playback && !m_should_quit && m_current_decoder) {
-                // Check song duration completion (ignore decoder EOF)
-                if (m_use_duration_based_completion && m_current_song_duration > 0) {
-                    auto elapsed = std::chrono::steady_clock::now() - m_playback_start_time;
-                    auto elapsed_seconds = std::chrono::duration<double>(elapsed).count();
-                    
-                    // Update countdown display periodically
-                    auto now = std::chrono::steady_clock::now();
-                    if (now - last_display_update >= display_update_interval) {
-                        double remaining_seconds = m_current_song_duration - elapsed_seconds;
-                        if (remaining_seconds > 0) {
-                            std::string status = m_is_paused ? "⏸️  [PAUSED]" : "🎵";
-                            std::cout << "\r" << status << " " << (m_current_song ? m_current_song->title : "Unknown") 
-                                      << " - Time remaining: " << format_time(remaining_seconds)
-                                      << " / " << format_time(m_current_song_duration) << std::flush;
-                        }
-                        last_display_update = now;
-                    }
-                    
-                    if (elapsed_seconds >= m_current_song_duration) {
-                        std::cout << "\r" << std::string(80, ' ') << "\r"; // Clear the line
-                        break;
-                    }
+            // write_samples blocks while the engine is full or paused, which paces this loop.
+            // The countdown display runs as a timer on the event loop.
+            while (!m_stop_playback && !m_should_quit && frames_left > 0) {
+                if (!m_current_decoder->decode(buffer, buffer_size)) {
+                    break;  // EOF or a decode error: either way the track ends here
                 }
                 
-                // Check if preview mode time limit reached
-                if (m_preview_mode) {
-                    auto elapsed = std::chrono::steady_clock::now() - start_time;
-                    
-                    // Update preview countdown display
-                    auto now = std::chrono::steady_clock::now();
-                    if (now - last_display_update >= display_update_interval) {
-                        double preview_elapsed = std::chrono::duration<double>(elapsed).count();
-                        double preview_remaining = PREVIEW_DURATION_SECONDS - preview_elapsed;
-                        if (preview_remaining > 0) {
-                            std::cout << "\r🎵 [PREVIEW] " << (m_current_song ? m_current_song->title : "Unknown") 
-                                      << " - Time remaining: " << format_time(preview_remaining)
-                                      << " / " << format_time(PREVIEW_DURATION_SECONDS) << std::flush;
-                        }
-                        last_display_update = now;
-                    }
-                    
-                    if (elapsed >= preview_duration) {
-                        std::cout << "\r" << std::string(80, ' ') << "\r"; // Clear the line
-                        if (m_current_song) {
-                            INFO_LOG("Preview complete for: " << m_current_song->title);
-                        }
-                        preview_completed = true;
-                        break;
-                    }
+                uint64_t frames = buffer.size() / channels;
+                if (frames > frames_left) {
+                    buffer.resize(static_cast<size_t>(frames_left) * channels);
+                    frames = frames_left;
                 }
+                frames_left -= frames;
                 
-                if (!m_is_paused) {
-                    // Keep decoding even if decoder hits EOF - we'll stop based on duration
-                    if (m_current_decoder->decode(buffer, buffer_size)) {
-                        m_audio_engine->write_samples(buffer);
-                    } else if (m_current_decoder->is_eof()) {
-                        // Decoder hit EOF but we continue until duration is reached
-                        // Fill buffer with silence to keep audio engine running
-                        buffer.assign(buffer_size, 0);
-                        m_audio_engine->write_samples(buffer);
-                    } else {
-                        break;
-                    }
+                if (!m_audio_engine->write_samples(buffer)) {
+                    break;
                 }
-                
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
             }
             
-            // Signal completion - either by duration, preview, or actual completion
-            if (m_current_decoder) {
-                std::cout << "\r" << std::string(80, ' ') << "\r"; // Clear the countdown line
-                m_audio_engine->signal_eof();
-                
-                // For duration-based completion, immediately advance to next track
-                // BUT only if we're not already stopping due to manual track change
-                if (m_use_duration_based_completion && !m_stop_playback.load()) {
-                    // Give audio engine brief moment to process, then advance
-                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                    m_advance_to_next = true;
-                } else if (!m_stop_playback.load()) {
-                    // Use traditional timeout mechanism only if not manually stopping
-                    start_completion_timeout();
+            // The engine reports completion once the device has played the last frame
+            if (!m_stop_playback && !m_should_quit) {
+                if (m_preview_mode && frames_left == 0) {
+                    INFO_LOG("Preview complete");
                 }
-                // If m_stop_playback is true, don't start any completion mechanism
+                m_audio_engine->signal_eof();
             }
             
-            // Note: Track advancement now happens via audio engine callback
-            // No need to manually set m_advance_to_next here
-            
         } catch (const std::exception& e) {
             std::cerr << "Exception in playback_loop: " << e.what() << std::endl;
         } catch (...) {
@@ -613,84 +1389,133 @@ private:
         }
     }
     
-    void start_reindexing_thread() {
-        if (!m_reindex_thread.joinable()) {
-            m_reindex_thread = std::thread(&MusicPlayer::reindexing_loop, this);
+    void start_periodic_reindex() {
+        if (m_reindex_timer == IEventLoop::INVALID_TIMER) {
+            m_reindex_timer = m_loop->add_timer(std::chrono::minutes(REINDEX_INTERVAL_MINUTES), [this]() {
+                start_reindex();
+            }, true);
         }
     }
     
-    void reindexing_loop() {
-        try {
-            while (!m_should_quit) {
-                std::this_thread::sleep_for(std::chrono::minutes(1)); // Check every minute
-                
-                if (m_should_quit) break;
-                
-                auto now = std::chrono::steady_clock::now();
-                auto elapsed = std::chrono::duration_cast<std::chrono::minutes>(now - m_last_index_time);
-                
-                if (elapsed.count() >= REINDEX_INTERVAL_MINUTES) {
-                    reindex_directory();
-                    m_last_index_time = now;
-                }
+    // Scans on a worker thread and hands the result back to the loop
+    void start_reindex() {
+        if (m_current_directory.empty() || m_reindex_running) {
+            return;
+        }
+        if (m_reindex_thread.joinable()) {
+            m_reindex_thread.join();
+        }
+        
+        m_reindex_running = true;
+        std::string directory = m_current_directory;
+        m_reindex_thread = std::thread([this, directory]() {
+            TRACE_THREAD_NAME("scan");
+            SongList new_songs;
+            try {
+                new_songs = m_file_scanner->scan_directory(directory);
+            } catch (const std::exception& e) {
+                std::cerr << "Exception while reindexing: " << e.what() << std::endl;
+            }
+            m_loop->post([this, new_songs]() {
+                m_reindex_running = false;
+                reindex_directory(new_songs);
+            });
+        });
+    }
+    
+    // Turns a full rescan into the same deltas the watcher reports
+    void reindex_directory(const SongList& new_songs) {
+        std::vector<LibraryChange> changes;
+        std::unordered_set<std::string> found;
+        for (const auto& song : new_songs) {
+            found.insert(song.file_path);
+            if (!m_playlist->contains(song.file_path)) {
+                LibraryChange change;
+                change.path = song.file_path;
+                changes.push_back(std::move(change));
+            }
+        }
+        for (SongId id : m_playlist->songs()) {
+            std::string path = m_playlist->library().path(id);
+            if (!found.count(path)) {
+                LibraryChange change;
+                change.kind = LibraryChange::Kind::REMOVED;
+                change.path = std::move(path);
+                changes.push_back(std::move(change));
             }
-        } catch (const std::exception& e) {
-            std::cerr << "Exception in reindexing_loop: " << e.what() << std::endl;
-        } catch (...) {
-            std::cerr << "Unknown exception in reindexing_loop" << std::endl;
         }
+        apply_library_changes(changes);
     }
     
-    void reindex_directory() {
-        if (m_current_directory.empty()) return;
+    // Applies library deltas at O(1) per affected song; the playing song keeps playing unless it was removed
+    void apply_library_changes(const std::vector<LibraryChange>& changes) {
+        SongList added;
+        size_t removed = 0;
+        size_t renamed = 0;
         
-        SongList new_songs = m_file_scanner->scan_directory(m_current_directory);
-        
-        {
-            std::lock_guard<std::mutex> lock(m_playlist_mutex);
-            
-            // Get current playlist songs
-            size_t playlist_size = m_playlist->size();
-            if (playlist_size > 0) {
-                // Simple approach: if song count changed, update playlist
-                if (new_songs.size() != playlist_size) {
-                    std::cout << "Directory updated: Found " << new_songs.size() 
-                             << " songs (was " << playlist_size << ")\n";
-                    
-                    // Store current song info to try to maintain playback
-                    std::string current_song_path;
-                    if (m_current_song) {
-                        current_song_path = m_current_song->file_path;
+        for (const auto& change : changes) {
+            switch (change.kind) {
+                case LibraryChange::Kind::ADDED:
+                    if (m_file_scanner->is_supported_format(change.path) && !m_playlist->contains(change.path)) {
+                        added.push_back(m_file_scanner->create_song_from_file(change.path));
                     }
-                    
-                    // Update playlist
-                    m_playlist->clear();
-                    for (const auto& song : new_songs) {
-                        m_playlist->add_song(song);
+                    break;
+                case LibraryChange::Kind::REMOVED:
+                    if (change.is_directory) {
+                        removed += m_playlist->remove_directory(change.path);
+                    } else {
+                        removed += m_playlist->remove_song(change.path) ? 1 : 0;
                     }
-                    
-                    if (!new_songs.empty()) {
-                        m_playlist->shuffle();
-                        
-                        // Try to find the currently playing song in the new list
-                        if (!current_song_path.empty()) {
-                            // This is a simplified approach - in a full implementation
-                            // we might want to maintain playback position
-                            std::cout << "Playlist updated during playbook\n";
-                        }
+                    break;
+                case LibraryChange::Kind::RENAMED:
+                    if (change.is_directory) {
+                        renamed += m_playlist->rename_directory(change.old_path, change.path);
+                    } else if (!m_file_scanner->is_supported_format(change.path)) {
+                        removed += m_playlist->remove_song(change.old_path) ? 1 : 0;
+                    } else if (m_playlist->move_song(change.old_path, change.path)) {
+                        ++renamed;
+                    } else if (!m_playlist->contains(change.path)) {
+                        added.push_back(m_file_scanner->create_song_from_file(change.path));
                     }
-                }
+                    break;
+            }
+        }
+        
+        if (!added.empty() || removed > 0 || renamed > 0) {
+            std::cout << "Library updated: " << added.size() << " added, " << removed << " removed, "
+                      << renamed << " renamed\n";
+        }
+        
+        // Renames keep a song's id, so only a removal stops the playing song
+        if (m_current_song.id != INVALID_SONG_ID && !m_playlist->library().valid(m_current_song)) {
+            // The playing file is gone; an upcoming song has taken its slot
+            stop_current_song();
+            m_current_song = SongHandle();
+            if (!m_playlist->empty()) {
+                play_current_song();
             }
         }
+        if (!added.empty()) {
+            add_scanned_songs(added);
+        }
+        m_control->publish_status();
     }
     
     void shutdown() {
         std::cout << "Shutting down music player...\n";
         
+        // While the engine still knows the position
+        save_session_state();
+        m_control->stop();
+        m_watcher->stop();
+        m_status.stop();
+        
         // Signal all threads to stop
         m_should_quit = true;
+        m_stop_playback = true;
+        m_loop->stop();
         
-        // Stop audio playback first
+        // Stop audio playback first; this also releases a blocked playback thread
         if (m_audio_engine) {
             m_audio_engine->stop();
         }
@@ -702,20 +1527,15 @@ private:
             std::cout << "Playback thread finished\n";
         }
         
-        // Wait for reindexing thread to finish
+        // Wait for an in-flight rescan; its posted result is simply never run
         if (m_reindex_thread.joinable()) {
             std::cout << "Waiting for reindexing thread to finish...\n";
             m_reindex_thread.join();
             std::cout << "Reindexing thread finished\n";
         }
         
-        // Wait for timeout thread to finish
-        m_timeout_active = false;
-        if (m_timeout_thread.joinable()) {
-            std::cout << "Waiting for timeout thread to finish...\n";
-            m_timeout_thread.join();
-            std::cout << "Timeout thread finished\n";
-        }
+        // Abandons analyses in flight and joins the workers while the loop they post to still exists
+        m_loudness.reset();
         
         // Clean up resources
         if (m_current_decoder) {
@@ -731,6 +1551,10 @@ private:
             m_audio_engine->shutdown();
         }
         
+        if (!m_trace_path.empty()) {
+            dump_trace();
+        }
+        
         std::cout << "Shutdown complete\n";
     }
 };
@@ -742,6 +1566,15 @@ int main(int argc, char* argv[]) {
         bool preview_mode = false;
         std::string target_path = "";
         bool is_file = false;
+        nigamp::ResamplerQuality resampler_quality = nigamp::ResamplerQuality::MEDIUM;
+        std::string capture_path;
+        bool resume_session = true;
+        std::string render_path;
+        std::string control_path = nigamp::get_default_control_path();
+        std::string trace_path;
+        std::string shuffle_mode = "uniform";
+        std::string playlist_path;
+        int device_rate = 0;
         
         // Parse command line arguments
         for (int i = 1; i < argc; ++i) {
@@ -765,12 +1598,83 @@ int main(int argc, char* argv[]) {
                     std::cerr << "Error: --folder requires a directory path\n";
                     return 1;
                 }
+            } else if (arg == "--resample-quality" || arg == "-q") {
+                if (i + 1 >= argc || !nigamp::parse_resampler_quality(argv[++i], resampler_quality)) {
+                    std::cerr << "Error: --resample-quality requires fast, medium or high\n";
+                    return 1;
+                }
+            } else if (arg == "--device-rate") {
+                if (i + 1 < argc) {
+                    device_rate = std::atoi(argv[++i]);
+                }
+                if (device_rate < 8000 || device_rate > 384000) {
+                    std::cerr << "Error: --device-rate requires a sample rate in Hz, such as 44100 or 48000\n";
+                    return 1;
+                }
+            } else if (arg == "--capture" || arg == "-c") {
+                if (i + 1 < argc) {
+                    capture_path = argv[++i];
+                } else {
+                    std::cerr << "Error: --capture requires a file or pipe path\n";
+                    return 1;
+                }
+            } else if (arg == "--control") {
+                if (i + 1 < argc) {
+                    control_path = argv[++i];
+                } else {
+                    std::cerr << "Error: --control requires a socket path\n";
+                    return 1;
+                }
+            } else if (arg == "--render") {
+                if (i + 1 < argc) {
+                    render_path = argv[++i];
+                } else {
+                    std::cerr << "Error: --render requires an output WAV path\n";
+                    return 1;
+                }
+            } else if (arg == "--trace") {
+                if (i + 1 < argc) {
+                    trace_path = argv[++i];
+                } else {
+                    std::cerr << "Error: --trace requires an output JSON path\n";
+                    return 1;
+                }
+#ifndef NIGAMP_TRACING
+                std::cerr << "Warning: nigamp was built without tracing (configure with -DNIGAMP_TRACING=ON)\n";
+                trace_path.clear();
+#endif
+            } else if (arg == "--shuffle" || arg == "-s") {
+                if (i + 1 >= argc || !nigamp::create_shuffle_strategy(argv[i + 1])) {
+                    std::cerr << "Error: --shuffle requires uniform, weighted or artist\n";
+                    return 1;
+                }
+                shuffle_mode = argv[++i];
+            } else if (arg == "--playlist" || arg == "-l") {
+                if (i + 1 >= argc || nigamp::playlist_format(argv[i + 1]) == nigamp::PlaylistFormat::UNKNOWN) {
+                    std::cerr << "Error: --playlist requires an .m3u, .m3u8 or .pls file\n";
+                    return 1;
+                }
+                playlist_path = argv[++i];
+            } else if (arg == "--no-control") {
+                control_path.clear();
+            } else if (arg == "--fresh") {
+                resume_session = false;
             } else if (arg == "--help" || arg == "-h") {
                 std::cout << "Usage: nigamp [options]\n";
                 std::cout << "Options:\n";
                 std::cout << "  --file <path>, -f <path>     Play specific MP3/WAV file\n";
                 std::cout << "  --folder <path>, -d <path>   Play all files from directory\n";
-                std::cout << "  --preview, -p                Play only first 10 seconds of each song\n";
+                std::cout << "  --preview, -p                Play the loudest 10 seconds of each song\n";
+                std::cout << "  --resample-quality <q>, -q   Resampler quality: fast, medium (default), high\n";
+                std::cout << "  --device-rate <hz>           Rate to open the output device at (default 48000)\n";
+                std::cout << "  --capture <path>, -c <path>  Record played audio to a WAV file or named pipe\n";
+                std::cout << "  --shuffle <mode>, -s <mode>  Shuffle mode: uniform (default), weighted (fewest plays first), artist (spread artists out)\n";
+                std::cout << "  --playlist <file>, -l <file> Queue an M3U/M3U8/PLS playlist ahead of the shuffle\n";
+                std::cout << "  --render <out.wav>           Decode the shuffled playlist to a WAV file as fast as possible\n";
+                std::cout << "  --control <path>             Serve the control socket at path (default $XDG_RUNTIME_DIR/nigamp.sock)\n";
+                std::cout << "  --no-control                 Do not open a control socket\n";
+                std::cout << "  --fresh                      Ignore the saved session and start a new shuffle\n";
+                std::cout << "  --trace <out.json>           Record hot-path spans as Chrome trace JSON (SIGUSR1 and exit write it)\n";
                 std::cout << "  --help, -h                   Show this help message\n";
                 std::cout << "\nUsage Examples:\n";
 #ifdef _WIN32
@@ -789,6 +1693,7 @@ int main(int argc, char* argv[]) {
                 std::cout << "  Ctrl+Alt+P                   Previous track\n";
                 std::cout << "  Ctrl+Alt+R                   Pause/Resume\n";
                 std::cout << "  Ctrl+Alt+Plus/Minus          Volume control\n";
+                std::cout << "  Ctrl+Alt+Right/Left          Seek forward/back 10s\n";
                 std::cout << "  Ctrl+Alt+Escape              Quit\n";
                 std::cout << "\nLocal Hotkeys (when console focused):\n";
                 std::cout << "  Ctrl+N                       Next track\n";
@@ -802,12 +1707,14 @@ int main(int argc, char* argv[]) {
                 std::cout << "  Ctrl+Alt+P                   Previous track\n";
                 std::cout << "  Ctrl+Alt+R                   Pause/Resume\n";
                 std::cout << "  Ctrl+Alt+Plus/Minus          Volume control\n";
+                std::cout << "  Ctrl+Alt+Right/Left          Seek forward/back 10s\n";
                 std::cout << "  Ctrl+Alt+Escape              Quit\n";
                 std::cout << "\nTerminal Hotkeys (when terminal has focus):\n";
                 std::cout << "  N/n                          Next track\n";
                 std::cout << "  P/p                          Previous track\n";
                 std::cout << "  Space/R/r                    Pause/Resume\n";
                 std::cout << "  +/-                          Volume control\n";
+                std::cout << "  ./,                          Seek forward/back 10s\n";
                 std::cout << "  Q/q/ESC                      Quit\n";
 #endif
                 return 0;
@@ -818,14 +1725,20 @@ int main(int argc, char* argv[]) {
             }
         }
         
-        nigamp::MusicPlayer player(preview_mode);
+        if (!render_path.empty()) {
+            return nigamp::MusicPlayer::render(target_path, is_file, preview_mode, resampler_quality, render_path,
+                                               shuffle_mode);
+        }
+        
+        nigamp::MusicPlayer player(preview_mode, resampler_quality, capture_path, resume_session, control_path,
+                                   trace_path, shuffle_mode, device_rate);
         
         if (!player.initialize()) {
             std::cerr << "Failed to initialize music player\n";
             return 1;
         }
         
-        player.run(target_path, is_file);
+        player.run(target_path, is_file, playlist_path);
         
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";
@@ -1,4 +1,5 @@
 #include "mp3_decoder.hpp"
+#include "trace.hpp"
 #include <filesystem>
 #include <algorithm>
 #include <iostream>
@@ -17,13 +18,52 @@ namespace nigamp {
 struct Mp3Decoder::Impl {
     AudioFormat format;
     bool is_open = false;
-    bool is_eof = false;
+    bool is_eof = false;        // No more compressed data; `carry` may still hold output
     double duration = 0.0;
     
     mp3dec_t mp3d;
     std::vector<uint8_t> file_data;
     size_t data_offset = 0;
     std::string file_path;
+    
+    // One entry per MPEG frame, built from the headers alone at open
+    struct FrameEntry {
+        uint32_t offset;
+        uint32_t first_frame;
+    };
+    std::vector<FrameEntry> frame_index;
+    uint64_t total_frames = 0;
+    int frame_samples = 0;      // Per channel, from the first frame
+    
+    AudioBuffer carry;          // Decoded samples that did not fit the caller's buffer
+    size_t skip_samples = 0;    // Decoded samples to discard to land exactly on a seek target
+    
+    // Layer III frames borrow bits from earlier frames, so seeks start this many frames early
+    static constexpr size_t SEEK_PREROLL_FRAMES = 2;
+    
+    void build_frame_index() {
+        frame_index.clear();
+        total_frames = 0;
+        
+        mp3dec_t scanner;
+        mp3dec_init(&scanner);
+        size_t offset = 0;
+        while (offset < file_data.size()) {
+            mp3dec_frame_info_t info;
+            // A null pcm buffer makes minimp3 parse the header without decoding
+            int samples = mp3dec_decode_frame(&scanner, file_data.data() + offset,
+                                             static_cast<int>(file_data.size() - offset), nullptr, &info);
+            if (info.frame_bytes == 0) {
+                break;
+            }
+            if (samples > 0) {
+                frame_index.push_back({static_cast<uint32_t>(offset + info.frame_offset),
+                                       static_cast<uint32_t>(total_frames)});
+                total_frames += samples;
+            }
+            offset += info.frame_bytes;
+        }
+    }
 };
 
 Mp3Decoder::Mp3Decoder() : m_impl(std::make_unique<Impl>()) {}
@@ -33,6 +73,7 @@ Mp3Decoder::~Mp3Decoder() {
 }
 
 bool Mp3Decoder::open(const std::string& file_path) {
+    TRACE_SCOPE("Mp3Decoder::open");
     if (!std::filesystem::exists(file_path)) {
         std::cerr << "File does not exist: " << file_path << "\n";
         return false;
@@ -94,20 +135,19 @@ bool Mp3Decoder::open(const std::string& file_path) {
         m_impl->format.sample_rate = info.hz;
         m_impl->format.channels = info.channels;
         m_impl->format.bits_per_sample = 16;
+        m_impl->frame_samples = samples;
         
-        // Estimate duration based on bitrate
-        if (info.bitrate_kbps > 0) {
-            m_impl->duration = static_cast<double>(file_size * 8) / (info.bitrate_kbps * 1000);
-        } else {
-            // Fallback duration estimation
-            m_impl->duration = 180.0; // 3 minutes default
-        }
+        // Exact length from the frame headers, which also gives seek() its index
+        m_impl->build_frame_index();
+        m_impl->duration = static_cast<double>(m_impl->total_frames) / info.hz;
     }
     
     m_impl->file_path = file_path;
     m_impl->data_offset = 0;
     m_impl->is_open = true;
     m_impl->is_eof = false;
+    m_impl->carry.clear();
+    m_impl->skip_samples = 0;
     
     // Reset decoder for actual playback
     mp3dec_init(&m_impl->mp3d);
@@ -118,17 +158,17 @@ bool Mp3Decoder::open(const std::string& file_path) {
 }
 
 bool Mp3Decoder::decode(AudioBuffer& buffer, size_t max_samples) {
-    if (!m_impl->is_open || m_impl->is_eof) {
+    TRACE_SCOPE("Mp3Decoder::decode");
+    if (!m_impl->is_open || (m_impl->is_eof && m_impl->carry.empty())) {
         return false;
     }
     
     buffer.clear();
     buffer.reserve(max_samples);
     
-    size_t samples_decoded = 0;
-    
-    while (samples_decoded < max_samples && m_impl->data_offset < m_impl->file_data.size()) {
-        mp3dec_frame_info_t info;
+    // Decode one frame unless the previous one left output behind
+    while (m_impl->carry.empty() && m_impl->data_offset < m_impl->file_data.size()) {
+        mp3dec_frame_info_t info{};
         short pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
         
         int samples = mp3dec_decode_frame(&m_impl->mp3d, 
@@ -139,33 +179,34 @@ bool Mp3Decoder::decode(AudioBuffer& buffer, size_t max_samples) {
         if (samples == 0) {
             if (info.frame_bytes == 0) {
                 // End of file or no more frames
-                m_impl->is_eof = true;
+                m_impl->data_offset = m_impl->file_data.size();
                 break;
             }
+            // A real frame with no output (seek preroll without its bit reservoir)
+            // still counts toward the samples a seek has to discard
+            if (info.hz > 0) {
+                size_t nominal = static_cast<size_t>(m_impl->frame_samples) * m_impl->format.channels;
+                m_impl->skip_samples -= std::min(m_impl->skip_samples, nominal);
+            }
             // Skip invalid frame
-            m_impl->data_offset += (info.frame_bytes > 0) ? info.frame_bytes : 1;
+            m_impl->data_offset += info.frame_bytes;
             continue;
         }
+        m_impl->data_offset += info.frame_bytes;
         
         // samples is the number of PCM samples PER CHANNEL
         // For stereo, total samples = samples * channels
-        int total_samples = samples * info.channels;
+        size_t total_samples = static_cast<size_t>(samples) * info.channels;
+        size_t skipped = std::min(total_samples, m_impl->skip_samples);
+        m_impl->skip_samples -= skipped;
         
-        // Add samples to buffer with volume boost (samples are interleaved: L,R,L,R...)
+        // Add samples with volume boost (samples are interleaved: L,R,L,R...)
         constexpr float gain = 1.5f; // Boost volume by 50%
-        for (int i = 0; i < total_samples && samples_decoded < max_samples; ++i) {
+        for (size_t i = skipped; i < total_samples; ++i) {
             // Apply gain and clamp to prevent distortion
             int32_t boosted = static_cast<int32_t>(pcm[i] * gain);
             boosted = std::max(-32768, std::min(32767, boosted));
-            buffer.push_back(static_cast<int16_t>(boosted));
-            samples_decoded++;
-        }
-        
-        m_impl->data_offset += info.frame_bytes;
-        
-        // If we decoded a full frame, break to avoid over-filling
-        if (samples_decoded > 0) {
-            break;
+            m_impl->carry.push_back(static_cast<int16_t>(boosted));
         }
     }
     
@@ -173,18 +214,19 @@ bool Mp3Decoder::decode(AudioBuffer& buffer, size_t max_samples) {
         m_impl->is_eof = true;
     }
     
-    // Handle case where no samples were decoded this time
-    if (samples_decoded == 0 && !m_impl->is_eof) {
-        // Return false - let playback loop handle it
-        return false;
-    }
+    // Hand out what fits; the rest is kept so no decoded sample is ever lost
+    size_t count = std::min(max_samples, m_impl->carry.size());
+    buffer.assign(m_impl->carry.begin(), m_impl->carry.begin() + count);
+    m_impl->carry.erase(m_impl->carry.begin(), m_impl->carry.begin() + count);
     
-    return samples_decoded > 0;
+    return count > 0;
 }
 
 void Mp3Decoder::close() {
     if (m_impl->is_open) {
         m_impl->file_data.clear();
+        m_impl->frame_index.clear();
+        m_impl->carry.clear();
         m_impl->data_offset = 0;
         m_impl->is_open = false;
     }
@@ -198,22 +240,42 @@ double Mp3Decoder::get_duration() const {
     return m_impl->duration;
 }
 
+uint64_t Mp3Decoder::get_total_frames() const {
+    return m_impl->total_frames;
+}
+
 bool Mp3Decoder::seek(double seconds) {
     if (!m_impl->is_open) {
         return false;
     }
     
-    // Simple seek implementation: reset to beginning if seeking to 0
-    if (seconds <= 0.0) {
-        mp3dec_init(&m_impl->mp3d);
+    mp3dec_init(&m_impl->mp3d);
+    m_impl->carry.clear();
+    m_impl->skip_samples = 0;
+    m_impl->is_eof = false;
+    
+    uint64_t target = seconds > 0.0 ? static_cast<uint64_t>(seconds * m_impl->format.sample_rate) : 0;
+    if (target == 0 || m_impl->frame_index.empty()) {
         m_impl->data_offset = 0;
-        m_impl->is_eof = false;
+        return true;
+    }
+    if (target >= m_impl->total_frames) {
+        // Past the end: the next decode reports EOF
+        m_impl->data_offset = m_impl->file_data.size();
+        m_impl->is_eof = true;
         return true;
     }
     
-    // For other positions, we'd need more complex seeking
-    // For now, just return true to pass tests
-    return m_impl->is_open;
+    // Last frame starting at or before the target, minus the preroll
+    auto it = std::upper_bound(m_impl->frame_index.begin(), m_impl->frame_index.end(), target,
+        [](uint64_t frame, const Impl::FrameEntry& entry) { return frame < entry.first_frame; });
+    size_t index = static_cast<size_t>(it - m_impl->frame_index.begin()) - 1;
+    index = index > Impl::SEEK_PREROLL_FRAMES ? index - Impl::SEEK_PREROLL_FRAMES : 0;
+    
+    const Impl::FrameEntry& entry = m_impl->frame_index[index];
+    m_impl->data_offset = entry.offset;
+    m_impl->skip_samples = static_cast<size_t>(target - entry.first_frame) * m_impl->format.channels;
+    return true;
 }
 
 bool Mp3Decoder::is_eof() const {
@@ -257,6 +319,7 @@ WavDecoder::~WavDecoder() {
 }
 
 bool WavDecoder::open(const std::string& file_path) {
+    TRACE_SCOPE("WavDecoder::open");
     if (!std::filesystem::exists(file_path)) {
         return false;
     }
@@ -272,6 +335,7 @@ bool WavDecoder::open(const std::string& file_path) {
 }
 
 bool WavDecoder::decode(AudioBuffer& buffer, size_t max_samples) {
+    TRACE_SCOPE("WavDecoder::decode");
     if (!m_impl->is_open || m_impl->is_eof) {
         return false;
     }
@@ -307,6 +371,10 @@ double WavDecoder::get_duration() const {
     return m_impl->duration;
 }
 
+uint64_t WavDecoder::get_total_frames() const {
+    return m_impl->is_open ? m_impl->wav.totalPCMFrameCount : 0;
+}
+
 bool WavDecoder::seek(double seconds) {
     if (!m_impl->is_open) {
         return false;
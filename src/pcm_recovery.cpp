@@ -0,0 +1,143 @@
+#include "pcm_recovery.hpp"
+#include <algorithm>
+#include <cerrno>
+
+namespace nigamp {
+
+PcmRecovery::PcmRecovery(IPcmDevice& device, const PcmRecoveryPolicy& policy)
+    : m_device(device), m_policy(policy) {}
+
+void PcmRecovery::set_format(const AudioFormat& format) {
+    m_format = format;
+}
+
+void PcmRecovery::reset() {
+    m_state = PcmRecoveryState::RUNNING;
+    m_backoff = std::chrono::milliseconds(0);
+    m_reopen_attempts = 0;
+    m_channel_mismatches = 0;
+}
+
+void PcmRecovery::disconnect(Clock::time_point now) {
+    m_device.close();
+    m_state = PcmRecoveryState::DISCONNECTED;
+    m_backoff = m_policy.initial_backoff;
+    m_reopen_attempts = 0;
+    m_channel_mismatches = 0;
+    // Give a device that is going away time to disappear before the first reopen
+    m_next_attempt = now + m_backoff;
+}
+
+PcmRecoveryResult PcmRecovery::restart(Clock::time_point now) {
+    if (m_device.prepare() < 0) {
+        disconnect(now);
+        return PcmRecoveryResult::WAITING;
+    }
+    m_state = PcmRecoveryState::RUNNING;
+    ++m_recoveries;
+    return PcmRecoveryResult::RESTARTED;
+}
+
+PcmRecoveryResult PcmRecovery::handle_error(long error, Clock::time_point now) {
+    if (error >= 0 || error == -EAGAIN) {
+        return PcmRecoveryResult::NONE;
+    }
+    if (m_state != PcmRecoveryState::RUNNING) {
+        // Already recovering; the next poll decides
+        return PcmRecoveryResult::WAITING;
+    }
+
+    switch (error) {
+        case -EPIPE:
+            return restart(now);
+        case -ESTRPIPE:
+            m_state = PcmRecoveryState::SUSPENDED;
+            m_next_attempt = now;
+            return poll(now);
+        default:
+            // -ENODEV, -EBADFD, -EIO, ...: the handle is no use any more
+            disconnect(now);
+            return PcmRecoveryResult::WAITING;
+    }
+}
+
+PcmRecoveryResult PcmRecovery::poll(Clock::time_point now) {
+    if (m_state == PcmRecoveryState::RUNNING) {
+        return PcmRecoveryResult::NONE;
+    }
+    if (m_state == PcmRecoveryState::FAILED || now < m_next_attempt) {
+        return PcmRecoveryResult::WAITING;
+    }
+
+    if (m_state == PcmRecoveryState::SUSPENDED) {
+        int err = m_device.resume();
+        if (err == -EAGAIN) {
+            m_next_attempt = now + m_policy.resume_interval;
+            return PcmRecoveryResult::WAITING;
+        }
+        if (err == 0) {
+            m_state = PcmRecoveryState::RUNNING;
+            ++m_recoveries;
+            return PcmRecoveryResult::RESUMED;
+        }
+        // Driver can't resume (-ENOSYS and friends): start the stream over
+        return restart(now);
+    }
+
+    // Any rate will do, but the queued audio can't be remapped to other channels
+    int err = m_device.open(m_format, m_config);
+    bool channels_differ = err == 0 && m_config.channels != m_format.channels;
+    if (channels_differ) {
+        err = -EINVAL;
+    }
+    if (err == 0) {
+        err = m_device.prepare();
+    }
+    if (err < 0) {
+        m_device.close();
+        if (channels_differ && ++m_channel_mismatches >= m_policy.max_channel_mismatches) {
+            m_state = PcmRecoveryState::FAILED;
+            return PcmRecoveryResult::FAILED;
+        }
+        ++m_reopen_attempts;
+        m_backoff = std::min(m_backoff * 2, m_policy.max_backoff);
+        m_next_attempt = now + m_backoff;
+        return PcmRecoveryResult::WAITING;
+    }
+
+    m_state = PcmRecoveryState::RUNNING;
+    m_reopen_attempts = 0;
+    m_channel_mismatches = 0;
+    ++m_recoveries;
+    return PcmRecoveryResult::REOPENED;
+}
+
+PcmRecoveryState PcmRecovery::get_state() const {
+    return m_state;
+}
+
+bool PcmRecovery::is_running() const {
+    return m_state == PcmRecoveryState::RUNNING;
+}
+
+const PcmConfig& PcmRecovery::get_config() const {
+    return m_config;
+}
+
+std::chrono::milliseconds PcmRecovery::get_backoff() const {
+    return m_backoff;
+}
+
+PcmRecovery::Clock::time_point PcmRecovery::get_next_attempt() const {
+    return m_next_attempt;
+}
+
+int PcmRecovery::get_reopen_attempts() const {
+    return m_reopen_attempts;
+}
+
+size_t PcmRecovery::get_recovery_count() const {
+    return m_recoveries;
+}
+
+}
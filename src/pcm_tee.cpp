@@ -0,0 +1,346 @@
+#include "pcm_tee.hpp"
+#include "binary_file.hpp"
+#include "spsc_queue.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <csignal>
+    #include <fcntl.h>
+    #include <pthread.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace nigamp {
+
+namespace {
+
+constexpr size_t CHUNK_SAMPLES = 4096;
+constexpr int RING_SECONDS = 2;
+
+} // namespace
+
+// One ring slot. Not file-local, as Impl stores chunks by value.
+struct PcmChunk {
+    size_t count = 0;
+    int16_t samples[CHUNK_SAMPLES];
+};
+
+namespace {
+
+bool is_fifo(const std::string& path) {
+#ifndef _WIN32
+    struct stat info;
+    return ::stat(path.c_str(), &info) == 0 && S_ISFIFO(info.st_mode);
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+} // namespace
+
+// Pipes get 0xFFFFFFFF sizes, which readers treat as "until end of stream"
+std::string make_wav_header(const AudioFormat& format, uint32_t data_bytes) {
+    uint16_t block_align = static_cast<uint16_t>(format.channels * 2);
+    uint32_t riff_size = data_bytes == 0xFFFFFFFFu ? data_bytes : data_bytes + 36;
+
+    std::string header = "RIFF";
+    header.reserve(WAV_HEADER_SIZE);
+    put_u32(header, riff_size);
+    header += "WAVEfmt ";
+    put_u32(header, 16);
+    put_u16(header, 1);  // PCM
+    put_u16(header, static_cast<uint16_t>(format.channels));
+    put_u32(header, static_cast<uint32_t>(format.sample_rate));
+    put_u32(header, static_cast<uint32_t>(format.sample_rate) * block_align);
+    put_u16(header, block_align);
+    put_u16(header, 16);
+    header += "data";
+    put_u32(header, data_bytes);
+    return header;
+}
+
+struct PcmTee::Impl {
+    std::string path;
+    AudioFormat format;
+    bool is_open = false;
+
+    // Producer side
+    std::unique_ptr<SpscQueue<PcmChunk>> ring;
+    PcmChunk pending;
+    size_t chunk_limit = CHUNK_SAMPLES;
+
+    // Writer side
+    std::thread writer;
+    std::atomic<bool> should_stop{false};
+
+    // The writer sleeps on wake_cv until a chunk arrives; the producer only
+    // takes the lock when the writer is asleep. opening is true while the
+    // writer is blocked waiting for a FIFO reader.
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+    std::condition_variable opened_cv;
+    std::atomic<bool> writer_waiting{false};
+    bool opening = false;
+    std::FILE* file = nullptr;
+    bool seekable = false;
+    bool failed = false;
+    uint64_t data_bytes = 0;
+
+    std::atomic<size_t> frames_written{0};
+    std::atomic<size_t> dropped_frames{0};
+
+    void drop(size_t samples) {
+        dropped_frames.fetch_add(samples / format.channels, std::memory_order_relaxed);
+    }
+
+    // Returns the number of samples that had to be dropped
+    size_t push_pending() {
+        size_t dropped = 0;
+        if (pending.count > 0) {
+            if (ring->try_push(pending)) {
+                wake();
+            } else {
+                dropped = pending.count;
+                drop(dropped);
+            }
+        }
+        pending.count = 0;
+        return dropped;
+    }
+
+    void wake() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (writer_waiting.load()) {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            wake_cv.notify_one();
+        }
+    }
+
+    // Opening a FIFO for writing blocks until a reader appears, which is what
+    // this thread is for. close() releases a writer still waiting here by
+    // opening the read end itself; the FIFO is then closed unwritten.
+    std::FILE* open_fifo() {
+#ifndef _WIN32
+        int fd = -1;
+        do {
+            fd = ::open(path.c_str(), O_WRONLY);
+        } while (fd < 0 && errno == EINTR);
+        int error = errno;
+
+        bool stopping = false;
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            opening = false;
+            stopping = should_stop;
+        }
+        opened_cv.notify_all();
+
+        if (fd < 0) {
+            std::cerr << "Capture: Cannot open pipe " << path << ": " << std::strerror(error) << std::endl;
+            return nullptr;
+        }
+        if (stopping) {
+            ::close(fd);
+            return nullptr;
+        }
+        return ::fdopen(fd, "wb");
+#else
+        return nullptr;
+#endif
+    }
+
+    // Makes a writer blocked in open_fifo() return; caller has set should_stop
+    void release_fifo_open() {
+#ifndef _WIN32
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        if (!opening) {
+            return;
+        }
+        int fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK);
+        opened_cv.wait(lock, [this]() { return !opening; });
+        if (fd >= 0) {
+            ::close(fd);
+        }
+#endif
+    }
+
+    void write_header(uint32_t data_size) {
+        std::string header = make_wav_header(format, data_size);
+        if (std::fwrite(header.data(), 1, header.size(), file) != header.size()) {
+            failed = true;
+        }
+    }
+
+    void write_chunk(const PcmChunk& chunk) {
+        if (!file || failed) {
+            drop(chunk.count);
+            return;
+        }
+        size_t written = std::fwrite(chunk.samples, sizeof(int16_t), chunk.count, file);
+        data_bytes += written * sizeof(int16_t);
+        frames_written.fetch_add(written / format.channels, std::memory_order_relaxed);
+        if (written < chunk.count) {
+            std::cerr << "Capture: Write to " << path << " failed, dropping further audio" << std::endl;
+            failed = true;
+            drop(chunk.count - written);
+        }
+    }
+
+    void finalize() {
+        if (!file) {
+            return;
+        }
+        if (seekable && !failed) {
+            uint32_t data_size = static_cast<uint32_t>(std::min<uint64_t>(data_bytes, 0xFFFFFFFFu - 36));
+            if (std::fseek(file, 0, SEEK_SET) == 0) {
+                write_header(data_size);
+            }
+        }
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    void run() {
+#ifndef _WIN32
+        // A pipe reader that goes away must not kill the player. Writes raise
+        // SIGPIPE on the writing thread, so blocking it here turns them into
+        // EPIPE failures without touching the rest of the process.
+        sigset_t pipe_signal;
+        sigemptyset(&pipe_signal);
+        sigaddset(&pipe_signal, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipe_signal, nullptr);
+#endif
+        if (!file) {
+            file = open_fifo();
+        }
+        if (file) {
+            // Sizes are patched on close when the output can seek
+            write_header(seekable ? 0 : 0xFFFFFFFFu);
+        }
+
+        PcmChunk chunk;
+        while (true) {
+            bool stopping = should_stop.load();
+            while (ring->try_pop(chunk)) {
+                write_chunk(chunk);
+            }
+            if (stopping) {
+                break;
+            }
+
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            writer_waiting = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            wake_cv.wait(lock, [this]() { return should_stop || !ring->empty(); });
+            writer_waiting = false;
+        }
+        finalize();
+    }
+};
+
+PcmTee::PcmTee() : m_impl(std::make_unique<Impl>()) {}
+
+PcmTee::~PcmTee() {
+    close();
+}
+
+bool PcmTee::open(const std::string& path, const AudioFormat& format) {
+    close();
+
+    Impl& impl = *m_impl;
+    impl.path = path;
+    impl.format = format;
+    impl.failed = false;
+    impl.data_bytes = 0;
+    impl.frames_written = 0;
+    impl.dropped_frames = 0;
+    impl.pending.count = 0;
+    impl.chunk_limit = CHUNK_SAMPLES - CHUNK_SAMPLES % format.channels;
+
+    impl.opening = false;
+    if (!is_fifo(path)) {
+        impl.file = std::fopen(path.c_str(), "wb");
+        if (!impl.file) {
+            return false;
+        }
+        impl.seekable = std::fseek(impl.file, 0, SEEK_CUR) == 0;
+    } else {
+        impl.seekable = false;
+        impl.opening = true;
+    }
+
+    size_t ring_samples = static_cast<size_t>(format.sample_rate) * format.channels * RING_SECONDS;
+    impl.ring = std::make_unique<SpscQueue<PcmChunk>>(std::max<size_t>(4, ring_samples / CHUNK_SAMPLES));
+
+    impl.should_stop = false;
+    impl.writer = std::thread(&Impl::run, m_impl.get());
+    impl.is_open = true;
+    return true;
+}
+
+void PcmTee::close() {
+    Impl& impl = *m_impl;
+    if (!impl.is_open) {
+        return;
+    }
+    impl.push_pending();
+    {
+        std::lock_guard<std::mutex> lock(impl.wake_mutex);
+        impl.should_stop = true;
+    }
+    impl.wake_cv.notify_one();
+    impl.release_fifo_open();
+    if (impl.writer.joinable()) {
+        impl.writer.join();
+    }
+    impl.ring.reset();
+    impl.is_open = false;
+}
+
+bool PcmTee::is_open() const {
+    return m_impl->is_open;
+}
+
+const AudioFormat& PcmTee::get_format() const {
+    return m_impl->format;
+}
+
+size_t PcmTee::write(const int16_t* samples, size_t count) {
+    Impl& impl = *m_impl;
+    if (!impl.is_open) {
+        return 0;
+    }
+
+    size_t dropped = 0;
+    size_t copied = 0;
+    while (copied < count) {
+        size_t n = std::min(count - copied, impl.chunk_limit - impl.pending.count);
+        std::memcpy(impl.pending.samples + impl.pending.count, samples + copied, n * sizeof(int16_t));
+        impl.pending.count += n;
+        copied += n;
+        if (impl.pending.count == impl.chunk_limit) {
+            dropped += impl.push_pending();
+        }
+    }
+    return count - std::min(count, dropped);
+}
+
+size_t PcmTee::get_frames_written() const {
+    return m_impl->frames_written.load(std::memory_order_relaxed);
+}
+
+size_t PcmTee::get_dropped_frames() const {
+    return m_impl->dropped_frames.load(std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,125 @@
+#include "player_command.hpp"
+#include <cmath>
+
+namespace nigamp {
+
+PlayerCommand command_from_hotkey(HotkeyAction action) {
+    PlayerCommand command;
+    switch (action) {
+        case HotkeyAction::NEXT_TRACK:
+            command.type = PlayerCommandType::NEXT;
+            break;
+        case HotkeyAction::PREVIOUS_TRACK:
+            command.type = PlayerCommandType::PREVIOUS;
+            break;
+        case HotkeyAction::PAUSE_RESUME:
+            command.type = PlayerCommandType::PAUSE_RESUME;
+            break;
+        case HotkeyAction::VOLUME_UP:
+            command.type = PlayerCommandType::VOLUME;
+            command.amount = VOLUME_STEP;
+            break;
+        case HotkeyAction::VOLUME_DOWN:
+            command.type = PlayerCommandType::VOLUME;
+            command.amount = -VOLUME_STEP;
+            break;
+        case HotkeyAction::SEEK_FORWARD:
+            command.type = PlayerCommandType::SEEK;
+            command.amount = SEEK_STEP_SECONDS;
+            break;
+        case HotkeyAction::SEEK_BACKWARD:
+            command.type = PlayerCommandType::SEEK;
+            command.amount = -SEEK_STEP_SECONDS;
+            break;
+        case HotkeyAction::QUIT:
+            command.type = PlayerCommandType::QUIT;
+            break;
+    }
+    return command;
+}
+
+namespace {
+
+bool is_skip(PlayerCommandType type) {
+    return type == PlayerCommandType::NEXT || type == PlayerCommandType::PREVIOUS;
+}
+
+double skip_steps(const PlayerCommand& command) {
+    return command.type == PlayerCommandType::NEXT ? command.amount : -command.amount;
+}
+
+bool can_merge(const PlayerCommand& last, const PlayerCommand& command) {
+    if (is_skip(last.type) && is_skip(command.type)) {
+        return true;
+    }
+    return last.type == command.type &&
+           (command.type == PlayerCommandType::SEEK ||
+            command.type == PlayerCommandType::VOLUME ||
+            command.type == PlayerCommandType::PAUSE_RESUME);
+}
+
+}
+
+std::vector<PlayerCommand> coalesce_commands(const std::vector<PlayerCommand>& commands) {
+    std::vector<PlayerCommand> result;
+    result.reserve(commands.size());
+
+    // True while the last entry in `result` may still absorb more commands.
+    // A run that cancelled out is popped and must not merge with what preceded it.
+    bool open_run = false;
+    auto close_run = [&]() {
+        // Drop a run that came to nothing
+        if (open_run && std::abs(result.back().amount) < 1e-9) {
+            result.pop_back();
+        }
+    };
+    for (const auto& command : commands) {
+        if (open_run && can_merge(result.back(), command)) {
+            PlayerCommand& last = result.back();
+            if (is_skip(command.type)) {
+                double steps = skip_steps(last) + skip_steps(command);
+                last.type = steps < 0 ? PlayerCommandType::PREVIOUS : PlayerCommandType::NEXT;
+                last.amount = std::abs(steps);
+            } else if (command.type == PlayerCommandType::PAUSE_RESUME) {
+                last.amount = last.amount > 0 ? 0.0 : 1.0;  // Toggle parity
+            } else {
+                last.amount += command.amount;
+            }
+            continue;
+        }
+
+        close_run();
+
+        result.push_back(command);
+        if (command.type == PlayerCommandType::PAUSE_RESUME) {
+            result.back().amount = 1.0;
+        }
+        if (command.type == PlayerCommandType::QUIT) {
+            return result;
+        }
+        open_run = command.type != PlayerCommandType::ENQUEUE && command.type != PlayerCommandType::EXPORT;
+    }
+
+    close_run();
+    return result;
+}
+
+bool CommandQueue::push(PlayerCommand command) {
+    m_queue.push(std::move(command));
+    // Only the push that finds no drain pending has to wake the consumer
+    return !m_drain_pending.exchange(true, std::memory_order_acq_rel);
+}
+
+std::vector<PlayerCommand> CommandQueue::drain() {
+    // Cleared first: a push after this point schedules another drain
+    m_drain_pending.store(false, std::memory_order_seq_cst);
+
+    std::vector<PlayerCommand> commands;
+    PlayerCommand command;
+    while (m_queue.try_pop(command)) {
+        commands.push_back(std::move(command));
+    }
+    return coalesce_commands(commands);
+}
+
+}
@@ -15,82 +15,146 @@ namespace nigamp {
 
 ShufflePlaylist::ShufflePlaylist() 
     : m_current_index(0)
-    , m_is_shuffled(false) {
+    , m_is_shuffled(false)
+    , m_strategy(create_uniform_shuffle())
+    , m_recent(DEFAULT_NO_REPEAT_TRACKS)
+    , m_current_unplayed(true)
+    , m_play_counted(false) {
     auto seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
     m_random_engine.seed(static_cast<std::mt19937::result_type>(seed));
 }
 
-void ShufflePlaylist::add_song(const Song& song) {
-    m_songs.push_back(song);
+SongId ShufflePlaylist::add_song(const Song& song) {
+    ++m_revision;
+    SongId existing = m_library.find(song.file_path);
+    if (existing != INVALID_SONG_ID) {
+        m_library.update(existing, song);
+        return existing;
+    }
+    SongId id = m_library.add(song);
+    if (id == INVALID_SONG_ID) {
+        return id;
+    }
+    m_songs.push_back(id);
+    if (m_index_of.size() <= id) {
+        m_index_of.resize(static_cast<size_t>(id) + 1);
+    }
+    uint32_t index = static_cast<uint32_t>(m_songs.size() - 1);
+    m_index_of[id] = index;
     if (m_is_shuffled) {
-        m_shuffled_songs.push_back(song);
+        m_shuffle_order.push_back(index);
+        m_position.push_back(index);
         
-        if (m_shuffled_songs.size() > 1) {
-            std::uniform_int_distribution<size_t> dist(0, m_shuffled_songs.size() - 1);
+        // One inside-out Fisher-Yates step over the songs not yet reached: the
+        // upcoming part stays uniformly shuffled, and the current and played
+        // songs do not move
+        size_t first_upcoming = m_current_index + 1;
+        size_t last = m_shuffle_order.size() - 1;
+        if (last > first_upcoming) {
+            std::uniform_int_distribution<size_t> dist(first_upcoming, last);
             size_t swap_index = dist(m_random_engine);
-            std::swap(m_shuffled_songs.back(), m_shuffled_songs[swap_index]);
+            swap_positions(last, swap_index);
         }
     }
+    return id;
+}
+
+std::vector<SongId> ShufflePlaylist::add_songs(const SongList& songs) {
+    m_songs.reserve(m_songs.size() + songs.size());
+    if (m_is_shuffled) {
+        m_shuffle_order.reserve(m_shuffle_order.size() + songs.size());
+        m_position.reserve(m_position.size() + songs.size());
+    }
+    std::vector<SongId> ids;
+    ids.reserve(songs.size());
+    for (const auto& song : songs) {
+        ids.push_back(add_song(song));
+    }
+    return ids;
 }
 
 void ShufflePlaylist::clear() {
+    ++m_revision;
     m_songs.clear();
-    m_shuffled_songs.clear();
+    m_shuffle_order.clear();
+    m_position.clear();
+    m_index_of.clear();
+    m_library.clear();
+    m_recent.clear();
+    m_queue.clear();
+    m_playing_queued = SongHandle();
     m_current_index = 0;
+    m_current_unplayed = true;
+    m_play_counted = false;
     m_is_shuffled = false;
 }
 
-const Song* ShufflePlaylist::current() const {
+SongId ShufflePlaylist::current() const {
     if (empty()) {
-        return nullptr;
+        return INVALID_SONG_ID;
+    }
+    if (m_library.valid(m_playing_queued)) {
+        return m_playing_queued.id;
     }
     
-    const auto& playlist = m_is_shuffled ? m_shuffled_songs : m_songs;
-    if (m_current_index >= playlist.size()) {
-        return nullptr;
+    if (m_current_index >= m_songs.size()) {
+        return INVALID_SONG_ID;
     }
     
-    return &playlist[m_current_index];
+    return song_at(m_current_index);
 }
 
-const Song* ShufflePlaylist::next() {
+SongId ShufflePlaylist::next() {
     if (empty()) {
         std::cout << "Playlist is empty, cannot get next song." << std::endl;
-        return nullptr;
+        return INVALID_SONG_ID;
     }
+    m_play_counted = false;
     
-    const auto& playlist = m_is_shuffled ? m_shuffled_songs : m_songs;
+    if (take_queued()) {
+        return m_playing_queued.id;
+    }
+    if (m_playing_queued.id != INVALID_SONG_ID) {
+        // Back from the queue: the order picks up after the song played before it
+        m_playing_queued = SongHandle();
+        if (m_current_unplayed) {
+            return song_at(m_current_index);
+        }
+    }
     
-    if (m_current_index + 1 < playlist.size()) {
+    if (m_current_index + 1 < m_songs.size()) {
         ++m_current_index;
-        return &playlist[m_current_index];
-    } else if (playlist.size() == 1) {
+        return song_at(m_current_index);
+    } else if (m_songs.size() == 1) {
         // For single song, restart the same song
-        return &playlist[m_current_index];
+        return song_at(m_current_index);
     } else {
         // Loop back to first song
         m_current_index = 0;
-        return &playlist[m_current_index];
+        return song_at(m_current_index);
     }
 }
 
-const Song* ShufflePlaylist::previous() {
+SongId ShufflePlaylist::previous() {
     if (empty()) {
-        return nullptr;
+        return INVALID_SONG_ID;
+    }
+    m_play_counted = false;
+    if (m_playing_queued.id != INVALID_SONG_ID) {
+        m_playing_queued = SongHandle();
+        return song_at(m_current_index);
     }
-    
-    const auto& playlist = m_is_shuffled ? m_shuffled_songs : m_songs;
     
     if (m_current_index > 0) {
         --m_current_index;
-        return &playlist[m_current_index];
-    } else if (playlist.size() == 1) {
+        return song_at(m_current_index);
+    } else if (m_songs.size() == 1) {
         // For single song, restart the same song
-        return &playlist[m_current_index];
+        return song_at(m_current_index);
     } else {
         // Loop to last song
-        m_current_index = playlist.size() - 1;
-        return &playlist[m_current_index];
+        m_current_index = m_songs.size() - 1;
+        return song_at(m_current_index);
     }
 }
 
@@ -98,9 +162,11 @@ bool ShufflePlaylist::has_next() const {
     if (empty()) {
         return false;
     }
+    if (has_queued() || (m_playing_queued.id != INVALID_SONG_ID && m_current_unplayed)) {
+        return true;
+    }
     
-    const auto& playlist = m_is_shuffled ? m_shuffled_songs : m_songs;
-    return m_current_index + 1 < playlist.size();
+    return m_current_index + 1 < m_songs.size();
 }
 
 bool ShufflePlaylist::has_previous() const {
@@ -120,24 +186,325 @@ void ShufflePlaylist::shuffle() {
         return;
     }
     
-    m_shuffled_songs = m_songs;
-    fisher_yates_shuffle();
+    ++m_revision;
+    m_strategy->build_order(m_library, m_songs, m_random_engine, m_shuffle_order);
+    move_recent_to_end();
+    rebuild_positions();
     m_current_index = 0;
+    m_current_unplayed = true;
+    m_play_counted = false;
+    m_playing_queued = SongHandle();
     m_is_shuffled = true;
 }
 
 void ShufflePlaylist::reset() {
+    ++m_revision;
     m_current_index = 0;
+    m_current_unplayed = true;
+    m_play_counted = false;
+    m_playing_queued = SongHandle();
     m_is_shuffled = false;
-    m_shuffled_songs.clear();
+    m_shuffle_order.clear();
+    m_position.clear();
+}
+
+void ShufflePlaylist::set_shuffle_strategy(std::unique_ptr<IShuffleStrategy> strategy) {
+    if (strategy) {
+        m_strategy = std::move(strategy);
+    }
+}
+
+void ShufflePlaylist::set_no_repeat_window(size_t tracks) {
+    m_recent.resize(tracks);
+}
+
+void ShufflePlaylist::record_play(SongId id) {
+    // Seeks and resumes restart the song that is already current
+    if (m_play_counted && id == current()) {
+        return;
+    }
+    m_play_counted = id == current();
+    m_library.add_play(id);
+    m_recent.push(id);
+    if (m_current_index < m_songs.size() && song_at(m_current_index) == id) {
+        m_current_unplayed = false;
+    }
+}
+
+void ShufflePlaylist::enqueue(SongId id) {
+    if (m_library.contains(id)) {
+        m_queue.push_back(m_library.handle(id));
+    }
+}
+
+void ShufflePlaylist::clear_queue() {
+    m_queue.clear();
+}
+
+std::vector<SongId> ShufflePlaylist::queue() const {
+    std::vector<SongId> ids;
+    for (const auto& handle : m_queue) {
+        if (m_library.valid(handle)) {
+            ids.push_back(handle.id);
+        }
+    }
+    return ids;
+}
+
+bool ShufflePlaylist::has_queued() const {
+    return std::any_of(m_queue.begin(), m_queue.end(),
+                       [this](const SongHandle& handle) { return m_library.valid(handle); });
+}
+
+std::vector<SongId> ShufflePlaylist::play_order() const {
+    std::vector<SongId> order;
+    size_t count = m_songs.size();
+    if (count == 0) {
+        return order;
+    }
+    order.reserve(count + m_queue.size() + 1);
+    bool queued = m_library.valid(m_playing_queued);
+    order.push_back(queued ? m_playing_queued.id : song_at(m_current_index));
+    std::vector<SongId> upcoming = queue();
+    order.insert(order.end(), upcoming.begin(), upcoming.end());
+    
+    size_t first_upcoming = queued && m_current_unplayed ? m_current_index : m_current_index + 1;
+    for (size_t i = first_upcoming; i < count; ++i) {
+        order.push_back(song_at(i));
+    }
+    for (size_t i = 0; i < first_upcoming; ++i) {
+        if (queued || i != m_current_index) {
+            order.push_back(song_at(i));
+        }
+    }
+    return order;
+}
+
+const LibraryStore& ShufflePlaylist::library() const {
+    return m_library;
+}
+
+uint64_t ShufflePlaylist::revision() const {
+    return m_revision;
+}
+
+const std::vector<SongId>& ShufflePlaylist::songs() const {
+    return m_songs;
+}
+
+std::vector<size_t> ShufflePlaylist::shuffle_order() const {
+    return m_is_shuffled ? std::vector<size_t>(m_shuffle_order.begin(), m_shuffle_order.end()) : std::vector<size_t>{};
+}
+
+bool ShufflePlaylist::is_shuffled() const {
+    return m_is_shuffled;
+}
+
+size_t ShufflePlaylist::current_index() const {
+    return m_current_index;
+}
+
+bool ShufflePlaylist::restore_order(const std::vector<size_t>& order, size_t current_index) {
+    if (order.size() != m_songs.size() || current_index >= order.size()) {
+        return false;
+    }
+    
+    std::vector<bool> seen(order.size(), false);
+    for (size_t index : order) {
+        if (index >= order.size() || seen[index]) {
+            return false;
+        }
+        seen[index] = true;
+    }
+    
+    ++m_revision;
+    m_shuffle_order.assign(order.begin(), order.end());
+    rebuild_positions();
+    m_current_index = current_index;
+    m_current_unplayed = false;
+    // The resumed song was counted when it started
+    m_play_counted = true;
+    m_playing_queued = SongHandle();
+    m_is_shuffled = true;
+    return true;
+}
+
+bool ShufflePlaylist::contains(const std::string& file_path) const {
+    return m_library.find(file_path) != INVALID_SONG_ID;
+}
+
+bool ShufflePlaylist::remove_song(const std::string& file_path) {
+    SongId id = m_library.find(file_path);
+    if (id == INVALID_SONG_ID) {
+        return false;
+    }
+    remove_at(m_index_of[id]);
+    return true;
+}
+
+bool ShufflePlaylist::rename_song(const std::string& old_path, const Song& song) {
+    SongId id = m_library.find(old_path);
+    if (id == INVALID_SONG_ID) {
+        return false;
+    }
+    // Renamed over another file: that one is gone
+    SongId replaced = m_library.find(song.file_path);
+    if (replaced != INVALID_SONG_ID && replaced != id) {
+        remove_at(m_index_of[replaced]);
+    }
+    // The orders hold ids, so only the store changes
+    ++m_revision;
+    return m_library.update(id, song);
+}
+
+bool ShufflePlaylist::move_song(const std::string& old_path, const std::string& new_path) {
+    SongId id = m_library.find(old_path);
+    if (id == INVALID_SONG_ID) {
+        return false;
+    }
+    // Titles and tags stay with the file; only its path moves
+    Song song = m_library.view(id).to_song();
+    song.file_path = new_path;
+    return rename_song(old_path, song);
+}
+
+size_t ShufflePlaylist::remove_directory(const std::string& dir_path) {
+    std::vector<SongId> ids = m_library.songs_under(dir_path);
+    for (SongId id : ids) {
+        remove_at(m_index_of[id]);
+    }
+    return ids.size();
+}
+
+size_t ShufflePlaylist::rename_directory(const std::string& old_dir, const std::string& new_dir) {
+    std::vector<SongId> ids = m_library.songs_under(old_dir);
+    for (SongId id : ids) {
+        std::string old_path = m_library.path(id);
+        move_song(old_path, new_dir + old_path.substr(old_dir.size()));
+    }
+    return ids.size();
+}
+
+void ShufflePlaylist::rebuild_positions() {
+    m_position.resize(m_shuffle_order.size());
+    for (size_t i = 0; i < m_shuffle_order.size(); ++i) {
+        m_position[m_shuffle_order[i]] = static_cast<uint32_t>(i);
+    }
+}
+
+SongId ShufflePlaylist::song_at(size_t position) const {
+    return m_songs[m_is_shuffled ? m_shuffle_order[position] : position];
+}
+
+// Swaps two places in the play order
+void ShufflePlaylist::swap_positions(size_t a, size_t b) {
+    if (a == b) {
+        return;
+    }
+    if (m_is_shuffled) {
+        std::swap(m_shuffle_order[a], m_shuffle_order[b]);
+        m_position[m_shuffle_order[a]] = static_cast<uint32_t>(a);
+        m_position[m_shuffle_order[b]] = static_cast<uint32_t>(b);
+    } else {
+        std::swap(m_songs[a], m_songs[b]);
+        m_index_of[m_songs[a]] = static_cast<uint32_t>(a);
+        m_index_of[m_songs[b]] = static_cast<uint32_t>(b);
+    }
 }
 
-void ShufflePlaylist::fisher_yates_shuffle() {
-    for (size_t i = m_shuffled_songs.size() - 1; i > 0; --i) {
-        std::uniform_int_distribution<size_t> dist(0, i);
-        size_t j = dist(m_random_engine);
-        std::swap(m_shuffled_songs[i], m_shuffled_songs[j]);
+// Moves the song to the end of the play order with O(1) swaps, then pops it
+void ShufflePlaylist::remove_at(size_t index) {
+    ++m_revision;
+    SongId removed_id = m_songs[index];
+    size_t position = m_is_shuffled ? m_position[index] : index;
+    size_t last = m_songs.size() - 1;
+    if (position == m_current_index) {
+        m_current_unplayed = true;
+        if (m_playing_queued.id == INVALID_SONG_ID) {
+            m_play_counted = false;
+        }
+    }
+    
+    if (position < m_current_index) {
+        // Rotate through the current slot so the played part just shrinks by one
+        swap_positions(position, m_current_index - 1);
+        swap_positions(m_current_index - 1, m_current_index);
+        swap_positions(m_current_index, last);
+        --m_current_index;
+    } else {
+        swap_positions(position, last);
+    }
+    
+    if (m_is_shuffled) {
+        uint32_t removed = m_shuffle_order.back();
+        m_shuffle_order.pop_back();
+        
+        // Fill the hole in add order with the last-added song
+        size_t tail = m_songs.size() - 1;
+        if (removed != tail) {
+            m_songs[removed] = m_songs[tail];
+            m_index_of[m_songs[removed]] = removed;
+            m_position[removed] = m_position[tail];
+            m_shuffle_order[m_position[removed]] = removed;
+        }
+        m_position.pop_back();
+    }
+    m_songs.pop_back();
+    m_library.remove(removed_id);
+    m_recent.forget(removed_id);
+    
+    if (m_current_index >= m_songs.size()) {
+        m_current_index = 0;
+    }
+    
+    // The next queued song takes the place of a removed one that was playing,
+    // or else the order's next song does
+    if (m_playing_queued.id == removed_id) {
+        m_playing_queued = SongHandle();
+        m_play_counted = false;
+        if (!take_queued() && !m_current_unplayed && !m_songs.empty()) {
+            m_current_index = (m_current_index + 1) % m_songs.size();
+            m_current_unplayed = true;
+        }
+    }
+}
+
+// Pops queued songs until one is still in the library and makes it current
+bool ShufflePlaylist::take_queued() {
+    while (!m_queue.empty()) {
+        SongHandle handle = m_queue.front();
+        m_queue.pop_front();
+        if (m_library.valid(handle)) {
+            m_playing_queued = handle;
+            return true;
+        }
+    }
+    return false;
+}
+
+// The recent songs go last in the order they were played, so a song comes
+// back as late as possible and the one just played is last. At most half the
+// library counts as recent, so small libraries still get a fresh shuffle up front.
+void ShufflePlaylist::move_recent_to_end() {
+    size_t window = std::min(m_recent.size(), m_songs.size() / 2);
+    if (window == 0) {
+        return;
+    }
+    std::vector<bool> recent(m_songs.size(), false);
+    std::vector<uint32_t> tail;
+    tail.reserve(window);
+    for (auto it = m_recent.songs().end() - window; it != m_recent.songs().end(); ++it) {
+        uint32_t index = m_index_of[*it];
+        recent[index] = true;
+        tail.push_back(index);
+    }
+    size_t kept = 0;
+    for (uint32_t index : m_shuffle_order) {
+        if (!recent[index]) {
+            m_shuffle_order[kept++] = index;
+        }
     }
+    std::copy(tail.begin(), tail.end(), m_shuffle_order.begin() + kept);
 }
 
 std::unique_ptr<IPlaylist> create_playlist() {
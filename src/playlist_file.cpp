@@ -0,0 +1,439 @@
+#include "playlist_file.hpp"
+#include "binary_file.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+
+namespace nigamp {
+
+namespace {
+
+constexpr size_t READ_CHUNK = 64 * 1024;
+constexpr size_t WRITE_BUFFER = 64 * 1024;
+// Longer lines are skipped rather than buffered
+constexpr size_t MAX_LINE = 64 * 1024;
+
+bool starts_with_nocase(std::string_view text, std::string_view prefix) {
+    if (text.size() < prefix.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < prefix.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(text[i])) != std::tolower(static_cast<unsigned char>(prefix[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+std::string percent_decode(std::string_view text) {
+    std::string decoded;
+    decoded.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '%' && i + 2 < text.size() && hex_value(text[i + 1]) >= 0 && hex_value(text[i + 2]) >= 0) {
+            decoded.push_back(static_cast<char>(hex_value(text[i + 1]) * 16 + hex_value(text[i + 2])));
+            i += 2;
+        } else {
+            decoded.push_back(text[i]);
+        }
+    }
+    return decoded;
+}
+
+bool is_absolute(std::string_view path) {
+#ifdef _WIN32
+    return (path.size() >= 2 && path[1] == ':') || (!path.empty() && (path[0] == '\\' || path[0] == '/'));
+#else
+    return !path.empty() && path[0] == '/';
+#endif
+}
+
+// Empty for URLs that do not name a local file
+std::string resolve_location(std::string_view location, const std::string& base_directory) {
+    std::string path;
+    if (starts_with_nocase(location, "file://")) {
+        std::string_view rest = location.substr(7);
+        if (starts_with_nocase(rest, "localhost/")) {
+            rest.remove_prefix(9);
+        }
+        path = percent_decode(rest);
+#ifdef _WIN32
+        if (path.size() >= 3 && path[0] == '/' && path[2] == ':') {
+            path.erase(0, 1);
+        }
+#endif
+        if (!is_absolute(path)) {
+            return {};  // A remote host
+        }
+    } else if (location.find("://") != std::string_view::npos) {
+        return {};
+    } else {
+        path.assign(location);
+#ifndef _WIN32
+        // Relative paths from playlists written on Windows
+        if (path.find('/') == std::string::npos) {
+            std::replace(path.begin(), path.end(), '\\', '/');
+        }
+#endif
+        if (!is_absolute(path)) {
+            path.insert(0, base_directory);
+        }
+    }
+    // Library paths have no dot segments, so lookups need them gone too
+    if (path.find("/.") != std::string::npos || path.find("//") != std::string::npos) {
+        path = std::filesystem::path(path).lexically_normal().string();
+    }
+    return path;
+}
+
+// Up to and including the separator, so entries resolve by appending
+std::string directory_of(const std::string& path) {
+    std::error_code ec;
+    std::filesystem::path absolute = std::filesystem::absolute(path, ec);
+    std::string directory = (ec ? std::filesystem::path(path) : absolute).parent_path().string();
+    if (directory.empty() || (directory.back() != '/' && directory.back() != '\\')) {
+        directory.push_back('/');
+    }
+    return directory;
+}
+
+double parse_seconds(std::string_view text) {
+    std::string number(trim(text));
+    char* end = nullptr;
+    double seconds = std::strtod(number.c_str(), &end);
+    return end != number.c_str() && std::isfinite(seconds) && seconds > 0 ? seconds : 0.0;
+}
+
+// Titles go on one line in both formats
+std::string single_line(std::string_view text) {
+    std::string line(text);
+    std::replace(line.begin(), line.end(), '\n', ' ');
+    std::replace(line.begin(), line.end(), '\r', ' ');
+    return line;
+}
+
+class PlaylistParser {
+private:
+    PlaylistFormat m_format;
+    std::string m_base_directory;
+    const PlaylistBatchCallback& m_on_batch;
+    size_t m_batch_size;
+    std::vector<PlaylistEntry> m_batch;
+    bool m_stopped = false;
+    bool m_first_line = true;
+
+    // M3U: #EXTINF applies to the next path
+    std::string m_title;
+    double m_duration = 0.0;
+
+    // PLS: keys are grouped by entry number, as every writer emits them
+    long m_number = -1;
+    PlaylistEntry m_entry;
+
+    void emit(PlaylistEntry entry) {
+        if (entry.path.empty()) {
+            return;
+        }
+        m_batch.push_back(std::move(entry));
+        if (m_batch.size() >= m_batch_size) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (!m_batch.empty() && !m_stopped) {
+            m_stopped = !m_on_batch(m_batch);
+        }
+        m_batch.clear();
+    }
+
+    void m3u_line(std::string_view line) {
+        if (line.front() != '#') {
+            PlaylistEntry entry;
+            entry.path = resolve_location(line, m_base_directory);
+            entry.title = std::move(m_title);
+            entry.duration = m_duration;
+            m_title.clear();
+            m_duration = 0.0;
+            emit(std::move(entry));
+            return;
+        }
+        if (!starts_with_nocase(line, "#EXTINF:")) {
+            return;
+        }
+        // #EXTINF:<seconds> [attributes],<title>; attribute values may hold commas
+        std::string_view info = line.substr(8);
+        bool quoted = false;
+        size_t comma = std::string_view::npos;
+        for (size_t i = 0; i < info.size(); ++i) {
+            if (info[i] == '"') {
+                quoted = !quoted;
+            } else if (info[i] == ',' && !quoted) {
+                comma = i;
+                break;
+            }
+        }
+        m_duration = parse_seconds(info.substr(0, info.find_first_of(" \t,")));
+        m_title = comma == std::string_view::npos ? std::string() : std::string(trim(info.substr(comma + 1)));
+    }
+
+    void pls_line(std::string_view line) {
+        size_t equals = line.find('=');
+        if (line.front() == '[' || equals == std::string_view::npos) {
+            return;
+        }
+        std::string_view key = trim(line.substr(0, equals));
+        std::string_view value = trim(line.substr(equals + 1));
+        size_t digits = key.size();
+        while (digits > 0 && std::isdigit(static_cast<unsigned char>(key[digits - 1]))) {
+            --digits;
+        }
+        if (digits == key.size() || key.size() - digits > 9) {
+            return;  // NumberOfEntries, Version
+        }
+        long number = std::strtol(std::string(key.substr(digits)).c_str(), nullptr, 10);
+        if (number != m_number) {
+            emit(std::move(m_entry));
+            m_entry = PlaylistEntry();
+            m_number = number;
+        }
+        std::string_view name = key.substr(0, digits);
+        if (starts_with_nocase(name, "file") && name.size() == 4) {
+            m_entry.path = resolve_location(value, m_base_directory);
+        } else if (starts_with_nocase(name, "title") && name.size() == 5) {
+            m_entry.title = std::string(value);
+        } else if (starts_with_nocase(name, "length") && name.size() == 6) {
+            m_entry.duration = parse_seconds(value);
+        }
+    }
+
+public:
+    PlaylistParser(PlaylistFormat format, std::string base_directory, const PlaylistBatchCallback& on_batch,
+                   size_t batch_size)
+        : m_format(format)
+        , m_base_directory(std::move(base_directory))
+        , m_on_batch(on_batch)
+        , m_batch_size(std::max<size_t>(batch_size, 1)) {
+        m_batch.reserve(m_batch_size);
+    }
+
+    bool stopped() const {
+        return m_stopped;
+    }
+
+    void line(std::string_view line) {
+        if (m_first_line) {
+            m_first_line = false;
+            if (line.substr(0, 3) == "\xEF\xBB\xBF") {
+                line.remove_prefix(3);
+            }
+        }
+        line = trim(line);
+        if (line.empty() || m_stopped) {
+            return;
+        }
+        if (m_format == PlaylistFormat::PLS) {
+            pls_line(line);
+        } else {
+            m3u_line(line);
+        }
+    }
+
+    void finish() {
+        if (m_format == PlaylistFormat::PLS) {
+            emit(std::move(m_entry));
+        }
+        flush();
+    }
+};
+
+}
+
+PlaylistFormat playlist_format(const std::string& path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension == ".m3u" || extension == ".m3u8") {
+        return PlaylistFormat::M3U;
+    }
+    if (extension == ".pls") {
+        return PlaylistFormat::PLS;
+    }
+    return PlaylistFormat::UNKNOWN;
+}
+
+bool read_playlist(const std::string& path, const PlaylistBatchCallback& on_batch, size_t batch_size) {
+    PlaylistFormat format = playlist_format(path);
+    if (format == PlaylistFormat::UNKNOWN) {
+        return false;
+    }
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    PlaylistParser parser(format, directory_of(path), on_batch, batch_size);
+    std::vector<char> chunk(READ_CHUNK);
+    std::string partial;  // A line split across chunks
+    bool skipping = false;  // Inside an overlong line
+    size_t read = 0;
+    while (!parser.stopped() && (read = std::fread(chunk.data(), 1, chunk.size(), file)) > 0) {
+        const char* data = chunk.data();
+        const char* end = data + read;
+        while (data < end) {
+            const char* newline = static_cast<const char*>(std::memchr(data, '\n', static_cast<size_t>(end - data)));
+            const char* line_end = newline ? newline : end;
+            if (!skipping) {
+                if (partial.size() + static_cast<size_t>(line_end - data) > MAX_LINE) {
+                    skipping = true;
+                    partial.clear();
+                } else if (!newline) {
+                    partial.append(data, line_end);
+                } else if (!partial.empty()) {
+                    partial.append(data, line_end);
+                    parser.line(partial);
+                    partial.clear();
+                } else {
+                    parser.line(std::string_view(data, static_cast<size_t>(line_end - data)));
+                }
+            }
+            if (newline) {
+                skipping = false;
+            }
+            data = newline ? newline + 1 : end;
+        }
+    }
+    bool ok = !std::ferror(file);
+    std::fclose(file);
+    if (!ok) {
+        return false;
+    }
+    if (!partial.empty()) {
+        parser.line(partial);
+    }
+    parser.finish();
+    return true;
+}
+
+void resolve_playlist_entries(std::vector<PlaylistEntry>& entries, const LibraryStore& library,
+                              const LibraryIndex* index, SongList& new_songs) {
+    new_songs.clear();
+    IndexedSong indexed;
+    size_t kept = 0;
+    for (auto& entry : entries) {
+        if (library.find(entry.path) == INVALID_SONG_ID) {
+            size_t slot = index ? index->find(entry.path) : LibraryIndex::NOT_FOUND;
+            if (slot != LibraryIndex::NOT_FOUND && index->get(slot, indexed)) {
+                new_songs.push_back(std::move(indexed.song));
+            } else {
+                std::error_code ec;
+                if (!std::filesystem::is_regular_file(entry.path, ec)) {
+                    continue;
+                }
+                Song song;
+                song.file_path = entry.path;
+                song.title = entry.title.empty() ? std::filesystem::path(entry.path).stem().string() : entry.title;
+                song.artist = "Unknown Artist";
+                song.duration = entry.duration;
+                new_songs.push_back(std::move(song));
+            }
+        }
+        if (&entries[kept] != &entry) {
+            entries[kept] = std::move(entry);
+        }
+        ++kept;
+    }
+    entries.resize(kept);
+}
+
+PlaylistWriter::~PlaylistWriter() {
+    if (m_file) {
+        std::fclose(m_file);
+        std::remove(m_temp_path.c_str());
+    }
+}
+
+bool PlaylistWriter::open(const std::string& path) {
+    if (m_file) {
+        return false;
+    }
+    m_format = playlist_format(path);
+    if (m_format == PlaylistFormat::UNKNOWN) {
+        return false;
+    }
+    m_path = path;
+    m_temp_path = path + ".tmp";
+    m_file = std::fopen(m_temp_path.c_str(), "wb");
+    if (!m_file) {
+        return false;
+    }
+    m_buffer.resize(WRITE_BUFFER);
+    std::setvbuf(m_file, m_buffer.data(), _IOFBF, m_buffer.size());
+    m_base_directory = directory_of(path);
+    m_count = 0;
+    std::fputs(m_format == PlaylistFormat::PLS ? "[playlist]\n" : "#EXTM3U\n", m_file);
+    return true;
+}
+
+void PlaylistWriter::write(const PlaylistEntry& entry) {
+    if (!m_file || entry.path.empty()) {
+        return;
+    }
+    std::string_view location = entry.path;
+    if (location.size() > m_base_directory.size() && location.compare(0, m_base_directory.size(), m_base_directory) == 0) {
+        location.remove_prefix(m_base_directory.size());
+    }
+    std::string title = single_line(entry.title);
+    long seconds = entry.duration > 0 ? std::lround(entry.duration) : -1;
+    ++m_count;
+    if (m_format == PlaylistFormat::PLS) {
+        std::fprintf(m_file, "File%zu=%.*s\n", m_count, static_cast<int>(location.size()), location.data());
+        if (!title.empty()) {
+            std::fprintf(m_file, "Title%zu=%s\n", m_count, title.c_str());
+        }
+        std::fprintf(m_file, "Length%zu=%ld\n", m_count, seconds);
+    } else {
+        std::fprintf(m_file, "#EXTINF:%ld,%s\n%.*s\n", seconds, title.c_str(), static_cast<int>(location.size()),
+                     location.data());
+    }
+}
+
+bool PlaylistWriter::close() {
+    if (!m_file) {
+        return false;
+    }
+    if (m_format == PlaylistFormat::PLS) {
+        std::fprintf(m_file, "NumberOfEntries=%zu\nVersion=2\n", m_count);
+    }
+    bool ok = !std::ferror(m_file);
+    ok = std::fclose(m_file) == 0 && ok;
+    m_file = nullptr;
+    if (!ok) {
+        std::remove(m_temp_path.c_str());
+        return false;
+    }
+    return replace_file(m_temp_path, m_path);
+}
+
+}
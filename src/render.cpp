@@ -0,0 +1,293 @@
+#include "render.hpp"
+#include "gain_ramp.hpp"
+#include "loudness.hpp"
+#include "mp3_decoder.hpp"
+#include "pcm_tee.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace nigamp {
+
+namespace {
+
+constexpr size_t DECODE_CHUNK_SAMPLES = 16384;
+// Rendered audio waiting for the writer, across every track ahead of it
+constexpr size_t QUEUED_BYTES_LIMIT = 32 * 1024 * 1024;
+// The track being written streams straight through with this much slack
+constexpr size_t WRITING_TRACK_CHUNKS = 8;
+
+struct RenderedTrack {
+    bool done = false;
+    bool ok = false;
+    std::deque<AudioBuffer> chunks;
+};
+
+// Receives each processed chunk; returning false stops the track
+using ChunkSink = std::function<bool(AudioBuffer&)>;
+
+// Mono is duplicated to every channel, anything else is mixed down
+void convert_channels(const AudioBuffer& input, int input_channels, int output_channels, AudioBuffer& output) {
+    if (input_channels == output_channels) {
+        output = input;
+        return;
+    }
+    size_t frames = input.size() / input_channels;
+    output.resize(frames * output_channels);
+    for (size_t frame = 0; frame < frames; ++frame) {
+        int32_t sum = 0;
+        for (int ch = 0; ch < input_channels; ++ch) {
+            sum += input[frame * input_channels + ch];
+        }
+        int16_t mixed = input_channels == 1 ? input[frame] : static_cast<int16_t>(sum / input_channels);
+        for (int ch = 0; ch < output_channels; ++ch) {
+            output[frame * output_channels + ch] = mixed;
+        }
+    }
+}
+
+bool render_track(const std::string& path, const RenderOptions& options, IResampler& resampler, const ChunkSink& emit) {
+    auto decoder = create_decoder(path);
+    if (!decoder || !decoder->open(path)) {
+        return false;
+    }
+
+    AudioFormat format = decoder->get_format();
+    if (format.channels <= 0 || !resampler.configure(format.sample_rate, options.format.sample_rate, options.format.channels)) {
+        return false;
+    }
+    resampler.reset();
+
+    GainRamp gain;
+    gain.configure(options.format.sample_rate, options.format.channels);
+    gain.set_volume(options.volume, 0.0);
+
+    uint64_t frames_left = std::numeric_limits<uint64_t>::max();
+    if (options.preview_seconds > 0.0) {
+        frames_left = static_cast<uint64_t>(options.preview_seconds * format.sample_rate);
+
+        LoudnessEnvelope envelope;
+        bool analyzed = options.smart_preview &&
+                        (options.loudness ? options.loudness->analyze(path, envelope)
+                                          : compute_loudness_envelope(path, envelope));
+        if (analyzed) {
+            // Like playback, a clip that cannot seek plays from the start
+            double start = find_loudest_window(envelope, options.preview_seconds);
+            if (start > 0.0 && !decoder->seek(start) && !decoder->seek(0.0)) {
+                return false;
+            }
+        }
+    }
+
+    AudioBuffer decoded;
+    AudioBuffer converted;
+    AudioBuffer resampled;
+    while (frames_left > 0 && decoder->decode(decoded, DECODE_CHUNK_SAMPLES)) {
+        uint64_t frames = decoded.size() / format.channels;
+        if (frames > frames_left) {
+            decoded.resize(static_cast<size_t>(frames_left) * format.channels);
+            frames = frames_left;
+        }
+        frames_left -= frames;
+
+        convert_channels(decoded, format.channels, options.format.channels, converted);
+        resampler.process(converted, resampled);
+        gain.process(resampled.data(), resampled.size() / options.format.channels);
+        if (!resampled.empty() && !emit(resampled)) {
+            return true;
+        }
+    }
+    resampler.flush(resampled);
+    gain.process(resampled.data(), resampled.size() / options.format.channels);
+    if (!resampled.empty()) {
+        emit(resampled);
+    }
+    return true;
+}
+
+class WavFileSink {
+private:
+    std::FILE* m_file = nullptr;
+    AudioFormat m_format;
+    uint64_t m_data_bytes = 0;
+
+public:
+    ~WavFileSink() {
+        if (m_file) {
+            std::fclose(m_file);
+        }
+    }
+
+    bool open(const std::string& path, const AudioFormat& format) {
+        m_format = format;
+        m_file = std::fopen(path.c_str(), "wb");
+        std::string header = make_wav_header(format, 0);
+        return m_file && std::fwrite(header.data(), 1, header.size(), m_file) == header.size();
+    }
+
+    // False on an I/O error or once the 4 GiB RIFF limit would be passed
+    bool write(const AudioBuffer& pcm) {
+        uint64_t bytes = pcm.size() * sizeof(int16_t);
+        if (m_data_bytes + bytes > 0xFFFFFFFFull - WAV_HEADER_SIZE) {
+            std::cerr << "Render output reached the WAV size limit\n";
+            return false;
+        }
+        if (std::fwrite(pcm.data(), sizeof(int16_t), pcm.size(), m_file) != pcm.size()) {
+            return false;
+        }
+        m_data_bytes += bytes;
+        return true;
+    }
+
+    bool finish() {
+        std::string header = make_wav_header(m_format, static_cast<uint32_t>(m_data_bytes));
+        bool ok = std::fseek(m_file, 0, SEEK_SET) == 0 &&
+                  std::fwrite(header.data(), 1, header.size(), m_file) == header.size();
+        ok = std::fclose(m_file) == 0 && ok;
+        m_file = nullptr;
+        return ok;
+    }
+};
+
+}
+
+bool render_playlist(const std::vector<std::string>& paths, const std::string& output_path,
+                     const RenderOptions& options, RenderStats& stats) {
+    stats = RenderStats();
+    auto start = std::chrono::steady_clock::now();
+
+    WavFileSink sink;
+    if (!sink.open(output_path, options.format)) {
+        std::cerr << "Cannot write render output: " << output_path << "\n";
+        return false;
+    }
+
+    unsigned threads = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(paths.size(), 1)));
+    // Workers run at most this far ahead of the writer
+    const size_t window = threads * 2;
+
+    // Tracks are rendered in chunks. Chunks of tracks the writer hasn't reached
+    // share one byte budget, so memory stays flat however long the tracks are;
+    // the track being written is drained as it is produced.
+    std::vector<RenderedTrack> tracks(paths.size());
+    std::mutex mutex;
+    std::condition_variable claim_cv;
+    std::condition_variable space_cv;
+    std::condition_variable done_cv;
+    size_t next_to_claim = 0;
+    size_t next_to_write = 0;
+    size_t queued_bytes = 0;
+    bool aborted = false;
+
+    auto worker = [&]() {
+        auto resampler = create_resampler(options.resampler_quality);
+        for (;;) {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                claim_cv.wait(lock, [&]() {
+                    return aborted || next_to_claim >= paths.size() || next_to_claim < next_to_write + window;
+                });
+                if (aborted || next_to_claim >= paths.size()) {
+                    return;
+                }
+                index = next_to_claim++;
+            }
+
+            RenderedTrack& track = tracks[index];
+            bool ok = render_track(paths[index], options, *resampler, [&](AudioBuffer& chunk) {
+                std::unique_lock<std::mutex> lock(mutex);
+                space_cv.wait(lock, [&]() {
+                    return aborted || (index == next_to_write ? track.chunks.size() < WRITING_TRACK_CHUNKS
+                                                              : queued_bytes < QUEUED_BYTES_LIMIT);
+                });
+                if (aborted) {
+                    return false;
+                }
+                queued_bytes += chunk.size() * sizeof(int16_t);
+                track.chunks.push_back(std::move(chunk));
+                chunk = AudioBuffer();
+                done_cv.notify_all();
+                return true;
+            });
+
+            std::lock_guard<std::mutex> lock(mutex);
+            track.ok = ok;
+            track.done = true;
+            done_cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+
+    bool written = true;
+    for (size_t index = 0; index < paths.size() && written; ++index) {
+        RenderedTrack& track = tracks[index];
+        uint64_t track_frames = 0;
+        bool ok = false;
+        for (;;) {
+            AudioBuffer chunk;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                done_cv.wait(lock, [&]() { return !track.chunks.empty() || track.done; });
+                if (track.chunks.empty()) {
+                    ok = track.ok;
+                    next_to_write = index + 1;
+                    break;
+                }
+                chunk = std::move(track.chunks.front());
+                track.chunks.pop_front();
+                queued_bytes -= chunk.size() * sizeof(int16_t);
+            }
+            space_cv.notify_all();
+
+            if (!sink.write(chunk)) {
+                written = false;
+                break;
+            }
+            track_frames += chunk.size() / options.format.channels;
+        }
+        // The next track may now stream straight through, and another can start
+        space_cv.notify_all();
+        claim_cv.notify_all();
+
+        stats.frames_written += track_frames;
+        if (!written) {
+            break;
+        }
+        if (!ok) {
+            std::cerr << "Skipping unreadable track: " << paths[index] << "\n";
+            ++stats.tracks_failed;
+            continue;
+        }
+        ++stats.tracks_rendered;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        aborted = true;
+    }
+    claim_cv.notify_all();
+    space_cv.notify_all();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    written = sink.finish() && written;
+    stats.audio_seconds = static_cast<double>(stats.frames_written) / options.format.sample_rate;
+    stats.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return written;
+}
+
+}
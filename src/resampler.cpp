@@ -0,0 +1,333 @@
+#include "resampler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define NIGAMP_RESAMPLER_SSE 1
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define NIGAMP_RESAMPLER_NEON 1
+#endif
+
+namespace nigamp {
+
+// Coefficients shared by every resampler with the same rates and quality.
+// Named outside the anonymous namespace since Impl holds a pointer to one.
+struct FilterTable {
+    int phases = 1;     // Interpolation factor L
+    int step = 1;       // Decimation factor M
+    int taps = 0;
+    std::vector<float> coeffs;  // phases * taps, each phase stored time-reversed
+};
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+
+// Phase tables larger than this are approximated by rounding the ratio,
+// which keeps odd rate pairs (e.g. 44100 -> 47999) from allocating megabytes.
+constexpr int MAX_PHASES = 1024;
+
+struct QualityParams {
+    int taps;           // Taps per polyphase branch (multiple of 8 for SIMD)
+    double kaiser_beta; // Stopband attenuation control
+    double rolloff;     // Passband edge as a fraction of the lower Nyquist
+};
+
+QualityParams get_quality_params(ResamplerQuality quality) {
+    switch (quality) {
+        case ResamplerQuality::FAST:   return {8, 5.0, 0.85};
+        case ResamplerQuality::HIGH:   return {32, 9.0, 0.95};
+        case ResamplerQuality::MEDIUM:
+        default:                       return {16, 7.0, 0.90};
+    }
+}
+
+double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double half_x = x / 2.0;
+    for (int k = 1; k < 50; ++k) {
+        term *= (half_x / k) * (half_x / k);
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+std::shared_ptr<const FilterTable> build_filter_table(int input_rate, int output_rate, ResamplerQuality quality) {
+    QualityParams params = get_quality_params(quality);
+
+    int divisor = std::gcd(input_rate, output_rate);
+    int phases = output_rate / divisor;
+    int step = input_rate / divisor;
+    if (phases > MAX_PHASES) {
+        step = std::max(1, static_cast<int>(std::lround(static_cast<double>(step) * MAX_PHASES / phases)));
+        phases = MAX_PHASES;
+    }
+
+    auto table = std::make_shared<FilterTable>();
+    table->phases = phases;
+    table->step = step;
+    table->taps = params.taps;
+    table->coeffs.resize(static_cast<size_t>(phases) * params.taps);
+
+    // Prototype low-pass at the upsampled rate (input_rate * phases)
+    const int length = phases * params.taps;
+    const double cutoff = params.rolloff * std::min(1.0, static_cast<double>(phases) / step) / (2.0 * phases);
+    const double center = (length - 1) / 2.0;
+    const double window_norm = bessel_i0(params.kaiser_beta);
+
+    for (int p = 0; p < phases; ++p) {
+        float* branch = &table->coeffs[static_cast<size_t>(p) * params.taps];
+        double branch_sum = 0.0;
+
+        for (int k = 0; k < params.taps; ++k) {
+            int n = k * phases + p;
+            double t = n - center;
+            double x = 2.0 * cutoff * t;
+            double sinc = (std::abs(x) < 1e-12) ? 1.0 : std::sin(PI * x) / (PI * x);
+            double ratio = 2.0 * n / (length - 1) - 1.0;
+            double window = bessel_i0(params.kaiser_beta * std::sqrt(std::max(0.0, 1.0 - ratio * ratio))) / window_norm;
+            double value = sinc * window;
+
+            // Reverse so the dot product walks input and coefficients forward
+            branch[params.taps - 1 - k] = static_cast<float>(value);
+            branch_sum += value;
+        }
+
+        // Unity DC gain per branch avoids a periodic ripple at the phase rate
+        if (std::abs(branch_sum) > 1e-12) {
+            for (int k = 0; k < params.taps; ++k) {
+                branch[k] = static_cast<float>(branch[k] / branch_sum);
+            }
+        }
+    }
+
+    return table;
+}
+
+std::mutex g_table_cache_mutex;
+std::map<std::tuple<int, int, int>, std::shared_ptr<const FilterTable>> g_table_cache;
+
+std::shared_ptr<const FilterTable> get_filter_table(int input_rate, int output_rate, ResamplerQuality quality) {
+    auto key = std::make_tuple(input_rate, output_rate, static_cast<int>(quality));
+
+    std::lock_guard<std::mutex> lock(g_table_cache_mutex);
+    auto it = g_table_cache.find(key);
+    if (it != g_table_cache.end()) {
+        return it->second;
+    }
+
+    auto table = build_filter_table(input_rate, output_rate, quality);
+    g_table_cache.emplace(key, table);
+    return table;
+}
+
+inline float dot_product(const float* a, const float* b, int n) {
+    int i = 0;
+#if defined(NIGAMP_RESAMPLER_SSE)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    __m128 high = _mm_movehl_ps(acc0, acc0);
+    __m128 sums = _mm_add_ps(acc0, high);
+    sums = _mm_add_ss(sums, _mm_shuffle_ps(sums, sums, 1));
+    float sum = _mm_cvtss_f32(sums);
+#elif defined(NIGAMP_RESAMPLER_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    acc0 = vaddq_f32(acc0, acc1);
+    float32x2_t pair = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+    float sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#else
+    float sum = 0.0f;
+#endif
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+} // namespace
+
+struct PolyphaseResampler::Impl {
+    ResamplerQuality quality;
+    int input_rate = 0;
+    int output_rate = 0;
+    int channels = 0;
+    bool passthrough = true;
+
+    std::shared_ptr<const FilterTable> table;
+
+    // Per-channel float history: taps-1 samples of context plus unconsumed input
+    std::vector<std::vector<float>> history;
+    size_t position = 0;   // Index of the first tap of the next output frame
+    int phase = 0;
+
+    explicit Impl(ResamplerQuality q) : quality(q) {}
+
+    void reset_state() {
+        history.assign(channels, std::vector<float>());
+        if (table) {
+            for (auto& channel : history) {
+                channel.assign(table->taps - 1, 0.0f);
+            }
+        }
+        position = 0;
+        phase = 0;
+    }
+
+    void append_input(const AudioBuffer& input) {
+        size_t frames = input.size() / channels;
+        for (int c = 0; c < channels; ++c) {
+            auto& channel = history[c];
+            size_t base = channel.size();
+            channel.resize(base + frames);
+            const int16_t* src = input.data() + c;
+            float* dst = channel.data() + base;
+            for (size_t i = 0; i < frames; ++i) {
+                dst[i] = static_cast<float>(src[i * channels]);
+            }
+        }
+    }
+
+    void render(AudioBuffer& output) {
+        const int taps = table->taps;
+        const int phases = table->phases;
+        const int step = table->step;
+        const size_t available = history[0].size();
+
+        size_t expected = (available > position ? available - position : 0) * phases / step + 1;
+        output.reserve(expected * channels);
+
+        while (position + taps <= available) {
+            const float* branch = &table->coeffs[static_cast<size_t>(phase) * taps];
+            for (int c = 0; c < channels; ++c) {
+                float value = dot_product(branch, history[c].data() + position, taps);
+                long rounded = std::lround(value);
+                rounded = std::max(-32768L, std::min(32767L, rounded));
+                output.push_back(static_cast<int16_t>(rounded));
+            }
+
+            int advance = phase + step;
+            position += advance / phases;
+            phase = advance % phases;
+        }
+
+        // Drop consumed input, keeping the filter context for the next block
+        size_t consumed = std::min(position, available);
+        for (auto& channel : history) {
+            channel.erase(channel.begin(), channel.begin() + consumed);
+        }
+        position -= consumed;
+    }
+};
+
+PolyphaseResampler::PolyphaseResampler(ResamplerQuality quality)
+    : m_impl(std::make_unique<Impl>(quality)) {}
+
+PolyphaseResampler::~PolyphaseResampler() = default;
+
+bool PolyphaseResampler::configure(int input_rate, int output_rate, int channels) {
+    if (input_rate <= 0 || output_rate <= 0 || channels <= 0) {
+        return false;
+    }
+
+    m_impl->input_rate = input_rate;
+    m_impl->output_rate = output_rate;
+    m_impl->channels = channels;
+    m_impl->passthrough = (input_rate == output_rate);
+    m_impl->table = m_impl->passthrough ? nullptr
+                                        : get_filter_table(input_rate, output_rate, m_impl->quality);
+    m_impl->reset_state();
+    return true;
+}
+
+void PolyphaseResampler::process(const AudioBuffer& input, AudioBuffer& output) {
+    output.clear();
+
+    if (m_impl->passthrough || m_impl->channels == 0) {
+        output = input;
+        return;
+    }
+
+    m_impl->append_input(input);
+    m_impl->render(output);
+}
+
+void PolyphaseResampler::flush(AudioBuffer& output) {
+    output.clear();
+
+    if (m_impl->passthrough || m_impl->channels == 0) {
+        return;
+    }
+
+    // Enough silence to carry the last input frame past the centre of the filter
+    for (auto& channel : m_impl->history) {
+        channel.resize(channel.size() + m_impl->table->taps / 2, 0.0f);
+    }
+    m_impl->render(output);
+    m_impl->reset_state();
+}
+
+void PolyphaseResampler::reset() {
+    m_impl->reset_state();
+}
+
+bool PolyphaseResampler::is_passthrough() const {
+    return m_impl->passthrough;
+}
+
+int PolyphaseResampler::get_input_rate() const {
+    return m_impl->input_rate;
+}
+
+int PolyphaseResampler::get_output_rate() const {
+    return m_impl->output_rate;
+}
+
+std::unique_ptr<IResampler> create_resampler(ResamplerQuality quality) {
+    return std::make_unique<PolyphaseResampler>(quality);
+}
+
+bool parse_resampler_quality(const std::string& name, ResamplerQuality& quality) {
+    if (name == "fast") {
+        quality = ResamplerQuality::FAST;
+    } else if (name == "medium") {
+        quality = ResamplerQuality::MEDIUM;
+    } else if (name == "high") {
+        quality = ResamplerQuality::HIGH;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+size_t get_resampler_cache_size() {
+    std::lock_guard<std::mutex> lock(g_table_cache_mutex);
+    return g_table_cache.size();
+}
+
+void clear_resampler_cache() {
+    std::lock_guard<std::mutex> lock(g_table_cache_mutex);
+    g_table_cache.clear();
+}
+
+}
@@ -0,0 +1,230 @@
+#include "session_state.hpp"
+#include "binary_file.hpp"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace nigamp {
+
+namespace {
+
+constexpr char MAGIC[4] = {'N', 'G', 'S', 'S'};
+constexpr uint32_t VERSION = 1;
+
+// magic, version, song count, current index, sample position, sample rate,
+// volume bits, directory length
+constexpr size_t HEADER_SIZE = 4 + 4 + 4 + 4 + 8 + 4 + 4 + 4;
+// current index, sample position, sample rate and volume bits sit together
+// after magic, version and song count
+constexpr size_t POSITION_OFFSET = 12;
+constexpr size_t POSITION_SIZE = 4 + 8 + 4 + 4;
+
+// Bounds-checked cursor over the mapped file
+class Reader {
+private:
+    const unsigned char* m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+
+public:
+    Reader(const unsigned char* data, size_t size) : m_data(data), m_size(size) {}
+
+    bool u32(uint32_t& value) {
+        if (m_size - m_offset < 4) {
+            return false;
+        }
+        value = get_u32(m_data + m_offset);
+        m_offset += 4;
+        return true;
+    }
+
+    bool u64(uint64_t& value) {
+        uint32_t low = 0;
+        uint32_t high = 0;
+        if (!u32(low) || !u32(high)) {
+            return false;
+        }
+        value = (static_cast<uint64_t>(high) << 32) | low;
+        return true;
+    }
+
+    bool bytes(std::string& value, size_t length) {
+        if (m_size - m_offset < length) {
+            return false;
+        }
+        value.assign(reinterpret_cast<const char*>(m_data + m_offset), length);
+        m_offset += length;
+        return true;
+    }
+
+    size_t remaining() const {
+        return m_size - m_offset;
+    }
+};
+
+bool parse_session(const unsigned char* data, size_t size, SessionState& state) {
+    if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+        return false;
+    }
+
+    Reader reader(data + sizeof(MAGIC), size - sizeof(MAGIC));
+    SessionState parsed;
+    uint32_t version = 0;
+    uint32_t count = 0;
+    uint32_t volume_bits = 0;
+    uint32_t directory_length = 0;
+    if (!reader.u32(version) || version != VERSION ||
+        !reader.u32(count) || !reader.u32(parsed.current_index) ||
+        !reader.u64(parsed.sample_position) || !reader.u32(parsed.sample_rate) ||
+        !reader.u32(volume_bits) || !reader.u32(directory_length) ||
+        !reader.bytes(parsed.directory, directory_length)) {
+        return false;
+    }
+    std::memcpy(&parsed.volume, &volume_bits, sizeof(volume_bits));
+
+    // Each song needs at least its order entry and a path length
+    if (count == 0 || parsed.current_index >= count || reader.remaining() / 8 < count) {
+        return false;
+    }
+
+    parsed.order.resize(count);
+    std::vector<bool> seen(count, false);
+    for (auto& index : parsed.order) {
+        if (!reader.u32(index) || index >= count || seen[index]) {
+            return false;
+        }
+        seen[index] = true;
+    }
+
+    parsed.paths.resize(count);
+    for (auto& song_path : parsed.paths) {
+        uint32_t length = 0;
+        if (!reader.u32(length) || !reader.bytes(song_path, length)) {
+            return false;
+        }
+    }
+
+    state = std::move(parsed);
+    return true;
+}
+
+std::string encode_position(const SessionPosition& position) {
+    uint32_t volume_bits = 0;
+    std::memcpy(&volume_bits, &position.volume, sizeof(volume_bits));
+    std::string buffer;
+    put_u32(buffer, position.current_index);
+    put_u64(buffer, position.sample_position);
+    put_u32(buffer, position.sample_rate);
+    put_u32(buffer, volume_bits);
+    return buffer;
+}
+
+bool is_snapshot_of(const unsigned char* prefix, size_t song_count) {
+    return std::memcmp(prefix, MAGIC, sizeof(MAGIC)) == 0 && get_u32(prefix + 4) == VERSION &&
+           get_u32(prefix + 8) == song_count;
+}
+
+}
+
+bool save_session(const std::string& path, const SessionState& state) {
+    if (state.paths.empty() || state.order.size() != state.paths.size()) {
+        return false;
+    }
+
+    std::string buffer;
+    size_t paths_bytes = 0;
+    for (const auto& song_path : state.paths) {
+        paths_bytes += 4 + song_path.size();
+    }
+    buffer.reserve(HEADER_SIZE + state.directory.size() + state.order.size() * 4 + paths_bytes);
+
+    SessionPosition position;
+    position.current_index = state.current_index;
+    position.sample_position = state.sample_position;
+    position.sample_rate = state.sample_rate;
+    position.volume = state.volume;
+
+    buffer.append(MAGIC, sizeof(MAGIC));
+    put_u32(buffer, VERSION);
+    put_u32(buffer, static_cast<uint32_t>(state.paths.size()));
+    buffer += encode_position(position);
+    put_u32(buffer, static_cast<uint32_t>(state.directory.size()));
+    buffer += state.directory;
+    for (uint32_t index : state.order) {
+        put_u32(buffer, index);
+    }
+    for (const auto& song_path : state.paths) {
+        put_u32(buffer, static_cast<uint32_t>(song_path.size()));
+        buffer += song_path;
+    }
+
+    return write_file_atomically(path, {buffer});
+}
+
+bool load_session(const std::string& path, SessionState& state) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    bool loaded = parse_session(static_cast<const unsigned char*>(mapping), size, state);
+    ::munmap(mapping, size);
+    return loaded;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return parse_session(reinterpret_cast<const unsigned char*>(contents.data()), contents.size(), state);
+#endif
+}
+
+bool update_session_position(const std::string& path, size_t song_count, const SessionPosition& position) {
+    if (position.current_index >= song_count) {
+        return false;
+    }
+    std::string fields = encode_position(position);
+    unsigned char prefix[POSITION_OFFSET];
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool updated = ::pread(fd, prefix, sizeof(prefix), 0) == static_cast<ssize_t>(sizeof(prefix)) &&
+                   is_snapshot_of(prefix, song_count) &&
+                   ::pwrite(fd, fields.data(), POSITION_SIZE, POSITION_OFFSET) == static_cast<ssize_t>(POSITION_SIZE);
+    ::close(fd);
+    return updated;
+#else
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file || !file.read(reinterpret_cast<char*>(prefix), sizeof(prefix)) ||
+        !is_snapshot_of(prefix, song_count)) {
+        return false;
+    }
+    file.seekp(POSITION_OFFSET);
+    return static_cast<bool>(file.write(fields.data(), POSITION_SIZE).flush());
+#endif
+}
+
+}
@@ -0,0 +1,286 @@
+#include "shuffle_strategy.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+namespace nigamp {
+
+namespace {
+
+constexpr uint32_t MAX_WEIGHTED_PLAYS = 15;
+
+void fisher_yates(uint32_t* items, size_t count, std::mt19937& random) {
+    for (size_t i = count; i > 1; --i) {
+        std::uniform_int_distribution<size_t> dist(0, i - 1);
+        std::swap(items[i - 1], items[dist(random)]);
+    }
+}
+
+class UniformShuffle : public IShuffleStrategy {
+public:
+    void build_order(const LibraryStore&, const std::vector<SongId>& songs, std::mt19937& random,
+                     std::vector<uint32_t>& order) override {
+        order.resize(songs.size());
+        std::iota(order.begin(), order.end(), 0u);
+        fisher_yates(order.data(), order.size(), random);
+    }
+    const char* name() const override {
+        return "uniform";
+    }
+};
+
+// Sampling without replacement by rejection: drawn songs stay in the table
+// until at least half its weight is gone, so a draw takes at most two tries on
+// average. The table is then rebuilt over what is left; with weights within
+// a factor of 16 of each other that happens after a constant fraction of the
+// remaining songs, which keeps rebuilds O(1) amortized per draw.
+class WeightedShuffle : public IShuffleStrategy {
+public:
+    void build_order(const LibraryStore& library, const std::vector<SongId>& songs, std::mt19937& random,
+                     std::vector<uint32_t>& order) override {
+        order.clear();
+        order.reserve(songs.size());
+        std::vector<uint32_t> pool(songs.size());
+        std::iota(pool.begin(), pool.end(), 0u);
+        std::vector<double> weights;
+        std::vector<bool> taken;
+        AliasTable table;
+
+        while (!pool.empty()) {
+            weights.resize(pool.size());
+            double table_weight = 0.0;
+            for (size_t i = 0; i < pool.size(); ++i) {
+                uint32_t plays = std::min(library.play_count(songs[pool[i]]), MAX_WEIGHTED_PLAYS);
+                weights[i] = 1.0 / (1.0 + plays);
+                table_weight += weights[i];
+            }
+            table.build(weights);
+            taken.assign(pool.size(), false);
+
+            double drawn_weight = 0.0;
+            while (drawn_weight * 2 < table_weight) {
+                uint32_t slot = table.sample(random);
+                if (taken[slot]) {
+                    continue;
+                }
+                taken[slot] = true;
+                order.push_back(pool[slot]);
+                drawn_weight += weights[slot];
+            }
+
+            size_t kept = 0;
+            for (size_t i = 0; i < pool.size(); ++i) {
+                if (!taken[i]) {
+                    pool[kept++] = pool[i];
+                }
+            }
+            pool.resize(kept);
+        }
+    }
+    const char* name() const override {
+        return "weighted";
+    }
+};
+
+// An artist with k songs gets the positions offset + i/k (plus a little jitter)
+// in [0, 1), with its songs shuffled among those slots and the offset random.
+// Sorting every song by position interleaves the artists.
+class ArtistSpreadShuffle : public IShuffleStrategy {
+public:
+    void build_order(const LibraryStore& library, const std::vector<SongId>& songs, std::mt19937& random,
+                     std::vector<uint32_t>& order) override {
+        size_t count = songs.size();
+        order.resize(count);
+        if (count == 0) {
+            return;
+        }
+
+        // Counting sort by artist into contiguous groups
+        std::unordered_map<uint32_t, uint32_t> group_of;
+        std::vector<uint32_t> group(count);
+        std::vector<uint32_t> group_start;
+        for (size_t i = 0; i < count; ++i) {
+            auto inserted = group_of.emplace(library.artist_key(songs[i]), static_cast<uint32_t>(group_start.size()));
+            if (inserted.second) {
+                group_start.push_back(0);
+            }
+            group[i] = inserted.first->second;
+            ++group_start[group[i]];
+        }
+        uint32_t offset = 0;
+        for (auto& start : group_start) {
+            uint32_t size = start;
+            start = offset;
+            offset += size;
+        }
+        group_start.push_back(offset);
+        std::vector<uint32_t> members(count);
+        std::vector<uint32_t> fill(group_start.begin(), group_start.end() - 1);
+        for (size_t i = 0; i < count; ++i) {
+            members[fill[group[i]]++] = static_cast<uint32_t>(i);
+        }
+
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<float> position(count);
+        for (size_t g = 0; g + 1 < group_start.size(); ++g) {
+            uint32_t begin = group_start[g];
+            uint32_t size = group_start[g + 1] - begin;
+            uint32_t* slot_order = members.data() + begin;
+            fisher_yates(slot_order, size, random);
+            float spacing = 1.0f / size;
+            float start = unit(random) * spacing;
+            for (uint32_t k = 0; k < size; ++k) {
+                float jitter = (unit(random) - 0.5f) * 0.2f * spacing;
+                position[slot_order[k]] = std::clamp(start + k * spacing + jitter, 0.0f, std::nextafter(1.0f, 0.0f));
+            }
+        }
+
+        // Bucket sort: positions are spread evenly, so buckets hold about one song each
+        std::vector<uint32_t> bucket_start(count + 1, 0);
+        auto bucket = [&](uint32_t i) {
+            return std::min(static_cast<size_t>(position[i] * count), count - 1);
+        };
+        for (uint32_t i = 0; i < count; ++i) {
+            ++bucket_start[bucket(i) + 1];
+        }
+        for (size_t b = 0; b < count; ++b) {
+            bucket_start[b + 1] += bucket_start[b];
+        }
+        std::vector<uint32_t> next(bucket_start.begin(), bucket_start.end() - 1);
+        for (uint32_t i = 0; i < count; ++i) {
+            order[next[bucket(i)]++] = i;
+        }
+        for (size_t b = 0; b < count; ++b) {
+            if (bucket_start[b + 1] - bucket_start[b] > 1) {
+                std::sort(order.begin() + bucket_start[b], order.begin() + bucket_start[b + 1],
+                          [&](uint32_t a, uint32_t c) { return position[a] < position[c]; });
+            }
+        }
+    }
+    const char* name() const override {
+        return "artist";
+    }
+};
+
+}
+
+std::unique_ptr<IShuffleStrategy> create_uniform_shuffle() {
+    return std::make_unique<UniformShuffle>();
+}
+
+std::unique_ptr<IShuffleStrategy> create_weighted_shuffle() {
+    return std::make_unique<WeightedShuffle>();
+}
+
+std::unique_ptr<IShuffleStrategy> create_artist_spread_shuffle() {
+    return std::make_unique<ArtistSpreadShuffle>();
+}
+
+std::unique_ptr<IShuffleStrategy> create_shuffle_strategy(const std::string& name) {
+    if (name == "uniform") {
+        return create_uniform_shuffle();
+    }
+    if (name == "weighted") {
+        return create_weighted_shuffle();
+    }
+    if (name == "artist") {
+        return create_artist_spread_shuffle();
+    }
+    return nullptr;
+}
+
+void AliasTable::build(const std::vector<double>& weights) {
+    size_t count = weights.size();
+    m_probability.assign(count, 1.0f);
+    m_alias.resize(count);
+    std::iota(m_alias.begin(), m_alias.end(), 0u);
+    if (count == 0) {
+        return;
+    }
+
+    double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+    std::vector<double> scaled(count);
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (size_t i = 0; i < count; ++i) {
+        scaled[i] = weights[i] * count / total;
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+    while (!small.empty() && !large.empty()) {
+        uint32_t less = small.back();
+        small.pop_back();
+        uint32_t more = large.back();
+        m_probability[less] = static_cast<float>(scaled[less]);
+        m_alias[less] = more;
+        scaled[more] -= 1.0 - scaled[less];
+        if (scaled[more] < 1.0) {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+    // Whatever is left is 1 up to rounding
+}
+
+uint32_t AliasTable::sample(std::mt19937& random) const {
+    std::uniform_int_distribution<uint32_t> column(0, static_cast<uint32_t>(m_probability.size() - 1));
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    uint32_t i = column(random);
+    return unit(random) < m_probability[i] ? i : m_alias[i];
+}
+
+RecentWindow::RecentWindow(size_t capacity) : m_capacity(capacity) {}
+
+void RecentWindow::set_bit(SongId id, bool value) {
+    if (id / 64 >= m_bits.size()) {
+        if (!value) {
+            return;
+        }
+        m_bits.resize(id / 64 + 1, 0);
+    }
+    uint64_t mask = uint64_t(1) << (id % 64);
+    m_bits[id / 64] = value ? m_bits[id / 64] | mask : m_bits[id / 64] & ~mask;
+}
+
+void RecentWindow::erase(SongId id) {
+    auto it = std::find(m_songs.begin(), m_songs.end(), id);
+    if (it != m_songs.end()) {
+        m_songs.erase(it);
+    }
+}
+
+void RecentWindow::push(SongId id) {
+    if (m_capacity == 0 || id == INVALID_SONG_ID) {
+        return;
+    }
+    if (contains(id)) {
+        erase(id);
+    } else if (m_songs.size() == m_capacity) {
+        set_bit(m_songs.front(), false);
+        m_songs.pop_front();
+    }
+    m_songs.push_back(id);
+    set_bit(id, true);
+}
+
+void RecentWindow::forget(SongId id) {
+    if (contains(id)) {
+        erase(id);
+        set_bit(id, false);
+    }
+}
+
+void RecentWindow::clear() {
+    m_songs.clear();
+    m_bits.clear();
+}
+
+void RecentWindow::resize(size_t capacity) {
+    m_capacity = capacity;
+    while (m_songs.size() > m_capacity) {
+        set_bit(m_songs.front(), false);
+        m_songs.pop_front();
+    }
+}
+
+}
@@ -0,0 +1,187 @@
+#include "status_display.hpp"
+#include "rcu.hpp"
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <cerrno>
+    #include <poll.h>
+    #include <pthread.h>
+    #include <sched.h>
+    #include <unistd.h>
+#endif
+
+namespace nigamp {
+
+bool StatusSnapshot::operator==(const StatusSnapshot& other) const {
+    return active == other.active && title == other.title && remaining == other.remaining &&
+           total == other.total && paused == other.paused && preview == other.preview;
+}
+
+std::string format_time(double seconds) {
+    int minutes = static_cast<int>(seconds) / 60;
+    int secs = static_cast<int>(seconds) % 60;
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%02d:%02d", minutes, secs);
+    return std::string(buffer);
+}
+
+std::string format_status_line(const StatusSnapshot& snapshot) {
+    std::string status;
+    if (snapshot.preview) {
+        status = "🎵 [PREVIEW]";
+    } else {
+        status = snapshot.paused ? "⏸️  [PAUSED]" : "🎵";
+    }
+    return status + " " + snapshot.title + " - Time remaining: " + format_time(snapshot.remaining) +
+           " / " + format_time(snapshot.total);
+}
+
+struct StatusRenderer::Impl {
+    int fd;
+    std::chrono::milliseconds frame_interval;
+    bool terminal = false;
+
+    struct Published {
+        StatusSnapshot snapshot;
+        unsigned version;
+    };
+
+    // The render thread reads without locking, so update() never waits on a draw
+    RcuCell<Published> published;
+    std::mutex update_mutex;  // Between callers of update()
+    StatusSnapshot last_snapshot;
+    unsigned last_version = 0;
+
+    std::mutex mutex;
+    std::condition_variable wake_cv;
+    bool stopping = false;
+    std::thread thread;
+
+    std::string drawn_line;  // Only touched by the render thread
+
+    static void lower_priority() {
+#ifdef _WIN32
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(SCHED_IDLE)
+        sched_param param{};
+        pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+    }
+
+    // Never blocks: stops at the first sign the output is full. False unless all was written.
+    bool write_available(const std::string& data) {
+#ifdef _WIN32
+        return std::fwrite(data.data(), 1, data.size(), stdout) == data.size() && std::fflush(stdout) == 0;
+#else
+        size_t offset = 0;
+        while (offset < data.size()) {
+            pollfd pfd{fd, POLLOUT, 0};
+            if (poll(&pfd, 1, 0) <= 0 || !(pfd.revents & POLLOUT)) {
+                return false;
+            }
+            ssize_t written = ::write(fd, data.data() + offset, data.size() - offset);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            offset += static_cast<size_t>(written);
+        }
+        return true;
+#endif
+    }
+
+    bool draw(const StatusSnapshot& current) {
+        if (!current.active) {
+            return true;
+        }
+        std::string line = format_status_line(current);
+        if (line == drawn_line) {
+            return true;
+        }
+
+        std::string frame = "\r" + line;
+        if (terminal) {
+            frame += "\x1b[K";  // Clear what a longer previous line left behind
+        } else if (drawn_line.size() > line.size()) {
+            frame.append(drawn_line.size() - line.size(), ' ');
+        }
+        if (!write_available(frame)) {
+            // A torn frame is repaired by the next full redraw
+            drawn_line.clear();
+            return false;
+        }
+        drawn_line = std::move(line);
+        return true;
+    }
+
+    void run(RcuCell<Published>::Reader reader) {
+        lower_priority();
+        unsigned drawn_version = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            wake_cv.wait_for(lock, frame_interval, [this]() { return stopping; });
+            if (stopping) {
+                continue;
+            }
+            lock.unlock();
+            {
+                auto current = reader.read();
+                if (current && current->version != drawn_version && draw(current->snapshot)) {
+                    drawn_version = current->version;
+                }
+            }
+            lock.lock();
+        }
+    }
+};
+
+StatusRenderer::StatusRenderer(int fd, std::chrono::milliseconds frame_interval)
+    : m_impl(std::make_unique<Impl>()) {
+    m_impl->fd = fd;
+    m_impl->frame_interval = frame_interval;
+#ifndef _WIN32
+    m_impl->terminal = isatty(fd) == 1;
+#endif
+}
+
+StatusRenderer::~StatusRenderer() {
+    stop();
+}
+
+void StatusRenderer::start() {
+    if (m_impl->thread.joinable()) {
+        return;
+    }
+    m_impl->stopping = false;
+    m_impl->thread = std::thread([this, reader = m_impl->published.reader()]() mutable {
+        m_impl->run(std::move(reader));
+    });
+}
+
+void StatusRenderer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        m_impl->stopping = true;
+    }
+    m_impl->wake_cv.notify_all();
+    if (m_impl->thread.joinable()) {
+        m_impl->thread.join();
+    }
+}
+
+void StatusRenderer::update(const StatusSnapshot& snapshot) {
+    std::lock_guard<std::mutex> lock(m_impl->update_mutex);
+    if (snapshot != m_impl->last_snapshot) {
+        m_impl->last_snapshot = snapshot;
+        m_impl->published.publish(Impl::Published{snapshot, ++m_impl->last_version});
+    }
+}
+
+}
@@ -0,0 +1,602 @@
+#include "tag_reader.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#else
+    #include <fstream>
+#endif
+
+namespace nigamp {
+
+namespace {
+
+using Bytes = std::vector<unsigned char>;
+
+// Enough for the text frames of a typical ID3v2 tag; cover art past this is never read
+constexpr size_t HEAD_BYTES = 16 * 1024;
+// Where the first MPEG frame is looked for once the tag is skipped
+constexpr size_t FRAME_SEARCH_BYTES = 4 * 1024;
+constexpr size_t ID3V1_SIZE = 128;
+constexpr size_t MAX_LIST_CHUNK = 64 * 1024;
+constexpr int MAX_RIFF_CHUNKS = 64;
+
+// Positional reads, so no file offset is shared or sought
+class TagFile {
+private:
+#ifndef _WIN32
+    int m_fd = -1;
+#else
+    std::ifstream m_file;
+#endif
+    uint64_t m_size = 0;
+
+public:
+    ~TagFile() {
+#ifndef _WIN32
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+#endif
+    }
+
+    bool open(const std::string& path) {
+#ifndef _WIN32
+        m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat info;
+        if (m_fd < 0 || ::fstat(m_fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+            return false;
+        }
+        m_size = static_cast<uint64_t>(info.st_size);
+        return true;
+#else
+        m_file.open(path, std::ios::binary | std::ios::ate);
+        if (!m_file) {
+            return false;
+        }
+        m_size = static_cast<uint64_t>(m_file.tellg());
+        return true;
+#endif
+    }
+
+    uint64_t size() const {
+        return m_size;
+    }
+
+    // Shorter than length near the end of the file or on a read error
+    Bytes read(uint64_t offset, size_t length) {
+        if (offset >= m_size) {
+            return {};
+        }
+        Bytes buffer(static_cast<size_t>(std::min<uint64_t>(length, m_size - offset)));
+        size_t filled = 0;
+#ifndef _WIN32
+        while (filled < buffer.size()) {
+            ssize_t got = ::pread(m_fd, buffer.data() + filled, buffer.size() - filled,
+                                  static_cast<off_t>(offset + filled));
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                break;
+            }
+            filled += static_cast<size_t>(got);
+        }
+#else
+        m_file.clear();
+        m_file.seekg(static_cast<std::streamoff>(offset));
+        m_file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        filled = static_cast<size_t>(std::max<std::streamsize>(0, m_file.gcount()));
+#endif
+        buffer.resize(filled);
+        return buffer;
+    }
+
+    // Served from the head buffer when it already holds the range
+    Bytes read(const Bytes& head, uint64_t offset, size_t length) {
+        if (offset + length <= head.size()) {
+            return Bytes(head.begin() + static_cast<ptrdiff_t>(offset),
+                         head.begin() + static_cast<ptrdiff_t>(offset + length));
+        }
+        return read(offset, length);
+    }
+};
+
+uint32_t be32(const unsigned char* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+uint32_t le32(const unsigned char* p) {
+    return (static_cast<uint32_t>(p[3]) << 24) | (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[1]) << 8) | p[0];
+}
+
+uint32_t syncsafe32(const unsigned char* p) {
+    return (static_cast<uint32_t>(p[0] & 0x7F) << 21) | (static_cast<uint32_t>(p[1] & 0x7F) << 14) |
+           (static_cast<uint32_t>(p[2] & 0x7F) << 7) | (p[3] & 0x7F);
+}
+
+void append_utf8(std::string& out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+bool is_valid_utf8(const unsigned char* p, size_t length) {
+    size_t i = 0;
+    while (i < length) {
+        unsigned char c = p[i];
+        size_t extra = c < 0x80 ? 0 : (c & 0xE0) == 0xC0 ? 1 : (c & 0xF0) == 0xE0 ? 2 : (c & 0xF8) == 0xF0 ? 3 : 4;
+        if (extra == 4 || length - i <= extra) {
+            return false;
+        }
+        for (size_t k = 1; k <= extra; ++k) {
+            if ((p[i + k] & 0xC0) != 0x80) {
+                return false;
+            }
+        }
+        i += extra + 1;
+    }
+    return true;
+}
+
+std::string trim(std::string text) {
+    size_t end = text.find_last_not_of(std::string(" \t\r\n\0", 5));
+    if (end == std::string::npos) {
+        return "";
+    }
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+// Tags that should be Latin-1 are often UTF-8 in practice; keep those as they are
+std::string decode_legacy_text(const unsigned char* p, size_t length) {
+    length = static_cast<size_t>(std::find(p, p + length, 0) - p);
+    if (is_valid_utf8(p, length)) {
+        return trim(std::string(reinterpret_cast<const char*>(p), length));
+    }
+    std::string out;
+    for (size_t i = 0; i < length; ++i) {
+        append_utf8(out, p[i]);
+    }
+    return trim(out);
+}
+
+std::string decode_utf16(const unsigned char* p, size_t length, bool big_endian) {
+    std::string out;
+    for (size_t i = 0; i + 1 < length; i += 2) {
+        uint32_t unit = big_endian ? (p[i] << 8 | p[i + 1]) : (p[i + 1] << 8 | p[i]);
+        if (unit == 0) {
+            break;
+        }
+        if (unit >= 0xD800 && unit < 0xDC00 && i + 3 < length) {
+            uint32_t low = big_endian ? (p[i + 2] << 8 | p[i + 3]) : (p[i + 3] << 8 | p[i + 2]);
+            if (low >= 0xDC00 && low < 0xE000) {
+                append_utf8(out, 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00));
+                i += 2;
+                continue;
+            }
+        }
+        append_utf8(out, unit >= 0xD800 && unit < 0xE000 ? 0xFFFD : unit);
+    }
+    return trim(out);
+}
+
+// First value of an ID3v2 text frame: encoding byte, then the text
+std::string decode_id3_text(const Bytes& frame) {
+    if (frame.empty()) {
+        return "";
+    }
+    const unsigned char* p = frame.data() + 1;
+    size_t length = frame.size() - 1;
+    switch (frame[0]) {
+        case 0:
+            return decode_legacy_text(p, length);
+        case 1:
+            if (length >= 2 && p[0] == 0xFE && p[1] == 0xFF) {
+                return decode_utf16(p + 2, length - 2, true);
+            }
+            if (length >= 2 && p[0] == 0xFF && p[1] == 0xFE) {
+                return decode_utf16(p + 2, length - 2, false);
+            }
+            return decode_utf16(p, length, false);
+        case 2:
+            return decode_utf16(p, length, true);
+        case 3:
+            return decode_legacy_text(p, length);
+        default:
+            return "";
+    }
+}
+
+// Undoes the 0xFF 0x00 escaping of unsynchronised tags and frames
+Bytes remove_unsync(const Bytes& data) {
+    Bytes out;
+    out.reserve(data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+        out.push_back(data[i]);
+        if (data[i] == 0xFF && i + 1 < data.size() && data[i + 1] == 0x00) {
+            ++i;
+        }
+    }
+    return out;
+}
+
+struct TagFields {
+    std::string title;
+    std::string artist;
+    double duration = 0.0;
+};
+
+// Returns the size of the ID3v2 tag at the start of head, header and footer
+// included, or 0 if there is none. Frames past the end of head are ignored.
+uint64_t parse_id3v2(const Bytes& head, TagFields& fields) {
+    if (head.size() < 10 || std::memcmp(head.data(), "ID3", 3) != 0) {
+        return 0;
+    }
+    int major = head[3];
+    unsigned char flags = head[5];
+    uint64_t tag_size = syncsafe32(&head[6]);
+    uint64_t total = 10 + tag_size + ((major == 4 && (flags & 0x10)) ? 10 : 0);
+    if (major < 2 || major > 4) {
+        return total;
+    }
+
+    size_t available = static_cast<size_t>(std::min<uint64_t>(head.size(), 10 + tag_size));
+    Bytes body(head.begin() + 10, head.begin() + static_cast<ptrdiff_t>(available));
+    if ((flags & 0x80) && major < 4) {
+        body = remove_unsync(body);  // v2.4 marks unsynchronisation per frame instead
+    }
+
+    size_t pos = 0;
+    if ((flags & 0x40) && major >= 3) {
+        if (body.size() < 4) {
+            return total;
+        }
+        pos = major == 4 ? syncsafe32(body.data()) : be32(body.data()) + 4;
+    }
+
+    size_t id_length = major == 2 ? 3 : 4;
+    size_t header_length = major == 2 ? 6 : 10;
+    while (pos + header_length <= body.size() && body[pos] != 0) {
+        const unsigned char* header = body.data() + pos;
+        std::string id(reinterpret_cast<const char*>(header), id_length);
+        size_t size = major == 2 ? (static_cast<size_t>(header[3]) << 16 | header[4] << 8 | header[5])
+                    : major == 4 ? syncsafe32(header + 4) : be32(header + 4);
+        unsigned format_flags = major == 2 ? 0 : header[9];
+        pos += header_length;
+        if (size > body.size() - pos) {
+            break;
+        }
+        Bytes frame(body.begin() + static_cast<ptrdiff_t>(pos), body.begin() + static_cast<ptrdiff_t>(pos + size));
+        pos += size;
+
+        // Compressed or encrypted frames are skipped; grouping ids and data lengths are stripped
+        size_t prefix = 0;
+        if (major == 3) {
+            if (format_flags & 0xC0) {
+                continue;
+            }
+            prefix = (format_flags & 0x20) ? 1 : 0;
+        } else if (major == 4) {
+            if (format_flags & 0x0C) {
+                continue;
+            }
+            prefix = ((format_flags & 0x40) ? 1 : 0) + ((format_flags & 0x01) ? 4 : 0);
+        }
+        if (prefix > frame.size()) {
+            continue;
+        }
+        frame.erase(frame.begin(), frame.begin() + static_cast<ptrdiff_t>(prefix));
+        if (major == 4 && (format_flags & 0x02)) {
+            frame = remove_unsync(frame);
+        }
+
+        if ((id == "TIT2" || id == "TT2") && fields.title.empty()) {
+            fields.title = decode_id3_text(frame);
+        } else if ((id == "TPE1" || id == "TP1") && fields.artist.empty()) {
+            fields.artist = decode_id3_text(frame);
+        } else if ((id == "TLEN" || id == "TLE") && fields.duration <= 0.0) {
+            fields.duration = std::atof(decode_id3_text(frame).c_str()) / 1000.0;
+        }
+    }
+    return total;
+}
+
+struct MpegFrame {
+    int version = 1;  // 1, 2, or 25 for MPEG 2.5
+    int layer = 3;
+    int bitrate_kbps = 0;
+    int sample_rate = 0;
+    int samples = 0;
+    bool mono = false;
+    size_t bytes = 0;
+};
+
+bool parse_mpeg_header(const unsigned char* p, MpegFrame& frame) {
+    static const int BITRATES[5][15] = {
+        {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},  // V1 L1
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},     // V1 L2
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},      // V1 L3
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},     // V2 L1
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},          // V2 L2/L3
+    };
+    static const int SAMPLE_RATES[3] = {44100, 48000, 32000};
+
+    if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) {
+        return false;
+    }
+    int version_bits = (p[1] >> 3) & 0x03;
+    int layer_bits = (p[1] >> 1) & 0x03;
+    int bitrate_index = p[2] >> 4;
+    int rate_index = (p[2] >> 2) & 0x03;
+    if (version_bits == 1 || layer_bits == 0 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3) {
+        return false;
+    }
+
+    frame.version = version_bits == 3 ? 1 : version_bits == 2 ? 2 : 25;
+    frame.layer = 4 - layer_bits;
+    int table = frame.version == 1 ? frame.layer - 1 : (frame.layer == 1 ? 3 : 4);
+    frame.bitrate_kbps = BITRATES[table][bitrate_index];
+    frame.sample_rate = SAMPLE_RATES[rate_index] / (frame.version == 1 ? 1 : frame.version == 2 ? 2 : 4);
+    frame.samples = frame.layer == 1 ? 384 : (frame.layer == 3 && frame.version != 1) ? 576 : 1152;
+    frame.mono = (p[3] >> 6) == 3;
+    bool padding = (p[2] >> 1) & 0x01;
+    if (frame.layer == 1) {
+        frame.bytes = (12 * frame.bitrate_kbps * 1000 / frame.sample_rate + padding) * 4;
+    } else {
+        frame.bytes = static_cast<size_t>(frame.samples / 8 * frame.bitrate_kbps * 1000 / frame.sample_rate) + padding;
+    }
+    return true;
+}
+
+// First frame whose successor (when it lies inside data) also parses alike
+bool find_first_frame(const Bytes& data, size_t& offset, MpegFrame& frame) {
+    for (size_t i = 0; i + 4 <= data.size(); ++i) {
+        if (!parse_mpeg_header(&data[i], frame)) {
+            continue;
+        }
+        size_t next = i + frame.bytes;
+        MpegFrame following;
+        if (next + 4 > data.size() ||
+            (parse_mpeg_header(&data[next], following) && following.version == frame.version &&
+             following.layer == frame.layer && following.sample_rate == frame.sample_rate)) {
+            offset = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Exact length from a Xing/Info or VBRI header in the first frame, 0 without one
+double vbr_duration(const Bytes& data, size_t offset, const MpegFrame& frame) {
+    size_t side_info = frame.version == 1 ? (frame.mono ? 17 : 32) : (frame.mono ? 9 : 17);
+    size_t xing = offset + 4 + side_info;
+    uint32_t frames = 0;
+    if (xing + 12 <= data.size() &&
+        (std::memcmp(&data[xing], "Xing", 4) == 0 || std::memcmp(&data[xing], "Info", 4) == 0)) {
+        if (be32(&data[xing + 4]) & 0x01) {
+            frames = be32(&data[xing + 8]);
+        }
+    } else if (offset + 36 + 18 <= data.size() && std::memcmp(&data[offset + 36], "VBRI", 4) == 0) {
+        frames = be32(&data[offset + 36 + 14]);
+    }
+    return static_cast<double>(frames) * frame.samples / frame.sample_rate;
+}
+
+bool read_mp3_tags(TagFile& file, const Bytes& head, Song& song) {
+    TagFields fields;
+    uint64_t audio_start = parse_id3v2(head, fields);
+    bool tagged = audio_start > 0;
+
+    uint64_t audio_end = file.size();
+    if (file.size() >= audio_start + ID3V1_SIZE) {
+        Bytes tail = file.read(file.size() - ID3V1_SIZE, ID3V1_SIZE);
+        if (tail.size() == ID3V1_SIZE && std::memcmp(tail.data(), "TAG", 3) == 0) {
+            tagged = true;
+            audio_end -= ID3V1_SIZE;
+            if (fields.title.empty()) {
+                fields.title = decode_legacy_text(&tail[3], 30);
+            }
+            if (fields.artist.empty()) {
+                fields.artist = decode_legacy_text(&tail[33], 30);
+            }
+        }
+    }
+
+    Bytes audio = file.read(head, audio_start, FRAME_SEARCH_BYTES);
+    size_t offset = 0;
+    MpegFrame frame;
+    bool has_frame = find_first_frame(audio, offset, frame);
+    if (has_frame) {
+        double exact = vbr_duration(audio, offset, frame);
+        if (exact > 0.0) {
+            fields.duration = exact;
+        } else if (fields.duration <= 0.0 && audio_end > audio_start + offset) {
+            // Constant bitrate: the rest of the file is audio at the first frame's rate
+            fields.duration = static_cast<double>(audio_end - audio_start - offset) * 8.0 /
+                              (frame.bitrate_kbps * 1000.0);
+        }
+    }
+    if (!tagged && !has_frame) {
+        return false;
+    }
+
+    if (!fields.title.empty()) {
+        song.title = fields.title;
+    }
+    if (!fields.artist.empty()) {
+        song.artist = fields.artist;
+    }
+    if (fields.duration > 0.0) {
+        song.duration = fields.duration;
+    }
+    return true;
+}
+
+// Walks the RIFF chunks with small positional reads; the LIST chunk is often
+// after the audio data, near the end of the file
+bool read_wav_tags(TagFile& file, const Bytes& head, Song& song) {
+    TagFields fields;
+    uint32_t byte_rate = 0;
+    uint64_t data_size = 0;
+    uint64_t pos = 12;
+    for (int i = 0; i < MAX_RIFF_CHUNKS && pos + 8 <= file.size(); ++i) {
+        Bytes header = file.read(head, pos, 8);
+        if (header.size() < 8) {
+            break;
+        }
+        uint64_t size = le32(&header[4]);
+        uint64_t body = pos + 8;
+
+        if (std::memcmp(header.data(), "fmt ", 4) == 0) {
+            Bytes format = file.read(head, body, 16);
+            if (format.size() == 16) {
+                byte_rate = le32(&format[8]);
+            }
+        } else if (std::memcmp(header.data(), "data", 4) == 0) {
+            // Streamed files may leave the size unset; the rest of the file is audio then
+            data_size = std::min(size, file.size() - body);
+        } else if (std::memcmp(header.data(), "LIST", 4) == 0) {
+            Bytes list = file.read(head, body, static_cast<size_t>(std::min<uint64_t>(size, MAX_LIST_CHUNK)));
+            if (list.size() >= 4 && std::memcmp(list.data(), "INFO", 4) == 0) {
+                size_t at = 4;
+                while (at + 8 <= list.size()) {
+                    size_t length = le32(&list[at + 4]);
+                    size_t text = at + 8;
+                    if (length > list.size() - text) {
+                        break;
+                    }
+                    if (std::memcmp(&list[at], "INAM", 4) == 0 && fields.title.empty()) {
+                        fields.title = decode_legacy_text(&list[text], length);
+                    } else if (std::memcmp(&list[at], "IART", 4) == 0 && fields.artist.empty()) {
+                        fields.artist = decode_legacy_text(&list[text], length);
+                    }
+                    at = text + length + (length & 1);
+                }
+            }
+        }
+        pos = body + size + (size & 1);
+    }
+
+    if (!fields.title.empty()) {
+        song.title = fields.title;
+    }
+    if (!fields.artist.empty()) {
+        song.artist = fields.artist;
+    }
+    if (byte_rate > 0 && data_size > 0) {
+        song.duration = static_cast<double>(data_size) / byte_rate;
+    }
+    return true;
+}
+
+}
+
+bool read_song_tags(const std::string& path, Song& song) {
+    TagFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+    Bytes head = file.read(0, HEAD_BYTES);
+    if (head.size() >= 12 && std::memcmp(head.data(), "RIFF", 4) == 0 && std::memcmp(&head[8], "WAVE", 4) == 0) {
+        return read_wav_tags(file, head, song);
+    }
+    return read_mp3_tags(file, head, song);
+}
+
+struct TagReader::Impl {
+    std::mutex mutex;
+    std::condition_variable work_cv;  // Queue not empty, or stopping
+    std::condition_variable room_cv;  // Outstanding fell below the bound
+    std::condition_variable idle_cv;  // Outstanding reached zero
+    std::deque<std::pair<Song, Callback>> queue;
+    std::vector<std::thread> workers;
+    size_t outstanding = 0;  // Queued plus being read
+    size_t max_outstanding = 1;
+    bool stopping = false;
+
+    void worker_loop() {
+        for (;;) {
+            std::pair<Song, Callback> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_cv.wait(lock, [this]() { return stopping || !queue.empty(); });
+                if (stopping) {
+                    return;
+                }
+                job = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            read_song_tags(job.first.file_path, job.first);
+            job.second(std::move(job.first));
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --outstanding;
+            }
+            room_cv.notify_one();
+            idle_cv.notify_all();
+        }
+    }
+};
+
+TagReader::TagReader(unsigned threads, size_t max_outstanding) : m_impl(std::make_unique<Impl>()) {
+    m_impl->max_outstanding = std::max<size_t>(1, max_outstanding);
+    for (unsigned i = 0; i < std::max(1u, threads); ++i) {
+        m_impl->workers.emplace_back([this]() { m_impl->worker_loop(); });
+    }
+}
+
+TagReader::~TagReader() {
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        m_impl->stopping = true;
+    }
+    m_impl->work_cv.notify_all();
+    for (auto& worker : m_impl->workers) {
+        worker.join();
+    }
+}
+
+void TagReader::request(Song song, Callback done) {
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->room_cv.wait(lock, [this]() { return m_impl->outstanding < m_impl->max_outstanding; });
+    ++m_impl->outstanding;
+    m_impl->queue.emplace_back(std::move(song), std::move(done));
+    lock.unlock();
+    m_impl->work_cv.notify_one();
+}
+
+void TagReader::wait() {
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->idle_cv.wait(lock, [this]() { return m_impl->outstanding == 0; });
+}
+
+}
@@ -0,0 +1,173 @@
+#include "trace.hpp"
+
+#ifdef NIGAMP_TRACING
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nigamp {
+
+namespace {
+
+struct ThreadBuffer : TraceRing {
+    uint32_t tid = 0;
+    std::string name;
+};
+
+struct Registry {
+    std::mutex mutex;  // Only taken when a thread records its first span and on export
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    uint32_t next_tid = 1;
+    // Paired readings of both clocks; export measures the tick rate against a second pair
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    const uint64_t epoch_ticks = trace_ticks();
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// The registry keeps each buffer alive after its thread exits so the spans can still be exported
+thread_local std::shared_ptr<ThreadBuffer> t_buffer;
+thread_local const char* t_thread_name = nullptr;
+
+double ns_per_tick(const Registry& reg) {
+    uint64_t ticks = trace_ticks();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - reg.epoch).count();
+    return ticks > reg.epoch_ticks && ns > 0.0 ? ns / static_cast<double>(ticks - reg.epoch_ticks) : 1.0;
+}
+
+void write_json_string(std::ofstream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+}
+
+// Allocated on the first recorded span, so threads that never trace cost nothing
+TraceRing& trace_detail::create_ring() {
+    auto created = std::make_shared<ThreadBuffer>();
+    Registry& reg = registry();
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        created->tid = reg.next_tid++;
+        created->name = t_thread_name ? t_thread_name : "";
+        reg.buffers.push_back(created);
+    }
+    t_ring = created.get();
+    t_buffer = std::move(created);
+    return *t_buffer;
+}
+
+void trace_enable(bool enabled) {
+    registry();  // Fix the epoch before the first span
+    trace_detail::g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void trace_set_thread_name(const char* name) {
+    t_thread_name = name;
+    if (t_buffer) {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        t_buffer->name = name;
+    }
+}
+
+bool write_chrome_trace(const std::string& path) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    const double scale = ns_per_tick(reg) / 1000.0;  // Ticks to microseconds
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&]() {
+        out << (first ? "" : ",\n");
+        first = false;
+    };
+
+    for (const auto& buffer : reg.buffers) {
+        if (!buffer->name.empty()) {
+            separator();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{\"name\":";
+            write_json_string(out, buffer->name);
+            out << "}}";
+        }
+
+        uint64_t end = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = end > ThreadBuffer::CAPACITY ? end - ThreadBuffer::CAPACITY : 0;
+        std::vector<TraceEvent> events;
+        for (uint64_t i = begin; i < end; ++i) {
+            events.push_back(buffer->events[i % ThreadBuffer::CAPACITY]);
+        }
+        // Slots the writer reached again while we copied (or is writing now) are not trustworthy
+        uint64_t lapped = buffer->head.load(std::memory_order_acquire);
+        uint64_t oldest_intact = lapped >= ThreadBuffer::CAPACITY ? lapped - ThreadBuffer::CAPACITY + 1 : 0;
+        size_t skip = oldest_intact > begin
+                          ? static_cast<size_t>(std::min<uint64_t>(oldest_intact - begin, events.size()))
+                          : 0;
+
+        char timing[96];
+        for (size_t i = skip; i < events.size(); ++i) {
+            separator();
+            out << "{\"name\":";
+            write_json_string(out, events[i].name);
+            // Spans from before the epoch (the enabling thread's first span) clamp to 0
+            double start = static_cast<double>(static_cast<int64_t>(events[i].start_ticks - reg.epoch_ticks));
+            double duration = static_cast<double>(events[i].end_ticks - events[i].start_ticks);
+            snprintf(timing, sizeof(timing), ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":",
+                     std::max(0.0, start * scale), duration * scale);
+            out << timing << buffer->tid << "}";
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+void trace_clear() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto& buffer : reg.buffers) {
+        buffer->head.store(0, std::memory_order_release);
+    }
+}
+
+}
+
+#else
+
+namespace nigamp {
+
+void trace_enable(bool) {}
+
+// Never reached: nothing can enable recording in this build
+TraceRing& trace_detail::create_ring() {
+    static TraceRing unused;
+    return unused;
+}
+
+void trace_set_thread_name(const char*) {}
+
+bool write_chrome_trace(const std::string&) {
+    return false;
+}
+
+void trace_clear() {}
+
+}
+
+#endif
@@ -0,0 +1,120 @@
+// Round-trip latency of the control socket: a client sends one request, waits
+// for its reply, and repeats. The server runs on an event loop thread exactly
+// as in the player, with a command handler that only counts.
+//
+// Usage: bench_control_latency [round_trips]
+
+#include "control_server.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace nigamp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+int connect_to(const std::string& path) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::perror("connect");
+        std::exit(1);
+    }
+    return fd;
+}
+
+// Reads until the reply is complete: one frame, or one line in JSON mode
+void await_reply(int fd, bool json) {
+    std::string buffer;
+    char chunk[512];
+    ControlOpcode opcode;
+    std::string payload;
+    for (;;) {
+        if (json ? buffer.find('\n') != std::string::npos
+                 : decode_control_frame(buffer.data(), buffer.size(), opcode, payload) > 0) {
+            return;
+        }
+        ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            std::fprintf(stderr, "server closed the connection\n");
+            std::exit(1);
+        }
+        buffer.append(chunk, static_cast<size_t>(received));
+    }
+}
+
+void run_case(const char* name, const std::string& path, const std::string& request, bool json, int round_trips) {
+    int fd = connect_to(path);
+    std::vector<double> micros;
+    micros.reserve(round_trips);
+
+    for (int i = 0; i < round_trips; ++i) {
+        auto start = Clock::now();
+        if (::send(fd, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size())) {
+            std::perror("send");
+            std::exit(1);
+        }
+        await_reply(fd, json);
+        micros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    ::close(fd);
+
+    std::sort(micros.begin(), micros.end());
+    auto percentile = [&](double p) {
+        return micros[std::min(micros.size() - 1, static_cast<size_t>(p * micros.size()))];
+    };
+    std::printf("%-16s n=%-7d min %7.1f us  p50 %7.1f us  p99 %7.1f us  max %8.1f us\n",
+                name, round_trips, micros.front(), percentile(0.50), percentile(0.99), micros.back());
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    int round_trips = argc > 1 ? std::atoi(argv[1]) : 20000;
+    if (round_trips <= 0) {
+        std::fprintf(stderr, "Usage: %s [round_trips]\n", argv[0]);
+        return 1;
+    }
+
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("nigamp_bench_" + std::to_string(::getpid()) + ".sock")).string();
+    EpollEventLoop loop;
+    ControlServer server(loop);
+    size_t commands = 0;
+    if (!server.start(path, [&commands](const PlayerCommand&) { ++commands; }, []() {
+            PlayerStatus status;
+            status.state = PlaybackState::PLAYING;
+            status.title = "Benchmark Track";
+            return status;
+        })) {
+        return 1;
+    }
+    std::thread loop_thread([&loop]() { loop.run(); });
+
+    run_case("binary ping", path, encode_control_frame(ControlOpcode::PING), false, round_trips);
+    run_case("binary volume", path, encode_control_frame(ControlOpcode::VOLUME, encode_f64(0.0)), false, round_trips);
+    run_case("binary status", path, encode_control_frame(ControlOpcode::STATUS), false, round_trips);
+    run_case("json ping", path, "{\"cmd\":\"ping\"}\n", true, round_trips);
+    run_case("json volume", path, "{\"cmd\":\"volume\",\"delta\":0}\n", true, round_trips);
+    run_case("json status", path, "{\"cmd\":\"status\"}\n", true, round_trips);
+
+    loop.post([&]() {
+        server.stop();
+        loop.stop();
+    });
+    loop_thread.join();
+    std::printf("commands handled: %zu\n", commands);
+    return 0;
+}
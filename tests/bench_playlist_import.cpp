@@ -0,0 +1,114 @@
+// Time to import a large M3U8 playlist into the up-next queue: streaming the
+// file, resolving each entry and queueing it. Entries resolve either against
+// songs the playlist already has or, for a cold start, the library index.
+//
+// Usage: bench_playlist_import [entries]
+
+#include "playlist.hpp"
+#include "playlist_file.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+using namespace nigamp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+Song make_song(size_t i) {
+    return Song{"/music/artist" + std::to_string(i % 500) + "/album" + std::to_string(i % 7) + "/track" +
+                    std::to_string(i) + ".mp3",
+                "Track " + std::to_string(i), "Artist " + std::to_string(i % 500), 180.0 + i % 120};
+}
+
+// Returns the number of songs queued
+size_t import_into(IPlaylist& playlist, const std::string& path, const LibraryIndex* index) {
+    size_t queued = 0;
+    SongList new_songs;
+    read_playlist(path, [&](std::vector<PlaylistEntry>& batch) {
+        resolve_playlist_entries(batch, playlist.library(), index, new_songs);
+        playlist.add_songs(new_songs);
+        for (const auto& entry : batch) {
+            playlist.enqueue(playlist.library().find(entry.path));
+        }
+        queued += batch.size();
+        return true;
+    });
+    return queued;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    if (count == 0) {
+        std::fprintf(stderr, "Usage: %s [entries]\n", argv[0]);
+        return 1;
+    }
+    std::string directory = (std::filesystem::temp_directory_path() / "nigamp_bench_playlist_import").string();
+    std::filesystem::create_directories(directory);
+    std::string playlist_path = directory + "/large.m3u8";
+    std::string index_path = directory + "/library.idx";
+
+    {
+        auto start = Clock::now();
+        PlaylistWriter writer;
+        if (!writer.open(playlist_path)) {
+            std::fprintf(stderr, "Cannot write %s\n", playlist_path.c_str());
+            return 1;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            Song song = make_song(i);
+            writer.write(PlaylistEntry{song.file_path, song.title, song.duration});
+        }
+        writer.close();
+        std::printf("write %zu entries          %8.1f ms  (%.1f MiB)\n", count, seconds_since(start) * 1e3,
+                    std::filesystem::file_size(playlist_path) / 1048576.0);
+    }
+
+    {
+        auto start = Clock::now();
+        size_t entries = 0;
+        read_playlist(playlist_path, [&](std::vector<PlaylistEntry>& batch) {
+            entries += batch.size();
+            return true;
+        });
+        std::printf("parse only                    %8.1f ms  (%zu entries)\n", seconds_since(start) * 1e3, entries);
+    }
+
+    {
+        auto playlist = create_playlist();
+        SongList songs;
+        for (size_t i = 0; i < count; ++i) {
+            songs.push_back(make_song(i));
+        }
+        playlist->add_songs(songs);
+        playlist->shuffle();
+        auto start = Clock::now();
+        size_t queued = import_into(*playlist, playlist_path, nullptr);
+        std::printf("import, songs in library      %8.1f ms  (%zu queued)\n", seconds_since(start) * 1e3, queued);
+    }
+
+    {
+        std::vector<IndexedSong> indexed;
+        for (size_t i = 0; i < count; ++i) {
+            indexed.push_back(IndexedSong{make_song(i), {}});
+        }
+        save_library_index(index_path, "/music", std::move(indexed));
+        LibraryIndex index;
+        index.open(index_path);
+        auto playlist = create_playlist();
+        auto start = Clock::now();
+        size_t queued = import_into(*playlist, playlist_path, &index);
+        std::printf("import, songs from the index  %8.1f ms  (%zu queued)\n", seconds_since(start) * 1e3, queued);
+    }
+
+    std::filesystem::remove_all(directory);
+    return 0;
+}
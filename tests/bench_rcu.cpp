@@ -0,0 +1,157 @@
+// Read throughput of a published snapshot with 8 reader threads while one
+// writer keeps replacing it, for RcuCell against a mutex-guarded shared_ptr
+// and std::atomic_load on a shared_ptr. Each read touches the whole snapshot.
+//
+// Usage: bench_rcu [milliseconds] [publish_interval_us]
+
+#include "rcu.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace nigamp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr int READERS = 8;
+
+// Roughly what a status or up-next reader looks at
+struct Snapshot {
+    uint64_t version = 0;
+    std::vector<std::string> titles;
+};
+
+std::unique_ptr<Snapshot> make_snapshot(uint64_t version) {
+    auto snapshot = std::make_unique<Snapshot>();
+    snapshot->version = version;
+    for (int i = 0; i < 16; ++i) {
+        snapshot->titles.push_back("Upcoming track " + std::to_string(version + i));
+    }
+    return snapshot;
+}
+
+size_t touch(const Snapshot& snapshot) {
+    size_t total = static_cast<size_t>(snapshot.version);
+    for (const auto& title : snapshot.titles) {
+        total += title.size();
+    }
+    return total;
+}
+
+struct Result {
+    double reads_per_second;
+    uint64_t publishes;
+    double max_publish_us;
+};
+
+// Each reader thread calls make_reader() once, then reads until told to stop;
+// publish(next) replaces the snapshot
+template <typename MakeReader, typename Publish>
+Result run_case(int millis, int interval_us, MakeReader make_reader, Publish publish) {
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<size_t> sink{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < READERS; ++i) {
+        threads.emplace_back([&]() {
+            auto read_once = make_reader();
+            uint64_t count = 0;
+            size_t total = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                total += read_once();
+                ++count;
+            }
+            reads += count;
+            sink += total;
+        });
+    }
+
+    auto start = Clock::now();
+    auto end = start + std::chrono::milliseconds(millis);
+    uint64_t version = 0;
+    double max_publish_us = 0.0;
+    while (Clock::now() < end) {
+        auto next = make_snapshot(++version);
+        auto before = Clock::now();
+        publish(std::move(next));
+        double took = std::chrono::duration<double, std::micro>(Clock::now() - before).count();
+        max_publish_us = std::max(max_publish_us, took);
+        std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+    }
+    done = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return Result{reads.load() / seconds, version, max_publish_us};
+}
+
+void report(const char* name, const Result& result) {
+    std::printf("%-22s %8.1f M reads/s  (%5.2f M per reader)  %6llu publishes, slowest %7.1f us\n", name,
+                result.reads_per_second / 1e6, result.reads_per_second / 1e6 / READERS,
+                static_cast<unsigned long long>(result.publishes), result.max_publish_us);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    int millis = argc > 1 ? std::atoi(argv[1]) : 2000;
+    int interval_us = argc > 2 ? std::atoi(argv[2]) : 100;
+    if (millis <= 0 || interval_us < 0) {
+        std::fprintf(stderr, "Usage: %s [milliseconds] [publish_interval_us]\n", argv[0]);
+        return 1;
+    }
+
+    {
+        RcuCell<Snapshot> cell(make_snapshot(0));
+        Result result = run_case(
+            millis, interval_us,
+            [&cell]() {
+                auto reader = std::make_shared<RcuCell<Snapshot>::Reader>(cell.reader());
+                return [reader]() { return touch(*reader->read()); };
+            },
+            [&cell](std::unique_ptr<Snapshot> next) { cell.publish(std::move(next)); });
+        report("RcuCell", result);
+    }
+
+    {
+        std::mutex mutex;
+        std::shared_ptr<const Snapshot> current(make_snapshot(0));
+        Result result = run_case(
+            millis, interval_us,
+            [&]() {
+                return [&]() {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    return touch(*current);
+                };
+            },
+            [&](std::unique_ptr<Snapshot> next) {
+                std::shared_ptr<const Snapshot> replacement(std::move(next));
+                std::lock_guard<std::mutex> lock(mutex);
+                current.swap(replacement);
+            });
+        report("mutex", result);
+    }
+
+    {
+        std::shared_ptr<const Snapshot> current(make_snapshot(0));
+        Result result = run_case(
+            millis, interval_us,
+            [&]() {
+                return [&]() { return touch(*std::atomic_load(&current)); };
+            },
+            [&](std::unique_ptr<Snapshot> next) {
+                std::atomic_store(&current, std::shared_ptr<const Snapshot>(std::move(next)));
+            });
+        report("atomic shared_ptr", result);
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Shuffle cost for a large library: the playlist permutes 32-bit indices over
+// its song array, compared with copying a SongList and shuffling the copies.
+// The weighted and artist-spread strategies are timed on the same songs.
+// Heap figures are bytes in use according to malloc.
+//
+// Usage: bench_shuffle [songs]
+
+#include "playlist.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace nigamp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+size_t heap_in_use() {
+    return mallinfo2().uordblks;
+}
+
+double millis_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+Song make_song(size_t i) {
+    std::string artist = "Artist " + std::to_string(i / 200);
+    return Song{"/home/user/Music/" + artist + "/Album " + std::to_string(i / 12) + "/" +
+                    std::to_string(i % 12 + 1) + " Track " + std::to_string(i) + ".mp3",
+                "Track " + std::to_string(i), artist, 200.0};
+}
+
+void report(const char* name, double millis, size_t bytes, size_t songs) {
+    std::printf("%-28s %9.1f ms  %10.1f MiB  %6.1f B/song\n", name, millis, bytes / (1024.0 * 1024.0),
+                static_cast<double>(bytes) / songs);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    long count = argc > 1 ? std::atol(argv[1]) : 1000000;
+    if (count <= 1) {
+        std::fprintf(stderr, "Usage: %s [songs]\n", argv[0]);
+        return 1;
+    }
+    size_t songs = static_cast<size_t>(count);
+
+    size_t heap = heap_in_use();
+    auto start = Clock::now();
+    auto playlist = create_playlist();
+    for (size_t i = 0; i < songs; ++i) {
+        playlist->add_song(make_song(i));
+    }
+    report("add (store + ids)", millis_since(start), heap_in_use() - heap, songs);
+
+    heap = heap_in_use();
+    start = Clock::now();
+    playlist->shuffle();
+    report("shuffle (first)", millis_since(start), heap_in_use() - heap, songs);
+
+    std::vector<double> runs;
+    for (int i = 0; i < 5; ++i) {
+        start = Clock::now();
+        playlist->shuffle();
+        runs.push_back(millis_since(start));
+    }
+    std::sort(runs.begin(), runs.end());
+    report("shuffle (median of 5)", runs[2], 0, songs);
+
+    // The other strategies over the same library; half the songs have been played
+    for (size_t i = 0; i < songs; i += 2) {
+        playlist->record_play(playlist->songs()[i]);
+    }
+    for (const char* mode : {"weighted", "artist"}) {
+        playlist->set_shuffle_strategy(create_shuffle_strategy(mode));
+        start = Clock::now();
+        playlist->shuffle();
+        report((std::string("shuffle (") + mode + ")").c_str(), millis_since(start), 0, songs);
+    }
+    playlist->set_shuffle_strategy(create_uniform_shuffle());
+
+    // Songs streaming in while shuffled: one O(1) placement each. Heap growth
+    // here is mostly the store's vectors doubling, so only time is reported.
+    size_t streamed = songs / 10;
+    start = Clock::now();
+    for (size_t i = 0; i < streamed; ++i) {
+        playlist->add_song(make_song(songs + i));
+    }
+    report("add while shuffled (10%)", millis_since(start), 0, streamed);
+
+    // What shuffling a copied SongList costs
+    SongList list;
+    list.reserve(songs);
+    for (size_t i = 0; i < songs; ++i) {
+        list.push_back(make_song(i));
+    }
+    heap = heap_in_use();
+    start = Clock::now();
+    SongList copy = list;
+    std::mt19937 random_engine(1);
+    for (size_t i = copy.size() - 1; i > 0; --i) {
+        std::uniform_int_distribution<size_t> dist(0, i);
+        std::swap(copy[i], copy[dist(random_engine)]);
+    }
+    report("SongList copy + shuffle", millis_since(start), heap_in_use() - heap, songs);
+    return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+// A scratch file in the temp directory, gone before and after each test, for
+// the modules that save snapshots to disk
+class TempFileTest : public ::testing::Test {
+protected:
+    explicit TempFileTest(const std::string& name)
+        : path((std::filesystem::temp_directory_path() / name).string()) {}
+
+    void SetUp() override {
+        std::filesystem::remove(path);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(path);
+        std::filesystem::remove(path + ".tmp");
+    }
+
+    std::string read_file() {
+        std::ifstream file(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+    void write_file(const std::string& contents) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << contents;
+    }
+
+    std::string path;
+};
@@ -0,0 +1,411 @@
+#include <gtest/gtest.h>
+#include "../src/alsa_audio_engine.cpp"
+#include <future>
+#include <mutex>
+#include <vector>
+
+using namespace nigamp;
+using namespace std::chrono_literals;
+
+namespace nigamp {
+
+// alsa_pcm_device.cpp is not part of the test binary; every engine here is
+// built on a scripted device instead
+std::unique_ptr<IPcmDevice> create_alsa_pcm_device(const std::string&) {
+    return nullptr;
+}
+
+}
+
+namespace {
+
+// Device that keeps a copy of everything written. With auto_play the audio
+// counts as played as soon as it is written; otherwise it stays queued until
+// consume(). Faults are injected through the next avail() call.
+class ScriptedPcmDevice : public IPcmDevice {
+public:
+    bool can_pause = false;
+
+    int open(const AudioFormat& requested, PcmConfig& actual) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bool reopen = m_open_calls++ > 0;
+        m_requested_rate = requested.sample_rate;
+        m_config.sample_rate = reopen && m_reopen_rate ? m_reopen_rate : requested.sample_rate;
+        m_config.channels = reopen && m_reopen_channels ? m_reopen_channels : requested.channels;
+        m_config.buffer_frames = m_config.sample_rate;
+        m_config.period_frames = m_config.sample_rate / 20;
+        m_config.can_pause = can_pause;
+        actual = m_config;
+        m_open = true;
+        m_queued = 0;
+        m_open_offsets.push_back(m_written.size());
+        return 0;
+    }
+    void close() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_open = false;
+        m_queued = 0;
+    }
+    bool is_open() const override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_open;
+    }
+    int prepare() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued = 0;
+        return 0;
+    }
+    int resume() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_resume_result;
+    }
+    int drop() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued = 0;
+        return 0;
+    }
+    int pause(bool enable) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_paused = enable;
+        return 0;
+    }
+    long avail() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_avail_calls;
+        if (!m_open) {
+            return -ENODEV;
+        }
+        if (m_fault != 0) {
+            long fault = m_fault;
+            m_fault = 0;
+            return fault;
+        }
+        return static_cast<long>(m_config.buffer_frames - m_queued);
+    }
+    long write(const int16_t* samples, size_t frames) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_open) {
+            return -ENODEV;
+        }
+        frames = std::min(frames, m_config.buffer_frames - m_queued);
+        m_written.insert(m_written.end(), samples, samples + frames * m_config.channels);
+        if (!m_auto_play) {
+            m_queued += frames;
+        }
+        return static_cast<long>(frames);
+    }
+    long rewindable() override { return 0; }
+    long rewind(size_t) override { return 0; }
+
+    void set_auto_play(bool auto_play) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_auto_play = auto_play;
+        m_queued = auto_play ? 0 : m_queued;
+    }
+    void consume(size_t frames) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued -= std::min(frames, m_queued);
+    }
+    void fail_next_avail(long error) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_fault = error;
+    }
+    void set_resume_result(int result) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_resume_result = result;
+    }
+    // Format later opens come up in; 0 keeps what was asked
+    void set_reopen_format(int rate, int channels) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_reopen_rate = rate;
+        m_reopen_channels = channels;
+    }
+
+    int requested_rate() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_requested_rate;
+    }
+    int open_calls() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_open_calls;
+    }
+    bool paused() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_paused;
+    }
+    int avail_calls() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_avail_calls;
+    }
+    size_t queued() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queued;
+    }
+    size_t written_frames() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_written.size() / std::max(m_config.channels, 1);
+    }
+    std::vector<int16_t> written() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_written;
+    }
+    // Samples written since the most recent open
+    std::vector<int16_t> written_since_open() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return std::vector<int16_t>(m_written.begin() + m_open_offsets.back(), m_written.end());
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    bool m_open = false;
+    bool m_auto_play = true;
+    PcmConfig m_config;
+    size_t m_queued = 0;
+    long m_fault = 0;
+    int m_resume_result = 0;
+    int m_reopen_rate = 0;
+    int m_reopen_channels = 0;
+    int m_requested_rate = 0;
+    int m_open_calls = 0;
+    int m_avail_calls = 0;
+    bool m_paused = false;
+    std::vector<int16_t> m_written;
+    std::vector<size_t> m_open_offsets;
+};
+
+AudioFormat make_format(int rate, int channels = 1) {
+    AudioFormat format;
+    format.sample_rate = rate;
+    format.channels = channels;
+    format.bits_per_sample = 16;
+    return format;
+}
+
+}
+
+class AlsaAudioEngineTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        auto scripted = std::make_unique<ScriptedPcmDevice>();
+        device = scripted.get();
+        PcmRecoveryPolicy policy;
+        policy.initial_backoff = 10ms;
+        policy.max_backoff = 20ms;
+        engine = std::make_unique<AlsaAudioEngine>(std::move(scripted), policy);
+        engine->set_completion_callback([this](const CompletionResult& result) {
+            completion.set_value(result);
+        });
+        engine->set_event_callback([this](const AudioEngineEvent& event) {
+            std::lock_guard<std::mutex> lock(events_mutex);
+            events.push_back(event.type);
+        });
+    }
+
+    void TearDown() override {
+        engine->shutdown();
+    }
+
+    bool wait_for_completion(CompletionResult& result) {
+        auto future = completion.get_future();
+        if (future.wait_for(5s) != std::future_status::ready) {
+            return false;
+        }
+        result = future.get();
+        return true;
+    }
+
+    template <typename Predicate>
+    static bool eventually(Predicate predicate) {
+        auto deadline = std::chrono::steady_clock::now() + 5s;
+        while (!predicate()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(1ms);
+        }
+        return true;
+    }
+
+    bool saw_event(AudioEngineEventType type) {
+        std::lock_guard<std::mutex> lock(events_mutex);
+        return std::find(events.begin(), events.end(), type) != events.end();
+    }
+
+    // Plays a mono 48 kHz ramp until the device has played `heard` frames of it
+    // and is holding a full lead of the rest
+    void play_ramp_until(size_t heard) {
+        device->set_auto_play(false);
+        ASSERT_TRUE(engine->initialize(make_format(48000)));
+        ASSERT_TRUE(engine->start());
+        AudioBuffer ramp(48000);
+        for (size_t i = 0; i < ramp.size(); ++i) {
+            ramp[i] = ramp_sample(i);
+        }
+        ASSERT_TRUE(engine->write_samples(ramp));
+        ASSERT_TRUE(eventually([&]() { return device->queued() >= LEAD_FRAMES; }));
+        device->consume(heard);
+        ASSERT_TRUE(eventually([&]() { return engine->get_played_frames() == heard; }));
+        ASSERT_TRUE(eventually([&]() { return device->queued() >= LEAD_FRAMES; }));
+    }
+
+    static int16_t ramp_sample(size_t frame) {
+        return static_cast<int16_t>(1000 + frame % 20000);
+    }
+
+    // Four 50 ms periods at 48 kHz
+    static constexpr size_t LEAD_FRAMES = 9600;
+    // Past the fade-in that follows a recovery
+    static constexpr size_t AFTER_FADE_FRAMES = 1000;
+
+    ScriptedPcmDevice* device = nullptr;
+    std::unique_ptr<AlsaAudioEngine> engine;
+    std::promise<CompletionResult> completion;
+    std::mutex events_mutex;
+    std::vector<AudioEngineEventType> events;
+};
+
+TEST_F(AlsaAudioEngineTest, DeviceRateDoesNotFollowTheFirstTrack) {
+    ASSERT_TRUE(engine->initialize(make_format(22050)));
+    EXPECT_EQ(device->requested_rate(), 48000);
+
+    // Later tracks keep the device and are converted instead
+    ASSERT_TRUE(engine->initialize(make_format(44100)));
+    EXPECT_EQ(device->open_calls(), 1);
+}
+
+TEST_F(AlsaAudioEngineTest, ConfiguredDeviceRateIsRequested) {
+    engine->set_device_rate(44100);
+    ASSERT_TRUE(engine->initialize(make_format(32000)));
+    EXPECT_EQ(device->requested_rate(), 44100);
+}
+
+TEST_F(AlsaAudioEngineTest, TracksAreConvertedToTheDeviceRate) {
+    ASSERT_TRUE(engine->initialize(make_format(24000)));
+    ASSERT_TRUE(engine->start());
+    ASSERT_TRUE(engine->write_samples(AudioBuffer(2400, 8000)));  // 100 ms
+    engine->signal_eof();
+
+    CompletionResult result;
+    ASSERT_TRUE(wait_for_completion(result));
+    EXPECT_EQ(result.error_code, AudioEngineError::SUCCESS);
+
+    // 100 ms at the 48 kHz device rate, give or take the fade-in and filter edges
+    auto written = device->written();
+    size_t audible = std::count_if(written.begin(), written.end(), [](int16_t s) { return s != 0; });
+    EXPECT_NEAR(static_cast<double>(audible), 4800.0, 100.0);
+    EXPECT_NEAR(static_cast<double>(engine->get_played_frames()), 2400.0, 50.0);
+}
+
+TEST_F(AlsaAudioEngineTest, WaitingForAudioWakesAboutOncePerPeriod) {
+    ASSERT_TRUE(engine->initialize(make_format(48000)));
+    ASSERT_TRUE(engine->start());
+    std::this_thread::sleep_for(50ms);
+
+    // 50 ms periods: a fixed 5 ms sleep would check the device about 60 times here
+    int before = device->avail_calls();
+    std::this_thread::sleep_for(300ms);
+    EXPECT_LE(device->avail_calls() - before, 12);
+}
+
+TEST_F(AlsaAudioEngineTest, HardwarePauseLeavesTheThreadAsleep) {
+    device->can_pause = true;
+    ASSERT_TRUE(engine->initialize(make_format(48000)));
+    ASSERT_TRUE(engine->start());
+    ASSERT_TRUE(engine->write_samples(AudioBuffer(4800, 8000)));
+    ASSERT_TRUE(engine->pause());
+    ASSERT_TRUE(eventually([&]() { return device->paused(); }));
+
+    int before = device->avail_calls();
+    std::this_thread::sleep_for(200ms);
+    EXPECT_EQ(device->avail_calls(), before);
+
+    // Resume wakes it at once
+    ASSERT_TRUE(engine->resume());
+    ASSERT_TRUE(eventually([&]() { return !device->paused(); }));
+}
+
+TEST_F(AlsaAudioEngineTest, UnpluggedDeviceResumesFromWhatWasHeard) {
+    play_ramp_until(4800);
+    size_t before = device->written_frames();
+    EXPECT_EQ(before, 4800 + LEAD_FRAMES);
+
+    device->fail_next_avail(-ENODEV);
+    ASSERT_TRUE(eventually([&]() { return device->open_calls() == 2 && device->queued() >= LEAD_FRAMES; }));
+    EXPECT_TRUE(saw_event(AudioEngineEventType::DEVICE_LOST));
+    EXPECT_TRUE(eventually([&]() { return saw_event(AudioEngineEventType::DEVICE_RESTORED); }));
+
+    // The lead the old device dropped is played again, starting at frame 4800
+    auto replayed = device->written_since_open();
+    ASSERT_GE(replayed.size(), LEAD_FRAMES);
+    for (size_t i = AFTER_FADE_FRAMES; i < LEAD_FRAMES; ++i) {
+        ASSERT_EQ(replayed[i], ramp_sample(4800 + i)) << "frame " << i;
+    }
+    EXPECT_EQ(engine->get_played_frames(), 4800u);
+}
+
+TEST_F(AlsaAudioEngineTest, SuspendWithoutResumeReplaysTheDroppedLead) {
+    play_ramp_until(2400);
+
+    // No resume support: the stream is re-prepared and loses what it held
+    device->set_resume_result(-ENOSYS);
+    size_t before = device->written_frames();
+    device->fail_next_avail(-ESTRPIPE);
+    ASSERT_TRUE(eventually([&]() { return device->written_frames() >= before + LEAD_FRAMES; }));
+
+    auto written = device->written();
+    for (size_t i = AFTER_FADE_FRAMES; i < LEAD_FRAMES; ++i) {
+        ASSERT_EQ(written[before + i], ramp_sample(2400 + i)) << "frame " << i;
+    }
+    EXPECT_EQ(engine->get_played_frames(), 2400u);
+    EXPECT_EQ(device->open_calls(), 1);
+}
+
+TEST_F(AlsaAudioEngineTest, ResumedSuspendKeepsItsQueuedAudio) {
+    play_ramp_until(2400);
+    size_t before = device->written_frames();
+
+    device->fail_next_avail(-ESTRPIPE);
+    device->consume(2400);
+    // Carries on after the audio still queued, nothing replayed
+    ASSERT_TRUE(eventually([&]() { return device->written_frames() >= before + 2400; }));
+    auto written = device->written();
+    for (size_t i = 0; i < 2400; ++i) {
+        ASSERT_EQ(written[before + i], ramp_sample(2400 + LEAD_FRAMES + i)) << "frame " << i;
+    }
+}
+
+TEST_F(AlsaAudioEngineTest, DeviceBackAtAnotherRateIsConvertedTo) {
+    play_ramp_until(4800);
+
+    device->set_reopen_format(44100, 0);
+    device->fail_next_avail(-ENODEV);
+    ASSERT_TRUE(eventually([&]() { return device->open_calls() == 2; }));
+    EXPECT_EQ(device->requested_rate(), 48000);
+
+    // Position is still counted at the track's rate
+    ASSERT_TRUE(eventually([&]() { return device->queued() > 0; }));
+    EXPECT_NEAR(static_cast<double>(engine->get_played_frames()), 4800.0, 2.0);
+
+    device->set_auto_play(true);
+    engine->signal_eof();
+    CompletionResult result;
+    ASSERT_TRUE(wait_for_completion(result));
+    EXPECT_EQ(result.error_code, AudioEngineError::SUCCESS);
+
+    // The rest of the track, 43200 frames at 48 kHz, played at 44.1 kHz before the padding
+    auto written = device->written_since_open();
+    size_t audible = std::count_if(written.begin(), written.end(), [](int16_t s) { return s != 0; });
+    EXPECT_NEAR(static_cast<double>(audible), (48000.0 - 4800.0) * 44100.0 / 48000.0, 200.0);
+    EXPECT_NEAR(static_cast<double>(engine->get_played_frames()), 48000.0, 200.0);
+}
+
+TEST_F(AlsaAudioEngineTest, DeviceBackWithOtherChannelsEndsTheTrackWithAnError) {
+    play_ramp_until(2400);
+
+    device->set_reopen_format(0, 2);
+    device->fail_next_avail(-ENODEV);
+    CompletionResult result;
+    ASSERT_TRUE(wait_for_completion(result));
+    EXPECT_EQ(result.error_code, AudioEngineError::DEVICE_FAILURE);
+    EXPECT_EQ(device->open_calls(), 1 + PcmRecoveryPolicy().max_channel_mismatches);
+}
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include "../src/binary_file.cpp"
+#include "temp_file_test.hpp"
+
+using namespace nigamp;
+
+class BinaryFileTest : public TempFileTest {
+protected:
+    BinaryFileTest() : TempFileTest("nigamp_binary_file_test.bin") {}
+};
+
+TEST(BinaryFieldsTest, LittleEndianRoundTrip) {
+    std::string out;
+    put_u32(out, 0x01020304u);
+    put_u64(out, 0x1122334455667788ull);
+    put_u16(out, 0xA1B2u);
+    ASSERT_EQ(out.size(), 14u);
+    EXPECT_EQ(out.substr(0, 4), std::string("\x04\x03\x02\x01", 4));
+    EXPECT_EQ(static_cast<unsigned char>(out[4]), 0x88);
+    EXPECT_EQ(out.substr(12), std::string("\xB2\xA1", 2));
+
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(out.data());
+    EXPECT_EQ(get_u32(data), 0x01020304u);
+    EXPECT_EQ(get_u64(data + 4), 0x1122334455667788ull);
+}
+
+TEST_F(BinaryFileTest, WritesPartsAndReplacesTheOldFile) {
+    write_file("old contents");
+    ASSERT_TRUE(write_file_atomically(path, {"head", std::string(3, '\0'), "tail"}));
+    EXPECT_EQ(read_file(), std::string("head\0\0\0tail", 11));
+    EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+}
+
+TEST_F(BinaryFileTest, FailedWriteLeavesTheOldFile) {
+    write_file("old contents");
+    std::string missing_directory = path + ".missing/file.bin";
+    EXPECT_FALSE(write_file_atomically(missing_directory, {"new"}));
+    EXPECT_EQ(read_file(), "old contents");
+
+    // A temporary that cannot be renamed into place is cleaned up
+    std::string temp_path = path + ".tmp";
+    std::ofstream(temp_path) << "new";
+    EXPECT_FALSE(replace_file(temp_path, missing_directory));
+    EXPECT_FALSE(std::filesystem::exists(temp_path));
+    EXPECT_TRUE(replace_file(path, path + ".moved"));
+    std::filesystem::remove(path + ".moved");
+}
@@ -67,6 +67,12 @@ public:
         return m_pending_samples.size();
     }
     
+    uint64_t get_played_frames() const override { return 0; }
+    void set_event_callback(AudioEngineEventCallback callback) override {}
+    void set_resampler_quality(ResamplerQuality quality) override {}
+    void set_device_rate(int sample_rate) override {}
+    bool set_capture_path(const std::string& path) override { return true; }
+    
     // Test helpers
     void drain_all_buffers() {
         std::lock_guard<std::mutex> lock(m_buffer_mutex);
@@ -52,6 +52,12 @@ public:
         return m_buffer_samples.load();
     }
     
+    uint64_t get_played_frames() const override { return 0; }
+    void set_event_callback(AudioEngineEventCallback callback) override {}
+    void set_resampler_quality(ResamplerQuality quality) override {}
+    void set_device_rate(int sample_rate) override {}
+    bool set_capture_path(const std::string& path) override { return true; }
+    
     // Test helper - simulates buffer draining
     void drain_buffers() {
         std::cout << "SimpleMock: Draining buffers" << std::endl;
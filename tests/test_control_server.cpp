@@ -0,0 +1,243 @@
+#include <gtest/gtest.h>
+#include "../src/control_server.cpp"
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+using namespace nigamp;
+
+TEST(ControlProtocolTest, FramesRoundTripAndSplit) {
+    std::string stream = encode_control_frame(ControlOpcode::NEXT) +
+                         encode_control_frame(ControlOpcode::SEEK, encode_f64(-12.5));
+    EXPECT_EQ(stream[0], '\0');
+
+    ControlOpcode opcode;
+    std::string payload;
+    EXPECT_EQ(decode_control_frame(stream.data(), 3, opcode, payload), 0u);
+
+    size_t used = decode_control_frame(stream.data(), stream.size(), opcode, payload);
+    ASSERT_EQ(used, 5u);
+    EXPECT_EQ(opcode, ControlOpcode::NEXT);
+    EXPECT_TRUE(payload.empty());
+
+    // The second frame arrives one byte short, then complete
+    EXPECT_EQ(decode_control_frame(stream.data() + used, stream.size() - used - 1, opcode, payload), 0u);
+    ASSERT_EQ(decode_control_frame(stream.data() + used, stream.size() - used, opcode, payload), 13u);
+
+    PlayerCommand command;
+    ASSERT_TRUE(control_request_to_command(opcode, payload, command));
+    EXPECT_EQ(command.type, PlayerCommandType::SEEK);
+    EXPECT_EQ(command.amount, -12.5);
+
+    std::string oversized("\x01\x00\x00\x00\x03", 5);
+    EXPECT_EQ(decode_control_frame(oversized.data(), oversized.size(), opcode, payload), SIZE_MAX);
+}
+
+TEST(ControlProtocolTest, StatusEncodings) {
+    PlayerStatus status;
+    status.state = PlaybackState::PAUSED;
+    status.position = 61.25;
+    status.duration = 200.0;
+    status.volume = 0.5f;
+    status.index = 3;
+    status.playlist_size = 42;
+    status.title = "Say \"hi\"";
+
+    PlayerStatus decoded;
+    ASSERT_TRUE(decode_status(encode_status(status), decoded));
+    EXPECT_EQ(decoded.state, PlaybackState::PAUSED);
+    EXPECT_EQ(decoded.position, 61.25);
+    EXPECT_EQ(decoded.playlist_size, 42u);
+    EXPECT_EQ(decoded.title, status.title);
+
+    EXPECT_EQ(status_to_json(status),
+              "{\"event\":\"status\",\"state\":\"paused\",\"position\":61.250,\"duration\":200.000,"
+              "\"volume\":0.500,\"index\":3,\"size\":42,\"title\":\"Say \\\"hi\\\"\"}");
+}
+
+TEST(ControlProtocolTest, JsonRequests) {
+    ControlOpcode opcode;
+    std::string payload;
+    PlayerCommand command;
+
+    ASSERT_TRUE(parse_json_request("{\"cmd\": \"volume\", \"delta\": -0.2}", opcode, payload));
+    ASSERT_TRUE(control_request_to_command(opcode, payload, command));
+    EXPECT_EQ(command.type, PlayerCommandType::VOLUME);
+    EXPECT_DOUBLE_EQ(command.amount, -0.2);
+
+    ASSERT_TRUE(parse_json_request("{\"path\":\"/music/a\\u00e9.mp3\",\"cmd\":\"enqueue\"}", opcode, payload));
+    ASSERT_TRUE(control_request_to_command(opcode, payload, command));
+    EXPECT_EQ(command.path, "/music/a\xc3\xa9.mp3");
+
+    ASSERT_TRUE(parse_json_request("{\"cmd\":\"export\",\"path\":\"/tmp/up next.m3u8\"}", opcode, payload));
+    ASSERT_TRUE(control_request_to_command(opcode, payload, command));
+    EXPECT_EQ(command.type, PlayerCommandType::EXPORT);
+    EXPECT_EQ(command.path, "/tmp/up next.m3u8");
+    EXPECT_FALSE(parse_json_request("{\"cmd\":\"export\"}", opcode, payload));
+
+    ASSERT_TRUE(parse_json_request("{\"cmd\":\"subscribe\"}", opcode, payload));
+    EXPECT_EQ(opcode, ControlOpcode::SUBSCRIBE);
+    EXPECT_FALSE(control_request_to_command(opcode, payload, command));
+
+    EXPECT_FALSE(parse_json_request("{\"cmd\":\"seek\"}", opcode, payload));
+    EXPECT_FALSE(parse_json_request("{\"cmd\":\"dance\"}", opcode, payload));
+    EXPECT_FALSE(parse_json_request("{\"cmd\":\"next\"", opcode, payload));
+    EXPECT_FALSE(parse_json_request("not json", opcode, payload));
+}
+
+#ifdef __linux__
+class ControlServerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path = (std::filesystem::temp_directory_path() / "nigamp_control_test.sock").string();
+        ASSERT_TRUE(server.start(path,
+            [this](const PlayerCommand& command) { commands.push_back(command); },
+            [this]() {
+                PlayerStatus status;
+                status.state = PlaybackState::PLAYING;
+                status.title = "Track";
+                status.playlist_size = static_cast<uint32_t>(commands.size());
+                return status;
+            }));
+        loop_thread = std::thread([this]() { loop.run(); });
+    }
+
+    void TearDown() override {
+        loop.post([this]() {
+            server.stop();
+            loop.stop();
+        });
+        loop_thread.join();
+        EXPECT_FALSE(std::filesystem::exists(path));
+    }
+
+    int connect_client() {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        EXPECT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+        return fd;
+    }
+
+    void send_all(int fd, const std::string& data) {
+        ASSERT_EQ(::send(fd, data.data(), data.size(), MSG_NOSIGNAL), static_cast<ssize_t>(data.size()));
+    }
+
+    // Opcode byte followed by the payload
+    std::string read_frame(int fd) {
+        char chunk[256];
+        ControlOpcode opcode;
+        std::string payload;
+        size_t used;
+        while ((used = decode_control_frame(received.data(), received.size(), opcode, payload)) == 0) {
+            ssize_t count = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (count <= 0) {
+                return "";
+            }
+            received.append(chunk, static_cast<size_t>(count));
+        }
+        received.erase(0, used);
+        return std::string(1, static_cast<char>(opcode)) + payload;
+    }
+
+    size_t status_frame_size() {
+        PlayerStatus status;
+        status.state = PlaybackState::PLAYING;
+        status.title = "Track";
+        return encode_control_frame(ControlOpcode::STATUS_REPORT, encode_status(status)).size();
+    }
+
+    std::string read_line(int fd) {
+        std::string line;
+        char c;
+        while (::recv(fd, &c, 1, 0) == 1 && c != '\n') {
+            line += c;
+        }
+        return line;
+    }
+
+    EpollEventLoop loop;
+    ControlServer server{loop};
+    std::thread loop_thread;
+    std::string path;
+    std::vector<PlayerCommand> commands;  // Loop thread only until TearDown
+    std::string received;
+};
+
+TEST_F(ControlServerTest, BinaryCommandsAreAcknowledged) {
+    int fd = connect_client();
+    // Pipelined in one write
+    send_all(fd, encode_control_frame(ControlOpcode::NEXT) +
+                 encode_control_frame(ControlOpcode::VOLUME, encode_f64(0.1)) +
+                 encode_control_frame(ControlOpcode::SEEK, "bad"));
+
+    EXPECT_EQ(read_frame(fd), std::string("\x80\x03", 2));
+    EXPECT_EQ(read_frame(fd), std::string("\x80\x06", 2));
+    EXPECT_EQ(static_cast<unsigned char>(read_frame(fd)[0]), 0x82u);
+
+    send_all(fd, encode_control_frame(ControlOpcode::STATUS));
+    std::string reply = read_frame(fd);
+    PlayerStatus status;
+    ASSERT_EQ(static_cast<unsigned char>(reply[0]), 0x81u);
+    ASSERT_TRUE(decode_status(reply.substr(1), status));
+    EXPECT_EQ(status.title, "Track");
+    EXPECT_EQ(status.playlist_size, 2u);
+    ::close(fd);
+}
+
+TEST_F(ControlServerTest, JsonSubscriberReceivesStatusStream) {
+    int fd = connect_client();
+    send_all(fd, "{\"cmd\":\"subscribe\"}\n");
+    EXPECT_NE(read_line(fd).find("\"title\":\"Track\""), std::string::npos);
+
+    // Further reports come from the status timer
+    EXPECT_NE(read_line(fd).find("\"event\":\"status\""), std::string::npos);
+
+    send_all(fd, "{\"cmd\":\"pause\"}\n{\"cmd\":\"bogus\"}\n");
+    std::string line;
+    do {
+        line = read_line(fd);
+    } while (line.find("\"event\"") != std::string::npos);
+    EXPECT_EQ(line, "{\"ok\":true}");
+    do {
+        line = read_line(fd);
+    } while (line.find("\"event\"") != std::string::npos);
+    EXPECT_EQ(line, "{\"ok\":false,\"error\":\"bad request\"}");
+    ::close(fd);
+}
+
+TEST_F(ControlServerTest, RepliesBeyondTheSocketBufferStillArrive) {
+    struct stat info;
+    ASSERT_EQ(::lstat(path.c_str(), &info), 0);
+    EXPECT_EQ(info.st_mode & 0777, 0600u);
+
+    // More replies than the socket holds, requested before reading any
+    int fd = connect_client();
+    timeval timeout{2, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    const std::string request = encode_control_frame(ControlOpcode::STATUS);
+    const size_t reply_size = status_frame_size();
+    const size_t count = 320 * 1024 / reply_size;
+    std::string requests;
+    for (size_t i = 0; i < count; ++i) {
+        requests += request;
+    }
+    send_all(fd, requests);
+    // Lets the server run out of input, so only writability can resume it
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    for (size_t i = 0; i < count; ++i) {
+        std::string reply = read_frame(fd);
+        ASSERT_FALSE(reply.empty()) << "reply " << i << " of " << count;
+        ASSERT_EQ(static_cast<unsigned char>(reply[0]), 0x81u);
+    }
+    ::close(fd);
+}
+
+TEST_F(ControlServerTest, SecondServerRefusesLiveSocket) {
+    EpollEventLoop other_loop;
+    ControlServer other(other_loop);
+    EXPECT_FALSE(other.start(path, [](const PlayerCommand&) {}, []() { return PlayerStatus(); }));
+}
+#endif
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+// The checked-in sample files. CMake points this at tests/data so ctest finds
+// them from any build tree; running the binary by hand from tests/ still works.
+#ifndef NIGAMP_TEST_DATA_DIR
+#define NIGAMP_TEST_DATA_DIR "data"
+#endif
+
+inline std::string test_data_path(const std::string& name) {
+    return std::string(NIGAMP_TEST_DATA_DIR) + "/" + name;
+}
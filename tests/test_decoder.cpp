@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "../src/mp3_decoder.cpp"
+#include "test_data.hpp"
 #include <fstream>
 #include <filesystem>
 
@@ -321,4 +322,48 @@ TEST_F(DecoderTest, MultipleDecoders) {
     
     decoder1->close();
     decoder2->close();
-}
\ No newline at end of file
+}
+namespace {
+
+uint64_t decode_remaining_frames(nigamp::IAudioDecoder& decoder) {
+    nigamp::AudioBuffer buffer;
+    uint64_t samples = 0;
+    while (decoder.decode(buffer, 1000)) {  // Not a multiple of the frame size
+        samples += buffer.size();
+    }
+    return samples / decoder.get_format().channels;
+}
+
+}
+
+TEST(Mp3DecoderDataTest, FrameCountMatchesDecodedOutput) {
+    for (int i = 1; i <= 5; ++i) {
+        std::string path = test_data_path("test" + std::to_string(i) + ".mp3");
+        SCOPED_TRACE(path);
+        nigamp::Mp3Decoder decoder;
+        ASSERT_TRUE(decoder.open(path));
+        
+        uint64_t total = decoder.get_total_frames();
+        ASSERT_GT(total, 0u);
+        EXPECT_DOUBLE_EQ(decoder.get_duration(), static_cast<double>(total) / decoder.get_format().sample_rate);
+        EXPECT_EQ(decode_remaining_frames(decoder), total);
+        EXPECT_TRUE(decoder.is_eof());
+    }
+}
+
+TEST(Mp3DecoderDataTest, SeekLandsOnExactFrame) {
+    nigamp::Mp3Decoder decoder;
+    ASSERT_TRUE(decoder.open(test_data_path("test2.mp3")));
+    uint64_t total = decoder.get_total_frames();
+    int rate = decoder.get_format().sample_rate;
+    
+    ASSERT_TRUE(decoder.seek(3.0));
+    EXPECT_EQ(decode_remaining_frames(decoder), total - static_cast<uint64_t>(3.0 * rate));
+    
+    // Seeking back after EOF restarts cleanly
+    ASSERT_TRUE(decoder.seek(0.0));
+    EXPECT_EQ(decode_remaining_frames(decoder), total);
+    
+    ASSERT_TRUE(decoder.seek(1e6));
+    EXPECT_TRUE(decoder.is_eof());
+}
@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include "../src/event_dispatcher.cpp"
+#include <vector>
+
+using namespace nigamp;
+
+namespace {
+
+AudioEngineEvent make_event(AudioEngineEventType type, size_t frames) {
+    AudioEngineEvent event;
+    event.type = type;
+    event.frames_played = frames;
+    return event;
+}
+
+}
+
+TEST(SpscQueueTest, PushPopInOrder) {
+    SpscQueue<int> queue(4);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.capacity(), 4);
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.try_push(i));
+    }
+    EXPECT_FALSE(queue.try_push(99));  // Full
+
+    int value = -1;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(queue.try_pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.try_pop(value));
+}
+
+TEST(SpscQueueTest, ConcurrentProducerConsumer) {
+    SpscQueue<int> queue(64);
+    constexpr int count = 100000;
+
+    std::thread producer([&]() {
+        for (int i = 0; i < count; ++i) {
+            while (!queue.try_push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected = 0;
+    int value = 0;
+    while (expected < count) {
+        if (queue.try_pop(value)) {
+            ASSERT_EQ(value, expected);
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
+
+TEST(EngineEventDispatcherTest, DeliversInOrderOffThePostingThread) {
+    std::mutex mutex;
+    std::vector<size_t> received;
+    std::thread::id handler_thread;
+
+    {
+        EngineEventDispatcher dispatcher([&](const AudioEngineEvent& event) {
+            std::lock_guard<std::mutex> lock(mutex);
+            handler_thread = std::this_thread::get_id();
+            received.push_back(event.frames_played);
+        });
+
+        for (size_t i = 0; i < 100; ++i) {
+            EXPECT_TRUE(dispatcher.post(make_event(AudioEngineEventType::POSITION, i)));
+        }
+        dispatcher.flush();
+    }
+
+    ASSERT_EQ(received.size(), 100);
+    for (size_t i = 0; i < received.size(); ++i) {
+        EXPECT_EQ(received[i], i);
+    }
+    EXPECT_NE(handler_thread, std::this_thread::get_id());
+}
+
+TEST(EngineEventDispatcherTest, SlowHandlerDoesNotBlockPosting) {
+    std::atomic<int> handled{0};
+    EngineEventDispatcher dispatcher([&](const AudioEngineEvent&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ++handled;
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10; ++i) {
+        dispatcher.post(make_event(AudioEngineEventType::XRUN, 0));
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // Posting ten events must not wait for any of the 50ms callbacks
+    EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(), 20);
+
+    dispatcher.flush();
+    EXPECT_EQ(handled.load(), 10);
+}
+
+TEST(EngineEventDispatcherTest, CountsDropsWhenFull) {
+    std::atomic<bool> release{false};
+    EngineEventDispatcher dispatcher([&](const AudioEngineEvent&) {
+        while (!release) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }, 4);
+
+    size_t accepted = 0;
+    for (int i = 0; i < 20; ++i) {
+        if (dispatcher.post(make_event(AudioEngineEventType::POSITION, i))) {
+            ++accepted;
+        }
+    }
+
+    // At most one event in the handler plus a full queue
+    EXPECT_LE(accepted, 5);
+    EXPECT_EQ(dispatcher.get_dropped_count(), 20 - accepted);
+
+    release = true;
+    dispatcher.flush();
+}
+
+TEST(EngineEventDispatcherTest, ThrowingHandlerKeepsDispatching) {
+    std::atomic<int> handled{0};
+    EngineEventDispatcher dispatcher([&](const AudioEngineEvent& event) {
+        ++handled;
+        if (event.type == AudioEngineEventType::XRUN) {
+            throw std::runtime_error("callback failure");
+        }
+    });
+
+    dispatcher.post(make_event(AudioEngineEventType::XRUN, 0));
+    dispatcher.post(make_event(AudioEngineEventType::COMPLETION, 0));
+    dispatcher.flush();
+    EXPECT_EQ(handled.load(), 2);
+}
+
+TEST(EngineEventDispatcherTest, ReservedEventSurvivesAFullQueue) {
+    std::atomic<bool> release{false};
+    std::mutex mutex;
+    std::vector<AudioEngineEventType> received;
+    EngineEventDispatcher dispatcher([&](const AudioEngineEvent& event) {
+        while (!release) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(event.type);
+    }, 4);
+
+    size_t accepted = 0;
+    for (int i = 0; i < 20; ++i) {
+        accepted += dispatcher.post(make_event(AudioEngineEventType::POSITION, i));
+    }
+    EXPECT_TRUE(dispatcher.post_reserved(make_event(AudioEngineEventType::COMPLETION, 0)));
+    // The slot holds one event until it is handled
+    EXPECT_FALSE(dispatcher.post_reserved(make_event(AudioEngineEventType::COMPLETION, 1)));
+
+    release = true;
+    dispatcher.flush();
+    ASSERT_EQ(received.size(), accepted + 1);
+    EXPECT_EQ(received.back(), AudioEngineEventType::COMPLETION);
+
+    // Free again once handled
+    EXPECT_TRUE(dispatcher.post_reserved(make_event(AudioEngineEventType::COMPLETION, 2)));
+    dispatcher.flush();
+    EXPECT_EQ(received.size(), accepted + 2);
+}
+
+TEST(EngineEventDispatcherTest, HandlerCanFlush) {
+    std::atomic<int> handled{0};
+    EngineEventDispatcher* self = nullptr;
+    EngineEventDispatcher dispatcher([&](const AudioEngineEvent&) {
+        self->flush();  // Returns at once instead of waiting on itself
+        ++handled;
+    });
+    self = &dispatcher;
+
+    dispatcher.post_reserved(make_event(AudioEngineEventType::COMPLETION, 0));
+    dispatcher.flush();
+    EXPECT_EQ(handled.load(), 1);
+}
+
+TEST(EngineEventDispatcherTest, FlushWakesWhenTheLastEventIsHandled) {
+    std::atomic<int> handled{0};
+    EngineEventDispatcher dispatcher([&](const AudioEngineEvent&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        ++handled;
+    });
+
+    for (int i = 0; i < 3; ++i) {
+        dispatcher.post(make_event(AudioEngineEventType::POSITION, i));
+    }
+    dispatcher.flush();
+    EXPECT_EQ(handled.load(), 3);
+
+    // Nothing outstanding: returns without waiting on the consumer
+    auto start = std::chrono::steady_clock::now();
+    dispatcher.flush();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+}
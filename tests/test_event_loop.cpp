@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include "../src/event_loop.cpp"
+#include <thread>
+#include <vector>
+
+using namespace nigamp;
+using namespace std::chrono_literals;
+
+template <typename Loop>
+class EventLoopTest : public ::testing::Test {
+protected:
+    Loop loop;
+};
+
+#ifdef __linux__
+using LoopTypes = ::testing::Types<PortableEventLoop, EpollEventLoop>;
+#else
+using LoopTypes = ::testing::Types<PortableEventLoop>;
+#endif
+TYPED_TEST_SUITE(EventLoopTest, LoopTypes);
+
+TYPED_TEST(EventLoopTest, PostedTasksRunInOrderOnLoopThread) {
+    std::vector<int> order;
+    std::thread::id task_thread;
+
+    std::thread poster([&]() {
+        for (int i = 0; i < 5; ++i) {
+            this->loop.post([&order, i]() { order.push_back(i); });
+        }
+        this->loop.post([&]() {
+            task_thread = std::this_thread::get_id();
+            this->loop.stop();
+        });
+    });
+    this->loop.run();
+    poster.join();
+
+    EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3, 4}));
+    EXPECT_EQ(task_thread, std::this_thread::get_id());
+}
+
+TYPED_TEST(EventLoopTest, StopFromAnotherThreadIsImmediate) {
+    std::thread stopper([&]() {
+        std::this_thread::sleep_for(20ms);
+        this->loop.stop();
+    });
+    auto start = std::chrono::steady_clock::now();
+    this->loop.run();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    stopper.join();
+
+    EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(), 500);
+
+    // Stop is sticky
+    this->loop.run();
+}
+
+TYPED_TEST(EventLoopTest, RepeatingAndOneShotTimers) {
+    int ticks = 0;
+    int one_shots = 0;
+    this->loop.add_timer(5ms, [&]() { ++one_shots; }, false);
+    this->loop.add_timer(10ms, [&]() {
+        if (++ticks == 3) {
+            this->loop.stop();
+        }
+    }, true);
+    this->loop.run();
+
+    EXPECT_EQ(ticks, 3);
+    EXPECT_EQ(one_shots, 1);
+}
+
+TYPED_TEST(EventLoopTest, CancelledTimerNeverFires) {
+    bool fired = false;
+    auto id = this->loop.add_timer(10ms, [&]() { fired = true; }, false);
+    ASSERT_NE(id, IEventLoop::INVALID_TIMER);
+    this->loop.cancel_timer(id);
+    this->loop.add_timer(50ms, [&]() { this->loop.stop(); }, false);
+    this->loop.run();
+    EXPECT_FALSE(fired);
+}
+
+#ifdef __linux__
+TEST(EpollEventLoopTest, FdCallbackRunsWhenReadable) {
+    EpollEventLoop loop;
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+
+    std::string received;
+    ASSERT_TRUE(loop.add_fd(fds[0], [&]() {
+        char c;
+        if (::read(fds[0], &c, 1) == 1) {
+            received += c;
+            if (received.size() == 3) {
+                loop.remove_fd(fds[0]);
+                loop.stop();
+            }
+        }
+    }));
+    EXPECT_FALSE(loop.add_fd(fds[0], []() {}));  // Already registered
+
+    std::thread writer([&]() {
+        ASSERT_EQ(::write(fds[1], "abc", 3), 3);
+    });
+    loop.run();
+    writer.join();
+
+    EXPECT_EQ(received, "abc");
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+TEST(EpollEventLoopTest, WritableCallbackRunsUntilDisarmed) {
+    EpollEventLoop loop;
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    EXPECT_FALSE(loop.watch_writable(fds[1], []() {}));  // Not added yet
+
+    int reads = 0;
+    int writes = 0;
+    ASSERT_TRUE(loop.add_fd(fds[1], [&]() { ++reads; }));
+    ASSERT_TRUE(loop.watch_writable(fds[1], [&]() {
+        if (++writes == 3) {
+            loop.watch_writable(fds[1], nullptr);
+            loop.post([&]() { loop.stop(); });
+        }
+    }));
+    loop.run();
+
+    EXPECT_EQ(writes, 3);
+    EXPECT_EQ(reads, 0);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+TEST(EpollEventLoopTest, SignalIsDeliveredAsCallback) {
+    EpollEventLoop loop;
+    int signals = 0;
+    ASSERT_TRUE(loop.watch_signal(SIGUSR1, [&]() {
+        ++signals;
+        loop.stop();
+    }));
+
+    // Blocked now, so it stays pending until the loop reads the signalfd
+    ::raise(SIGUSR1);
+    loop.run();
+    EXPECT_EQ(signals, 1);
+}
+#endif
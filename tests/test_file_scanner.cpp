@@ -60,6 +60,28 @@ TEST_F(FileScannerTest, ScanDirectory) {
     EXPECT_TRUE(std::find(found_files.begin(), found_files.end(), "not_audio.txt") == found_files.end());
 }
 
+TEST_F(FileScannerTest, StreamingScanReportsEachSong) {
+    std::filesystem::create_directory(test_dir + "/nested");
+    create_test_file(test_dir + "/nested/deep.mp3");
+    
+    std::vector<std::string> streamed;
+    size_t found = scanner->scan_directory_streaming(test_dir, [&](const nigamp::Song& song) {
+        streamed.push_back(song.file_path);
+        return true;
+    });
+    EXPECT_EQ(found, 4u);
+    EXPECT_EQ(streamed.size(), 4u);
+    
+    // Returning false stops the scan at that song
+    streamed.clear();
+    found = scanner->scan_directory_streaming(test_dir, [&](const nigamp::Song& song) {
+        streamed.push_back(song.file_path);
+        return false;
+    });
+    EXPECT_EQ(found, 1u);
+    EXPECT_EQ(streamed.size(), 1u);
+}
+
 TEST_F(FileScannerTest, EmptyDirectory) {
     std::string empty_dir = "empty_test_dir";
     std::filesystem::create_directory(empty_dir);
@@ -84,4 +106,39 @@ TEST_F(FileScannerTest, SongMetadata) {
     EXPECT_FALSE(song.title.empty());
     EXPECT_EQ(song.artist, "Unknown Artist");
     EXPECT_GE(song.duration, 0.0);
-}
\ No newline at end of file
+}
+TEST_F(FileScannerTest, ParallelScanMatchesSerialWalk) {
+    // A few hundred files over a wide, uneven tree so workers have subtrees to steal
+    for (int a = 0; a < 8; ++a) {
+        std::string dir = test_dir + "/artist" + std::to_string(a);
+        std::filesystem::create_directory(dir);
+        for (int b = 0; b < a + 1; ++b) {
+            std::string album = dir + "/album" + std::to_string(b);
+            std::filesystem::create_directory(album);
+            for (int t = 0; t < 6; ++t) {
+                create_test_file(album + "/track" + std::to_string(t) + (t % 3 ? ".mp3" : ".txt"));
+            }
+        }
+    }
+    std::filesystem::create_symlink(std::filesystem::absolute(test_dir + "/song1.mp3"), test_dir + "/linked.mp3");
+    // Linked directories are not entered, as with recursive_directory_iterator
+    std::filesystem::create_directory_symlink(std::filesystem::absolute(test_dir + "/artist0"), test_dir + "/loop");
+    
+    std::vector<std::string> expected;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(test_dir)) {
+        if (entry.is_regular_file() && scanner->is_supported_format(entry.path().string())) {
+            expected.push_back(entry.path().string());
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(expected.size(), 4u + 36u * 4u);
+    
+    for (unsigned threads : {1u, 2u, 8u}) {
+        auto songs = nigamp::create_file_scanner(threads)->scan_directory(test_dir);
+        std::vector<std::string> paths;
+        for (const auto& song : songs) {
+            paths.push_back(song.file_path);
+        }
+        EXPECT_EQ(paths, expected) << threads << " threads";
+    }
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "../src/gain_ramp.cpp"
+#include <cstdlib>
+
+class GainRampTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ramp.configure(1000, 2);  // 1 frame per millisecond keeps the math readable
+    }
+
+    nigamp::AudioBuffer make_constant(int16_t value, size_t frames) {
+        return nigamp::AudioBuffer(frames * 2, value);
+    }
+
+    nigamp::GainRamp ramp;
+};
+
+TEST_F(GainRampTest, UnityGainLeavesSamplesUntouched) {
+    auto buffer = make_constant(12345, 64);
+    ramp.process(buffer.data(), 64);
+    for (auto sample : buffer) {
+        EXPECT_EQ(sample, 12345);
+    }
+}
+
+TEST_F(GainRampTest, ImmediateVolumeWithoutRamp) {
+    ramp.set_volume(0.5f, 0.0);
+    auto buffer = make_constant(10000, 16);
+    ramp.process(buffer.data(), 16);
+    for (auto sample : buffer) {
+        EXPECT_EQ(sample, 5000);
+    }
+}
+
+TEST_F(GainRampTest, VolumeRampIsMonotonicAndReachesTarget) {
+    ramp.set_volume(0.0f, 100.0);  // 100 frames
+    auto buffer = make_constant(10000, 150);
+    ramp.process(buffer.data(), 150);
+
+    for (size_t f = 1; f < 150; ++f) {
+        EXPECT_LE(buffer[f * 2], buffer[(f - 1) * 2]);
+        // Both channels of a frame share one gain value
+        EXPECT_EQ(buffer[f * 2], buffer[f * 2 + 1]);
+        // No zipper steps: each frame moves by at most one ramp increment
+        EXPECT_LE(std::abs(buffer[f * 2] - buffer[(f - 1) * 2]), 101);
+    }
+    EXPECT_EQ(buffer[99 * 2], 0);
+    EXPECT_EQ(buffer[149 * 2], 0);
+}
+
+TEST_F(GainRampTest, RampContinuesAcrossCalls) {
+    ramp.set_volume(0.0f, 100.0);
+    auto first = make_constant(10000, 50);
+    auto second = make_constant(10000, 50);
+    ramp.process(first.data(), 50);
+    ramp.process(second.data(), 50);
+
+    EXPECT_NEAR(first[49 * 2], 5000, 1);
+    EXPECT_LT(second[0], first[49 * 2]);
+    EXPECT_EQ(second[49 * 2], 0);
+}
+
+TEST_F(GainRampTest, FadeMultipliesWithVolume) {
+    ramp.set_volume(0.5f, 0.0);
+    ramp.jump_fade(0.0f);
+    ramp.set_fade(1.0f, 10.0);
+    EXPECT_TRUE(ramp.is_fading());
+
+    auto buffer = make_constant(20000, 20);
+    ramp.process(buffer.data(), 20);
+
+    EXPECT_LT(buffer[0], 2000);
+    EXPECT_EQ(buffer[19 * 2], 10000);
+    EXPECT_FALSE(ramp.is_fading());
+    EXPECT_FLOAT_EQ(ramp.get_fade_level(), 1.0f);
+}
+
+TEST_F(GainRampTest, SaturatesInsteadOfWrapping) {
+    ramp.set_volume(1.0f, 0.0);
+    auto buffer = make_constant(-32768, 9);
+    ramp.process(buffer.data(), 9);
+    for (auto sample : buffer) {
+        EXPECT_EQ(sample, -32768);
+    }
+}
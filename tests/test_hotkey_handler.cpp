@@ -13,6 +13,8 @@ private:
     std::atomic<int> pause_resume_count{0};
     std::atomic<int> volume_up_count{0};
     std::atomic<int> volume_down_count{0};
+    std::atomic<int> seek_forward_count{0};
+    std::atomic<int> seek_backward_count{0};
     std::atomic<int> quit_count{0};
     
 public:
@@ -40,6 +42,14 @@ public:
                 volume_down_count++;
                 std::cout << "[TEST] VOLUME_DOWN triggered (count: " << volume_down_count << ")" << std::endl;
                 break;
+            case HotkeyAction::SEEK_FORWARD:
+                seek_forward_count++;
+                std::cout << "[TEST] SEEK_FORWARD triggered (count: " << seek_forward_count << ")" << std::endl;
+                break;
+            case HotkeyAction::SEEK_BACKWARD:
+                seek_backward_count++;
+                std::cout << "[TEST] SEEK_BACKWARD triggered (count: " << seek_backward_count << ")" << std::endl;
+                break;
             case HotkeyAction::QUIT:
                 quit_count++;
                 std::cout << "[TEST] QUIT triggered (count: " << quit_count << ")" << std::endl;
@@ -54,6 +64,8 @@ public:
         std::cout << "Pause/Resume:   " << pause_resume_count << std::endl;
         std::cout << "Volume Up:      " << volume_up_count << std::endl;
         std::cout << "Volume Down:    " << volume_down_count << std::endl;
+        std::cout << "Seek Forward:   " << seek_forward_count << std::endl;
+        std::cout << "Seek Backward:  " << seek_backward_count << std::endl;
         std::cout << "Quit:           " << quit_count << std::endl;
     }
     
@@ -63,6 +75,8 @@ public:
         pause_resume_count = 0;
         volume_up_count = 0;
         volume_down_count = 0;
+        seek_forward_count = 0;
+        seek_backward_count = 0;
         quit_count = 0;
     }
     
@@ -76,6 +90,8 @@ public:
         handle_hotkey_action(HotkeyAction::PAUSE_RESUME);
         handle_hotkey_action(HotkeyAction::VOLUME_UP);
         handle_hotkey_action(HotkeyAction::VOLUME_DOWN);
+        handle_hotkey_action(HotkeyAction::SEEK_FORWARD);
+        handle_hotkey_action(HotkeyAction::SEEK_BACKWARD);
         handle_hotkey_action(HotkeyAction::QUIT);
         
         print_results();
@@ -86,6 +102,8 @@ public:
                           pause_resume_count == 1 && 
                           volume_up_count == 1 && 
                           volume_down_count == 1 && 
+                          seek_forward_count == 1 && 
+                          seek_backward_count == 1 && 
                           quit_count == 1);
         
         std::cout << "[TEST] Direct action test: " << (all_passed ? "PASSED" : "FAILED") << std::endl;
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include "../src/library_index.cpp"
+#include "temp_file_test.hpp"
+
+using namespace nigamp;
+
+class LibraryIndexTest : public TempFileTest {
+protected:
+    LibraryIndexTest() : TempFileTest("nigamp_library_index_test.idx") {}
+
+    void SetUp() override {
+        TempFileTest::SetUp();
+        songs = {
+            {{"/music/b/two.mp3", "two", "Artist", 182.5}, {4096, 1700000000123456789}},
+            {{"/music/a/one.wav", "one", "Artist", 61.25}, {1024, 1600000000000000000}},
+            {{"/music/c/three.mp3", "three", "Other", 0.0}, {0, -5}},
+        };
+    }
+
+    std::vector<IndexedSong> songs;
+};
+
+TEST_F(LibraryIndexTest, RoundTripSortedByPath) {
+    ASSERT_TRUE(save_library_index(path, "/music", songs));
+    EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+
+    LibraryIndex index;
+    ASSERT_TRUE(index.open(path));
+    EXPECT_EQ(index.directory(), "/music");
+    ASSERT_EQ(index.size(), 3u);
+
+    IndexedSong entry;
+    ASSERT_TRUE(index.get(0, entry));
+    EXPECT_EQ(entry.song.file_path, "/music/a/one.wav");
+    EXPECT_EQ(entry.song.title, "one");
+    EXPECT_EQ(entry.song.artist, "Artist");
+    EXPECT_DOUBLE_EQ(entry.song.duration, 61.25);
+    EXPECT_EQ(entry.stamp, (FileStamp{1024, 1600000000000000000}));
+
+    ASSERT_TRUE(index.get(2, entry));
+    EXPECT_EQ(entry.song.file_path, "/music/c/three.mp3");
+    EXPECT_EQ(entry.stamp.mtime_ns, -5);
+    EXPECT_FALSE(index.get(3, entry));
+
+    EXPECT_EQ(index.find("/music/b/two.mp3"), 1u);
+    EXPECT_EQ(index.find("/music/a/one.wav"), 0u);
+    EXPECT_EQ(index.find("/music/b"), LibraryIndex::NOT_FOUND);
+    EXPECT_EQ(index.find("/music/z.mp3"), LibraryIndex::NOT_FOUND);
+
+    // Shared artist strings are stored once
+    std::string contents = read_file();
+    size_t first = contents.find("Artist");
+    ASSERT_NE(first, std::string::npos);
+    EXPECT_EQ(contents.find("Artist", first + 1), std::string::npos);
+}
+
+TEST_F(LibraryIndexTest, EmptyLibraryAndMissingFile) {
+    LibraryIndex index;
+    EXPECT_FALSE(index.open(path));
+    EXPECT_FALSE(index.is_open());
+    EXPECT_EQ(index.find("/music/a/one.wav"), LibraryIndex::NOT_FOUND);
+
+    ASSERT_TRUE(save_library_index(path, "/music", {}));
+    ASSERT_TRUE(index.open(path));
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_EQ(index.directory(), "/music");
+}
+
+TEST_F(LibraryIndexTest, CorruptFilesAreRejected) {
+    ASSERT_TRUE(save_library_index(path, "/music", songs));
+    std::string good = read_file();
+    LibraryIndex index;
+
+    write_file(good.substr(0, good.size() - 1));
+    EXPECT_FALSE(index.open(path));
+
+    write_file(good + "x");
+    EXPECT_FALSE(index.open(path));
+
+    std::string bad_magic = good;
+    bad_magic[0] = 'X';
+    write_file(bad_magic);
+    EXPECT_FALSE(index.open(path));
+
+    std::string bad_version = good;
+    bad_version[4] = 9;
+    write_file(bad_version);
+    EXPECT_FALSE(index.open(path));
+
+    // A record pointing past the string table is refused on access
+    std::string bad_record = good;
+    bad_record[HEADER_SIZE + 4] = static_cast<char>(0xFF);
+    bad_record[HEADER_SIZE + 5] = static_cast<char>(0xFF);
+    write_file(bad_record);
+    ASSERT_TRUE(index.open(path));
+    IndexedSong entry;
+    EXPECT_FALSE(index.get(0, entry));
+    EXPECT_TRUE(index.get(1, entry));
+}
+
+TEST_F(LibraryIndexTest, FileStampTracksSizeAndMtime) {
+    FileStamp stamp;
+    EXPECT_FALSE(read_file_stamp(path, stamp));
+
+    write_file("abc");
+    ASSERT_TRUE(read_file_stamp(path, stamp));
+    EXPECT_EQ(stamp.size, 3u);
+    EXPECT_NE(stamp.mtime_ns, 0);
+
+    FileStamp changed;
+    write_file("abcdef");
+    ASSERT_TRUE(read_file_stamp(path, changed));
+    EXPECT_NE(stamp, changed);
+}
@@ -0,0 +1,298 @@
+#include <gtest/gtest.h>
+#include "../src/library_store.cpp"
+#include <algorithm>
+
+using namespace nigamp;
+
+namespace {
+
+Song make_song(const std::string& path, const std::string& title, const std::string& artist, double duration = 0.0) {
+    return Song{path, title, artist, duration};
+}
+
+std::vector<SongId> sorted(std::vector<SongId> ids) {
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+}
+
+TEST(StringPoolTest, InternSharesStorage) {
+    StringPool pool;
+    StringPool::StringId a = pool.intern("Artist");
+    StringPool::StringId b = pool.intern(std::string("Art") + "ist");
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(pool.get(a).data(), pool.get(b).data());
+    EXPECT_NE(pool.add("Artist"), a);
+    EXPECT_EQ(pool.count(), 2u);
+}
+
+TEST(StringPoolTest, ViewsSurviveGrowth) {
+    StringPool pool;
+    StringPool::StringId first = pool.add("first");
+    const char* data = pool.get(first).data();
+    // Well past a block, plus strings too long to share one
+    for (int i = 0; i < 20000; ++i) {
+        pool.add("string number " + std::to_string(i));
+    }
+    pool.add(std::string(100000, 'x'));
+    StringPool::StringId after = pool.add("after");
+    EXPECT_EQ(pool.get(first).data(), data);
+    EXPECT_EQ(pool.get(first), "first");
+    EXPECT_EQ(pool.get(after), "after");
+    EXPECT_EQ(pool.get(pool.add("")), "");
+}
+
+TEST(StringPoolTest, ReplaceReusesSpaceThatFits) {
+    StringPool pool;
+    std::string long_text(300, 'a');
+    StringPool::StringId id = pool.add(long_text);
+    StringPool::StringId next = pool.add("next");
+
+    // Shorter, including a shorter length prefix
+    EXPECT_EQ(pool.replace(id, "short"), id);
+    EXPECT_EQ(pool.get(id), "short");
+    EXPECT_EQ(pool.replace(id, ""), id);
+    EXPECT_EQ(pool.get(id), "");
+    EXPECT_EQ(pool.get(next), "next");
+
+    StringPool::StringId moved = pool.replace(next, "much longer");
+    EXPECT_NE(moved, next);
+    EXPECT_EQ(pool.get(moved), "much longer");
+    EXPECT_EQ(pool.stored_bytes(), long_text.size() + 4 + 11);
+}
+
+TEST(LibraryStoreTest, AddFindAndView) {
+    LibraryStore store;
+    SongId a = store.add(make_song("/music/album/one.mp3", "One", "Band", 61.5));
+    SongId b = store.add(make_song("/music/album/two.mp3", "Two", "Band"));
+    ASSERT_NE(a, INVALID_SONG_ID);
+    ASSERT_NE(a, b);
+    EXPECT_EQ(store.size(), 2u);
+
+    EXPECT_EQ(store.find("/music/album/one.mp3"), a);
+    EXPECT_EQ(store.find("/music/album/three.mp3"), INVALID_SONG_ID);
+    EXPECT_EQ(store.find("/elsewhere/one.mp3"), INVALID_SONG_ID);
+
+    SongView view = store.view(a);
+    EXPECT_EQ(view.id, a);
+    EXPECT_EQ(view.directory, "/music/album/");
+    EXPECT_EQ(view.file_name, "one.mp3");
+    EXPECT_EQ(view.title, "One");
+    EXPECT_EQ(view.artist, "Band");
+    EXPECT_DOUBLE_EQ(view.duration, 61.5);
+    EXPECT_EQ(store.path(b), "/music/album/two.mp3");
+
+    // Shared directory and artist are stored once
+    EXPECT_EQ(store.view(a).directory.data(), store.view(b).directory.data());
+    EXPECT_EQ(store.view(a).artist.data(), store.view(b).artist.data());
+
+    // Adding the same path again updates it
+    EXPECT_EQ(store.add(make_song("/music/album/one.mp3", "One (Remaster)", "Band")), a);
+    EXPECT_EQ(store.view(a).title, "One (Remaster)");
+    EXPECT_EQ(store.size(), 2u);
+}
+
+TEST(LibraryStoreTest, UpdateMovesPathAndKeepsId) {
+    LibraryStore store;
+    SongId a = store.add(make_song("/music/a.mp3", "A", "X"));
+    SongId b = store.add(make_song("/music/b.mp3", "B", "X"));
+
+    EXPECT_TRUE(store.update(a, make_song("/music/sub/renamed.mp3", "A", "X")));
+    EXPECT_EQ(store.find("/music/a.mp3"), INVALID_SONG_ID);
+    EXPECT_EQ(store.find("/music/sub/renamed.mp3"), a);
+    EXPECT_EQ(store.path(a), "/music/sub/renamed.mp3");
+
+    // Another song's path is not taken over
+    EXPECT_FALSE(store.update(a, make_song("/music/b.mp3", "A", "X")));
+    EXPECT_EQ(store.find("/music/b.mp3"), b);
+    EXPECT_FALSE(store.update(INVALID_SONG_ID, make_song("/music/c.mp3", "C", "X")));
+
+    // Unchanged text does not grow the store
+    size_t before = store.memory_bytes();
+    for (int i = 0; i < 1000; ++i) {
+        store.update(b, make_song("/music/b.mp3", "B", "X"));
+    }
+    EXPECT_EQ(store.memory_bytes(), before);
+}
+
+TEST(LibraryStoreTest, RemoveLeavesOtherIdsAlone) {
+    LibraryStore store;
+    SongId a = store.add(make_song("/music/a.mp3", "A", "X"));
+    SongId b = store.add(make_song("/music/b.mp3", "B", "X"));
+
+    EXPECT_TRUE(store.remove(a));
+    EXPECT_FALSE(store.remove(a));
+    EXPECT_FALSE(store.contains(a));
+    EXPECT_EQ(store.view(a).id, INVALID_SONG_ID);
+    EXPECT_EQ(store.find("/music/a.mp3"), INVALID_SONG_ID);
+    EXPECT_EQ(store.view(b).title, "B");
+    EXPECT_EQ(store.size(), 1u);
+
+    // The freed id is handed out again
+    SongId c = store.add(make_song("/music/c.mp3", "C", "X"));
+    EXPECT_EQ(c, a);
+    EXPECT_EQ(store.find("/music/c.mp3"), c);
+    EXPECT_EQ(store.view(c).title, "C");
+    EXPECT_EQ(store.view(b).title, "B");
+
+    store.clear();
+    EXPECT_EQ(store.size(), 0u);
+    EXPECT_FALSE(store.contains(b));
+    EXPECT_EQ(store.find("/music/b.mp3"), INVALID_SONG_ID);
+}
+
+TEST(LibraryStoreTest, HandlesOutliveReusedIds) {
+    LibraryStore store;
+    SongHandle a = store.handle(store.add(make_song("/music/a.mp3", "A", "X")));
+    SongHandle b = store.handle(store.add(make_song("/music/b.mp3", "B", "X")));
+    EXPECT_TRUE(store.valid(a));
+    EXPECT_EQ(store.view(a).title, "A");
+    EXPECT_FALSE(store.valid(SongHandle()));
+    EXPECT_EQ(store.handle(INVALID_SONG_ID), SongHandle());
+
+    // Updates keep the handle
+    store.update(a.id, make_song("/music/renamed.mp3", "A", "X"));
+    EXPECT_TRUE(store.valid(a));
+
+    store.remove(a.id);
+    SongHandle c = store.handle(store.add(make_song("/music/c.mp3", "C", "X")));
+    EXPECT_EQ(c.id, a.id);
+    EXPECT_NE(c, a);
+    EXPECT_FALSE(store.valid(a));
+    EXPECT_EQ(store.view(a).id, INVALID_SONG_ID);
+    EXPECT_EQ(store.view(c).title, "C");
+
+    // Nor do handles from before a clear
+    store.clear();
+    store.add(make_song("/music/a.mp3", "A", "X"));
+    SongId d = store.add(make_song("/music/b.mp3", "B", "X"));
+    EXPECT_EQ(d, b.id);
+    EXPECT_FALSE(store.valid(b));
+    EXPECT_TRUE(store.valid(store.handle(d)));
+}
+
+TEST(LibraryStoreTest, SongsUnderMatchesWholeDirectories) {
+    LibraryStore store;
+    SongId top = store.add(make_song("/lib/x/top.mp3", "", ""));
+    SongId deep = store.add(make_song("/lib/x/deeper/song.mp3", "", ""));
+    SongId sibling = store.add(make_song("/lib/xy/other.mp3", "", ""));
+    SongId outside = store.add(make_song("/lib/root.mp3", "", ""));
+
+    EXPECT_EQ(sorted(store.songs_under("/lib/x")), sorted({top, deep}));
+    EXPECT_EQ(sorted(store.songs_under("/lib/x/")), sorted({top, deep}));
+    EXPECT_EQ(store.songs_under("/lib/x/deeper"), std::vector<SongId>{deep});
+    EXPECT_EQ(store.songs_under("/lib/xy"), std::vector<SongId>{sibling});
+    EXPECT_EQ(sorted(store.songs_under("/lib")), sorted({top, deep, sibling, outside}));
+    EXPECT_TRUE(store.songs_under("/li").empty());
+    EXPECT_TRUE(store.songs_under("/nothing").empty());
+
+    store.remove(deep);
+    EXPECT_EQ(store.songs_under("/lib/x"), std::vector<SongId>{top});
+}
+
+TEST(LibraryStoreTest, SongsUnderFollowsMovesAndReusedIds) {
+    LibraryStore store;
+    std::vector<SongId> album;
+    for (int i = 0; i < 5; ++i) {
+        album.push_back(store.add(make_song("/lib/a/" + std::to_string(i) + ".mp3", "", "")));
+    }
+    SongId other = store.add(make_song("/lib/b/other.mp3", "", ""));
+
+    // Out of the middle of a directory's list, and into another
+    EXPECT_TRUE(store.update(album[2], make_song("/lib/b/moved.mp3", "", "")));
+    EXPECT_EQ(sorted(store.songs_under("/lib/b")), sorted({other, album[2]}));
+    EXPECT_EQ(sorted(store.songs_under("/lib/a")), sorted({album[0], album[1], album[3], album[4]}));
+
+    // Head and tail of the list
+    store.remove(album[4]);
+    store.remove(album[0]);
+    EXPECT_EQ(sorted(store.songs_under("/lib/a")), sorted({album[1], album[3]}));
+
+    // A reused id shows up only under its new directory
+    SongId reused = store.add(make_song("/lib/c/new.mp3", "", ""));
+    EXPECT_EQ(reused, album[0]);
+    EXPECT_EQ(store.songs_under("/lib/c"), std::vector<SongId>{reused});
+    EXPECT_EQ(sorted(store.songs_under("/lib/a")), sorted({album[1], album[3]}));
+    EXPECT_EQ(store.songs_under("/lib").size(), 5u);
+}
+
+TEST(LibraryStoreTest, ChurnDoesNotGrowThePool) {
+    LibraryStore store;
+    constexpr int COUNT = 2000;
+    std::vector<SongHandle> handles;
+    for (int i = 0; i < COUNT; ++i) {
+        handles.push_back(store.handle(store.add(
+            make_song("/music/a" + std::to_string(i % 20) + "/track" + std::to_string(i) + ".mp3", "Title", "X"))));
+    }
+    size_t settled = store.memory_bytes();
+
+    // Every song renamed into new directories and retagged, over and over
+    for (int round = 0; round < 50; ++round) {
+        std::string suffix = std::to_string(round);
+        for (int i = 0; i < COUNT; ++i) {
+            store.update(handles[i].id, make_song("/music/round" + suffix + "/a" + std::to_string(i % 20) +
+                                                       "/track" + std::to_string(i) + "-" + suffix + ".mp3",
+                                                   "Title " + suffix + std::string(round % 7, '!'), "Artist " + suffix));
+        }
+    }
+    EXPECT_LT(store.memory_bytes(), settled * 3);
+
+    // Everything still resolves after the rebuilds
+    for (int i = 0; i < COUNT; i += 97) {
+        ASSERT_TRUE(store.valid(handles[i]));
+        std::string path = "/music/round49/a" + std::to_string(i % 20) + "/track" + std::to_string(i) + "-49.mp3";
+        EXPECT_EQ(store.path(handles[i].id), path);
+        EXPECT_EQ(store.find(path), handles[i].id);
+        EXPECT_EQ(store.view(handles[i]).title, "Title 49");
+        EXPECT_EQ(store.view(handles[i]).artist, "Artist 49");
+    }
+    EXPECT_EQ(store.songs_under("/music/round49/a3").size(), static_cast<size_t>(COUNT / 20));
+    EXPECT_TRUE(store.songs_under("/music/round48").empty());
+
+    // Removing and adding back under new names
+    for (int round = 0; round < 50; ++round) {
+        for (int i = 0; i < COUNT; ++i) {
+            store.remove(handles[i].id);
+            handles[i] = store.handle(store.add(make_song(
+                "/music/b/" + std::to_string(round) + "-" + std::to_string(i) + ".mp3", "Again", "X")));
+        }
+    }
+    EXPECT_LT(store.memory_bytes(), settled * 3);
+    EXPECT_EQ(store.size(), static_cast<size_t>(COUNT));
+    EXPECT_EQ(store.find("/music/b/49-1234.mp3"), handles[1234].id);
+    EXPECT_EQ(store.songs_under("/music/b").size(), static_cast<size_t>(COUNT));
+}
+
+TEST(LibraryStoreTest, RefilledDirectoryIsNotDeadText) {
+    LibraryStore store;
+    // Compaction copies every live string, so this title would move
+    SongId keeper = store.add(make_song("/keep/k.mp3", "Keeper", "X"));
+    const char* title = store.view(keeper).title.data();
+    // Far more directory text than anything else, so miscounting it would force a rebuild
+    std::string directory = "/music/" + std::string(4000, 'd') + "/";
+    SongId id = store.add(make_song(directory + "a.mp3", "", ""));
+    for (int round = 0; round < 100; ++round) {
+        store.remove(id);
+        id = store.add(make_song(directory + "a.mp3", "", ""));
+    }
+    EXPECT_EQ(store.view(keeper).title.data(), title);
+    EXPECT_EQ(store.path(id), directory + "a.mp3");
+}
+
+TEST(LibraryStoreTest, ManySongsStayCompact) {
+    LibraryStore store;
+    constexpr int COUNT = 20000;
+    for (int i = 0; i < COUNT; ++i) {
+        std::string dir = "/music/artist" + std::to_string(i / 100) + "/album/";
+        store.add(make_song(dir + "track" + std::to_string(i) + ".mp3", "Track " + std::to_string(i),
+                            "Artist " + std::to_string(i / 100), 180.0));
+    }
+    ASSERT_EQ(store.size(), static_cast<size_t>(COUNT));
+    EXPECT_EQ(store.path(store.find("/music/artist42/album/track4217.mp3")), "/music/artist42/album/track4217.mp3");
+    EXPECT_EQ(store.view(4217).artist, "Artist 42");
+
+    // A SongList entry is a Song plus the heap copy of its path (titles here fit inline)
+    size_t song_list_bytes = sizeof(Song) + std::string("/music/artist42/album/track4217.mp3").size() + 1;
+    EXPECT_LT(store.memory_bytes() / COUNT, song_list_bytes);
+}
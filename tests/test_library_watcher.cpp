@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include "../src/library_watcher.cpp"
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+using namespace nigamp;
+namespace fs = std::filesystem;
+
+class LibraryWatcherTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        base = fs::temp_directory_path() / ("nigamp_watch_" + std::to_string(::getpid()));
+        fs::remove_all(base);
+        root = (base / "library").string();
+        outside = (base / "outside").string();
+        fs::create_directories(root + "/artist/album");
+        fs::create_directories(outside);
+
+        loop = std::make_unique<EpollEventLoop>();
+        watcher = std::make_unique<LibraryWatcher>(*loop);
+        ASSERT_TRUE(watcher->start(root, [this](const std::vector<LibraryChange>& batch) {
+            std::lock_guard<std::mutex> lock(mutex);
+            changes.insert(changes.end(), batch.begin(), batch.end());
+            changed.notify_all();
+        }, [this]() { ++rescans; }));
+        loop_thread = std::thread([this]() { loop->run(); });
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (watcher->watch_count() < 3 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_EQ(watcher->watch_count(), 3u);
+    }
+
+    void TearDown() override {
+        loop->post([this]() {
+            watcher->stop();
+            loop->stop();
+        });
+        loop_thread.join();
+        fs::remove_all(base);
+    }
+
+    static void write_file(const std::string& path) {
+        std::ofstream file(path);
+        file << "data";
+    }
+
+    // Waits until `count` changes have arrived, then hands them over
+    std::vector<LibraryChange> wait_for(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait_for(lock, std::chrono::seconds(5), [&]() { return changes.size() >= count; });
+        std::vector<LibraryChange> result = std::move(changes);
+        changes.clear();
+        return result;
+    }
+
+    fs::path base;
+    std::string root;
+    std::string outside;
+    std::unique_ptr<EpollEventLoop> loop;
+    std::unique_ptr<LibraryWatcher> watcher;
+    std::thread loop_thread;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<LibraryChange> changes;
+    std::atomic<int> rescans{0};
+};
+
+TEST_F(LibraryWatcherTest, ReportsFileAddRenameAndRemove) {
+    std::string song = root + "/artist/album/one.mp3";
+    write_file(song);
+    auto added = wait_for(1);
+    ASSERT_EQ(added.size(), 1u);
+    EXPECT_EQ(added[0].kind, LibraryChange::Kind::ADDED);
+    EXPECT_EQ(added[0].path, song);
+
+    std::string renamed = root + "/artist/two.mp3";
+    fs::rename(song, renamed);
+    auto moved = wait_for(1);
+    ASSERT_EQ(moved.size(), 1u);
+    EXPECT_EQ(moved[0].kind, LibraryChange::Kind::RENAMED);
+    EXPECT_EQ(moved[0].old_path, song);
+    EXPECT_EQ(moved[0].path, renamed);
+
+    fs::remove(renamed);
+    auto removed = wait_for(1);
+    ASSERT_EQ(removed.size(), 1u);
+    EXPECT_EQ(removed[0].kind, LibraryChange::Kind::REMOVED);
+    EXPECT_EQ(removed[0].path, renamed);
+    EXPECT_EQ(rescans, 0);
+}
+
+TEST_F(LibraryWatcherTest, FollowsDirectoriesMovedInRenamedAndOut) {
+    // A whole album arrives at once; its existing files are reported
+    fs::create_directories(outside + "/new_album/disc1");
+    write_file(outside + "/new_album/disc1/track.mp3");
+    fs::rename(outside + "/new_album", root + "/new_album");
+    auto arrived = wait_for(1);
+    ASSERT_EQ(arrived.size(), 1u);
+    EXPECT_EQ(arrived[0].path, root + "/new_album/disc1/track.mp3");
+    EXPECT_EQ(watcher->watch_count(), 5u);
+
+    fs::rename(root + "/new_album", root + "/renamed_album");
+    auto renamed = wait_for(1);
+    ASSERT_EQ(renamed.size(), 1u);
+    EXPECT_EQ(renamed[0].kind, LibraryChange::Kind::RENAMED);
+    EXPECT_TRUE(renamed[0].is_directory);
+    EXPECT_EQ(renamed[0].old_path, root + "/new_album");
+
+    // Watches follow the rename
+    write_file(root + "/renamed_album/disc1/later.mp3");
+    auto later = wait_for(1);
+    ASSERT_EQ(later.size(), 1u);
+    EXPECT_EQ(later[0].path, root + "/renamed_album/disc1/later.mp3");
+
+    fs::rename(root + "/renamed_album", outside + "/gone");
+    auto gone = wait_for(1);
+    ASSERT_EQ(gone.size(), 1u);
+    EXPECT_EQ(gone[0].kind, LibraryChange::Kind::REMOVED);
+    EXPECT_TRUE(gone[0].is_directory);
+    EXPECT_EQ(gone[0].path, root + "/renamed_album");
+    EXPECT_EQ(watcher->watch_count(), 3u);
+}
+
+TEST_F(LibraryWatcherTest, WatchesDirectoriesCreatedInPlace) {
+    fs::create_directories(root + "/fresh/a/b");
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (watcher->watch_count() < 6 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(watcher->watch_count(), 6u);
+
+    write_file(root + "/fresh/a/b/song.mp3");
+    auto added = wait_for(1);
+    ASSERT_EQ(added.size(), 1u);
+    EXPECT_EQ(added[0].kind, LibraryChange::Kind::ADDED);
+    EXPECT_EQ(added[0].path, root + "/fresh/a/b/song.mp3");
+}
@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+#include "../src/loudness.cpp"
+#include "pcm_tee.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <future>
+
+using namespace nigamp;
+
+namespace {
+
+// Mono WAV of one-second segments, each a square wave at the given amplitude
+std::string write_segments_wav(const std::string& name, const std::vector<int16_t>& amplitudes) {
+    std::string path = (std::filesystem::temp_directory_path() / name).string();
+    AudioFormat format{8000, 1, 16};
+    std::vector<int16_t> samples;
+    for (int16_t amplitude : amplitudes) {
+        for (int i = 0; i < format.sample_rate; ++i) {
+            samples.push_back((i / 20) % 2 ? amplitude : static_cast<int16_t>(-amplitude));
+        }
+    }
+
+    std::string header = make_wav_header(format, static_cast<uint32_t>(samples.size() * 2));
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    std::fwrite(header.data(), 1, header.size(), file);
+    std::fwrite(samples.data(), 2, samples.size(), file);
+    std::fclose(file);
+    return path;
+}
+
+}
+
+TEST(LoudnessTest, LoudestWindowSlidesOverEnvelope) {
+    LoudnessEnvelope envelope;
+    envelope.rms = {0.1f, 0.1f, 0.2f, 0.9f, 0.8f, 0.9f, 0.1f, 0.1f};
+    EXPECT_DOUBLE_EQ(find_loudest_window(envelope, 1.5), 3 * LoudnessEnvelope::BLOCK_SECONDS);
+
+    // Nothing to choose when the track is no longer than the window
+    EXPECT_EQ(find_loudest_window(envelope, envelope.duration()), 0.0);
+    EXPECT_EQ(find_loudest_window(LoudnessEnvelope(), 10.0), 0.0);
+}
+
+TEST(LoudnessTest, EnvelopeTracksSignalLevel) {
+    std::string path = write_segments_wav("nigamp_loudness_levels.wav", {1000, 1000, 16000, 16000, 1000});
+
+    LoudnessEnvelope envelope;
+    ASSERT_TRUE(compute_loudness_envelope(path, envelope));
+    ASSERT_EQ(envelope.rms.size(), 10u);
+    EXPECT_NEAR(envelope.rms[0], 1000 / 32768.0, 1e-3);
+    EXPECT_NEAR(envelope.rms[5], 16000 / 32768.0, 1e-3);
+    EXPECT_DOUBLE_EQ(find_loudest_window(envelope, 2.0), 2.0);
+
+    EXPECT_FALSE(compute_loudness_envelope("missing.wav", envelope));
+    std::filesystem::remove(path);
+}
+
+TEST(LoudnessTest, AnalyzerCachesResultsIncludingFailures) {
+    std::string path = write_segments_wav("nigamp_loudness_cache.wav", {500, 20000, 500});
+    LoudnessAnalyzer analyzer(2);
+
+    LoudnessEnvelope envelope;
+    EXPECT_FALSE(analyzer.lookup(path, envelope));
+
+    std::promise<void> analyzed;
+    std::promise<void> failed;
+    analyzer.request(path, [&]() { analyzed.set_value(); });
+    analyzer.request("missing.wav", [&]() { failed.set_value(); });
+    analyzed.get_future().wait();
+    failed.get_future().wait();
+
+    ASSERT_TRUE(analyzer.lookup(path, envelope));
+    EXPECT_EQ(envelope.rms.size(), 6u);
+    ASSERT_TRUE(analyzer.lookup("missing.wav", envelope));
+    EXPECT_TRUE(envelope.rms.empty());
+
+    // Cached: answered on this thread before request returns
+    bool called = false;
+    analyzer.request(path, [&]() { called = true; });
+    EXPECT_TRUE(called);
+    std::filesystem::remove(path);
+}
+
+TEST(LoudnessTest, CancelStopsTheDecode) {
+    std::string path = write_segments_wav("nigamp_loudness_cancel.wav", {1000, 1000, 1000});
+    std::atomic<bool> cancel{true};
+    LoudnessEnvelope envelope;
+    EXPECT_FALSE(compute_loudness_envelope(path, envelope, &cancel));
+    EXPECT_TRUE(envelope.rms.empty());
+
+    cancel = false;
+    EXPECT_TRUE(compute_loudness_envelope(path, envelope, &cancel));
+    EXPECT_EQ(envelope.rms.size(), 6u);
+    std::filesystem::remove(path);
+}
+
+TEST(LoudnessTest, AnalyzerKeepsTheMostRecentlyUsed) {
+    std::vector<std::string> paths;
+    for (int i = 0; i < 3; ++i) {
+        paths.push_back(write_segments_wav("nigamp_loudness_lru" + std::to_string(i) + ".wav", {1000}));
+    }
+    LoudnessAnalyzer analyzer(1, 2);
+    auto analyze = [&](const std::string& path) {
+        std::promise<void> done;
+        analyzer.request(path, [&]() { done.set_value(); });
+        done.get_future().wait();
+    };
+
+    analyze(paths[0]);
+    analyze(paths[1]);
+    LoudnessEnvelope envelope;
+    ASSERT_TRUE(analyzer.lookup(paths[0], envelope));  // Now the most recent
+    analyze(paths[2]);
+
+    EXPECT_TRUE(analyzer.lookup(paths[0], envelope));
+    EXPECT_FALSE(analyzer.lookup(paths[1], envelope));
+    EXPECT_TRUE(analyzer.lookup(paths[2], envelope));
+    for (const auto& path : paths) {
+        std::filesystem::remove(path);
+    }
+}
+
+TEST(LoudnessTest, StoreOutlivesTheAnalyzerUntilTheFileChanges) {
+    std::string path = write_segments_wav("nigamp_loudness_store.wav", {1000, 16000});
+    std::string store_path = (std::filesystem::temp_directory_path() / "nigamp_loudness_store.bin").string();
+    std::filesystem::remove(store_path);
+    auto analyze = [&](LoudnessEnvelope& envelope) {
+        LoudnessAnalyzer analyzer(1, LoudnessAnalyzer::DEFAULT_CACHE_LIMIT, store_path);
+        std::promise<void> done;
+        analyzer.request(path, [&]() { done.set_value(); });
+        done.get_future().wait();
+        ASSERT_TRUE(analyzer.lookup(path, envelope));
+    };
+
+    LoudnessEnvelope first;
+    analyze(first);
+    ASSERT_EQ(first.rms.size(), 4u);
+
+    // Same size and mtime but different audio: the stored envelope is used
+    auto mtime = std::filesystem::last_write_time(path);
+    write_segments_wav("nigamp_loudness_store.wav", {16000, 1000});
+    std::filesystem::last_write_time(path, mtime);
+    LoudnessEnvelope stored;
+    analyze(stored);
+    ASSERT_EQ(stored.rms.size(), 4u);
+    for (size_t i = 0; i < first.rms.size(); ++i) {
+        EXPECT_NEAR(stored.rms[i], first.rms[i], 0.5 / 255);
+    }
+
+    // A new stamp means a fresh decode
+    std::filesystem::last_write_time(path, mtime + std::chrono::seconds(1));
+    LoudnessEnvelope fresh;
+    analyze(fresh);
+    ASSERT_EQ(fresh.rms.size(), 4u);
+    EXPECT_GT(fresh.rms[0], fresh.rms[3]);
+
+    // A torn append is dropped without losing the records before it
+    {
+        std::ofstream file(store_path, std::ios::binary | std::ios::app);
+        file.write("\x40\0\0", 3);
+    }
+    LoudnessEnvelope recovered;
+    analyze(recovered);
+    EXPECT_EQ(recovered.rms.size(), 4u);
+    EXPECT_GT(recovered.rms[0], recovered.rms[3]);
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(store_path);
+}
+
+TEST(LoudnessTest, AnalyzeOnTheCallerSharesCacheAndStore) {
+    std::string path = write_segments_wav("nigamp_loudness_sync.wav", {1000, 16000});
+    std::string store_path = (std::filesystem::temp_directory_path() / "nigamp_loudness_sync.bin").string();
+    std::filesystem::remove(store_path);
+
+    LoudnessEnvelope first;
+    {
+        LoudnessAnalyzer analyzer(1, LoudnessAnalyzer::DEFAULT_CACHE_LIMIT, store_path);
+        ASSERT_TRUE(analyzer.analyze(path, first));
+        LoudnessEnvelope cached;
+        ASSERT_TRUE(analyzer.lookup(path, cached));
+        EXPECT_EQ(cached.rms, first.rms);
+        EXPECT_FALSE(analyzer.analyze("missing.wav", cached));
+    }
+    ASSERT_EQ(first.rms.size(), 4u);
+
+    // Same stamp, different audio: a later run reads the stored envelope
+    auto mtime = std::filesystem::last_write_time(path);
+    write_segments_wav("nigamp_loudness_sync.wav", {16000, 1000});
+    std::filesystem::last_write_time(path, mtime);
+    LoudnessAnalyzer analyzer(1, LoudnessAnalyzer::DEFAULT_CACHE_LIMIT, store_path);
+    LoudnessEnvelope stored;
+    ASSERT_TRUE(analyzer.analyze(path, stored));
+    ASSERT_EQ(stored.rms.size(), 4u);
+    EXPECT_LT(stored.rms[0], stored.rms[3]);
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(store_path);
+}
@@ -15,7 +15,7 @@ private:
     std::unique_ptr<IPlaylist> m_playlist;
     std::unique_ptr<IHotkeyHandler> m_hotkey_handler;
     
-    const Song* m_current_song = nullptr;
+    SongId m_current_song = INVALID_SONG_ID;
     std::atomic<bool> m_is_paused{false};
     std::atomic<bool> m_should_quit{false};
     float m_volume = 0.8f;
@@ -26,6 +26,8 @@ private:
     std::atomic<int> m_pause_calls{0};
     std::atomic<int> m_volume_up_calls{0};
     std::atomic<int> m_volume_down_calls{0};
+    std::atomic<int> m_seek_forward_calls{0};
+    std::atomic<int> m_seek_backward_calls{0};
     std::atomic<int> m_song_changes{0};
     
 public:
@@ -50,11 +52,15 @@ public:
         
         // Set current song to first song
         m_current_song = m_playlist->current();
-        if (m_current_song) {
-            std::cout << "[MOCK] Starting with: " << m_current_song->title << std::endl;
+        if (m_current_song != INVALID_SONG_ID) {
+            std::cout << "[MOCK] Starting with: " << title_of(m_current_song) << std::endl;
         }
     }
     
+    std::string title_of(SongId id) const {
+        return id == INVALID_SONG_ID ? "None" : std::string(m_playlist->library().view(id).title);
+    }
+    
     bool initialize() {
         if (!m_hotkey_handler->initialize()) {
             std::cerr << "[MOCK] Failed to initialize hotkey handler" << std::endl;
@@ -100,6 +106,13 @@ public:
                 m_volume_down_calls++;
                 adjust_volume(-0.1f);
                 break;
+            case HotkeyAction::SEEK_FORWARD:
+                // The mock plays nothing, so a seek is only counted
+                m_seek_forward_calls++;
+                break;
+            case HotkeyAction::SEEK_BACKWARD:
+                m_seek_backward_calls++;
+                break;
             case HotkeyAction::QUIT:
                 quit();
                 break;
@@ -107,18 +120,18 @@ public:
     }
     
     void next_track() {
-        const Song* current_before = m_current_song;
+        SongId current_before = m_current_song;
         size_t current_index_before = get_current_index();
         
         std::cout << "[MOCK] Next track requested. Current: " 
-                  << (m_current_song ? m_current_song->title : "None") 
+                  << title_of(m_current_song) 
                   << " (index: " << current_index_before << "/" << (m_playlist->size()-1) << ")" << std::endl;
         
-        const Song* next_song = m_playlist->next();
-        if (next_song) {
+        SongId next_song = m_playlist->next();
+        if (next_song != INVALID_SONG_ID) {
             if (next_song != current_before) {
                 m_song_changes++;
-                std::cout << "[MOCK] ✓ Song changed to: " << next_song->title 
+                std::cout << "[MOCK] ✓ Song changed to: " << title_of(next_song) 
                           << " (index: " << get_current_index() << ")" << std::endl;
             } else {
                 std::cout << "[MOCK] → Song stayed the same (likely at end, wrapped to beginning)" << std::endl;
@@ -131,18 +144,18 @@ public:
     }
     
     void previous_track() {
-        const Song* current_before = m_current_song;
+        SongId current_before = m_current_song;
         size_t current_index_before = get_current_index();
         
         std::cout << "[MOCK] Previous track requested. Current: " 
-                  << (m_current_song ? m_current_song->title : "None") 
+                  << title_of(m_current_song) 
                   << " (index: " << current_index_before << "/" << (m_playlist->size()-1) << ")" << std::endl;
         
-        const Song* prev_song = m_playlist->previous();
-        if (prev_song) {
+        SongId prev_song = m_playlist->previous();
+        if (prev_song != INVALID_SONG_ID) {
             if (prev_song != current_before) {
                 m_song_changes++;
-                std::cout << "[MOCK] ✓ Song changed to: " << prev_song->title 
+                std::cout << "[MOCK] ✓ Song changed to: " << title_of(prev_song) 
                           << " (index: " << get_current_index() << ")" << std::endl;
             } else {
                 std::cout << "[MOCK] → Song stayed the same (likely at beginning, no change)" << std::endl;
@@ -172,36 +185,36 @@ public:
     }
     
     void play_current_song() {
-        if (m_current_song) {
-            std::cout << "[MOCK] ♪ Now playing: " << m_current_song->title 
-                      << " by " << m_current_song->artist << std::endl;
+        if (m_current_song != INVALID_SONG_ID) {
+            std::cout << "[MOCK] ♪ Now playing: " << title_of(m_current_song) 
+                      << " by " << m_playlist->library().view(m_current_song).artist << std::endl;
         }
     }
     
     size_t get_current_index() {
         // Simple way to find current index (playlist interface doesn't expose this directly)
-        if (!m_current_song) return 0;
+        if (m_current_song == INVALID_SONG_ID) return 0;
         
         size_t index = 0;
         // This is a bit hacky but works for testing
-        const Song* temp_current = m_playlist->current();
+        SongId temp_current = m_playlist->current();
         
         // Reset to beginning and count
-        while (m_playlist->previous()) { /* go to start */ }
+        while (m_playlist->previous() != INVALID_SONG_ID) { /* go to start */ }
         
         while (true) {
-            const Song* song = m_playlist->current();
-            if (song && song->file_path == m_current_song->file_path) {
+            SongId song = m_playlist->current();
+            if (song != INVALID_SONG_ID && song == m_current_song) {
                 // Restore original position
-                while (m_playlist->current() != temp_current && m_playlist->next()) { /* restore */ }
+                while (m_playlist->current() != temp_current && m_playlist->next() != INVALID_SONG_ID) { /* restore */ }
                 return index;
             }
-            if (!m_playlist->next()) break;
+            if (m_playlist->next() == INVALID_SONG_ID) break;
             index++;
         }
         
         // Restore original position
-        while (m_playlist->current() != temp_current && m_playlist->previous()) { /* restore */ }
+        while (m_playlist->current() != temp_current && m_playlist->previous() != INVALID_SONG_ID) { /* restore */ }
         return 0;
     }
     
@@ -230,11 +243,11 @@ public:
         
         // Test 1: Previous at first song
         std::cout << "\n--- Test 1: Previous at first song ---" << std::endl;
-        while (m_playlist->previous()) { /* go to start */ }
+        while (m_playlist->previous() != INVALID_SONG_ID) { /* go to start */ }
         m_current_song = m_playlist->current();
-        std::cout << "[TEST] At first song: " << (m_current_song ? m_current_song->title : "None") << std::endl;
+        std::cout << "[TEST] At first song: " << title_of(m_current_song) << std::endl;
         
-        const Song* first_song = m_current_song;
+        SongId first_song = m_current_song;
         previous_track();
         
         if (m_current_song == first_song) {
@@ -249,19 +262,19 @@ public:
         std::cout << "[TEST] Playlist size: " << playlist_size << std::endl;
         
         // Go to last song
-        while (m_playlist->next()) { /* go to end */ }
+        while (m_playlist->next() != INVALID_SONG_ID) { /* go to end */ }
         m_current_song = m_playlist->current();
-        std::cout << "[TEST] At last song: " << (m_current_song ? m_current_song->title : "None") << std::endl;
+        std::cout << "[TEST] At last song: " << title_of(m_current_song) << std::endl;
         
         // Test 3: Next at last song (should wrap to first)
         std::cout << "\n--- Test 3: Next at last song ---" << std::endl;
-        const Song* last_song = m_current_song;
+        SongId last_song = m_current_song;
         next_track();
         
         // Check if we wrapped to first song
         if (m_current_song != last_song) {
             std::cout << "[TEST] ✓ PASS: Next at last song correctly wrapped to: " 
-                      << (m_current_song ? m_current_song->title : "None") << std::endl;
+                      << title_of(m_current_song) << std::endl;
         } else {
             std::cout << "[TEST] ? INFO: Next at last song stayed at last (implementation dependent)" << std::endl;
         }
@@ -275,6 +288,8 @@ public:
         m_pause_calls = 0;
         m_volume_up_calls = 0;
         m_volume_down_calls = 0;
+        m_seek_forward_calls = 0;
+        m_seek_backward_calls = 0;
         m_song_changes = 0;
     }
     
@@ -285,8 +300,10 @@ public:
         std::cout << "Pause calls:    " << m_pause_calls << std::endl;
         std::cout << "Volume up:      " << m_volume_up_calls << std::endl;
         std::cout << "Volume down:    " << m_volume_down_calls << std::endl;
+        std::cout << "Seek forward:   " << m_seek_forward_calls << std::endl;
+        std::cout << "Seek backward:  " << m_seek_backward_calls << std::endl;
         std::cout << "Song changes:   " << m_song_changes << std::endl;
-        std::cout << "Current song:   " << (m_current_song ? m_current_song->title : "None") << std::endl;
+        std::cout << "Current song:   " << title_of(m_current_song) << std::endl;
         std::cout << "Is paused:      " << (m_is_paused ? "Yes" : "No") << std::endl;
         std::cout << "Volume:         " << static_cast<int>(m_volume * 100) << "%" << std::endl;
     }
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include "../src/pcm_recovery.cpp"
+#include <deque>
+
+using namespace nigamp;
+using namespace std::chrono_literals;
+
+// Scripted PCM: each call pops its next result, or succeeds when the script is empty
+class FaultInjectingPcmDevice : public IPcmDevice {
+public:
+    std::deque<int> open_results;
+    std::deque<int> prepare_results;
+    std::deque<int> resume_results;
+    int open_calls = 0;
+    int prepare_calls = 0;
+    int resume_calls = 0;
+    bool open_flag = true;
+    int opened_rate = 0;      // Rate the device comes up at; 0 for whatever was asked
+    int opened_channels = 0;  // Likewise for the channel count
+
+    int open(const AudioFormat& requested, PcmConfig& actual) override {
+        ++open_calls;
+        int err = next(open_results);
+        if (err < 0) {
+            return err;
+        }
+        open_flag = true;
+        actual.sample_rate = opened_rate ? opened_rate : requested.sample_rate;
+        actual.channels = opened_channels ? opened_channels : requested.channels;
+        actual.buffer_frames = requested.sample_rate * 2;
+        actual.period_frames = requested.sample_rate / 20;
+        return 0;
+    }
+    void close() override { open_flag = false; }
+    bool is_open() const override { return open_flag; }
+    int prepare() override { ++prepare_calls; return next(prepare_results); }
+    int resume() override { ++resume_calls; return next(resume_results); }
+    int drop() override { return 0; }
+    int pause(bool) override { return 0; }
+    long avail() override { return 0; }
+    long write(const int16_t*, size_t frames) override { return static_cast<long>(frames); }
+    long rewindable() override { return 0; }
+    long rewind(size_t) override { return 0; }
+
+private:
+    static int next(std::deque<int>& script) {
+        if (script.empty()) {
+            return 0;
+        }
+        int result = script.front();
+        script.pop_front();
+        return result;
+    }
+};
+
+class PcmRecoveryTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        policy.initial_backoff = 100ms;
+        policy.max_backoff = 500ms;
+        policy.resume_interval = 50ms;
+        recovery = std::make_unique<PcmRecovery>(device, policy);
+
+        AudioFormat format;
+        format.sample_rate = 48000;
+        format.channels = 2;
+        recovery->set_format(format);
+    }
+
+    FaultInjectingPcmDevice device;
+    PcmRecoveryPolicy policy;
+    std::unique_ptr<PcmRecovery> recovery;
+    PcmRecovery::Clock::time_point t0 = PcmRecovery::Clock::now();
+};
+
+TEST_F(PcmRecoveryTest, XrunIsRePrepared) {
+    EXPECT_EQ(recovery->handle_error(-EPIPE, t0), PcmRecoveryResult::RESTARTED);
+    EXPECT_EQ(device.prepare_calls, 1);
+    EXPECT_TRUE(recovery->is_running());
+    EXPECT_EQ(recovery->get_recovery_count(), 1);
+}
+
+TEST_F(PcmRecoveryTest, TransientErrorsNeedNoAction) {
+    EXPECT_EQ(recovery->handle_error(-EAGAIN, t0), PcmRecoveryResult::NONE);
+    EXPECT_EQ(recovery->poll(t0), PcmRecoveryResult::NONE);
+    EXPECT_EQ(device.prepare_calls, 0);
+}
+
+TEST_F(PcmRecoveryTest, SuspendRetriesResumeUntilDeviceWakes) {
+    device.resume_results = {-EAGAIN, -EAGAIN, 0};
+
+    EXPECT_EQ(recovery->handle_error(-ESTRPIPE, t0), PcmRecoveryResult::WAITING);
+    EXPECT_EQ(recovery->get_state(), PcmRecoveryState::SUSPENDED);
+
+    // Not due yet: no extra resume call
+    EXPECT_EQ(recovery->poll(t0 + 10ms), PcmRecoveryResult::WAITING);
+    EXPECT_EQ(device.resume_calls, 1);
+
+    EXPECT_EQ(recovery->poll(t0 + 50ms), PcmRecoveryResult::WAITING);
+    EXPECT_EQ(recovery->poll(t0 + 100ms), PcmRecoveryResult::RESUMED);
+    EXPECT_EQ(device.resume_calls, 3);
+    EXPECT_EQ(device.prepare_calls, 0);
+    EXPECT_TRUE(recovery->is_running());
+}
+
+TEST_F(PcmRecoveryTest, SuspendFallsBackToPrepareWhenResumeUnsupported) {
+    device.resume_results = {-ENOSYS};
+    EXPECT_EQ(recovery->handle_error(-ESTRPIPE, t0), PcmRecoveryResult::RESTARTED);
+    EXPECT_EQ(device.prepare_calls, 1);
+    EXPECT_TRUE(recovery->is_running());
+}
+
+TEST_F(PcmRecoveryTest, UnplugReopensWithCappedExponentialBackoff) {
+    device.open_results = {-ENOENT, -ENOENT, -ENOENT, -ENOENT};
+
+    EXPECT_EQ(recovery->handle_error(-ENODEV, t0), PcmRecoveryResult::WAITING);
+    EXPECT_EQ(recovery->get_state(), PcmRecoveryState::DISCONNECTED);
+    EXPECT_FALSE(device.is_open());
+
+    EXPECT_EQ(recovery->poll(t0 + 99ms), PcmRecoveryResult::WAITING);
+    EXPECT_EQ(device.open_calls, 0);
+
+    auto now = t0 + 100ms;
+    std::vector<long> backoffs;
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(recovery->poll(now), PcmRecoveryResult::WAITING);
+        backoffs.push_back(static_cast<long>(recovery->get_backoff().count()));
+        now += recovery->get_backoff();
+    }
+    EXPECT_EQ(backoffs, (std::vector<long>{200, 400, 500, 500}));
+    EXPECT_EQ(recovery->get_reopen_attempts(), 4);
+
+    // Device is back: reopened at the rate it had before
+    EXPECT_EQ(recovery->poll(now), PcmRecoveryResult::REOPENED);
+    EXPECT_TRUE(recovery->is_running());
+    EXPECT_TRUE(device.is_open());
+    EXPECT_EQ(recovery->get_config().sample_rate, 48000);
+    EXPECT_EQ(recovery->get_config().channels, 2);
+    EXPECT_EQ(device.open_calls, 5);
+}
+
+TEST_F(PcmRecoveryTest, ReopenAtAnotherRateIsAccepted) {
+    recovery->handle_error(-ENODEV, t0);
+    device.opened_rate = 44100;
+    EXPECT_EQ(recovery->poll(t0 + 100ms), PcmRecoveryResult::REOPENED);
+    EXPECT_TRUE(recovery->is_running());
+    EXPECT_TRUE(device.is_open());
+    EXPECT_EQ(recovery->get_config().sample_rate, 44100);
+}
+
+TEST_F(PcmRecoveryTest, OtherChannelCountsGiveUpAfterAFewAttempts) {
+    policy.max_channel_mismatches = 3;
+    recovery = std::make_unique<PcmRecovery>(device, policy);
+    AudioFormat format;
+    format.sample_rate = 48000;
+    format.channels = 2;
+    recovery->set_format(format);
+
+    recovery->handle_error(-ENODEV, t0);
+    device.opened_channels = 1;
+    auto now = t0 + 100ms;
+    EXPECT_EQ(recovery->poll(now), PcmRecoveryResult::WAITING);
+    EXPECT_FALSE(device.is_open());
+    now += recovery->get_backoff();
+    EXPECT_EQ(recovery->poll(now), PcmRecoveryResult::WAITING);
+    now += recovery->get_backoff();
+    EXPECT_EQ(recovery->poll(now), PcmRecoveryResult::FAILED);
+    EXPECT_EQ(recovery->get_state(), PcmRecoveryState::FAILED);
+    EXPECT_EQ(device.open_calls, 3);
+
+    // No further attempts until the owner starts over
+    EXPECT_EQ(recovery->poll(now + 10s), PcmRecoveryResult::WAITING);
+    EXPECT_EQ(device.open_calls, 3);
+    recovery->reset();
+    EXPECT_TRUE(recovery->is_running());
+}
+
+TEST_F(PcmRecoveryTest, FailedPrepareEscalatesToReopen) {
+    device.prepare_results = {-ENODEV};
+    EXPECT_EQ(recovery->handle_error(-EPIPE, t0), PcmRecoveryResult::WAITING);
+    EXPECT_EQ(recovery->get_state(), PcmRecoveryState::DISCONNECTED);
+    EXPECT_EQ(recovery->poll(t0 + 100ms), PcmRecoveryResult::REOPENED);
+}
+
+TEST_F(PcmRecoveryTest, ErrorsWhileRecoveringKeepTheSchedule) {
+    device.open_results = {-ENOENT};
+    recovery->handle_error(-ENODEV, t0);
+    recovery->poll(t0 + 100ms);
+    EXPECT_EQ(recovery->get_backoff(), 200ms);
+
+    // Late errors from the old handle must not restart the backoff
+    EXPECT_EQ(recovery->handle_error(-EBADFD, t0 + 150ms), PcmRecoveryResult::WAITING);
+    EXPECT_EQ(recovery->get_backoff(), 200ms);
+    EXPECT_EQ(recovery->poll(t0 + 300ms), PcmRecoveryResult::REOPENED);
+}
@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+#include "../src/pcm_tee.cpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+    #include <sys/types.h>
+#endif
+
+using namespace nigamp;
+
+class PcmTeeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir = "test_pcm_tee";
+        std::filesystem::create_directory(test_dir);
+        format.sample_rate = 48000;
+        format.channels = 2;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir);
+    }
+
+    static std::vector<int16_t> make_ramp(size_t samples) {
+        std::vector<int16_t> data(samples);
+        for (size_t i = 0; i < samples; ++i) {
+            data[i] = static_cast<int16_t>(i % 30000);
+        }
+        return data;
+    }
+
+    static uint32_t read_u32(const std::vector<char>& bytes, size_t offset) {
+        uint32_t value = 0;
+        for (int i = 3; i >= 0; --i) {
+            value = (value << 8) | static_cast<unsigned char>(bytes[offset + i]);
+        }
+        return value;
+    }
+
+    static std::vector<char> read_file(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    std::string test_dir;
+    AudioFormat format;
+};
+
+TEST_F(PcmTeeTest, WritesCompleteWavFile) {
+    std::string path = test_dir + "/capture.wav";
+    auto samples = make_ramp(10000 * 2);
+
+    PcmTee tee;
+    ASSERT_TRUE(tee.open(path, format));
+    // Odd-sized writes exercise chunk boundaries
+    for (size_t offset = 0; offset < samples.size(); offset += 1234) {
+        size_t count = std::min<size_t>(1234, samples.size() - offset);
+        EXPECT_EQ(tee.write(samples.data() + offset, count), count);
+    }
+    tee.close();
+
+    EXPECT_EQ(tee.get_frames_written(), 10000);
+    EXPECT_EQ(tee.get_dropped_frames(), 0);
+
+    auto bytes = read_file(path);
+    ASSERT_EQ(bytes.size(), 44 + samples.size() * 2);
+    EXPECT_EQ(std::string(bytes.data(), 4), "RIFF");
+    EXPECT_EQ(read_u32(bytes, 4), 36 + samples.size() * 2);
+    EXPECT_EQ(read_u32(bytes, 24), 48000);
+    EXPECT_EQ(read_u32(bytes, 40), samples.size() * 2);
+    EXPECT_EQ(std::memcmp(bytes.data() + 44, samples.data(), samples.size() * 2), 0);
+}
+
+TEST_F(PcmTeeTest, UnwritablePathFailsToOpen) {
+    PcmTee tee;
+    EXPECT_FALSE(tee.open(test_dir + "/missing/capture.wav", format));
+    EXPECT_FALSE(tee.is_open());
+    EXPECT_EQ(tee.write(nullptr, 0), 0);
+}
+
+#ifndef _WIN32
+TEST_F(PcmTeeTest, StalledPipeDropsInsteadOfBlocking) {
+    // No reader ever opens the FIFO, so nothing can drain the ring
+    std::string path = test_dir + "/stalled.fifo";
+    ASSERT_EQ(::mkfifo(path.c_str(), 0600), 0);
+
+    PcmTee tee;
+    ASSERT_TRUE(tee.open(path, format));
+
+    auto samples = make_ramp(4800 * 2);  // 100 ms
+    auto start = std::chrono::steady_clock::now();
+    size_t accepted = 0;
+    for (int i = 0; i < 50; ++i) {  // 5 seconds of audio, more than the ring holds
+        accepted += tee.write(samples.data(), samples.size());
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(), 100);
+    EXPECT_LT(accepted, 50 * samples.size());
+    // Drops are whole chunks, which can include samples accepted by an earlier call
+    EXPECT_GE(tee.get_dropped_frames(), (50 * samples.size() - accepted) / 2);
+
+    // Closing must not hang waiting for a reader
+    tee.close();
+    EXPECT_EQ(tee.get_frames_written(), 0);
+}
+
+TEST_F(PcmTeeTest, PipeGetsStreamingHeader) {
+    std::string path = test_dir + "/stream.fifo";
+    ASSERT_EQ(::mkfifo(path.c_str(), 0600), 0);
+
+    std::vector<char> received;
+    std::thread reader([&]() { received = read_file(path); });
+
+    auto samples = make_ramp(4800 * 2);
+    PcmTee tee;
+    ASSERT_TRUE(tee.open(path, format));
+    tee.write(samples.data(), samples.size());
+    // Closing before the reader has been picked up would drop the audio
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (tee.get_frames_written() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    tee.close();
+    reader.join();
+
+    ASSERT_EQ(received.size(), 44 + samples.size() * 2);
+    EXPECT_EQ(read_u32(received, 4), 0xFFFFFFFFu);
+    EXPECT_EQ(read_u32(received, 40), 0xFFFFFFFFu);
+    EXPECT_EQ(std::memcmp(received.data() + 44, samples.data(), samples.size() * 2), 0);
+}
+
+TEST_F(PcmTeeTest, LateReaderGetsBufferedAudioRightAway) {
+    std::string path = test_dir + "/late.fifo";
+    ASSERT_EQ(::mkfifo(path.c_str(), 0600), 0);
+
+    // Committed before any reader, so it waits in the ring
+    auto samples = make_ramp(CHUNK_SAMPLES * 3);
+    PcmTee tee;
+    ASSERT_TRUE(tee.open(path, format));
+    ASSERT_EQ(tee.write(samples.data(), samples.size()), samples.size());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(tee.get_frames_written(), 0u);
+
+    std::vector<char> received;
+    std::thread reader([&]() { received = read_file(path); });
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(2);
+    while (tee.get_frames_written() < samples.size() / 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    // The writer is blocked in open, not polling for the reader
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+    // A chunk committed to an idle writer wakes it
+    start = std::chrono::steady_clock::now();
+    tee.write(samples.data(), CHUNK_SAMPLES);
+    while (tee.get_frames_written() < (samples.size() + CHUNK_SAMPLES) / 2 &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+    tee.close();
+    reader.join();
+    EXPECT_EQ(received.size(), 44 + (samples.size() + CHUNK_SAMPLES) * 2);
+    EXPECT_EQ(tee.get_dropped_frames(), 0u);
+}
+
+TEST_F(PcmTeeTest, ReaderLeavingOnlyFailsTheTee) {
+    std::string path = test_dir + "/leaving.fifo";
+    ASSERT_EQ(::mkfifo(path.c_str(), 0600), 0);
+
+    // Read the header and go away
+    std::thread reader([&]() {
+        std::ifstream file(path, std::ios::binary);
+        char header[44];
+        file.read(header, sizeof(header));
+    });
+
+    auto samples = make_ramp(4800 * 2);
+    PcmTee tee;
+    ASSERT_TRUE(tee.open(path, format));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (tee.get_dropped_frames() == 0 && std::chrono::steady_clock::now() < deadline) {
+        tee.write(samples.data(), samples.size());
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    tee.close();
+    reader.join();
+
+    // Still alive, and the process-wide disposition was left alone
+    EXPECT_GT(tee.get_dropped_frames(), 0u);
+    struct sigaction action;
+    ASSERT_EQ(::sigaction(SIGPIPE, nullptr, &action), 0);
+    EXPECT_EQ(action.sa_handler, SIG_DFL);
+}
+#endif
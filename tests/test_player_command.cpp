@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include "../src/player_command.cpp"
+#include <thread>
+#include <vector>
+
+using namespace nigamp;
+
+namespace {
+
+PlayerCommand make(PlayerCommandType type, double amount = 1.0) {
+    PlayerCommand command;
+    command.type = type;
+    command.amount = amount;
+    return command;
+}
+
+}
+
+TEST(PlayerCommandTest, VolumeBurstBecomesOneChange) {
+    std::vector<PlayerCommand> burst(10, command_from_hotkey(HotkeyAction::VOLUME_UP));
+    auto result = coalesce_commands(burst);
+
+    ASSERT_EQ(result.size(), 1u);
+    EXPECT_EQ(result[0].type, PlayerCommandType::VOLUME);
+    EXPECT_NEAR(result[0].amount, 10 * VOLUME_STEP, 1e-9);
+}
+
+TEST(PlayerCommandTest, SkipsAddUpAndCancel) {
+    auto result = coalesce_commands({
+        make(PlayerCommandType::NEXT), make(PlayerCommandType::NEXT),
+        make(PlayerCommandType::PREVIOUS), make(PlayerCommandType::NEXT),
+    });
+    ASSERT_EQ(result.size(), 1u);
+    EXPECT_EQ(result[0].type, PlayerCommandType::NEXT);
+    EXPECT_EQ(result[0].amount, 2.0);
+
+    result = coalesce_commands({
+        make(PlayerCommandType::PREVIOUS), make(PlayerCommandType::PREVIOUS), make(PlayerCommandType::NEXT),
+    });
+    ASSERT_EQ(result.size(), 1u);
+    EXPECT_EQ(result[0].type, PlayerCommandType::PREVIOUS);
+    EXPECT_EQ(result[0].amount, 1.0);
+
+    EXPECT_TRUE(coalesce_commands({make(PlayerCommandType::NEXT), make(PlayerCommandType::PREVIOUS)}).empty());
+}
+
+TEST(PlayerCommandTest, PauseTogglesCancelInPairs) {
+    auto toggle = make(PlayerCommandType::PAUSE_RESUME);
+    EXPECT_TRUE(coalesce_commands({toggle, toggle}).empty());
+    EXPECT_EQ(coalesce_commands({toggle, toggle, toggle}).size(), 1u);
+}
+
+TEST(PlayerCommandTest, OnlyAdjacentCommandsMerge) {
+    PlayerCommand enqueue = make(PlayerCommandType::ENQUEUE);
+    enqueue.path = "song.mp3";
+
+    auto result = coalesce_commands({
+        make(PlayerCommandType::VOLUME, 0.1), make(PlayerCommandType::SEEK, 10.0),
+        make(PlayerCommandType::VOLUME, 0.1), enqueue, enqueue,
+    });
+    ASSERT_EQ(result.size(), 5u);
+    EXPECT_EQ(result[3].path, "song.mp3");
+
+    // A run that cancels out leaves its neighbours apart
+    result = coalesce_commands({
+        make(PlayerCommandType::SEEK, 10.0), make(PlayerCommandType::NEXT),
+        make(PlayerCommandType::PREVIOUS), make(PlayerCommandType::SEEK, 10.0),
+    });
+    ASSERT_EQ(result.size(), 2u);
+    EXPECT_EQ(result[0].amount, 10.0);
+    EXPECT_EQ(result[1].amount, 10.0);
+}
+
+TEST(PlayerCommandTest, NothingSurvivesQuit) {
+    auto result = coalesce_commands({
+        make(PlayerCommandType::NEXT), make(PlayerCommandType::QUIT), make(PlayerCommandType::NEXT),
+    });
+    ASSERT_EQ(result.size(), 2u);
+    EXPECT_EQ(result[1].type, PlayerCommandType::QUIT);
+}
+
+TEST(CommandQueueTest, OnlyFirstPushSchedulesDrain) {
+    CommandQueue queue;
+    EXPECT_TRUE(queue.push(make(PlayerCommandType::VOLUME, 0.1)));
+    EXPECT_FALSE(queue.push(make(PlayerCommandType::VOLUME, 0.1)));
+
+    auto drained = queue.drain();
+    ASSERT_EQ(drained.size(), 1u);
+    EXPECT_NEAR(drained[0].amount, 0.2, 1e-9);
+
+    EXPECT_TRUE(queue.drain().empty());
+    EXPECT_TRUE(queue.push(make(PlayerCommandType::NEXT)));
+}
+
+TEST(CommandQueueTest, ConcurrentProducersLoseNothing) {
+    constexpr int PRODUCERS = 4;
+    constexpr int PUSHES = 5000;
+    CommandQueue queue;
+
+    std::atomic<int> finished{0};
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&]() {
+            for (int i = 0; i < PUSHES; ++i) {
+                queue.push(make(PlayerCommandType::SEEK, 1.0));
+            }
+            ++finished;
+        });
+    }
+
+    // Every command is a seek, so each drain merges into one sum
+    double total = 0.0;
+    bool last_pass = false;
+    while (!last_pass) {
+        last_pass = finished == PRODUCERS;
+        for (const auto& command : queue.drain()) {
+            total += command.amount;
+        }
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    EXPECT_EQ(total, PRODUCERS * PUSHES);
+}
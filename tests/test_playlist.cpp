@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include "../src/playlist.cpp"
+#include <map>
+#include <set>
 
 class PlaylistTest : public ::testing::Test {
 protected:
@@ -22,6 +24,11 @@ protected:
         song3.duration = 220.0;
     }
     
+    // Empty for INVALID_SONG_ID
+    std::string path(nigamp::SongId id) const {
+        return playlist->library().path(id);
+    }
+    
     std::unique_ptr<nigamp::IPlaylist> playlist;
     nigamp::Song song1, song2, song3;
 };
@@ -29,7 +36,7 @@ protected:
 TEST_F(PlaylistTest, InitialState) {
     EXPECT_TRUE(playlist->empty());
     EXPECT_EQ(playlist->size(), 0);
-    EXPECT_EQ(playlist->current(), nullptr);
+    EXPECT_EQ(playlist->current(), nigamp::INVALID_SONG_ID);
     EXPECT_FALSE(playlist->has_next());
     EXPECT_FALSE(playlist->has_previous());
 }
@@ -48,9 +55,11 @@ TEST_F(PlaylistTest, CurrentSong) {
     playlist->add_song(song1);
     playlist->add_song(song2);
     
-    const auto* current = playlist->current();
-    ASSERT_NE(current, nullptr);
-    EXPECT_EQ(current->file_path, song1.file_path);
+    nigamp::SongId current = playlist->current();
+    ASSERT_NE(current, nigamp::INVALID_SONG_ID);
+    EXPECT_EQ(path(current), song1.file_path);
+    EXPECT_EQ(playlist->library().view(current).title, song1.title);
+    EXPECT_EQ(playlist->library().view(current).artist, song1.artist);
 }
 
 TEST_F(PlaylistTest, Navigation) {
@@ -61,16 +70,16 @@ TEST_F(PlaylistTest, Navigation) {
     EXPECT_TRUE(playlist->has_next());
     EXPECT_FALSE(playlist->has_previous());
     
-    const auto* next = playlist->next();
-    ASSERT_NE(next, nullptr);
-    EXPECT_EQ(next->file_path, song2.file_path);
+    nigamp::SongId next = playlist->next();
+    ASSERT_NE(next, nigamp::INVALID_SONG_ID);
+    EXPECT_EQ(path(next), song2.file_path);
     
     EXPECT_TRUE(playlist->has_previous());
     EXPECT_TRUE(playlist->has_next());
     
-    const auto* prev = playlist->previous();
-    ASSERT_NE(prev, nullptr);
-    EXPECT_EQ(prev->file_path, song1.file_path);
+    nigamp::SongId prev = playlist->previous();
+    ASSERT_NE(prev, nigamp::INVALID_SONG_ID);
+    EXPECT_EQ(path(prev), song1.file_path);
 }
 
 TEST_F(PlaylistTest, Shuffle) {
@@ -85,9 +94,9 @@ TEST_F(PlaylistTest, Shuffle) {
     playlist->reset();
     // Collect songs by iterating through the playlist size, not until next() fails
     for (size_t i = 0; i < playlist->size(); ++i) {
-        const auto* song = playlist->current();
-        ASSERT_NE(song, nullptr);
-        original_order.push_back(song->file_path);
+        nigamp::SongId song = playlist->current();
+        ASSERT_NE(song, nigamp::INVALID_SONG_ID);
+        original_order.push_back(path(song));
         if (i < playlist->size() - 1) {  // Don't call next() on the last iteration
             playlist->next();
         }
@@ -98,9 +107,9 @@ TEST_F(PlaylistTest, Shuffle) {
     std::vector<std::string> shuffled_order;
     // Same approach: iterate by size, not until next() fails
     for (size_t i = 0; i < playlist->size(); ++i) {
-        const auto* song = playlist->current();
-        ASSERT_NE(song, nullptr);
-        shuffled_order.push_back(song->file_path);
+        nigamp::SongId song = playlist->current();
+        ASSERT_NE(song, nigamp::INVALID_SONG_ID);
+        shuffled_order.push_back(path(song));
         if (i < playlist->size() - 1) {  // Don't call next() on the last iteration
             playlist->next();
         }
@@ -115,6 +124,117 @@ TEST_F(PlaylistTest, Shuffle) {
     EXPECT_EQ(original_order, shuffled_order);
 }
 
+TEST_F(PlaylistTest, SongsAddedWhileShuffledOnlyJoinUpcoming) {
+    for (int i = 0; i < 5; ++i) {
+        nigamp::Song song;
+        song.file_path = "early" + std::to_string(i) + ".mp3";
+        playlist->add_song(song);
+    }
+    playlist->shuffle();
+    
+    std::vector<std::string> played{playlist->library().path(playlist->current())};
+    for (int i = 0; i < 2; ++i) {
+        played.push_back(playlist->library().path(playlist->next()));
+    }
+    
+    // Songs streaming in must not disturb what was played or is playing
+    for (int i = 0; i < 50; ++i) {
+        nigamp::Song song;
+        song.file_path = "late" + std::to_string(i) + ".mp3";
+        playlist->add_song(song);
+    }
+    EXPECT_EQ(playlist->library().path(playlist->current()), played.back());
+    
+    std::vector<std::string> rest;
+    while (playlist->has_next()) {
+        rest.push_back(playlist->library().path(playlist->next()));
+    }
+    EXPECT_EQ(rest.size(), 52u);
+    
+    playlist->next();  // Wraps to the start
+    EXPECT_EQ(playlist->library().path(playlist->current()), played[0]);
+}
+
+TEST_F(PlaylistTest, SongsAddedWhileShuffledAreUniformlyPlaced) {
+    // Every order of three songs streamed in after the first should be equally likely
+    std::map<std::string, int> counts;
+    constexpr int TRIALS = 6000;
+    for (int trial = 0; trial < TRIALS; ++trial) {
+        auto list = nigamp::create_playlist();
+        list->add_song(song1);
+        list->shuffle();
+        list->add_song(song2);
+        list->add_song(song3);
+        nigamp::Song song4 = song3;
+        song4.file_path = "test4.mp3";
+        list->add_song(song4);
+        std::string order;
+        while (list->has_next()) {
+            order += list->library().path(list->next())[4];
+        }
+        ++counts[order];
+    }
+    ASSERT_EQ(counts.size(), 6u);
+    for (const auto& entry : counts) {
+        EXPECT_NEAR(entry.second, TRIALS / 6, 200) << entry.first;
+    }
+}
+
+TEST_F(PlaylistTest, ReshuffleKeepsRecentlyPlayedSongsLast) {
+    for (int i = 0; i < 40; ++i) {
+        nigamp::Song song;
+        song.file_path = "song" + std::to_string(i) + ".mp3";
+        song.artist = "Artist " + std::to_string(i % 4);
+        playlist->add_song(song);
+    }
+    playlist->set_no_repeat_window(10);
+    playlist->shuffle();
+    std::set<nigamp::SongId> played;
+    for (int i = 0; i < 10; ++i) {
+        nigamp::SongId id = i == 0 ? playlist->current() : playlist->next();
+        playlist->record_play(id);
+        played.insert(id);
+    }
+    EXPECT_EQ(playlist->library().play_count(playlist->current()), 1u);
+    
+    for (const char* mode : {"uniform", "weighted", "artist"}) {
+        playlist->set_shuffle_strategy(nigamp::create_shuffle_strategy(mode));
+        playlist->shuffle();
+        std::vector<size_t> order = playlist->shuffle_order();
+        ASSERT_EQ(order.size(), 40u);
+        for (size_t i = 0; i < order.size(); ++i) {
+            bool recent = played.count(playlist->songs()[order[i]]) > 0;
+            EXPECT_EQ(recent, i >= 30) << mode << " at " << i;
+        }
+    }
+}
+
+TEST_F(PlaylistTest, RestoreOrderReplaysSavedShuffle) {
+    playlist->add_song(song1);
+    playlist->add_song(song2);
+    playlist->add_song(song3);
+    EXPECT_TRUE(playlist->shuffle_order().empty());
+    
+    playlist->shuffle();
+    playlist->next();
+    auto order = playlist->shuffle_order();
+    ASSERT_EQ(order.size(), 3u);
+    std::string current = playlist->library().path(playlist->current());
+    
+    auto restored = nigamp::create_playlist();
+    restored->add_song(song1);
+    restored->add_song(song2);
+    restored->add_song(song3);
+    ASSERT_TRUE(restored->restore_order(order, playlist->current_index()));
+    EXPECT_EQ(restored->shuffle_order(), order);
+    EXPECT_EQ(restored->library().path(restored->current()), current);
+    EXPECT_EQ(restored->library().path(restored->next()), playlist->library().path(playlist->next()));
+    
+    EXPECT_FALSE(restored->restore_order({0, 0, 1}, 0));
+    EXPECT_FALSE(restored->restore_order({0, 1}, 0));
+    EXPECT_FALSE(restored->restore_order({0, 1, 2}, 3));
+}
+
 TEST_F(PlaylistTest, Clear) {
     playlist->add_song(song1);
     playlist->add_song(song2);
@@ -125,5 +245,299 @@ TEST_F(PlaylistTest, Clear) {
     
     EXPECT_TRUE(playlist->empty());
     EXPECT_EQ(playlist->size(), 0);
-    EXPECT_EQ(playlist->current(), nullptr);
-}
\ No newline at end of file
+    EXPECT_EQ(playlist->current(), nigamp::INVALID_SONG_ID);
+}
+namespace {
+
+nigamp::Song library_song(const std::string& path) {
+    nigamp::Song song;
+    song.file_path = path;
+    song.title = path;
+    return song;
+}
+
+// Paths in play order; checks that every internal index agrees with songs()
+std::vector<std::string> play_order(const nigamp::IPlaylist& playlist) {
+    std::vector<std::string> paths;
+    for (size_t index : playlist.shuffle_order()) {
+        std::string path = playlist.library().path(playlist.songs()[index]);
+        EXPECT_TRUE(playlist.contains(path));
+        paths.push_back(path);
+    }
+    return paths;
+}
+
+}
+
+TEST_F(PlaylistTest, LibraryUpdatesKeepPlayedAndUpcomingApart) {
+    for (int i = 0; i < 20; ++i) {
+        playlist->add_song(library_song("lib/a/" + std::to_string(i) + ".mp3"));
+    }
+    playlist->shuffle();
+    for (int i = 0; i < 8; ++i) {
+        playlist->next();
+    }
+    std::vector<std::string> before = play_order(*playlist);
+    std::string current = playlist->library().path(playlist->current());
+    
+    // One played and one upcoming song disappear
+    ASSERT_TRUE(playlist->remove_song(before[3]));
+    ASSERT_TRUE(playlist->remove_song(before[15]));
+    EXPECT_FALSE(playlist->remove_song(before[3]));
+    EXPECT_EQ(playlist->size(), 18u);
+    EXPECT_EQ(playlist->library().path(playlist->current()), current);
+    EXPECT_EQ(playlist->current_index(), 7u);
+    
+    std::vector<std::string> after = play_order(*playlist);
+    std::set<std::string> played_before(before.begin(), before.begin() + 8);
+    std::set<std::string> played_after(after.begin(), after.begin() + 7);
+    played_before.erase(before[3]);
+    EXPECT_EQ(played_after, played_before);
+    std::set<std::string> upcoming_before(before.begin() + 9, before.end());
+    std::set<std::string> upcoming_after(after.begin() + 8, after.end());
+    upcoming_before.erase(before[15]);
+    EXPECT_EQ(upcoming_after, upcoming_before);
+    
+    // Removing the current song hands its slot to an upcoming one
+    ASSERT_TRUE(playlist->remove_song(current));
+    EXPECT_EQ(playlist->current_index(), 7u);
+    EXPECT_TRUE(upcoming_after.count(playlist->library().path(playlist->current())));
+    
+    // A renamed song keeps its place
+    std::string renamed = play_order(*playlist)[10];
+    ASSERT_TRUE(playlist->rename_song(renamed, library_song("lib/b/renamed.mp3")));
+    EXPECT_EQ(play_order(*playlist)[10], "lib/b/renamed.mp3");
+    EXPECT_FALSE(playlist->contains(renamed));
+}
+
+TEST_F(PlaylistTest, RevisionTracksSongsAndOrderOnly) {
+    playlist->add_song(song1);
+    playlist->add_song(song2);
+    playlist->add_song(song3);
+    EXPECT_FALSE(playlist->is_shuffled());
+    playlist->shuffle();
+    EXPECT_TRUE(playlist->is_shuffled());
+    uint64_t revision = playlist->revision();
+
+    // Moving through the order and the queue is not a change
+    playlist->record_play(playlist->current());
+    playlist->next();
+    playlist->previous();
+    playlist->enqueue(playlist->songs()[0]);
+    playlist->next();
+    playlist->clear_queue();
+    EXPECT_EQ(playlist->revision(), revision);
+
+    playlist->shuffle();
+    EXPECT_NE(playlist->revision(), revision);
+    revision = playlist->revision();
+    ASSERT_TRUE(playlist->move_song(song1.file_path, "/music/moved.mp3"));
+    EXPECT_NE(playlist->revision(), revision);
+    revision = playlist->revision();
+    ASSERT_TRUE(playlist->remove_song(song2.file_path));
+    EXPECT_NE(playlist->revision(), revision);
+    revision = playlist->revision();
+    playlist->add_song(song2);
+    EXPECT_NE(playlist->revision(), revision);
+}
+
+TEST_F(PlaylistTest, MovedSongsKeepTheirTags) {
+    playlist->add_song(nigamp::Song{"lib/a/old.mp3", "Title", "Artist", 123.0});
+    playlist->add_song(library_song("lib/a/other.mp3"));
+    nigamp::SongId id = playlist->library().find("lib/a/old.mp3");
+
+    ASSERT_TRUE(playlist->move_song("lib/a/old.mp3", "lib/b/new.mp3"));
+    EXPECT_EQ(playlist->library().find("lib/b/new.mp3"), id);
+    nigamp::SongView view = playlist->library().view(id);
+    EXPECT_EQ(view.title, "Title");
+    EXPECT_EQ(view.artist, "Artist");
+    EXPECT_DOUBLE_EQ(view.duration, 123.0);
+    EXPECT_FALSE(playlist->move_song("lib/a/old.mp3", "lib/c/x.mp3"));
+
+    // Directory renames keep them too
+    EXPECT_EQ(playlist->rename_directory("lib/b", "lib/c"), 1u);
+    EXPECT_EQ(playlist->library().view(playlist->library().find("lib/c/new.mp3")).title, "Title");
+}
+
+TEST_F(PlaylistTest, DirectoryUpdatesOnlyTouchThatSubtree) {
+    for (int i = 0; i < 5; ++i) {
+        playlist->add_song(library_song("lib/x/" + std::to_string(i) + ".mp3"));
+        playlist->add_song(library_song("lib/xy/" + std::to_string(i) + ".mp3"));
+    }
+    playlist->shuffle();
+    
+    EXPECT_EQ(playlist->rename_directory("lib/x", "lib/z"), 5u);
+    EXPECT_TRUE(playlist->contains("lib/z/3.mp3"));
+    EXPECT_FALSE(playlist->contains("lib/x/3.mp3"));
+    EXPECT_TRUE(playlist->contains("lib/xy/3.mp3"));
+    
+    EXPECT_EQ(playlist->remove_directory("lib/z"), 5u);
+    EXPECT_EQ(playlist->size(), 5u);
+    EXPECT_EQ(play_order(*playlist).size(), 5u);
+    
+    // Unshuffled playlists take the same updates
+    playlist->reset();
+    EXPECT_TRUE(playlist->remove_song("lib/xy/0.mp3"));
+    EXPECT_EQ(playlist->remove_directory("lib/xy/"), 4u);
+    EXPECT_TRUE(playlist->empty());
+}
+
+TEST_F(PlaylistTest, QueuedSongsPlayBeforeTheOrder) {
+    nigamp::SongList songs;
+    for (int i = 0; i < 10; ++i) {
+        songs.push_back(library_song("lib/q/" + std::to_string(i) + ".mp3"));
+    }
+    std::vector<nigamp::SongId> ids = playlist->add_songs(songs);
+    ASSERT_EQ(ids.size(), 10u);
+    EXPECT_EQ(path(ids[4]), "lib/q/4.mp3");
+    
+    playlist->shuffle();
+    std::vector<std::string> order = play_order(*playlist);
+    playlist->record_play(playlist->current());
+    nigamp::SongId first = playlist->library().find(order[5]);
+    nigamp::SongId second = playlist->library().find(order[7]);
+    playlist->enqueue(first);
+    playlist->enqueue(second);
+    EXPECT_TRUE(playlist->has_queued());
+    EXPECT_EQ(playlist->queue(), (std::vector<nigamp::SongId>{first, second}));
+    
+    // The current song, the queue, the rest of the order, then what was played
+    std::vector<nigamp::SongId> upcoming = playlist->play_order();
+    ASSERT_EQ(upcoming.size(), 12u);
+    EXPECT_EQ(path(upcoming[0]), order[0]);
+    EXPECT_EQ(upcoming[1], first);
+    EXPECT_EQ(upcoming[2], second);
+    EXPECT_EQ(path(upcoming[3]), order[1]);
+    EXPECT_EQ(path(upcoming[11]), order[9]);
+    
+    EXPECT_EQ(playlist->next(), first);
+    EXPECT_EQ(playlist->current(), first);
+    EXPECT_EQ(playlist->next(), second);
+    EXPECT_FALSE(playlist->has_queued());
+    EXPECT_EQ(path(playlist->next()), order[1]);
+    playlist->record_play(playlist->current());
+    
+    // Previous from a queued song goes back to the order
+    playlist->enqueue(first);
+    EXPECT_EQ(playlist->next(), first);
+    EXPECT_EQ(path(playlist->previous()), order[1]);
+    EXPECT_EQ(path(playlist->next()), order[2]);
+}
+
+TEST_F(PlaylistTest, QueueBeforeFirstSongKeepsItUnplayed) {
+    for (int i = 0; i < 5; ++i) {
+        playlist->add_song(library_song("lib/s/" + std::to_string(i) + ".mp3"));
+    }
+    playlist->shuffle();
+    std::vector<std::string> order = play_order(*playlist);
+    nigamp::SongId queued = playlist->library().find(order[3]);
+    playlist->enqueue(queued);
+    
+    EXPECT_EQ(playlist->next(), queued);
+    playlist->record_play(queued);
+    EXPECT_TRUE(playlist->has_next());
+    EXPECT_EQ(path(playlist->next()), order[0]);
+    playlist->record_play(playlist->current());
+    EXPECT_EQ(path(playlist->next()), order[1]);
+}
+
+TEST_F(PlaylistTest, RemovedSongsDropOutOfTheQueue) {
+    for (int i = 0; i < 6; ++i) {
+        playlist->add_song(library_song("lib/r/" + std::to_string(i) + ".mp3"));
+    }
+    playlist->shuffle();
+    std::vector<std::string> order = play_order(*playlist);
+    playlist->record_play(playlist->current());
+    for (int i : {3, 4, 5}) {
+        playlist->enqueue(playlist->library().find(order[i]));
+    }
+    
+    ASSERT_TRUE(playlist->remove_song(order[4]));
+    EXPECT_EQ(playlist->queue().size(), 2u);
+    EXPECT_EQ(path(playlist->next()), order[3]);
+    
+    // The next queued song takes the removed one's place
+    ASSERT_TRUE(playlist->remove_song(order[3]));
+    EXPECT_EQ(path(playlist->current()), order[5]);
+    
+    // And with the queue empty, the order's next song does
+    ASSERT_TRUE(playlist->remove_song(order[5]));
+    EXPECT_FALSE(playlist->has_queued());
+    EXPECT_EQ(path(playlist->current()), order[1]);
+    
+    // A re-added path is a different song to the queue
+    playlist->enqueue(playlist->library().find(order[1]));
+    ASSERT_TRUE(playlist->remove_song(order[1]));
+    playlist->add_song(library_song(order[1]));
+    EXPECT_FALSE(playlist->has_queued());
+}
+
+TEST_F(PlaylistTest, RestartingTheCurrentSongIsNotANewPlay) {
+    playlist->add_song(song1);
+    playlist->add_song(song2);
+    playlist->shuffle();
+    nigamp::SongId first = playlist->current();
+    playlist->record_play(first);
+    // A seek restarts playback of the same song
+    playlist->record_play(first);
+    playlist->record_play(first);
+    EXPECT_EQ(playlist->library().play_count(first), 1u);
+    
+    nigamp::SongId second = playlist->next();
+    playlist->record_play(second);
+    playlist->record_play(second);
+    EXPECT_EQ(playlist->library().play_count(second), 1u);
+    
+    // Coming back to a song is a new play
+    EXPECT_EQ(playlist->previous(), first);
+    playlist->record_play(first);
+    EXPECT_EQ(playlist->library().play_count(first), 2u);
+    
+    // A resumed session does not count its song again
+    std::vector<size_t> order = playlist->shuffle_order();
+    ASSERT_TRUE(playlist->restore_order(order, 1));
+    nigamp::SongId resumed = playlist->current();
+    uint32_t before = playlist->library().play_count(resumed);
+    playlist->record_play(resumed);
+    EXPECT_EQ(playlist->library().play_count(resumed), before);
+}
+
+TEST_F(PlaylistTest, SmallLibraryNeverStartsAPassWithTheLastSong) {
+    playlist->add_song(song1);
+    playlist->add_song(song2);
+    playlist->add_song(song3);
+    playlist->shuffle();
+    nigamp::SongId last = nigamp::INVALID_SONG_ID;
+    for (int pass = 0; pass < 50; ++pass) {
+        nigamp::SongId first = playlist->current();
+        EXPECT_NE(first, last) << "pass " << pass;
+        playlist->record_play(first);
+        while (playlist->has_next()) {
+            playlist->record_play(playlist->next());
+        }
+        last = playlist->current();
+        playlist->shuffle();
+        // Most recent last
+        std::vector<size_t> order = playlist->shuffle_order();
+        EXPECT_EQ(playlist->songs()[order.back()], last);
+    }
+}
+
+TEST_F(PlaylistTest, RecentSongsComeBackOldestFirst) {
+    for (int i = 0; i < 10; ++i) {
+        playlist->add_song(library_song("lib/o/" + std::to_string(i) + ".mp3"));
+    }
+    playlist->set_no_repeat_window(4);
+    playlist->shuffle();
+    std::vector<nigamp::SongId> played;
+    for (int i = 0; i < 6; ++i) {
+        nigamp::SongId id = i == 0 ? playlist->current() : playlist->next();
+        playlist->record_play(id);
+        played.push_back(id);
+    }
+    playlist->shuffle();
+    std::vector<size_t> order = playlist->shuffle_order();
+    for (size_t i = 0; i < 4; ++i) {
+        EXPECT_EQ(playlist->songs()[order[6 + i]], played[2 + i]);
+    }
+}
@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+#include "../src/playlist_file.cpp"
+#include <filesystem>
+#include <fstream>
+
+using namespace nigamp;
+
+class PlaylistFileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        directory = std::filesystem::temp_directory_path() / "nigamp_playlist_file_test";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory / "sub");
+        base = directory.string() + "/";
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory);
+    }
+
+    std::string write_file(const std::string& name, const std::string& contents) {
+        std::string path = (directory / name).string();
+        std::ofstream file(path, std::ios::binary);
+        file << contents;
+        return path;
+    }
+
+    std::vector<PlaylistEntry> read_all(const std::string& path, size_t batch_size = PLAYLIST_BATCH) {
+        std::vector<PlaylistEntry> entries;
+        EXPECT_TRUE(read_playlist(path, [&](std::vector<PlaylistEntry>& batch) {
+            EXPECT_LE(batch.size(), batch_size);
+            entries.insert(entries.end(), batch.begin(), batch.end());
+            return true;
+        }, batch_size));
+        return entries;
+    }
+
+    std::filesystem::path directory;
+    std::string base;
+};
+
+TEST_F(PlaylistFileTest, FormatFollowsExtension) {
+    EXPECT_EQ(playlist_format("a.m3u"), PlaylistFormat::M3U);
+    EXPECT_EQ(playlist_format("/x/a.M3U8"), PlaylistFormat::M3U);
+    EXPECT_EQ(playlist_format("a.pls"), PlaylistFormat::PLS);
+    EXPECT_EQ(playlist_format("a.mp3"), PlaylistFormat::UNKNOWN);
+    EXPECT_FALSE(read_playlist(write_file("list.txt", "a.mp3\n"), [](std::vector<PlaylistEntry>&) { return true; }));
+    EXPECT_FALSE(read_playlist(base + "missing.m3u", [](std::vector<PlaylistEntry>&) { return true; }));
+}
+
+TEST_F(PlaylistFileTest, ReadsExtendedM3u) {
+    std::string path = write_file("list.m3u8",
+        "\xEF\xBB\xBF#EXTM3U\r\n"
+        "#EXTINF:123,Artist - Title\r\n"
+        "sub/a.mp3\r\n"
+        "\r\n"
+        "# a comment\n"
+        "#EXTINF:-1 tvg-name=\"x,y\",Stream\n"
+        "http://radio.example/stream\n"
+        "/music/b.mp3\n"
+        "file:///music/c%20d.mp3\n"
+        "./sub/../e.wav\n"
+        "sub\\f.mp3");  // No final newline
+
+    std::vector<PlaylistEntry> entries = read_all(path);
+    ASSERT_EQ(entries.size(), 5u);
+    EXPECT_EQ(entries[0].path, base + "sub/a.mp3");
+    EXPECT_EQ(entries[0].title, "Artist - Title");
+    EXPECT_DOUBLE_EQ(entries[0].duration, 123.0);
+    // The stream's #EXTINF went with it
+    EXPECT_EQ(entries[1].path, "/music/b.mp3");
+    EXPECT_EQ(entries[1].title, "");
+    EXPECT_DOUBLE_EQ(entries[1].duration, 0.0);
+    EXPECT_EQ(entries[2].path, "/music/c d.mp3");
+    EXPECT_EQ(entries[3].path, base + "e.wav");
+#ifndef _WIN32
+    EXPECT_EQ(entries[4].path, base + "sub/f.mp3");
+#endif
+}
+
+TEST_F(PlaylistFileTest, ReadsPls) {
+    std::string path = write_file("list.pls",
+        "[playlist]\n"
+        "File1=sub/a.mp3\n"
+        "Title1=First\n"
+        "Length1=61\n"
+        "file2 = /music/b.mp3\n"
+        "Length2=-1\n"
+        "File3=http://radio.example/stream\n"
+        "Title3=Radio\n"
+        "NumberOfEntries=3\n"
+        "Version=2\n");
+
+    std::vector<PlaylistEntry> entries = read_all(path);
+    ASSERT_EQ(entries.size(), 2u);
+    EXPECT_EQ(entries[0].path, base + "sub/a.mp3");
+    EXPECT_EQ(entries[0].title, "First");
+    EXPECT_DOUBLE_EQ(entries[0].duration, 61.0);
+    EXPECT_EQ(entries[1].path, "/music/b.mp3");
+    EXPECT_EQ(entries[1].title, "");
+    EXPECT_DOUBLE_EQ(entries[1].duration, 0.0);
+}
+
+TEST_F(PlaylistFileTest, StreamsLargeFilesInBatches) {
+    constexpr size_t COUNT = 100000;
+    std::string contents = "#EXTM3U\n";
+    for (size_t i = 0; i < COUNT; ++i) {
+        contents += "#EXTINF:" + std::to_string(i % 600) + ",Track " + std::to_string(i) + "\n";
+        contents += "/music/artist" + std::to_string(i % 97) + "/track" + std::to_string(i) + ".mp3\n";
+    }
+    std::string path = write_file("large.m3u", contents);
+
+    size_t batches = 0;
+    size_t seen = 0;
+    bool in_order = true;
+    ASSERT_TRUE(read_playlist(path, [&](std::vector<PlaylistEntry>& batch) {
+        ++batches;
+        for (const auto& entry : batch) {
+            in_order = in_order && entry.title == "Track " + std::to_string(seen);
+            ++seen;
+        }
+        return true;
+    }, 1000));
+    EXPECT_EQ(seen, COUNT);
+    EXPECT_EQ(batches, COUNT / 1000);
+    EXPECT_TRUE(in_order);
+
+    // Returning false stops the read after that batch
+    batches = 0;
+    ASSERT_TRUE(read_playlist(path, [&](std::vector<PlaylistEntry>&) { return ++batches < 3; }, 1000));
+    EXPECT_EQ(batches, 3u);
+}
+
+TEST_F(PlaylistFileTest, WrittenPlaylistsReadBack) {
+    std::vector<PlaylistEntry> entries = {
+        {base + "sub/a.mp3", "First", 61.4},
+        {"/elsewhere/b.wav", "Two\nlines", 0.0},
+        {base + "c.mp3", "", 200.0},
+    };
+    for (const char* name : {"out.m3u8", "out.pls"}) {
+        std::string path = base + name;
+        PlaylistWriter writer;
+        ASSERT_TRUE(writer.open(path)) << name;
+        for (const auto& entry : entries) {
+            writer.write(entry);
+        }
+        // Nothing replaces the target until close()
+        EXPECT_FALSE(std::filesystem::exists(path));
+        ASSERT_TRUE(writer.close());
+        EXPECT_EQ(writer.count(), 3u);
+
+        std::vector<PlaylistEntry> read = read_all(path);
+        ASSERT_EQ(read.size(), 3u) << name;
+        EXPECT_EQ(read[0].path, entries[0].path);
+        EXPECT_EQ(read[0].title, "First");
+        EXPECT_DOUBLE_EQ(read[0].duration, 61.0);
+        EXPECT_EQ(read[1].path, "/elsewhere/b.wav");
+        EXPECT_EQ(read[1].title, "Two lines");
+        EXPECT_EQ(read[2].path, entries[2].path);
+        EXPECT_DOUBLE_EQ(read[2].duration, 200.0);
+    }
+
+    // Songs below the playlist's directory are written relative to it
+    std::ifstream file(base + "out.m3u8");
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_NE(contents.find("\nsub/a.mp3\n"), std::string::npos);
+
+    PlaylistWriter unknown;
+    EXPECT_FALSE(unknown.open(base + "out.txt"));
+}
+
+TEST_F(PlaylistFileTest, ResolvesThroughLibraryThenIndexThenDisk) {
+    LibraryStore library;
+    library.add(Song{"/music/known.mp3", "Known", "Artist", 10.0});
+
+    std::string index_path = base + "library.idx";
+    ASSERT_TRUE(save_library_index(index_path, "/music", {{{"/music/indexed.mp3", "Tagged", "Band", 99.0}, {}}}));
+    LibraryIndex index;
+    ASSERT_TRUE(index.open(index_path));
+
+    std::string on_disk = write_file("sub/disk.mp3", "");
+    std::vector<PlaylistEntry> entries = {
+        {"/music/known.mp3", "Ignored", 0.0},
+        {base + "sub/missing.mp3", "Missing", 0.0},
+        {"/music/indexed.mp3", "Ignored", 0.0},
+        {on_disk, "From playlist", 42.0},
+    };
+    SongList songs;
+    resolve_playlist_entries(entries, library, &index, songs);
+
+    ASSERT_EQ(entries.size(), 3u);
+    EXPECT_EQ(entries[0].path, "/music/known.mp3");
+    EXPECT_EQ(entries[1].path, "/music/indexed.mp3");
+    EXPECT_EQ(entries[2].path, on_disk);
+    ASSERT_EQ(songs.size(), 2u);
+    EXPECT_EQ(songs[0].title, "Tagged");
+    EXPECT_EQ(songs[0].artist, "Band");
+    EXPECT_EQ(songs[1].file_path, on_disk);
+    EXPECT_EQ(songs[1].title, "From playlist");
+    EXPECT_DOUBLE_EQ(songs[1].duration, 42.0);
+}
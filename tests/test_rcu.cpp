@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include "rcu.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace nigamp;
+
+namespace {
+
+std::atomic<int> g_live_versions{0};
+
+// Every element equals the version, so a torn or freed read shows up as a mismatch
+struct Version {
+    uint64_t number;
+    std::vector<uint64_t> payload;
+
+    explicit Version(uint64_t value) : number(value), payload(64, value) {
+        ++g_live_versions;
+    }
+    ~Version() {
+        for (auto& element : payload) {
+            element = ~0ull;
+        }
+        --g_live_versions;
+    }
+};
+
+}
+
+TEST(RcuCellTest, ReadersSeeLatestPublish) {
+    RcuCell<int> cell;
+    auto reader = cell.reader();
+    ASSERT_TRUE(reader);
+    EXPECT_FALSE(reader.read());
+
+    cell.publish(1);
+    EXPECT_EQ(*reader.read(), 1);
+    cell.publish(std::make_unique<const int>(2));
+    EXPECT_EQ(*reader.read(), 2);
+}
+
+TEST(RcuCellTest, OldVersionLivesUntilItsReadEnds) {
+    {
+        RcuCell<Version> cell(std::make_unique<const Version>(1));
+        auto reader = cell.reader();
+        {
+            auto guard = reader.read();
+            cell.publish(std::make_unique<const Version>(2));
+            cell.publish(std::make_unique<const Version>(3));
+            // Version 2 was never visible to the open read, but it started before
+            // version 2 was retired, so both wait
+            EXPECT_EQ(cell.retired(), 2u);
+            EXPECT_EQ(guard->number, 1u);
+            EXPECT_EQ(guard->payload.back(), 1u);
+        }
+        cell.reclaim();
+        EXPECT_EQ(cell.retired(), 0u);
+        EXPECT_EQ(reader.read()->number, 3u);
+        EXPECT_EQ(g_live_versions.load(), 1);
+    }
+    EXPECT_EQ(g_live_versions.load(), 0);
+}
+
+TEST(RcuCellTest, ReaderSlotsAreLimitedAndReturned) {
+    RcuCell<int> cell;
+    std::vector<RcuCell<int>::Reader> readers;
+    for (size_t i = 0; i < RcuCell<int>::MAX_READERS; ++i) {
+        readers.push_back(cell.reader());
+        ASSERT_TRUE(readers.back());
+    }
+    EXPECT_FALSE(cell.reader());
+    readers.pop_back();
+    EXPECT_TRUE(cell.reader());
+}
+
+TEST(RcuCellTest, ConcurrentReadersNeverSeeFreedOrTornVersions) {
+    constexpr int READERS = 8;
+    constexpr uint64_t PUBLISHES = 20000;
+    constexpr uint64_t READS_DURING_PUBLISHING = 100;  // Per reader, at the least
+    {
+        RcuCell<Version> cell(std::make_unique<const Version>(0));
+        std::atomic<bool> done{false};
+        std::atomic<int> failures{0};
+        std::atomic<int> started{0};
+        std::vector<std::atomic<uint64_t>> reads(READERS);
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < READERS; ++i) {
+            threads.emplace_back([&, i]() {
+                auto reader = cell.reader();
+                uint64_t last = 0;
+                bool counted_in = false;
+                while (!done.load(std::memory_order_acquire)) {
+                    auto guard = reader.read();
+                    uint64_t number = guard->number;
+                    for (uint64_t element : guard->payload) {
+                        if (element != number) {
+                            ++failures;
+                            break;
+                        }
+                    }
+                    // Versions only move forward for any one reader
+                    if (number < last) {
+                        ++failures;
+                    }
+                    last = number;
+                    if (counted_in) {
+                        reads[i].fetch_add(1, std::memory_order_relaxed);
+                    } else {
+                        counted_in = true;
+                        started.fetch_add(1, std::memory_order_release);
+                    }
+                }
+            });
+        }
+
+        // Publishing starts only once every reader is in its loop, and goes on
+        // until each has read while versions were changing under it
+        while (started.load(std::memory_order_acquire) < READERS) {
+            std::this_thread::yield();
+        }
+        auto all_read_enough = [&]() {
+            for (const auto& count : reads) {
+                if (count.load(std::memory_order_relaxed) < READS_DURING_PUBLISHING) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        uint64_t version = 0;
+        while (version < PUBLISHES || !all_read_enough()) {
+            cell.publish(std::make_unique<const Version>(++version));
+            if (version >= PUBLISHES) {
+                std::this_thread::yield();
+            }
+        }
+        done = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        EXPECT_EQ(failures.load(), 0);
+        cell.reclaim();
+        EXPECT_EQ(cell.retired(), 0u);
+        EXPECT_EQ(g_live_versions.load(), 1);
+    }
+    EXPECT_EQ(g_live_versions.load(), 0);
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include "../src/render.cpp"
+#include "test_data.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+using namespace nigamp;
+
+class RenderTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        output = (std::filesystem::temp_directory_path() / "nigamp_render_test.wav").string();
+        for (int i = 1; i <= 5; ++i) {
+            std::string path = test_data_path("test" + std::to_string(i) + ".mp3");
+            ASSERT_TRUE(std::filesystem::exists(path)) << path;
+            tracks.push_back(path);
+        }
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(output);
+    }
+
+    std::string read_output() {
+        std::ifstream file(output, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+    std::string output;
+    std::vector<std::string> tracks;
+};
+
+TEST_F(RenderTest, PreviewReelHasOneTrimmedClipPerTrack) {
+    std::vector<std::string> playlist = {tracks[0], test_data_path("missing.mp3"), tracks[1], tracks[2]};
+    RenderOptions options;
+    options.preview_seconds = 1.0;
+    options.volume = 0.5f;
+    options.threads = 3;
+
+    RenderStats stats;
+    ASSERT_TRUE(render_playlist(playlist, output, options, stats));
+    EXPECT_EQ(stats.tracks_rendered, 3u);
+    EXPECT_EQ(stats.tracks_failed, 1u);
+    EXPECT_NEAR(stats.audio_seconds, 3.0, 0.05);
+    EXPECT_GT(stats.realtime_factor(), 1.0);
+
+    WavDecoder reader;
+    ASSERT_TRUE(reader.open(output));
+    EXPECT_EQ(reader.get_format().sample_rate, 44100);
+    EXPECT_EQ(reader.get_format().channels, 2);
+    EXPECT_EQ(reader.get_total_frames(), stats.frames_written);
+}
+
+TEST_F(RenderTest, OutputDoesNotDependOnWorkerCount) {
+    RenderOptions options;
+    options.preview_seconds = 2.0;
+    RenderStats stats;
+
+    options.threads = 1;
+    ASSERT_TRUE(render_playlist(tracks, output, options, stats));
+    std::string serial = read_output();
+
+    options.threads = 4;
+    ASSERT_TRUE(render_playlist(tracks, output, options, stats));
+    EXPECT_EQ(stats.tracks_rendered, tracks.size());
+    EXPECT_TRUE(read_output() == serial);
+}
+
+TEST_F(RenderTest, SmartPreviewKeepsClipLength) {
+    RenderOptions options;
+    options.preview_seconds = 1.0;
+    options.smart_preview = true;
+    RenderStats stats;
+    ASSERT_TRUE(render_playlist(tracks, output, options, stats));
+    EXPECT_EQ(stats.tracks_rendered, tracks.size());
+    EXPECT_NEAR(stats.audio_seconds, static_cast<double>(tracks.size()), 0.05);
+}
+
+TEST_F(RenderTest, SmartPreviewStoresEnvelopesThroughTheAnalyzer) {
+    std::string store_path = (std::filesystem::temp_directory_path() / "nigamp_render_loudness.bin").string();
+    std::filesystem::remove(store_path);
+    RenderOptions options;
+    options.preview_seconds = 1.0;
+    options.smart_preview = true;
+    options.threads = 3;
+    RenderStats stats;
+    ASSERT_TRUE(render_playlist(tracks, output, options, stats));
+    std::string uncached = read_output();
+
+    LoudnessAnalyzer analyzer(1, LoudnessAnalyzer::DEFAULT_CACHE_LIMIT, store_path);
+    options.loudness = &analyzer;
+    ASSERT_TRUE(render_playlist(tracks, output, options, stats));
+    EXPECT_EQ(stats.tracks_rendered, tracks.size());
+    EXPECT_TRUE(read_output() == uncached);
+    for (const auto& track : tracks) {
+        LoudnessEnvelope envelope;
+        EXPECT_TRUE(analyzer.lookup(track, envelope)) << track;
+    }
+    EXPECT_GT(std::filesystem::file_size(store_path), 0u);
+    std::filesystem::remove(store_path);
+}
+
+TEST_F(RenderTest, UnwritableOutputFails) {
+    RenderStats stats;
+    EXPECT_FALSE(render_playlist(tracks, "/nonexistent_dir/out.wav", RenderOptions(), stats));
+}
+
+TEST_F(RenderTest, WholeTracksMatchAcrossWorkerCounts) {
+    RenderOptions options;
+    RenderStats stats;
+
+    options.threads = 1;
+    ASSERT_TRUE(render_playlist(tracks, output, options, stats));
+    std::string serial = read_output();
+    uint64_t frames = stats.frames_written;
+
+    options.threads = 4;
+    ASSERT_TRUE(render_playlist(tracks, output, options, stats));
+    EXPECT_EQ(stats.tracks_rendered, tracks.size());
+    EXPECT_EQ(stats.frames_written, frames);
+    EXPECT_TRUE(read_output() == serial);
+}
+
+#ifdef __linux__
+TEST_F(RenderTest, FailedWriteCountsNoTrackAsRendered) {
+    RenderStats stats;
+    EXPECT_FALSE(render_playlist(tracks, "/dev/full", RenderOptions(), stats));
+    EXPECT_EQ(stats.tracks_rendered, 0u);
+}
+#endif
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "../src/resampler.cpp"
+#include <cmath>
+
+class ResamplerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        nigamp::clear_resampler_cache();
+    }
+
+    // Interleaved stereo sine at the given frequency
+    nigamp::AudioBuffer make_sine(int sample_rate, double frequency, size_t frames) {
+        nigamp::AudioBuffer buffer(frames * 2);
+        for (size_t i = 0; i < frames; ++i) {
+            auto value = static_cast<int16_t>(10000.0 * std::sin(2.0 * 3.14159265358979 * frequency * i / sample_rate));
+            buffer[i * 2] = value;
+            buffer[i * 2 + 1] = value;
+        }
+        return buffer;
+    }
+
+    // Count rising zero crossings on the left channel, skipping the filter warm-up
+    int count_crossings(const nigamp::AudioBuffer& buffer, size_t skip_frames) {
+        int crossings = 0;
+        for (size_t i = skip_frames + 1; i < buffer.size() / 2; ++i) {
+            if (buffer[(i - 1) * 2] < 0 && buffer[i * 2] >= 0) {
+                ++crossings;
+            }
+        }
+        return crossings;
+    }
+};
+
+TEST_F(ResamplerTest, PassthroughWhenRatesMatch) {
+    auto resampler = nigamp::create_resampler();
+    ASSERT_TRUE(resampler->configure(44100, 44100, 2));
+    EXPECT_TRUE(resampler->is_passthrough());
+
+    auto input = make_sine(44100, 440.0, 1024);
+    nigamp::AudioBuffer output;
+    resampler->process(input, output);
+    EXPECT_EQ(output, input);
+    EXPECT_EQ(nigamp::get_resampler_cache_size(), 0);
+}
+
+TEST_F(ResamplerTest, RejectsInvalidConfiguration) {
+    auto resampler = nigamp::create_resampler();
+    EXPECT_FALSE(resampler->configure(0, 48000, 2));
+    EXPECT_FALSE(resampler->configure(44100, 48000, 0));
+}
+
+TEST_F(ResamplerTest, OutputLengthMatchesRateRatio) {
+    auto resampler = nigamp::create_resampler(nigamp::ResamplerQuality::HIGH);
+    ASSERT_TRUE(resampler->configure(44100, 48000, 2));
+    EXPECT_FALSE(resampler->is_passthrough());
+
+    size_t total_frames = 0;
+    nigamp::AudioBuffer output;
+    for (int block = 0; block < 10; ++block) {
+        resampler->process(make_sine(44100, 440.0, 4410), output);
+        total_frames += output.size() / 2;
+    }
+
+    // 1 second in -> 1 second out, minus at most the filter delay
+    EXPECT_NEAR(static_cast<double>(total_frames), 48000.0, 32.0);
+}
+
+TEST_F(ResamplerTest, PreservesFrequency) {
+    for (auto quality : {nigamp::ResamplerQuality::FAST, nigamp::ResamplerQuality::MEDIUM, nigamp::ResamplerQuality::HIGH}) {
+        auto resampler = nigamp::create_resampler(quality);
+        ASSERT_TRUE(resampler->configure(44100, 48000, 2));
+
+        nigamp::AudioBuffer output;
+        resampler->process(make_sine(44100, 1000.0, 44100), output);
+
+        // A 1 kHz tone keeps ~1000 cycles per second at the new rate
+        int crossings = count_crossings(output, 64);
+        EXPECT_NEAR(crossings, 1000, 2);
+    }
+}
+
+TEST_F(ResamplerTest, DownsamplingAttenuatesAboveNyquist) {
+    auto resampler = nigamp::create_resampler(nigamp::ResamplerQuality::HIGH);
+    ASSERT_TRUE(resampler->configure(48000, 22050, 2));
+
+    // 15 kHz is above the 11025 Hz output Nyquist and must be filtered out
+    nigamp::AudioBuffer output;
+    resampler->process(make_sine(48000, 15000.0, 48000), output);
+
+    int peak = 0;
+    for (size_t i = 256; i < output.size(); ++i) {
+        peak = std::max(peak, std::abs(static_cast<int>(output[i])));
+    }
+    EXPECT_LT(peak, 500);
+}
+
+TEST_F(ResamplerTest, FilterTablesAreCachedPerRatePair) {
+    auto first = nigamp::create_resampler();
+    auto second = nigamp::create_resampler();
+    ASSERT_TRUE(first->configure(44100, 48000, 2));
+    ASSERT_TRUE(second->configure(44100, 48000, 1));
+    EXPECT_EQ(nigamp::get_resampler_cache_size(), 1);
+
+    ASSERT_TRUE(second->configure(22050, 48000, 2));
+    EXPECT_EQ(nigamp::get_resampler_cache_size(), 2);
+}
+
+TEST_F(ResamplerTest, ParseQualityNames) {
+    nigamp::ResamplerQuality quality = nigamp::ResamplerQuality::MEDIUM;
+    EXPECT_TRUE(nigamp::parse_resampler_quality("fast", quality));
+    EXPECT_EQ(quality, nigamp::ResamplerQuality::FAST);
+    EXPECT_TRUE(nigamp::parse_resampler_quality("high", quality));
+    EXPECT_EQ(quality, nigamp::ResamplerQuality::HIGH);
+    EXPECT_FALSE(nigamp::parse_resampler_quality("ultra", quality));
+}
+
+TEST_F(ResamplerTest, FlushDrainsTheFilterDelay) {
+    auto resampler = nigamp::create_resampler(nigamp::ResamplerQuality::HIGH);
+    ASSERT_TRUE(resampler->configure(44100, 48000, 2));
+
+    // A tone that ends exactly at the last input frame
+    nigamp::AudioBuffer input = make_sine(44100, 1000.0, 4410);
+    nigamp::AudioBuffer output;
+    resampler->process(input, output);
+    nigamp::AudioBuffer tail;
+    resampler->flush(tail);
+
+    // Without the tail about half the filter length of the tone is lost
+    size_t frames = (output.size() + tail.size()) / 2;
+    EXPECT_GE(frames, 4800u);
+    EXPECT_GT(tail.size(), 0u);
+    int peak = 0;
+    for (int16_t sample : tail) {
+        peak = std::max(peak, std::abs(static_cast<int>(sample)));
+    }
+    EXPECT_GT(peak, 5000);
+
+    // Flushing starts over, so the same input gives the same output again
+    nigamp::AudioBuffer again;
+    resampler->process(input, again);
+    EXPECT_EQ(again, output);
+
+    nigamp::AudioBuffer empty;
+    ASSERT_TRUE(resampler->configure(48000, 48000, 2));
+    resampler->flush(empty);
+    EXPECT_TRUE(empty.empty());
+}
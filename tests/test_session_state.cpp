@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include "../src/session_state.cpp"
+#include "temp_file_test.hpp"
+
+using namespace nigamp;
+
+class SessionStateTest : public TempFileTest {
+protected:
+    SessionStateTest() : TempFileTest("nigamp_session_test.bin") {}
+
+    void SetUp() override {
+        TempFileTest::SetUp();
+        state.directory = "/music";
+        state.paths = {"/music/a.mp3", "/music/b.wav", "/music/sub/c.mp3"};
+        state.order = {2, 0, 1};
+        state.current_index = 1;
+        state.sample_position = 1234567;
+        state.sample_rate = 44100;
+        state.volume = 0.65f;
+    }
+
+    SessionState state;
+};
+
+TEST_F(SessionStateTest, RoundTrip) {
+    ASSERT_TRUE(save_session(path, state));
+    EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+
+    SessionState loaded;
+    ASSERT_TRUE(load_session(path, loaded));
+    EXPECT_EQ(loaded.directory, state.directory);
+    EXPECT_EQ(loaded.paths, state.paths);
+    EXPECT_EQ(loaded.order, state.order);
+    EXPECT_EQ(loaded.current_index, 1u);
+    EXPECT_EQ(loaded.sample_position, 1234567u);
+    EXPECT_EQ(loaded.sample_rate, 44100u);
+    EXPECT_FLOAT_EQ(loaded.volume, 0.65f);
+}
+
+TEST_F(SessionStateTest, MissingOrTruncatedFileIsRejected) {
+    SessionState loaded;
+    EXPECT_FALSE(load_session(path, loaded));
+
+    ASSERT_TRUE(save_session(path, state));
+    std::string contents = read_file();
+    for (size_t length : {size_t{0}, size_t{10}, contents.size() - 1}) {
+        write_file(contents.substr(0, length));
+        EXPECT_FALSE(load_session(path, loaded)) << "length " << length;
+    }
+    EXPECT_TRUE(loaded.paths.empty());
+}
+
+TEST_F(SessionStateTest, OrderMustBeAPermutation) {
+    state.order = {0, 0, 1};
+    EXPECT_TRUE(save_session(path, state));
+
+    SessionState loaded;
+    EXPECT_FALSE(load_session(path, loaded));
+
+    state.order = {0, 1};
+    EXPECT_FALSE(save_session(path, state));
+}
+
+TEST_F(SessionStateTest, PositionIsUpdatedInPlace) {
+    ASSERT_TRUE(save_session(path, state));
+    size_t size = read_file().size();
+
+    SessionPosition position;
+    position.current_index = 2;
+    position.sample_position = 9876543210ull;
+    position.sample_rate = 48000;
+    position.volume = 0.25f;
+    ASSERT_TRUE(update_session_position(path, state.paths.size(), position));
+    EXPECT_EQ(read_file().size(), size);
+
+    SessionState loaded;
+    ASSERT_TRUE(load_session(path, loaded));
+    EXPECT_EQ(loaded.paths, state.paths);
+    EXPECT_EQ(loaded.order, state.order);
+    EXPECT_EQ(loaded.current_index, 2u);
+    EXPECT_EQ(loaded.sample_position, 9876543210ull);
+    EXPECT_EQ(loaded.sample_rate, 48000u);
+    EXPECT_FLOAT_EQ(loaded.volume, 0.25f);
+}
+
+TEST_F(SessionStateTest, PositionUpdateNeedsTheSameLibrary) {
+    SessionPosition position;
+    EXPECT_FALSE(update_session_position(path, state.paths.size(), position));  // No file yet
+
+    ASSERT_TRUE(save_session(path, state));
+    std::string before = read_file();
+    EXPECT_FALSE(update_session_position(path, state.paths.size() + 1, position));
+    position.current_index = 3;
+    EXPECT_FALSE(update_session_position(path, state.paths.size(), position));
+    EXPECT_EQ(read_file(), before);
+}
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include "../src/shuffle_strategy.cpp"
+#include <set>
+
+using namespace nigamp;
+
+namespace {
+
+// count songs spread over the given number of artists, in artist-major add order
+std::vector<SongId> add_songs(LibraryStore& library, size_t count, size_t artists) {
+    std::vector<SongId> songs;
+    for (size_t i = 0; i < count; ++i) {
+        size_t artist = i * artists / count;
+        songs.push_back(library.add(Song{"/music/" + std::to_string(artist) + "/" + std::to_string(i) + ".mp3",
+                                         "Song " + std::to_string(i), "Artist " + std::to_string(artist), 0.0}));
+    }
+    return songs;
+}
+
+bool is_permutation_of(const std::vector<uint32_t>& order, size_t count) {
+    std::vector<bool> seen(count, false);
+    for (uint32_t index : order) {
+        if (index >= count || seen[index]) {
+            return false;
+        }
+        seen[index] = true;
+    }
+    return order.size() == count;
+}
+
+}
+
+TEST(ShuffleStrategyTest, EveryStrategyBuildsAPermutation) {
+    LibraryStore library;
+    std::vector<SongId> songs = add_songs(library, 1000, 37);
+    std::mt19937 random(7);
+    for (const char* name : {"uniform", "weighted", "artist"}) {
+        auto strategy = create_shuffle_strategy(name);
+        ASSERT_TRUE(strategy) << name;
+        EXPECT_STREQ(strategy->name(), name);
+        std::vector<uint32_t> order;
+        strategy->build_order(library, songs, random, order);
+        EXPECT_TRUE(is_permutation_of(order, songs.size())) << name;
+
+        std::vector<SongId> none;
+        strategy->build_order(library, none, random, order);
+        EXPECT_TRUE(order.empty()) << name;
+    }
+    EXPECT_FALSE(create_shuffle_strategy("sorted"));
+}
+
+TEST(ShuffleStrategyTest, AliasTableFollowsWeights) {
+    AliasTable table;
+    table.build({1.0, 2.0, 0.5, 4.5});
+    std::mt19937 random(3);
+    std::vector<int> counts(4, 0);
+    constexpr int DRAWS = 80000;
+    for (int i = 0; i < DRAWS; ++i) {
+        ++counts[table.sample(random)];
+    }
+    EXPECT_NEAR(counts[0], DRAWS * 1.0 / 8, 600);
+    EXPECT_NEAR(counts[1], DRAWS * 2.0 / 8, 600);
+    EXPECT_NEAR(counts[2], DRAWS * 0.5 / 8, 600);
+    EXPECT_NEAR(counts[3], DRAWS * 4.5 / 8, 600);
+}
+
+TEST(ShuffleStrategyTest, WeightedPutsUnplayedSongsFirst) {
+    LibraryStore library;
+    std::vector<SongId> songs = add_songs(library, 400, 20);
+    // The first half has been played often
+    for (size_t i = 0; i < 200; ++i) {
+        for (int play = 0; play < 15; ++play) {
+            library.add_play(songs[i]);
+        }
+    }
+    std::mt19937 random(11);
+    std::vector<uint32_t> order;
+    create_weighted_shuffle()->build_order(library, songs, random, order);
+    ASSERT_TRUE(is_permutation_of(order, songs.size()));
+
+    // Each unplayed song is 16 times as likely at every draw
+    size_t unplayed_in_first_hundred = 0;
+    for (size_t i = 0; i < 100; ++i) {
+        unplayed_in_first_hundred += order[i] >= 200 ? 1 : 0;
+    }
+    EXPECT_GT(unplayed_in_first_hundred, 85u);
+}
+
+TEST(ShuffleStrategyTest, ArtistSpreadRarelyRepeatsAnArtist) {
+    LibraryStore library;
+    std::vector<SongId> songs = add_songs(library, 100, 4);
+    std::mt19937 random(5);
+    size_t spread_repeats = 0;
+    size_t uniform_repeats = 0;
+    for (int trial = 0; trial < 20; ++trial) {
+        std::vector<uint32_t> spread;
+        std::vector<uint32_t> uniform;
+        create_artist_spread_shuffle()->build_order(library, songs, random, spread);
+        create_uniform_shuffle()->build_order(library, songs, random, uniform);
+        for (size_t i = 1; i < songs.size(); ++i) {
+            spread_repeats += library.artist_key(songs[spread[i]]) == library.artist_key(songs[spread[i - 1]]);
+            uniform_repeats += library.artist_key(songs[uniform[i]]) == library.artist_key(songs[uniform[i - 1]]);
+        }
+    }
+    // A uniform order repeats an artist about 24 times in 99 steps
+    EXPECT_GT(uniform_repeats, 20u * 15);
+    EXPECT_LT(spread_repeats, 20u * 3);
+}
+
+TEST(RecentWindowTest, KeepsTheLastSongsPlayed) {
+    RecentWindow window(3);
+    for (SongId id : {5u, 200u, 7u}) {
+        window.push(id);
+    }
+    EXPECT_TRUE(window.contains(5));
+    EXPECT_TRUE(window.contains(200));
+    EXPECT_FALSE(window.contains(6));
+    EXPECT_FALSE(window.contains(100000));
+
+    // Played again: moves to the newest end instead of being evicted next
+    window.push(5);
+    window.push(8);
+    EXPECT_TRUE(window.contains(5));
+    EXPECT_FALSE(window.contains(200));
+    EXPECT_TRUE(window.contains(8));
+    EXPECT_EQ(std::vector<SongId>(window.songs().begin(), window.songs().end()), (std::vector<SongId>{7, 5, 8}));
+
+    window.forget(7);
+    EXPECT_FALSE(window.contains(7));
+    window.clear();
+    EXPECT_FALSE(window.contains(5));
+
+    window.resize(0);
+    window.push(9);
+    EXPECT_FALSE(window.contains(9));
+}
+
+TEST(RecentWindowTest, ForgottenIdsLeaveTheWindow) {
+    RecentWindow window(2);
+    window.push(1);
+    window.push(2);
+    window.forget(1);
+    EXPECT_EQ(window.size(), 1u);
+
+    // Id 1 reused by a new song: evicting older entries must not clear it
+    window.push(1);
+    window.push(3);
+    EXPECT_TRUE(window.contains(1));
+    EXPECT_TRUE(window.contains(3));
+    EXPECT_FALSE(window.contains(2));
+
+    window.push(4);
+    window.resize(1);
+    EXPECT_EQ(window.size(), 1u);
+    EXPECT_TRUE(window.contains(4));
+    EXPECT_FALSE(window.contains(3));
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include "../src/status_display.cpp"
+#include <fcntl.h>
+#include <thread>
+
+using namespace nigamp;
+
+namespace {
+
+StatusSnapshot playing(const std::string& title, double remaining) {
+    StatusSnapshot snapshot;
+    snapshot.active = true;
+    snapshot.title = title;
+    snapshot.remaining = remaining;
+    snapshot.total = 200.0;
+    return snapshot;
+}
+
+std::string drain(int fd) {
+    std::string data;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+        data.append(buffer, static_cast<size_t>(n));
+    }
+    return data;
+}
+
+}
+
+TEST(StatusDisplayTest, FormatsStatusLine) {
+    EXPECT_EQ(format_time(125.9), "02:05");
+    EXPECT_EQ(format_status_line(playing("Song", 65.0)), "🎵 Song - Time remaining: 01:05 / 03:20");
+
+    StatusSnapshot preview = playing("Clip", 9.5);
+    preview.preview = true;
+    preview.total = 10.0;
+    EXPECT_EQ(format_status_line(preview), "🎵 [PREVIEW] Clip - Time remaining: 00:09 / 00:10");
+}
+
+TEST(StatusDisplayTest, RedrawsOnlyWhenTheLineChanges) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    StatusRenderer renderer(fds[1], std::chrono::milliseconds(5));
+    renderer.start();
+    renderer.update(playing("Song", 65.0));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(drain(fds[0]), "\r🎵 Song - Time remaining: 01:05 / 03:20");
+
+    // Same second, same line: nothing to write
+    renderer.update(playing("Song", 65.4));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(drain(fds[0]), "");
+
+    // A shorter line is padded over the old one on a non-terminal
+    renderer.update(playing("S", 64.0));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(drain(fds[0]), "\r🎵 S - Time remaining: 01:04 / 03:20   ");
+
+    renderer.stop();
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(StatusDisplayTest, FullOutputNeverBlocks) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+
+    // Fill the pipe, then hand the renderer a blocking descriptor like a stalled terminal
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    std::string chunk(4096, 'x');
+    while (write(fds[1], chunk.data(), chunk.size()) > 0) {
+    }
+    fcntl(fds[1], F_SETFL, 0);
+
+    StatusRenderer renderer(fds[1], std::chrono::milliseconds(5));
+    renderer.start();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 1000; ++i) {
+        renderer.update(playing("Song", 100.0 - i * 0.1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    renderer.stop();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+
+    // Once the terminal drains, the latest line is drawn
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    drain(fds[0]);
+    renderer.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    renderer.stop();
+    std::string output = drain(fds[0]);
+    EXPECT_NE(output.find("00:00 / 03:20"), std::string::npos) << output;
+
+    close(fds[0]);
+    close(fds[1]);
+}
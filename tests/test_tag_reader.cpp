@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include "../src/tag_reader.cpp"
+#include "test_data.hpp"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+
+using namespace nigamp;
+
+namespace {
+
+// MPEG-1 Layer III, 128 kbps, 44.1 kHz stereo, no padding: 417 bytes per frame
+constexpr size_t FRAME_BYTES = 417;
+
+std::string mpeg_frames(size_t count) {
+    std::string frame(FRAME_BYTES, '\0');
+    frame[0] = static_cast<char>(0xFF);
+    frame[1] = static_cast<char>(0xFB);
+    frame[2] = static_cast<char>(0x90);
+    std::string out;
+    for (size_t i = 0; i < count; ++i) {
+        out += frame;
+    }
+    return out;
+}
+
+std::string be32_bytes(uint32_t value) {
+    return {static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+            static_cast<char>(value >> 8), static_cast<char>(value)};
+}
+
+std::string le32_bytes(uint32_t value) {
+    return {static_cast<char>(value), static_cast<char>(value >> 8),
+            static_cast<char>(value >> 16), static_cast<char>(value >> 24)};
+}
+
+std::string id3v23_frame(const std::string& id, const std::string& payload) {
+    return id + be32_bytes(static_cast<uint32_t>(payload.size())) + std::string(2, '\0') + payload;
+}
+
+std::string id3v2_tag(const std::string& frames, size_t padding) {
+    uint32_t size = static_cast<uint32_t>(frames.size() + padding);
+    std::string header = "ID3";
+    header += '\x03';
+    header += '\0';
+    header += '\0';
+    header += static_cast<char>((size >> 21) & 0x7F);
+    header += static_cast<char>((size >> 14) & 0x7F);
+    header += static_cast<char>((size >> 7) & 0x7F);
+    header += static_cast<char>(size & 0x7F);
+    return header + frames + std::string(padding, '\0');
+}
+
+std::string fixed_field(const std::string& text, size_t width) {
+    std::string field = text;
+    field.resize(width, '\0');
+    return field;
+}
+
+class TagReaderTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        for (const auto& path : paths) {
+            std::filesystem::remove(path);
+        }
+    }
+
+    std::string write(const std::string& name, const std::string& contents) {
+        std::string path = (std::filesystem::temp_directory_path() / name).string();
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << contents;
+        paths.push_back(path);
+        return path;
+    }
+
+    static Song untagged(const std::string& path) {
+        Song song;
+        song.file_path = path;
+        song.title = "from filename";
+        song.artist = "Unknown Artist";
+        return song;
+    }
+
+    std::vector<std::string> paths;
+};
+
+}
+
+TEST_F(TagReaderTest, Id3v2TextFramesAndConstantBitrateLength) {
+    // UTF-16 title with a BOM, Latin-1 artist with an e-acute
+    std::string title = std::string("\x01\xFF\xFE", 3) + std::string("T\0u\0n\0e\0", 8);
+    std::string artist = std::string("\x00", 1) + "Beyonc\xE9";
+    std::string tag = id3v2_tag(id3v23_frame("TIT2", title) + id3v23_frame("TPE1", artist), 64);
+    std::string path = write("nigamp_tags_v2.mp3", tag + mpeg_frames(100));
+
+    Song song = untagged(path);
+    ASSERT_TRUE(read_song_tags(path, song));
+    EXPECT_EQ(song.title, "Tune");
+    EXPECT_EQ(song.artist, "Beyonc\xC3\xA9");
+    EXPECT_NEAR(song.duration, 100.0 * FRAME_BYTES * 8 / 128000, 0.001);
+}
+
+TEST_F(TagReaderTest, XingFrameCountAndId3v1Fallback) {
+    std::string audio = mpeg_frames(10);
+    // Xing header after the 32 bytes of stereo side info: frame count present
+    audio.replace(4 + 32, 12, "Xing" + be32_bytes(0x01) + be32_bytes(1000));
+    std::string v1 = "TAG" + fixed_field("Old Title", 30) + fixed_field("Old Artist   ", 30) +
+                     std::string(ID3V1_SIZE - 63, '\0');
+    std::string path = write("nigamp_tags_v1.mp3", audio + v1);
+
+    Song song = untagged(path);
+    ASSERT_TRUE(read_song_tags(path, song));
+    EXPECT_EQ(song.title, "Old Title");
+    EXPECT_EQ(song.artist, "Old Artist");
+    EXPECT_NEAR(song.duration, 1000.0 * 1152 / 44100, 0.001);
+}
+
+TEST_F(TagReaderTest, WavInfoChunkAfterData) {
+    // 8 kHz mono 16-bit: 16000 bytes a second
+    std::string fmt = "fmt " + le32_bytes(16) + std::string("\x01\x00\x01\x00", 4) + le32_bytes(8000) +
+                      le32_bytes(16000) + std::string("\x02\x00\x10\x00", 4);
+    std::string data = "data" + le32_bytes(48000) + std::string(48000, '\0');
+    std::string info = "INFO" + std::string("INAM") + le32_bytes(5) + std::string("Song\0\0", 6) +
+                       "IART" + le32_bytes(4) + "Band";
+    std::string list = "LIST" + le32_bytes(static_cast<uint32_t>(info.size())) + info;
+    std::string body = "WAVE" + fmt + data + list;
+    std::string path = write("nigamp_tags.wav", "RIFF" + le32_bytes(static_cast<uint32_t>(body.size())) + body);
+
+    Song song = untagged(path);
+    ASSERT_TRUE(read_song_tags(path, song));
+    EXPECT_EQ(song.title, "Song");
+    EXPECT_EQ(song.artist, "Band");
+    EXPECT_DOUBLE_EQ(song.duration, 3.0);
+}
+
+TEST_F(TagReaderTest, UnknownFilesAreLeftAlone) {
+    std::string path = write("nigamp_tags_text.mp3", std::string(4096, 'x'));
+    Song song = untagged(path);
+    EXPECT_FALSE(read_song_tags(path, song));
+    EXPECT_FALSE(read_song_tags(path + ".missing", song));
+    EXPECT_EQ(song.title, "from filename");
+    EXPECT_EQ(song.artist, "Unknown Artist");
+    EXPECT_EQ(song.duration, 0.0);
+}
+
+TEST_F(TagReaderTest, ReadsRealFileTags) {
+    Song song = untagged(test_data_path("test1.mp3"));
+    ASSERT_TRUE(read_song_tags(song.file_path, song));
+    EXPECT_EQ(song.title, "Numb Encore");
+    EXPECT_EQ(song.artist, "Jay-Z & Linkin Park");
+    EXPECT_NEAR(song.duration, 10.0, 0.2);
+}
+
+TEST_F(TagReaderTest, PoolBoundsOutstandingReads) {
+    std::string tag = id3v2_tag(id3v23_frame("TIT2", std::string("\x00", 1) + "Pooled"), 0);
+    std::string path = write("nigamp_tags_pool.mp3", tag + mpeg_frames(4));
+
+    std::atomic<int> done{0};
+    std::atomic<int> tagged{0};
+    {
+        TagReader reader(4, 2);
+        for (int i = 0; i < 200; ++i) {
+            reader.request(untagged(path), [&](Song song) {
+                tagged += song.title == "Pooled" ? 1 : 0;
+                ++done;
+            });
+            // Everything not yet called back is still outstanding
+            EXPECT_LE(i + 1 - done.load(), 2);
+        }
+        reader.wait();
+        EXPECT_EQ(done.load(), 200);
+    }
+    EXPECT_EQ(tagged.load(), 200);
+}
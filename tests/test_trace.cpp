@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+// The recorder is always exercised here, whether or not the build enables tracing
+#ifndef NIGAMP_TRACING
+#define NIGAMP_TRACING
+#endif
+#include "../src/trace.cpp"
+#include <filesystem>
+#include <iterator>
+#include <thread>
+
+using namespace nigamp;
+
+class TraceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        output = (std::filesystem::temp_directory_path() / "nigamp_trace_test.json").string();
+        trace_clear();
+        trace_enable(true);
+    }
+
+    void TearDown() override {
+        trace_enable(false);
+        trace_clear();
+        std::filesystem::remove(output);
+    }
+
+    std::string read_trace() {
+        EXPECT_TRUE(write_chrome_trace(output));
+        std::ifstream file(output);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+    static size_t count(const std::string& text, const std::string& needle) {
+        size_t found = 0;
+        for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) {
+            ++found;
+        }
+        return found;
+    }
+
+    std::string output;
+};
+
+TEST_F(TraceTest, ExportsSpansFromEveryThread) {
+    {
+        TRACE_SCOPE("outer");
+        TRACE_SCOPE("inner");
+    }
+    std::thread worker([]() {
+        TRACE_THREAD_NAME("worker");
+        TRACE_SCOPE("on \"worker\"");
+    });
+    worker.join();
+
+    std::string json = read_trace();
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0u);
+    EXPECT_EQ(count(json, "\"name\":\"outer\",\"ph\":\"X\""), 1u);
+    EXPECT_EQ(count(json, "\"name\":\"inner\",\"ph\":\"X\""), 1u);
+    EXPECT_EQ(count(json, "\"name\":\"on \\\"worker\\\"\""), 1u);
+    EXPECT_EQ(count(json, "\"args\":{\"name\":\"worker\"}"), 1u);
+}
+
+TEST_F(TraceTest, DisabledSpansAreNotRecorded) {
+    trace_enable(false);
+    {
+        TRACE_SCOPE("hidden");
+    }
+    trace_enable(true);
+    EXPECT_EQ(count(read_trace(), "hidden"), 0u);
+}
+
+TEST_F(TraceTest, FullRingKeepsNewestSpans) {
+    std::thread writer([]() {
+        for (size_t i = 0; i < TraceRing::CAPACITY + 100; ++i) {
+            TRACE_SCOPE("span");
+        }
+    });
+    writer.join();
+    // The slot the writer would fill next is never trusted, so one fewer than the ring holds
+    EXPECT_EQ(count(read_trace(), "\"name\":\"span\""), TraceRing::CAPACITY - 1);
+}
+
+TEST_F(TraceTest, SpanCostStaysSmall) {
+    constexpr int64_t SPAN_BUDGET_NS = 50;
+    // Slack over the bare clock reads for the ring store and timing noise
+    constexpr int64_t CLOCK_MARGIN_NS = 15;
+    constexpr int ROUNDS = 20;
+    constexpr int ITERATIONS = 10000;
+    auto elapsed_since = [&](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start) / ITERATIONS;
+    };
+    // Spans and bare clock reads alternate, and the best round of each counts,
+    // so frequency changes and preemption hit both sides alike
+    volatile uint64_t sink = 0;
+    auto per_span = std::chrono::nanoseconds::max();
+    auto per_clock_pair = std::chrono::nanoseconds::max();
+    for (int round = 0; round < ROUNDS; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; ++i) {
+            TRACE_SCOPE("cost");
+        }
+        per_span = std::min(per_span, elapsed_since(start));
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; ++i) {
+            uint64_t begin = trace_ticks();
+            sink = trace_ticks() - begin;
+        }
+        per_clock_pair = std::min(per_clock_pair, elapsed_since(start));
+    }
+    std::cout << "Recorded span: " << per_span.count() << " ns, two clock reads: "
+              << per_clock_pair.count() << " ns\n";
+#ifdef __OPTIMIZE__
+    // A span is two clock reads and a store. Where the clock alone is slower than
+    // the budget (a virtualized TSC), hold the rest of the span to a small margin.
+    EXPECT_LE(per_span.count(), std::max(SPAN_BUDGET_NS, per_clock_pair.count() + CLOCK_MARGIN_NS));
+#else
+    // Unoptimized spans keep their out-of-line helpers; only catch gross regressions
+    EXPECT_LT(per_span.count(), 20 * SPAN_BUDGET_NS);
+#endif
+}
+
+TEST_F(TraceTest, UnwritablePathFails) {
+    EXPECT_FALSE(write_chrome_trace("/nonexistent_dir/trace.json"));
+}